@@ -83,6 +83,13 @@ public:
 	uint8_t reg_value( int, int );
 	int     envx_value( int );
 
+// Tables (shared with exotracker's sample-granular S-DSP, audio/synth/soa_dsp.h)
+
+	static uint8_t const initial_regs [register_count];
+	static short const gauss [512];
+	static unsigned const counter_rates [32];
+	static unsigned const counter_offsets [32];
+
 // DSP register addresses
 
 	// Global registers
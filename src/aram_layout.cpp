@@ -0,0 +1,666 @@
+#include "aram_layout.h"
+#include "spc_export/driver.h"
+#include "util/release_assert.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>  // std::copy, std::equal, std::sort, std::min, std::max
+#include <cstring>  // memmove
+#include <tuple>  // std::tie
+
+namespace aram_layout {
+
+using doc::sample::Sample;
+
+bool is_loadable(Sample const& smp) {
+    // Every sample must have a positive length.
+    // If the loop point lies past the end, the S-DSP would loop to garbage.
+    return !smp.brr.empty() && smp.loop_byte < smp.brr.size();
+}
+
+LayoutConfig playback_config() {
+    namespace driver = spc_export::driver;
+
+    // Tracker playback emulates the driver in C++, so the driver's code is never
+    // loaded into ARAM. But leave room for it anyway, so a song whose samples
+    // overflow ARAM in an exported .spc also fails to play in the tracker.
+    auto const driver_end = uint32_t(driver::driverPos + driver::driver.size());
+    return LayoutConfig {
+        .dir_begin = (driver_end + 0xFF) & ~0xFFu,
+        // TODO reserve the echo buffer once documents have echo settings.
+        .reserved = {},
+        .dir_slot_align = 8,
+    };
+}
+
+AramLayout::AramLayout(LayoutConfig cfg)
+    : _cfg(std::move(cfg))
+{
+    release_assert(_cfg.dir_begin % 0x100 == 0);
+    release_assert(_cfg.dir_begin < ARAM_SIZE);
+    release_assert(_cfg.dir_slot_align >= 1);
+
+    std::sort(_cfg.reserved.begin(), _cfg.reserved.end(),
+        [](Range const& a, Range const& b) {
+            return a.begin < b.begin;
+        });
+    uint32_t prev_end = _cfg.dir_begin;
+    for (Range const& r : _cfg.reserved) {
+        release_assert(prev_end <= r.begin);
+        release_assert(r.begin <= r.end);
+        release_assert(r.end <= ARAM_SIZE);
+        prev_end = r.end;
+    }
+}
+
+uint32_t AramLayout::max_nslot() const {
+    // The directory may not overlap reserved regions or run past the end of ARAM.
+    uint32_t limit = ARAM_SIZE;
+    if (!_cfg.reserved.empty()) {
+        limit = _cfg.reserved.front().begin;
+    }
+    return std::min(
+        (limit - _cfg.dir_begin) / SAMPLE_DIR_ENTRY_SIZE, (uint32_t) MAX_SAMPLES
+    );
+}
+
+gsl::span<AramLayout::Occupied const> AramLayout::occupied() const {
+    auto & out = _occupied;
+    size_t n = 0;
+
+    for (Range const& r : _cfg.reserved) {
+        out[n++] = Occupied{r, {}};
+    }
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        if (auto const& ext = _samples[i]) {
+            out[n++] = Occupied{Range{ext->begin, ext->end()}, i};
+        }
+    }
+    // Use std::sort() since std::stable_sort() may allocate memory. Reserved regions
+    // have no sample_idx, so they sort before samples at the same address,
+    // and samples are ordered by index.
+    auto const end = out.begin() + (ptrdiff_t) n;
+    std::sort(out.begin(), end, [](Occupied const& a, Occupied const& b) {
+        return std::tie(a.range.begin, a.sample_idx)
+            < std::tie(b.range.begin, b.sample_idx);
+    });
+
+    // Samples sharing data have identical ranges. Keep the lowest index.
+    auto last = std::unique(out.begin(), end,
+        [](Occupied const& a, Occupied const& b) {
+            return a.sample_idx && b.sample_idx && a.range == b.range;
+        });
+    return {out.data(), (size_t) (last - out.begin())};
+}
+
+uint32_t AramLayout::bytes_free() const {
+    uint32_t used = dir_end();
+    for (Occupied const& occ : occupied()) {
+        used += occ.range.size();
+    }
+    return ARAM_SIZE - std::min(used, ARAM_SIZE);
+}
+
+std::optional<uint32_t> AramLayout::best_fit(uint32_t size) const {
+    std::optional<uint32_t> best;
+    uint32_t best_size = 0;
+
+    auto try_hole = [&](uint32_t begin, uint32_t end) {
+        if (end < begin + size) {
+            return;
+        }
+        uint32_t hole_size = end - begin;
+        if (!best || hole_size < best_size) {
+            best = begin;
+            best_size = hole_size;
+        }
+    };
+
+    uint32_t cursor = dir_end();
+    for (Occupied const& occ : occupied()) {
+        try_hole(cursor, occ.range.begin);
+        cursor = std::max(cursor, occ.range.end);
+    }
+    try_hole(cursor, ARAM_SIZE);
+
+    return best;
+}
+
+void AramLayout::compact(uint8_t * ram_64k, SampleSet & moved) {
+    uint32_t cursor = dir_end();
+    for (Occupied const& occ : occupied()) {
+        if (!occ.sample_idx) {
+            // Samples are never moved past reserved regions.
+            cursor = std::max(cursor, occ.range.end);
+            continue;
+        }
+
+        uint32_t const old_begin = occ.range.begin;
+        uint32_t const size = occ.range.size();
+
+        // Samples only move towards lower addresses, and never past each other,
+        // so memmove won't overwrite samples before they're moved.
+        release_assert(cursor <= old_begin);
+        if (cursor != old_begin) {
+            memmove(ram_64k + cursor, ram_64k + old_begin, size);
+            for (size_t i = 0; i < MAX_SAMPLES; i++) {
+                auto & ext = _samples[i];
+                if (ext && ext->begin == old_begin) {
+                    ext->begin = cursor;
+                    moved.set(i);
+                }
+            }
+        }
+        cursor += size;
+    }
+}
+
+std::optional<size_t> AramLayout::find_identical(
+    doc::sample::Samples const& samples, size_t sample_idx
+) const {
+    auto const& brr = samples[sample_idx]->brr;
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        if (i == sample_idx || !_samples[i]) {
+            continue;
+        }
+        // Every loaded sample's data in ARAM matches the document.
+        auto const& other = samples[i]->brr;
+        if (other.size() == brr.size()
+            && std::equal(brr.begin(), brr.end(), other.begin()))
+        {
+            return i;
+        }
+    }
+    return {};
+}
+
+bool AramLayout::is_shared(size_t sample_idx) const {
+    auto const begin = _samples[sample_idx]->begin;
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        if (i != sample_idx && _samples[i] && _samples[i]->begin == begin) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SampleSet AramLayout::update(
+    doc::sample::Samples const& samples, uint8_t * ram_64k, SampleSet const& edited
+) {
+    SampleSet moved;
+
+    // The directory only needs entries up to the last sample present.
+    // Optionally round up, so adding a sample rarely grows the directory
+    // into sample data.
+    uint32_t nslot = 0;
+    for (size_t i = MAX_SAMPLES; i--; ) {
+        if (samples[i]) {
+            nslot = uint32_t(i + 1);
+            break;
+        }
+    }
+    uint32_t const align = _cfg.dir_slot_align;
+    nslot = std::min((nslot + align - 1) / align * align, max_nslot());
+    _nslot = nslot;
+    uint32_t const new_dir_end = dir_end();
+
+    /// Samples which were loaded, but must be moved out of the directory's way.
+    SampleSet displaced;
+
+    // Unload samples which were removed, resized, or overlap the grown directory.
+    // Samples whose size is unchanged are rewritten in place,
+    // unless other samples still use the old data.
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        auto & ext = _samples[i];
+        if (!ext) {
+            continue;
+        }
+
+        auto const& smp = samples[i];
+        if (i >= nslot || !smp || !is_loadable(*smp) || smp->brr.size() != ext->size) {
+            ext = {};
+            moved.set(i);
+            continue;
+        }
+        if (ext->begin < new_dir_end) {
+            ext = {};
+            moved.set(i);
+            displaced.set(i);
+            continue;
+        }
+
+        uint8_t * data = ram_64k + ext->begin;
+        if (edited[i] && !std::equal(smp->brr.begin(), smp->brr.end(), data)) {
+            moved.set(i);
+            if (is_shared(i)) {
+                ext = {};
+                continue;
+            }
+            std::copy(smp->brr.begin(), smp->brr.end(), data);
+        }
+        ext->loop_byte = smp->loop_byte;
+    }
+
+    // Reload displaced samples first, so they aren't pushed out of ARAM
+    // by new samples. Then load new samples, largest first,
+    // since small samples fit in more holes.
+    std::array<size_t, MAX_SAMPLES> pending;
+    size_t npending = 0;
+    for (size_t i = 0; i < nslot; i++) {
+        if (samples[i] && !_samples[i] && is_loadable(*samples[i])) {
+            pending[npending++] = i;
+        }
+    }
+    // std::stable_sort() may allocate memory, so break ties by sample index instead.
+    std::sort(pending.begin(), pending.begin() + (ptrdiff_t) npending,
+        [&samples, &displaced](size_t a, size_t b) {
+            if (displaced[a] != displaced[b]) {
+                return displaced[a] > displaced[b];
+            }
+            auto const a_size = samples[a]->brr.size();
+            auto const b_size = samples[b]->brr.size();
+            if (a_size != b_size) {
+                return a_size > b_size;
+            }
+            return a < b;
+        });
+
+    bool compacted = false;
+    for (size_t p = 0; p < npending; p++) {
+        size_t const i = pending[p];
+        auto const& smp = *samples[i];
+        if (smp.brr.size() > ARAM_SIZE) {
+            continue;
+        }
+        auto const size = (uint32_t) smp.brr.size();
+
+        // Samples with identical data share the same ARAM.
+        if (auto other = find_identical(samples, i)) {
+            _samples[i] = SampleExtent {
+                .begin = _samples[*other]->begin,
+                .size = size,
+                .loop_byte = smp.loop_byte,
+            };
+            continue;
+        }
+
+        auto addr = best_fit(size);
+        if (!addr && !compacted && size <= bytes_free()) {
+            // ARAM is too fragmented. Only move other samples when necessary.
+            compact(ram_64k, moved);
+            compacted = true;
+            addr = best_fit(size);
+        }
+        if (!addr) {
+            // Sample data overflow. Continue trying to load later samples,
+            // hopefully they're smaller and fit in the remaining space.
+            continue;
+        }
+
+        std::copy(smp.brr.begin(), smp.brr.end(), ram_64k + *addr);
+        _samples[i] = SampleExtent {
+            .begin = *addr,
+            .size = size,
+            .loop_byte = smp.loop_byte,
+        };
+    }
+
+    _not_loaded.reset();
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        if (samples[i] && !_samples[i]) {
+            _not_loaded.set(i);
+        }
+    }
+
+    // Write the sample directory.
+    for (size_t i = 0; i < nslot; i++) {
+        uint32_t start = 0;
+        uint32_t loop = 0;
+        if (auto const& ext = _samples[i]) {
+            start = ext->begin;
+            loop = ext->begin + ext->loop_byte;
+        }
+
+        uint8_t * entry = ram_64k + _cfg.dir_begin + i * SAMPLE_DIR_ENTRY_SIZE;
+        entry[0] = (uint8_t) start;
+        entry[1] = (uint8_t) (start >> 8);
+        entry[2] = (uint8_t) loop;
+        entry[3] = (uint8_t) (loop >> 8);
+    }
+
+    return moved;
+}
+
+AramUsage AramLayout::usage() const {
+    AramUsage out;
+
+    auto push = [&out](RegionKind kind, Range range, SampleSet samples = {}) {
+        if (range.size() == 0) {
+            return;
+        }
+        out.regions.push_back(UsageRegion{kind, range, samples});
+        switch (kind) {
+        case RegionKind::Reserved:
+            out.reserved_bytes += range.size();
+            break;
+        case RegionKind::SampleDir:
+            out.dir_bytes += range.size();
+            break;
+        case RegionKind::Sample:
+            out.sample_bytes += range.size();
+            break;
+        case RegionKind::Free:
+            out.free_bytes += range.size();
+            out.largest_free_block = std::max(out.largest_free_block, range.size());
+            break;
+        }
+    };
+
+    push(RegionKind::Reserved, Range{0, _cfg.dir_begin});
+    push(RegionKind::SampleDir, Range{_cfg.dir_begin, dir_end()});
+
+    uint32_t cursor = dir_end();
+    for (Occupied const& occ : occupied()) {
+        push(RegionKind::Free, Range{cursor, occ.range.begin});
+        if (occ.sample_idx) {
+            SampleSet samples;
+            for (size_t i = 0; i < MAX_SAMPLES; i++) {
+                if (_samples[i] && _samples[i]->begin == occ.range.begin) {
+                    samples.set(i);
+                }
+            }
+            push(RegionKind::Sample, occ.range, samples);
+        } else {
+            push(RegionKind::Reserved, occ.range);
+        }
+        cursor = occ.range.end;
+    }
+    push(RegionKind::Free, Range{cursor, ARAM_SIZE});
+
+    out.not_loaded = _not_loaded;
+    return out;
+}
+
+std::string format_usage(AramUsage const& usage) {
+    size_t nsample = 0;
+    size_t nshared = 0;
+    for (auto const& region : usage.regions) {
+        if (region.kind == RegionKind::Sample) {
+            nsample += region.samples.count();
+            nshared += region.samples.count() - 1;
+        }
+    }
+
+    std::string out;
+    auto row = [&out](char const* name, uint32_t bytes, std::string const& note) {
+        out += fmt::format("{:<22} {:>6} bytes{}\n", name, bytes, note);
+    };
+    row("driver and song data", usage.reserved_bytes, "");
+    row("sample directory", usage.dir_bytes, "");
+    row("samples", usage.sample_bytes,
+        fmt::format(" ({} samples, {} deduplicated)", nsample, nshared));
+    row("free", usage.free_bytes,
+        fmt::format(" (largest block {} bytes)", usage.largest_free_block));
+    if (usage.not_loaded.any()) {
+        out += fmt::format("{} samples not loaded\n", usage.not_loaded.count());
+    }
+    return out;
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+namespace aram_layout {
+
+using doc::sample::Samples;
+
+/// Matches the old fixed playback layout, so addresses in tests are easy to read.
+static LayoutConfig test_config() {
+    return LayoutConfig {
+        .dir_begin = 0x100,
+        .dir_slot_align = 8,
+    };
+}
+
+static Sample make_sample(size_t nblock, uint8_t fill, uint16_t loop_byte = 0) {
+    return Sample {
+        .name = "",
+        .brr = std::vector<uint8_t>(nblock * doc::sample::BRR_BLOCK_SIZE, fill),
+        .loop_byte = loop_byte,
+        .tuning = {.sample_rate = 32000, .root_key = 60},
+    };
+}
+
+static uint16_t dir_entry(
+    AramLayout const& aram, std::vector<uint8_t> const& ram, size_t i, size_t word
+) {
+    size_t addr = aram.dir_begin() + i * SAMPLE_DIR_ENTRY_SIZE + word * 2;
+    return uint16_t(ram[addr] | ram[addr + 1] << 8);
+}
+
+TEST_CASE("AramLayout only rewrites edited samples") {
+    std::vector<uint8_t> ram(ARAM_SIZE);
+    Samples samples;
+    samples[0] = make_sample(10, 0x10);
+    samples[1] = make_sample(20, 0x11);
+    samples[2] = make_sample(30, 0x12);
+
+    AramLayout aram{test_config()};
+    CHECK(aram.update(samples, ram.data()).none());
+    for (size_t i = 0; i < 3; i++) {
+        REQUIRE(aram.is_loaded(i));
+        auto ext = *aram.extent(i);
+        CHECK(dir_entry(aram, ram, i, 0) == ext.begin);
+        CHECK(ram[ext.begin] == 0x10 + i);
+        CHECK(ext.begin >= aram.dir_end());
+    }
+    auto const ext1 = *aram.extent(1);
+
+    SUBCASE("Changing a loop point only rewrites the directory") {
+        samples[1]->loop_byte = 9;
+        CHECK(aram.update(samples, ram.data()).none());
+        CHECK(aram.extent(1)->begin == ext1.begin);
+        CHECK(dir_entry(aram, ram, 1, 1) == ext1.begin + 9);
+    }
+
+    SUBCASE("Changing sample data in place only affects that sample") {
+        samples[1] = make_sample(20, 0x21);
+        auto moved = aram.update(samples, ram.data());
+        CHECK(moved.count() == 1);
+        CHECK(moved[1]);
+        CHECK(aram.extent(1)->begin == ext1.begin);
+        CHECK(ram[ext1.begin] == 0x21);
+    }
+
+    SUBCASE("Only edited samples are compared against ARAM") {
+        samples[1] = make_sample(20, 0x21);
+        // Not in `edited`, so assumed unchanged.
+        samples[2] = make_sample(30, 0x22);
+        auto moved = aram.update(samples, ram.data(), SampleSet{}.set(1));
+        CHECK(moved.count() == 1);
+        CHECK(moved[1]);
+        CHECK(ram[ext1.begin] == 0x21);
+        CHECK(ram[aram.extent(2)->begin] == 0x12);
+    }
+
+    SUBCASE("Removing a sample frees its space for a new sample") {
+        uint32_t free = aram.bytes_free();
+        samples[1] = {};
+        auto moved = aram.update(samples, ram.data());
+        CHECK(moved.count() == 1);
+        CHECK(!aram.is_loaded(1));
+        CHECK(dir_entry(aram, ram, 1, 0) == 0);
+        CHECK(aram.bytes_free() == free + ext1.size);
+
+        // A smaller sample fits in the hole (best fit).
+        samples[1] = make_sample(5, 0x31);
+        CHECK(aram.update(samples, ram.data()).none());
+        CHECK(aram.extent(1)->begin == ext1.begin);
+    }
+
+    SUBCASE("Adding a sample rarely grows the directory") {
+        samples[3] = make_sample(1, 0x13);
+        auto moved = aram.update(samples, ram.data());
+        CHECK(moved.none());
+        CHECK(aram.is_loaded(3));
+    }
+
+    SUBCASE("Growing the directory moves samples out of the way") {
+        samples[200] = make_sample(1, 0x40);
+        auto moved = aram.update(samples, ram.data());
+        CHECK(aram.is_loaded(200));
+        for (size_t i = 0; i <= 2; i++) {
+            REQUIRE(aram.is_loaded(i));
+            CHECK(aram.extent(i)->begin >= aram.dir_end());
+            CHECK(ram[aram.extent(i)->begin] == 0x10 + i);
+        }
+        CHECK(moved[0]);
+        CHECK(!moved[200]);
+    }
+}
+
+TEST_CASE("AramLayout compacts ARAM only when fragmented") {
+    std::vector<uint8_t> ram(ARAM_SIZE);
+    Samples samples;
+
+    // Fill ARAM with 4 samples of 0x3800 bytes, leaving little room.
+    constexpr size_t NBLOCK = 0x3800 / 9;
+    for (size_t i = 0; i < 4; i++) {
+        samples[i] = make_sample(NBLOCK, uint8_t(i + 1));
+    }
+    AramLayout aram{test_config()};
+    CHECK(aram.update(samples, ram.data()).none());
+    for (size_t i = 0; i < 4; i++) {
+        CHECK(aram.is_loaded(i));
+    }
+
+    // Remove samples 0 and 2, leaving two holes.
+    samples[0] = {};
+    samples[2] = {};
+    aram.update(samples, ram.data());
+
+    // A sample larger than each hole, but smaller than their sum,
+    // forces the remaining samples to move.
+    samples[4] = make_sample(NBLOCK * 3 / 2, 0x55);
+    auto moved = aram.update(samples, ram.data());
+    REQUIRE(aram.is_loaded(4));
+    CHECK((moved[1] || moved[3]));
+    CHECK(ram[aram.extent(1)->begin] == 2);
+    CHECK(ram[aram.extent(3)->begin] == 4);
+    CHECK(ram[aram.extent(4)->begin] == 0x55);
+
+    // A sample larger than the remaining space is not loaded.
+    samples[5] = make_sample(NBLOCK * 2, 0x66);
+    aram.update(samples, ram.data());
+    CHECK(!aram.is_loaded(5));
+    CHECK(aram.is_loaded(1));
+    CHECK(aram.is_loaded(3));
+    CHECK(aram.is_loaded(4));
+}
+
+
+TEST_CASE("AramLayout shares identical samples") {
+    std::vector<uint8_t> ram(ARAM_SIZE);
+    Samples samples;
+    samples[0] = make_sample(10, 0x10);
+    samples[1] = make_sample(10, 0x10, 9);
+    samples[2] = make_sample(10, 0x12);
+
+    AramLayout aram{test_config()};
+    CHECK(aram.update(samples, ram.data()).none());
+    REQUIRE(aram.is_loaded(1));
+    CHECK(aram.extent(0)->begin == aram.extent(1)->begin);
+    CHECK(aram.extent(0)->begin != aram.extent(2)->begin);
+    // Shared samples keep separate loop points.
+    CHECK(dir_entry(aram, ram, 0, 1) == aram.extent(0)->begin);
+    CHECK(dir_entry(aram, ram, 1, 1) == aram.extent(1)->begin + 9);
+
+    uint32_t const free = aram.bytes_free();
+    uint32_t const shared_begin = aram.extent(0)->begin;
+
+    SUBCASE("Editing a shared sample does not modify the other sample") {
+        samples[1] = make_sample(10, 0x21);
+        auto moved = aram.update(samples, ram.data());
+        CHECK(moved.count() == 1);
+        CHECK(moved[1]);
+        CHECK(aram.extent(0)->begin == shared_begin);
+        CHECK(ram[shared_begin] == 0x10);
+        CHECK(ram[aram.extent(1)->begin] == 0x21);
+        CHECK(aram.bytes_free() == free - 90);
+    }
+
+    SUBCASE("Removing one copy keeps the data loaded") {
+        samples[0] = {};
+        auto moved = aram.update(samples, ram.data());
+        CHECK(moved.count() == 1);
+        CHECK(moved[0]);
+        CHECK(aram.extent(1)->begin == shared_begin);
+        CHECK(aram.bytes_free() == free);
+    }
+
+    auto usage = aram.usage();
+    uint32_t covered = 0;
+    for (auto const& region : usage.regions) {
+        CHECK(region.range.begin == covered);
+        covered = region.range.end;
+    }
+    CHECK(covered == ARAM_SIZE);
+}
+
+TEST_CASE("AramLayout avoids reserved regions and reports usage") {
+    std::vector<uint8_t> ram(ARAM_SIZE);
+    Samples samples;
+
+    // Reserve the top half of ARAM (like an echo buffer).
+    auto cfg = test_config();
+    cfg.reserved.push_back(Range{0x8000, ARAM_SIZE});
+    AramLayout aram{cfg};
+
+    constexpr size_t NBLOCK = 0x3000 / 9;
+    samples[0] = make_sample(NBLOCK, 0x10);
+    samples[1] = make_sample(NBLOCK, 0x11);
+    samples[2] = make_sample(NBLOCK, 0x12);
+    aram.update(samples, ram.data());
+
+    CHECK(aram.is_loaded(0));
+    CHECK(aram.is_loaded(1));
+    CHECK(!aram.is_loaded(2));
+    for (size_t i = 0; i < 2; i++) {
+        CHECK(aram.extent(i)->end() <= 0x8000);
+    }
+    CHECK(ram[0x8000] == 0);
+
+    auto usage = aram.usage();
+    CHECK(usage.not_loaded.count() == 1);
+    CHECK(usage.not_loaded[2]);
+    CHECK(usage.reserved_bytes == 0x100 + 0x8000);
+    CHECK(usage.dir_bytes == 8 * SAMPLE_DIR_ENTRY_SIZE);
+    CHECK(usage.sample_bytes == 2 * NBLOCK * 9);
+    CHECK(usage.free_bytes == aram.bytes_free());
+    CHECK(usage.largest_free_block == usage.free_bytes);
+    CHECK(
+        usage.reserved_bytes + usage.dir_bytes + usage.sample_bytes + usage.free_bytes
+        == ARAM_SIZE);
+
+    REQUIRE(usage.regions.size() == 6);
+    CHECK(usage.regions[0].kind == RegionKind::Reserved);
+    CHECK(usage.regions[1].kind == RegionKind::SampleDir);
+    CHECK(usage.regions[2].kind == RegionKind::Sample);
+    CHECK(usage.regions[3].kind == RegionKind::Sample);
+    CHECK(usage.regions[4].kind == RegionKind::Free);
+    CHECK(usage.regions[5].kind == RegionKind::Reserved);
+}
+
+TEST_CASE("Playback reserves space for the driver") {
+    auto cfg = playback_config();
+    CHECK(cfg.dir_begin % 0x100 == 0);
+    CHECK(cfg.dir_begin
+        >= spc_export::driver::driverPos + spc_export::driver::driver.size());
+}
+
+}
+
+#endif
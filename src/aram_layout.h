@@ -0,0 +1,275 @@
+#pragma once
+
+/// Places samples in the SNES's 64 KB of audio RAM (ARAM).
+///
+/// Used both by tracker playback (audio/synth/spc700_driver.cpp) and SPC export
+/// (spc_export.cpp), so samples which don't fit in an exported .spc file
+/// also fail to play in the tracker.
+
+#include "doc/sample.h"
+#include "util/release_assert.h"
+
+#include <gsl/span>
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace aram_layout {
+
+using doc::sample::MAX_SAMPLES;
+
+constexpr uint32_t ARAM_SIZE = 0x1'0000;
+
+/// Each sample directory entry is:
+/// - 2 bytes (little endian) for sample start address
+/// - 2 bytes (little endian) for sample loop address
+/// We write raw bytes instead of casting to a struct pointer,
+/// due to C++ endian/alignment/strict aliasing issues.
+constexpr uint32_t SAMPLE_DIR_ENTRY_SIZE = 4;
+
+/// Half-open range of ARAM addresses.
+struct Range {
+    uint32_t begin;
+    uint32_t end;
+
+    uint32_t size() const {
+        return end - begin;
+    }
+
+    bool operator==(Range const& other) const = default;
+};
+
+/// Where a sample's BRR data lies in ARAM.
+struct SampleExtent {
+    uint32_t begin;
+    uint32_t size;
+    uint32_t loop_byte;
+
+    uint32_t end() const {
+        return begin + size;
+    }
+};
+
+/// Set of sample indexes.
+using SampleSet = std::bitset<MAX_SAMPLES>;
+
+/// Maximum number of LayoutConfig::reserved regions.
+constexpr size_t MAX_RESERVED = 4;
+
+/// Fixed-capacity list of reserved regions. Stored inline, so copying an AramLayout
+/// (eg. into audio thread checkpoints) doesn't allocate memory.
+class ReservedList {
+    std::array<Range, MAX_RESERVED> _ranges{};
+    size_t _size = 0;
+
+public:
+    ReservedList() = default;
+    ReservedList(std::initializer_list<Range> ranges) {
+        for (Range const& r : ranges) {
+            push_back(r);
+        }
+    }
+
+    void push_back(Range r) {
+        release_assert(_size < MAX_RESERVED);
+        _ranges[_size++] = r;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+    bool empty() const {
+        return _size == 0;
+    }
+    Range const& front() const {
+        return _ranges[0];
+    }
+
+    Range * begin() {
+        return _ranges.data();
+    }
+    Range * end() {
+        return _ranges.data() + _size;
+    }
+    Range const* begin() const {
+        return _ranges.data();
+    }
+    Range const* end() const {
+        return _ranges.data() + _size;
+    }
+};
+
+struct LayoutConfig {
+    /// Start of the sample directory. Must be a multiple of 0x100,
+    /// since the S-DSP's DIR register only holds the upper byte.
+    /// Addresses below this are reserved (for the driver, song data, etc.)
+    uint32_t dir_begin;
+
+    /// Other regions which may not hold samples (eg. the echo buffer).
+    /// Must lie above dir_begin. The sample directory stops growing at the first
+    /// reserved region, so samples with higher indexes will not be loaded.
+    ReservedList reserved = {};
+
+    /// The number of directory entries is rounded up to a multiple of this.
+    /// Values above 1 waste a few bytes, but reduce how often adding a sample
+    /// grows the directory into sample data.
+    uint32_t dir_slot_align = 1;
+};
+
+/// Samples which are empty, or loop past the end, are rejected instead of loaded.
+bool is_loadable(doc::sample::Sample const& smp);
+
+/// The layout used by tracker playback.
+/// Reserves the same space as SPC export does for the driver and echo buffer,
+/// but not song data (which is only compiled upon export).
+LayoutConfig playback_config();
+
+enum class RegionKind : uint8_t {
+    /// Driver code, song data, echo buffer, etc.
+    Reserved,
+    SampleDir,
+    Sample,
+    Free,
+};
+
+struct UsageRegion {
+    RegionKind kind;
+    Range range;
+
+    /// For RegionKind::Sample, the samples whose data is stored here.
+    /// (Several samples share a region if their BRR data is identical.)
+    SampleSet samples = {};
+};
+
+/// Breakdown of how ARAM is used.
+struct AramUsage {
+    /// Sorted by address, and covers all of ARAM.
+    std::vector<UsageRegion> regions;
+
+    uint32_t reserved_bytes = 0;
+    uint32_t dir_bytes = 0;
+    uint32_t sample_bytes = 0;
+    uint32_t free_bytes = 0;
+
+    /// The largest sample that can be added without moving other samples.
+    uint32_t largest_free_block = 0;
+
+    /// Samples present in the document but not loaded (because they didn't fit
+    /// or are corrupted).
+    SampleSet not_loaded = {};
+};
+
+/// Formats the totals of a usage breakdown as human-readable text,
+/// with a trailing newline.
+std::string format_usage(AramUsage const& usage);
+
+/// Keeps ARAM's sample directory and BRR data in sync with a document's samples,
+/// rewriting only the samples which changed.
+///
+/// Samples are placed in the smallest hole that fits them (best fit).
+/// Samples with byte-identical BRR data share the same ARAM.
+/// Samples which did not change are left at the same address,
+/// so voices playing them can keep playing.
+/// Existing samples are only moved (compacted towards the sample directory)
+/// when a new or resized sample does not fit in any hole.
+class AramLayout {
+    struct Occupied {
+        Range range;
+        /// Index of one sample stored here, or nullopt for reserved regions.
+        std::optional<size_t> sample_idx;
+    };
+
+    LayoutConfig _cfg;
+
+    /// [SampleIndex] Location of each sample loaded into ARAM.
+    std::array<std::optional<SampleExtent>, MAX_SAMPLES> _samples{};
+
+    /// Number of entries in the sample directory.
+    /// The directory grows when samples with higher indexes are added.
+    uint32_t _nslot = 0;
+
+    /// Samples present in the last update() call, but not loaded.
+    SampleSet _not_loaded{};
+
+    /// Scratch space filled by occupied(), so update() doesn't allocate memory
+    /// on the audio thread.
+    mutable std::array<Occupied, MAX_RESERVED + MAX_SAMPLES> _occupied{};
+
+public:
+    explicit AramLayout(LayoutConfig cfg);
+
+    /// Loads samples into ARAM (which must have ARAM_SIZE bytes),
+    /// and writes the sample directory.
+    /// Samples which don't fit (or are corrupted) are not loaded.
+    ///
+    /// Returns the set of previously loaded samples which were modified or moved
+    /// in ARAM. Voices playing these samples must be stopped, since the S-DSP
+    /// would otherwise continue reading data from the old address.
+    /// Samples whose loop point changed are not included,
+    /// since the S-DSP only reads the loop address from the directory.
+    ///
+    /// Only samples in `edited` are compared against the data in ARAM.
+    /// The data of other loaded samples must be unchanged since the last call.
+    SampleSet update(
+        doc::sample::Samples const& samples,
+        uint8_t * ram_64k,
+        SampleSet const& edited = SampleSet{}.set());
+
+    bool is_loaded(size_t sample_idx) const {
+        return _samples[sample_idx].has_value();
+    }
+
+    std::optional<SampleExtent> const& extent(size_t sample_idx) const {
+        return _samples[sample_idx];
+    }
+
+    uint32_t dir_begin() const {
+        return _cfg.dir_begin;
+    }
+
+    /// End of the sample directory. Samples are placed after this address.
+    uint32_t dir_end() const {
+        return _cfg.dir_begin + _nslot * SAMPLE_DIR_ENTRY_SIZE;
+    }
+
+    /// Total number of bytes not occupied by reserved regions,
+    /// the sample directory, or samples.
+    uint32_t bytes_free() const;
+
+    AramUsage usage() const;
+
+private:
+    /// The directory may not grow into reserved regions or past the end of ARAM.
+    uint32_t max_nslot() const;
+
+    /// Returns the sorted, non-overlapping regions which may not hold new samples
+    /// (reserved regions and loaded samples), after the sample directory.
+    /// Samples sharing data are only listed once.
+    ///
+    /// Doesn't allocate memory. The result points into _occupied,
+    /// and is overwritten by the next call.
+    gsl::span<Occupied const> occupied() const;
+
+    /// Finds the smallest free hole which fits `size` bytes.
+    std::optional<uint32_t> best_fit(uint32_t size) const;
+
+    /// Moves all loaded samples in address order towards the end of the directory
+    /// (or the previous reserved region), so free space is not fragmented.
+    void compact(uint8_t * ram_64k, SampleSet & moved);
+
+    /// Returns the index of another loaded sample with identical data, if any.
+    std::optional<size_t> find_identical(
+        doc::sample::Samples const& samples, size_t sample_idx
+    ) const;
+
+    /// Returns true if any other loaded sample shares sample_idx's data.
+    bool is_shared(size_t sample_idx) const;
+};
+
+}
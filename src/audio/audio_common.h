@@ -15,11 +15,69 @@ namespace audio {
 using Amplitude = float;
 using event_queue::ClockT;
 
+enum class ResamplerKind {
+    /// Built-in polyphase FIR resampler (synth/polyphase.h).
+    Polyphase,
+    /// libsamplerate, fed with 4x ZOH-upsampled audio.
+    Libsamplerate,
+};
+
+/// Which S-DSP emulator the synth runs.
+enum class DspCore {
+    /// SPC_DSP, which emulates each of the S-DSP's 32 clocks per sample.
+    ClockAccurate,
+    /// SoaDsp (synth/soa_dsp.h), which emulates a sample at a time,
+    /// running all 8 voices in parallel SIMD lanes. Produces identical output,
+    /// since register writes only occur at sample boundaries.
+    SoaSimd,
+};
+
+/// Polyphase filter length. Higher qualities have less aliasing and treble rolloff,
+/// but use more CPU time.
+enum class PolyphaseQuality {
+    Low,
+    Medium,
+    High,
+};
+
 struct AudioOptions {
     // Passed to synth only.
 
-    /// Which quality to use for resampling.
+    /// Which resampler converts the S-DSP's output to the output sampling rate.
+    ResamplerKind resampler = ResamplerKind::Polyphase;
+
+    /// Which quality to use for ResamplerKind::Polyphase.
+    PolyphaseQuality polyphase_quality = PolyphaseQuality::Medium;
+
+    /// Which quality to use for ResamplerKind::Libsamplerate.
     int resampler_quality = SRC_SINC_FASTEST;
+
+    /// Which S-DSP emulator each SPC700 chip runs. SoaSimd is faster in realtime
+    /// playback, since it skips voice processing while every voice is silent.
+    DspCore dsp_core = DspCore::SoaSimd;
+
+    /// How many threads synthesize chips concurrently (including the audio thread),
+    /// if the document has multiple chips. 0 uses one thread per CPU core.
+    /// Extra threads come from a worker pool (synth/worker_pool.h).
+    /// Output is identical regardless of the thread count.
+    uint32_t chip_threads = 1;
+
+    /// If true, when playback begins in the middle of the song, channels play
+    /// with the same state (instruments, volumes, held notes, and S-DSP state)
+    /// as if the song had played from the beginning. The synth restores the latest
+    /// checkpoint before the starting point (synth/seek_cache.h),
+    /// then silently fast-forwards to it.
+    /// If false, playback begins with the S-DSP reset. If realtime_seek is also false,
+    /// the drivers (but not the S-DSP) fast-forward from the beginning of the song,
+    /// so channels begin with the right instruments and volumes, but no notes playing.
+    /// Otherwise the drivers are reset too.
+    bool recall_on_seek = true;
+
+    /// If true, fast-forwarding to the starting point is spread across
+    /// audio callbacks, generating silence until it finishes,
+    /// so seeking never causes audio underruns.
+    /// If false, seeking finishes before generating audio (for offline rendering).
+    bool realtime_seek = true;
 };
 
 }
@@ -1,18 +1,19 @@
 #pragma once
 
+#include "stats.h"
 #include "timing_common.h"
-#include "cmd_queue.h"
 
 namespace audio::callback {
 
-using cmd_queue::AudioCommand;
 using timing::MaybeSequencerTime;
 
 struct CallbackInterface {
     virtual ~CallbackInterface() = default;
 
-    virtual AudioCommand * seen_command() const = 0;
     virtual MaybeSequencerTime play_time() const = 0;
+
+    /// Called by GUI thread, while the audio thread writes to the returned object.
+    virtual stats::AudioStats const& stats() const = 0;
 };
 
 }
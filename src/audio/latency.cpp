@@ -0,0 +1,129 @@
+#include "latency.h"
+
+#include <algorithm>  // std::clamp, std::min, std::max
+
+namespace audio::latency {
+
+LatencyOptions clamp(LatencyOptions options) {
+    options.smp_per_s = std::clamp(options.smp_per_s, MIN_SMP_PER_S, MAX_SMP_PER_S);
+    options.mono_smp_per_block = std::clamp(
+        options.mono_smp_per_block, MIN_SMP_PER_BLOCK, MAX_SMP_PER_BLOCK
+    );
+    options.nblocks = std::clamp(options.nblocks, MIN_NBLOCKS, MAX_NBLOCKS);
+    return options;
+}
+
+double latency_ms(LatencyOptions const& options) {
+    return 1000. * options.mono_smp_per_block * options.nblocks / options.smp_per_s;
+}
+
+/// Scales a block size in frames, which assumes 48000 Hz, to another sampling rate,
+/// so adaptive mode starts at about the same latency in milliseconds.
+static uint32_t initial_block(LatencyOptions const& user) {
+    uint64_t scaled = uint64_t(ADAPTIVE_INITIAL_BLOCK) * user.smp_per_s / 48000;
+    auto out = (uint32_t) std::max(scaled, uint64_t(MIN_SMP_PER_BLOCK));
+    return std::min(out, user.mono_smp_per_block);
+}
+
+AdaptiveLatency::AdaptiveLatency(LatencyOptions user)
+    : _user(clamp(user))
+    , _curr(_user)
+{
+    if (_user.adaptive) {
+        _curr.mono_smp_per_block = initial_block(_user);
+        _curr.nblocks = MIN_NBLOCKS;
+    }
+}
+
+void AdaptiveLatency::on_restart() {
+    _misses_base = 0;
+}
+
+std::optional<LatencyOptions> AdaptiveLatency::update(
+    uint64_t overloads, uint64_t underflows
+) {
+    if (!_user.adaptive) {
+        return {};
+    }
+
+    uint64_t const misses = overloads + underflows;
+    if (misses < _misses_base + ADAPTIVE_MAX_MISSES) {
+        return {};
+    }
+    // Don't raise latency again until more deadlines are missed,
+    // even if the caller doesn't restart audio.
+    _misses_base = misses;
+
+    if (_curr.mono_smp_per_block < _user.mono_smp_per_block) {
+        _curr.mono_smp_per_block =
+            std::min(_curr.mono_smp_per_block * 2, _user.mono_smp_per_block);
+    } else if (_curr.nblocks < MAX_NBLOCKS) {
+        _curr.nblocks++;
+    } else {
+        return {};
+    }
+    return _curr;
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+namespace audio::latency {
+
+TEST_CASE("AdaptiveLatency returns user options when not adaptive") {
+    LatencyOptions user{.mono_smp_per_block = 1024, .nblocks = 3};
+    AdaptiveLatency adapt{user};
+    CHECK(adapt.current() == user);
+    CHECK(!adapt.update(100, 100));
+    CHECK(adapt.current() == user);
+}
+
+TEST_CASE("AdaptiveLatency raises block size, then buffer count, on missed deadlines") {
+    LatencyOptions user{
+        .smp_per_s = 48000, .mono_smp_per_block = 512, .nblocks = 2, .adaptive = true
+    };
+    AdaptiveLatency adapt{user};
+    CHECK(adapt.current().mono_smp_per_block == ADAPTIVE_INITIAL_BLOCK);
+    CHECK(adapt.current().nblocks == 2);
+
+    // A single miss is tolerated.
+    CHECK(!adapt.update(1, 0));
+
+    auto next = adapt.update(1, 1);
+    REQUIRE(next);
+    CHECK(next->mono_smp_per_block == 256);
+    adapt.on_restart();
+
+    // Counters are relative to the restarted stream.
+    CHECK(!adapt.update(0, 1));
+    next = adapt.update(2, 0);
+    REQUIRE(next);
+    CHECK(next->mono_smp_per_block == 512);
+    adapt.on_restart();
+
+    // The block size never exceeds the user's choice.
+    next = adapt.update(2, 0);
+    REQUIRE(next);
+    CHECK(next->mono_smp_per_block == 512);
+    CHECK(next->nblocks == 3);
+
+    // Without a restart, the same counters don't raise latency twice.
+    CHECK(!adapt.update(2, 0));
+}
+
+TEST_CASE("AdaptiveLatency clamps user options") {
+    LatencyOptions user{
+        .smp_per_s = 1000, .mono_smp_per_block = 1, .nblocks = 100, .adaptive = true
+    };
+    AdaptiveLatency adapt{user};
+    CHECK(adapt.user().smp_per_s == MIN_SMP_PER_S);
+    CHECK(adapt.user().nblocks == MAX_NBLOCKS);
+    CHECK(adapt.current().mono_smp_per_block == MIN_SMP_PER_BLOCK);
+}
+
+}
+
+#endif
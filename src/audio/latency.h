@@ -0,0 +1,104 @@
+#pragma once
+
+/// Audio output buffering settings, and the policy for adjusting them at runtime.
+///
+/// Output latency (the delay between editing the document and hearing the result)
+/// is roughly mono_smp_per_block * nblocks / smp_per_s.
+/// Lower latency makes note entry feel more responsive,
+/// but leaves less slack before a slow callback causes an audible dropout.
+
+#include <cstdint>
+#include <optional>
+
+namespace audio::latency {
+
+/// Output sampling rates allowed by AudioThreadHandle.
+/// The polyphase resampler needs at least 1/8 of SAMPLES_PER_S_IDEAL,
+/// and higher rates only waste CPU time.
+/// (OverallSynth and both resamplers handle any block size.)
+constexpr uint32_t MIN_SMP_PER_S = 8'000;
+constexpr uint32_t MAX_SMP_PER_S = 192'000;
+
+constexpr uint32_t MIN_SMP_PER_BLOCK = 32;
+constexpr uint32_t MAX_SMP_PER_BLOCK = 8192;
+
+constexpr uint32_t MIN_NBLOCKS = 2;
+constexpr uint32_t MAX_NBLOCKS = 8;
+
+/// Choices shown in the GUI.
+inline constexpr uint32_t SAMPLE_RATES[] = {32000, 44100, 48000, 88200, 96000};
+inline constexpr uint32_t BLOCK_SIZES[] = {64, 128, 256, 512, 1024, 2048, 4096};
+
+struct LatencyOptions {
+    uint32_t smp_per_s = 48000;
+
+    /// Number of stereo frames generated per audio callback.
+    /// The audio backend may round this to a size it supports.
+    uint32_t mono_smp_per_block = 512;
+
+    /// Number of blocks buffered by the audio backend.
+    uint32_t nblocks = 2;
+
+    /// If true, start with a small block size and MIN_NBLOCKS, and increase them
+    /// (up to mono_smp_per_block and MAX_NBLOCKS)
+    /// whenever the audio callback misses deadlines.
+    bool adaptive = false;
+
+    bool operator==(LatencyOptions const& other) const = default;
+};
+
+/// Clamps each field to the supported range.
+LatencyOptions clamp(LatencyOptions options);
+
+/// Approximate output latency in milliseconds, excluding the audio backend's
+/// own buffering.
+double latency_ms(LatencyOptions const& options);
+
+/// In adaptive mode, the first block size to try.
+constexpr uint32_t ADAPTIVE_INITIAL_BLOCK = 128;
+
+/// In adaptive mode, the number of missed deadlines (overloads or underflows)
+/// tolerated before raising latency. One miss is common when a stream starts,
+/// or when the system is briefly busy.
+constexpr uint64_t ADAPTIVE_MAX_MISSES = 2;
+
+/// Decides which latency to open the audio output with.
+///
+/// If options.adaptive is false, always returns the user's options.
+/// Otherwise starts at ADAPTIVE_INITIAL_BLOCK, and whenever the audio thread's
+/// counters show too many missed deadlines, doubles the block size,
+/// until reaching the user's block size. After that, adds buffers
+/// up to MAX_NBLOCKS.
+/// Latency is never lowered automatically, since it would likely rise again.
+class AdaptiveLatency {
+    LatencyOptions _user;
+    LatencyOptions _curr;
+
+    /// Counters from the currently running audio output.
+    uint64_t _misses_base = 0;
+
+public:
+    explicit AdaptiveLatency(LatencyOptions user);
+
+    LatencyOptions const& user() const {
+        return _user;
+    }
+
+    /// The options to open the audio output with.
+    LatencyOptions const& current() const {
+        return _curr;
+    }
+
+    /// Call after (re)opening the audio output, since its counters start at 0.
+    void on_restart();
+
+    /// Called periodically by the GUI thread with the running audio output's
+    /// counters (stats::StatsSnapshot::overloads and underflows).
+    /// If latency should be raised, returns the new options.
+    /// The caller should reopen the audio output with them and call on_restart().
+    [[nodiscard]] std::optional<LatencyOptions> update(
+        uint64_t overloads, uint64_t underflows
+    );
+};
+
+}
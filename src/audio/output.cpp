@@ -48,40 +48,43 @@ static int rtaudio_callback(
         "rtaudio_callback() assumes interleaved stereo"
     );
     gsl::span output{(Amplitude *) output_buffer, stereo_smp_per_block};
+
+    auto const begin = stats::Clock::now();
     synth.synthesize_overall(output, mono_smp_per_block);
+    synth.record_callback(
+        stats::Clock::now() - begin,
+        mono_smp_per_block,
+        status & RTAUDIO_OUTPUT_UNDERFLOW);
 
     return 0;
 }
 
-// Any lower latency, and I get audio dropouts on PulseAudio.
-// Not sure if it's because of PulseAudio, exotracker, non-real-time threads,
-// or Linux kernel.
-static constexpr unsigned int MONO_SMP_PER_BLOCK = 512;
-static constexpr unsigned int NUM_BLOCKS = 2;
-
 /// Why factory method and not constructor?
 /// So we can calculate values (like sampling rate) used in multiple places.
 std::optional<AudioThreadHandle> AudioThreadHandle::make(
     RtAudio & rt,
     unsigned int device,
+    LatencyOptions latency,
     doc::Document document,
-    AudioCommand * stub_command
+    CommandReceiver commands
 ) {
+    latency = latency::clamp(latency);
+
     RtAudio::StreamParameters outParams;
     outParams.deviceId = device;
     outParams.nChannels = STEREO_NCHAN;
 
     RtAudio::StreamOptions stream_opt;
-    stream_opt.numberOfBuffers = NUM_BLOCKS;
+    stream_opt.numberOfBuffers = latency.nblocks;
     stream_opt.flags = RTAUDIO_FLAGS;
 
-    unsigned int sample_rate = 48000;
-    unsigned int mono_smp_per_block = MONO_SMP_PER_BLOCK;
+    unsigned int sample_rate = latency.smp_per_s;
+    unsigned int mono_smp_per_block = latency.mono_smp_per_block;
     AudioOptions audio_options {
     };
 
     auto synth = std::make_unique<OverallSynth>(
-        outParams.nChannels, sample_rate, std::move(document), stub_command, audio_options
+        outParams.nChannels, sample_rate, std::move(document), commands, audio_options
     );
 
     // On OpenSUSE Tumbleweed, if you hold F12,
@@ -108,8 +111,11 @@ std::optional<AudioThreadHandle> AudioThreadHandle::make(
         */
 
         fmt::print(stderr,
-            "{} smp/block, {} buffers\n", mono_smp_per_block, stream_opt.numberOfBuffers
+            "{} Hz, {} smp/block, {} buffers\n",
+            sample_rate, mono_smp_per_block, stream_opt.numberOfBuffers
         );
+        latency.mono_smp_per_block = mono_smp_per_block;
+        latency.nblocks = stream_opt.numberOfBuffers;
 
         rt.startStream();
     } catch (RtAudioError & e) {
@@ -117,7 +123,7 @@ std::optional<AudioThreadHandle> AudioThreadHandle::make(
         return {};
     }
 
-    return {AudioThreadHandle{rt, std::move(synth)}};
+    return {AudioThreadHandle{rt, std::move(synth), latency}};
 }
 
 AudioThreadHandle::~AudioThreadHandle() {
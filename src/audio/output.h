@@ -21,6 +21,7 @@
 #include "callback.h"
 #include "doc.h"
 #include "cmd_queue.h"
+#include "latency.h"
 #include "timing_common.h"
 #include "util/copy_move.h"
 
@@ -32,9 +33,10 @@
 namespace audio {
 namespace output {
 
-using cmd_queue::AudioCommand;
+using cmd_queue::CommandReceiver;
 using timing::MaybeSequencerTime;
 using callback::CallbackInterface;
+using latency::LatencyOptions;
 
 class AudioThreadHandle {
     // Used to shut down the stream when AudioThreadHandle is destroyed.
@@ -50,9 +52,18 @@ class AudioThreadHandle {
     //  since RtAudio accesses via pointer anyway.
     std::unique_ptr<CallbackInterface> _callback;
 
-    AudioThreadHandle(RtAudio & rt, std::unique_ptr<CallbackInterface> && callback)
+    /// The settings the stream was opened with,
+    /// after the audio backend adjusted the block size and buffer count.
+    LatencyOptions _latency;
+
+    AudioThreadHandle(
+        RtAudio & rt,
+        std::unique_ptr<CallbackInterface> && callback,
+        LatencyOptions latency
+    )
         : _rt{rt}
         , _callback{std::move(callback)}
+        , _latency{latency}
     {}
 
 public:
@@ -67,23 +78,30 @@ public:
     /// - get_document argument must outlive returned OverallSynth.
     /// - get_document's list of chips must not change between calls.
     ///   If it changes, destroy returned OverallSynth and create a new one.
+    /// - The CommandQueue which created `commands` must outlive the returned handle.
     ///
-    /// throws PaException or PaCppException or whatever else
+    /// `latency` is clamped to the supported range.
+    /// Returns nullopt if the audio backend fails to open the stream.
     static std::optional<AudioThreadHandle> make(
         RtAudio & rt,
         unsigned int device,
+        LatencyOptions latency,
         doc::Document document,
-        AudioCommand * stub_command
+        CommandReceiver commands
     );
 
     /// Called by GUI thread.
-    inline AudioCommand * seen_command() const {
-        return _callback->seen_command();
+    inline MaybeSequencerTime play_time() const {
+        return _callback->play_time();
     }
 
     /// Called by GUI thread.
-    inline MaybeSequencerTime play_time() const {
-        return _callback->play_time();
+    inline stats::StatsSnapshot stats() const {
+        return _callback->stats().snapshot();
+    }
+
+    LatencyOptions const& latency() const {
+        return _latency;
     }
 
     ~AudioThreadHandle();
@@ -0,0 +1,392 @@
+#include "render.h"
+#include "synth.h"
+#include "tempo_calc.h"
+#include "cmd_queue.h"
+#include "doc_util/track_util.h"
+#include "util/release_assert.h"
+
+#include <algorithm>  // std::min
+#include <atomic>
+#include <chrono>
+#include <cmath>  // std::ceil
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <numeric>  // std::gcd
+#include <thread>
+#include <vector>
+
+namespace audio::render {
+
+using synth::OverallSynth;
+using synth::STEREO_NCHAN;
+using cmd_queue::CommandQueue;
+using tempo_calc::CLOCKS_PER_SAMPLE;
+using tempo_calc::CLOCKS_PER_S_IDEAL;
+using tempo_calc::SAMPLES_PER_S_IDEAL;
+using doc_util::track_util::song_length;
+
+using Clock = std::chrono::steady_clock;
+
+/// Number of stereo frames generated per synthesize_overall() call.
+/// Matches a typical realtime audio callback.
+constexpr uint32_t RENDER_BLOCK_SIZE = 512;
+
+/// Predicts when the sequencer plays each tick, relative to the start of playback.
+/// Mirrors SequencerTiming (which starts its phase at 0xff upon PlayFrom,
+/// so tick 0 plays on the first timer).
+class TimerGrid {
+    ClockT _clocks_per_timer;
+    uint32_t _phase_step;
+
+public:
+    explicit TimerGrid(doc::SequencerOptions const& options)
+        : _clocks_per_timer(tempo_calc::calc_clocks_per_timer(options.spc_timer_period))
+        , _phase_step(tempo_calc::calc_sequencer_rate(options))
+    {}
+
+    /// If false, the sequencer never advances and the song never ends.
+    bool ticks() const {
+        return _phase_step > 0;
+    }
+
+    /// Index of the timer on which the sequencer plays `tick`.
+    /// Tick n plays on the first timer k where 0xff + (k + 1) * step >= 256 * (n + 1).
+    uint64_t tick_to_timer(uint64_t tick) const {
+        return (256 * tick + _phase_step) / _phase_step - 1;
+    }
+
+    /// Index of the first output frame generated after `tick` is played.
+    /// Rounded down, since the synth runs in whole SPC samples
+    /// and the resampler doesn't emit partial frames.
+    uint64_t tick_to_frame(uint64_t tick, uint32_t smp_per_s) const {
+        uint64_t snes_smp =
+            tick_to_timer(tick) * _clocks_per_timer / CLOCKS_PER_SAMPLE;
+        return snes_smp * smp_per_s / SAMPLES_PER_S_IDEAL;
+    }
+
+    /// If playback begins on a multiple of sync_ticks(),
+    /// the phase accumulator holds its initial value (0xff)
+    /// at the same point in a serial render, so every later tick
+    /// plays on the same timer in both.
+    uint64_t sync_ticks() const {
+        return _phase_step / std::gcd(_phase_step, 256u);
+    }
+
+    uint64_t seconds_to_ticks(double seconds) const {
+        double timers_per_s = double(CLOCKS_PER_S_IDEAL) / double(_clocks_per_timer);
+        return (uint64_t) std::ceil(seconds * timers_per_s * _phase_step / 256.);
+    }
+};
+
+/// How many frames to render, and whether that reaches the end of the song.
+struct RenderLength {
+    uint64_t nframes;
+    bool song_ends;
+};
+
+static RenderLength render_length(
+    doc::Document const& document, RenderOptions const& options
+) {
+    auto const max_frames =
+        (uint64_t) std::ceil(options.max_seconds * options.smp_per_s);
+
+    TimerGrid grid{document.sequencer_options};
+    doc::TickT len = song_length(document.sequence);
+
+    if (len > 0 && grid.ticks()) {
+        uint64_t end_tick = (uint64_t) len * options.loop_count;
+        uint64_t end_frame = grid.tick_to_frame(end_tick, options.smp_per_s);
+        if (end_frame <= max_frames) {
+            return {end_frame, true};
+        }
+    }
+    return {max_frames, false};
+}
+
+static std::unique_ptr<OverallSynth> play_from(
+    doc::Document const& document,
+    RenderOptions const& options,
+    CommandQueue & commands,
+    doc::TickT time)
+{
+    commands.push(cmd_queue::PlayFrom{time});
+
+    // Offline renders can spend as long as needed seeking.
+    AudioOptions audio_options = options.audio_options;
+    audio_options.realtime_seek = false;
+
+    return std::make_unique<OverallSynth>(
+        STEREO_NCHAN,
+        options.smp_per_s,
+        document.clone(),
+        commands.receiver(),
+        audio_options
+    );
+}
+
+RenderStats render_song(
+    doc::Document const& document,
+    RenderOptions const& options,
+    WriteBlock const& write_block)
+{
+    CommandQueue commands;
+    auto synth = play_from(document, options, commands, 0);
+
+    RenderLength const length = render_length(document, options);
+    RenderStats stats{.smp_per_s = options.smp_per_s};
+
+    std::vector<Amplitude> block(RENDER_BLOCK_SIZE * STEREO_NCHAN);
+    Clock::duration synth_time{};
+
+    bool aborted = false;
+    while (stats.nframes < length.nframes) {
+        auto nframe = (size_t) std::min<uint64_t>(
+            RENDER_BLOCK_SIZE, length.nframes - stats.nframes
+        );
+        auto out = gsl::span(block).first(nframe * STEREO_NCHAN);
+
+        auto const t0 = Clock::now();
+        synth->synthesize_overall(out, nframe);
+        synth_time += Clock::now() - t0;
+
+        stats.nframes += nframe;
+        if (!write_block(out)) {
+            aborted = true;
+            break;
+        }
+    }
+
+    stats.song_ended = length.song_ends && !aborted;
+    stats.synth_seconds = std::chrono::duration<double>(synth_time).count();
+    stats.audio_stats = synth->stats().snapshot();
+    return stats;
+}
+
+namespace {
+
+/// A range of the song rendered by one synth.
+/// All frame numbers are global (counted from the start of a serial render).
+struct Segment {
+    /// The tick (counted across loops) which the synth starts playing from.
+    uint64_t seek_tick;
+
+    /// The frame at which the synth starts playing.
+    uint64_t seek_frame;
+
+    /// The synth's output before this frame is pre-roll, and discarded.
+    uint64_t begin_frame;
+
+    /// One past the last frame rendered (including the crossfade into the next segment).
+    uint64_t end_frame;
+
+    /// Audio from begin_frame to end_frame. Written by a worker thread.
+    std::vector<Amplitude> audio = {};
+
+    /// Timing histograms of the segment's synth. Written by a worker thread.
+    stats::StatsSnapshot audio_stats = {};
+
+    /// Set if rendering this segment threw an exception.
+    std::exception_ptr error = {};
+
+    /// Protected by the mutex in render_song_parallel().
+    bool done = false;
+};
+
+void render_segment(
+    doc::Document const& document,
+    RenderOptions const& options,
+    doc::TickT song_len,
+    Segment & segment)
+{
+    // Recalling channel state would run the S-DSP from the beginning of the song
+    // in every segment. Instead each segment only runs the drivers silently from
+    // tick 0 (see OverallSynth::seek_without_recall()), then fast-forwards the
+    // S-DSP through the overlap before begin_frame.
+    RenderOptions segment_options = options;
+    segment_options.audio_options.recall_on_seek = false;
+
+    CommandQueue commands;
+    auto synth = play_from(
+        document,
+        segment_options,
+        commands,
+        doc::TickT(segment.seek_tick % (uint64_t) song_len));
+
+    std::vector<Amplitude> block(RENDER_BLOCK_SIZE * STEREO_NCHAN);
+    for (uint64_t now = segment.seek_frame; now < segment.begin_frame; ) {
+        auto nframe = (size_t) std::min<uint64_t>(
+            RENDER_BLOCK_SIZE, segment.begin_frame - now
+        );
+        synth->synthesize_overall(gsl::span(block).first(nframe * STEREO_NCHAN), nframe);
+        now += nframe;
+    }
+
+    auto nframe = (size_t) (segment.end_frame - segment.begin_frame);
+    segment.audio.resize(nframe * STEREO_NCHAN);
+    synth->synthesize_overall(segment.audio, nframe);
+
+    segment.audio_stats = synth->stats().snapshot();
+}
+
+}
+
+RenderStats render_song_parallel(
+    doc::Document const& document,
+    RenderOptions const& options,
+    ParallelOptions const& parallel,
+    WriteBlock const& write_block)
+{
+    TimerGrid const grid{document.sequencer_options};
+    doc::TickT const song_len = song_length(document.sequence);
+    RenderLength const length = render_length(document, options);
+
+    if (parallel.nthreads <= 1 || song_len <= 0 || !grid.ticks()) {
+        return render_song(document, options, write_block);
+    }
+
+    auto const t0 = Clock::now();
+    uint32_t const rate = options.smp_per_s;
+
+    // Pick segment boundaries on ticks where a synth can start in sync
+    // with the serial timer phase.
+    std::vector<Segment> segments;
+    {
+        uint64_t const end_tick = (uint64_t) song_len * options.loop_count;
+        uint64_t const sync = grid.sync_ticks();
+        uint64_t const preroll = grid.seconds_to_ticks(parallel.preroll_seconds);
+        uint32_t const nsegment = parallel.nsegments
+            ? parallel.nsegments
+            : 2 * parallel.nthreads;
+
+        std::vector<uint64_t> begin_ticks{0};
+        for (uint64_t i = 1; i < nsegment; i++) {
+            uint64_t tick = end_tick * i / nsegment / sync * sync;
+            if (tick > begin_ticks.back()
+                && grid.tick_to_frame(tick, rate) < length.nframes
+            ) {
+                begin_ticks.push_back(tick);
+            }
+        }
+
+        for (size_t i = 0; i < begin_ticks.size(); i++) {
+            uint64_t begin_tick = begin_ticks[i];
+            uint64_t seek_tick = begin_tick > preroll
+                ? (begin_tick - preroll) / sync * sync
+                : 0;
+            uint64_t end_frame = i + 1 < begin_ticks.size()
+                ? grid.tick_to_frame(begin_ticks[i + 1], rate)
+                : length.nframes;
+
+            segments.push_back(Segment{
+                .seek_tick = seek_tick,
+                .seek_frame = grid.tick_to_frame(seek_tick, rate),
+                .begin_frame = grid.tick_to_frame(begin_tick, rate),
+                .end_frame = end_frame,
+            });
+        }
+    }
+
+    // Each segment (except the last) overlaps the next by `crossfade` frames.
+    uint64_t crossfade = parallel.crossfade_frames;
+    for (auto const& segment : segments) {
+        crossfade = std::min(crossfade, segment.end_frame - segment.begin_frame);
+    }
+    for (size_t i = 0; i + 1 < segments.size(); i++) {
+        segments[i].end_frame = std::min(segments[i].end_frame + crossfade, length.nframes);
+    }
+
+    std::mutex mutex;
+    std::condition_variable segment_done;
+    std::atomic<size_t> next_segment{0};
+    std::atomic<bool> abort{false};
+
+    auto worker = [&]() {
+        size_t i;
+        while (!abort.load() && (i = next_segment++) < segments.size()) {
+            auto & segment = segments[i];
+            try {
+                render_segment(document, options, song_len, segment);
+            } catch (...) {
+                segment.error = std::current_exception();
+            }
+            {
+                auto lock = std::unique_lock(mutex);
+                segment.done = true;
+            }
+            segment_done.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    auto const nthreads = std::min<size_t>(parallel.nthreads, segments.size());
+    for (size_t i = 0; i < nthreads; i++) {
+        threads.emplace_back(worker);
+    }
+
+    RenderStats stats{.smp_per_s = rate};
+    Clock::duration write_time{};
+    std::exception_ptr error;
+
+    // Splice segments together in order, as they finish.
+    std::vector<Amplitude> prev_tail;
+    for (size_t i = 0; i < segments.size(); i++) {
+        auto & segment = segments[i];
+        {
+            auto lock = std::unique_lock(mutex);
+            segment_done.wait(lock, [&] { return segment.done; });
+        }
+        if (segment.error) {
+            error = segment.error;
+            break;
+        }
+
+        auto audio = gsl::span(segment.audio);
+
+        // Fade from the previous segment's overlapping tail into this segment.
+        size_t const fade_len = prev_tail.size() / STEREO_NCHAN;
+        release_assert(audio.size() >= prev_tail.size());
+        for (size_t frame = 0; frame < fade_len; frame++) {
+            float w = (float(frame) + 0.5f) / float(fade_len);
+            for (size_t chan = 0; chan < STEREO_NCHAN; chan++) {
+                size_t idx = frame * STEREO_NCHAN + chan;
+                audio[idx] = prev_tail[idx] * (1.f - w) + audio[idx] * w;
+            }
+        }
+
+        // Hold back the region overlapping the next segment.
+        size_t const tail_len = i + 1 < segments.size()
+            ? (size_t) (segment.end_frame - segments[i + 1].begin_frame)
+            : 0;
+        auto body = audio.first(audio.size() - tail_len * STEREO_NCHAN);
+        auto tail = audio.last(tail_len * STEREO_NCHAN);
+        prev_tail.assign(tail.begin(), tail.end());
+
+        auto const w0 = Clock::now();
+        bool ok = write_block(body);
+        write_time += Clock::now() - w0;
+
+        stats.nframes += body.size() / STEREO_NCHAN;
+        stats.audio_stats += segment.audio_stats;
+        segment.audio = {};
+
+        if (!ok) {
+            break;
+        }
+    }
+
+    abort.store(true);
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    stats.song_ended = length.song_ends && stats.nframes == length.nframes;
+    stats.synth_seconds =
+        std::chrono::duration<double>(Clock::now() - t0 - write_time).count();
+    return stats;
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "audio_common.h"
+#include "stats.h"
+#include "doc.h"
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <functional>
+
+/// Offline (non-realtime) rendering of a document to audio,
+/// used by exotracker-render and other headless tools.
+namespace audio::render {
+
+struct RenderOptions {
+    uint32_t smp_per_s = 48000;
+
+    /// Stop rendering once the song has played through this many times.
+    uint32_t loop_count = 1;
+
+    /// Stop rendering after this much audio, even if the song hasn't ended.
+    /// (Empty songs never end, so this bounds their length.)
+    double max_seconds = 20 * 60;
+
+    AudioOptions audio_options = {};
+};
+
+/// Options for render_song_parallel().
+struct ParallelOptions {
+    /// Number of worker threads, each running its own OverallSynth.
+    uint32_t nthreads = 1;
+
+    /// Number of segments to split the song into.
+    /// If 0, uses 2 segments per thread, so threads finishing early can pick up work.
+    uint32_t nsegments = 0;
+
+    /// How much audio to render (and discard) before each segment begins,
+    /// so notes and envelopes started earlier have time to match a serial render.
+    double preroll_seconds = 2.;
+
+    /// Length of the linear crossfade from one segment into the next,
+    /// covering any residual mismatch between the segments.
+    /// If 0, segments are spliced directly.
+    uint32_t crossfade_frames = 64;
+};
+
+struct RenderStats {
+    uint32_t smp_per_s = 0;
+
+    /// Number of stereo frames rendered.
+    uint64_t nframes = 0;
+
+    /// Wall-clock time spent synthesizing audio,
+    /// excluding time spent in the WriteBlock callback.
+    double synth_seconds = 0;
+
+    /// False if rendering stopped because of max_seconds or WriteBlock.
+    bool song_ended = false;
+
+    /// Timing histograms recorded by the synth (or all synths, if parallel).
+    stats::StatsSnapshot audio_stats = {};
+
+    double audio_seconds() const {
+        return smp_per_s ? double(nframes) / smp_per_s : 0.;
+    }
+
+    /// How many times faster than realtime the synth ran.
+    double realtime_multiple() const {
+        return synth_seconds > 0 ? audio_seconds() / synth_seconds : 0.;
+    }
+};
+
+/// Receives each rendered block of interleaved stereo audio,
+/// [smp#, * STEREO_NCHAN + chan#] Amplitude.
+/// Return false to stop rendering (eg. if writing to disk failed).
+using WriteBlock = std::function<bool(gsl::span<Amplitude const>)>;
+
+/// Plays `document` from the beginning until it has looped
+/// RenderOptions::loop_count times, passing audio to `write_block` as it's generated.
+///
+/// The song's end is computed from its length and tempo,
+/// so the output ends exactly where the next loop would begin.
+RenderStats render_song(
+    doc::Document const& document,
+    RenderOptions const& options,
+    WriteBlock const& write_block);
+
+/// Renders the same audio as render_song(), but splits the song into segments
+/// rendered concurrently by separate synths.
+///
+/// Each segment's synth seeks to a point `preroll_seconds` before the segment,
+/// chosen so its sequencer timer lines up with a serial render's,
+/// and renders up to the segment's start before its output is used.
+/// The output is not bit-exact with render_song(), since notes playing
+/// before the seek point are not recalled, the S-DSP's envelope counter restarts
+/// at each seek point, and segment joins can be offset by a fraction of
+/// an output sample. Compare the two renders to measure the error.
+///
+/// `write_block` is called on the calling thread, in order.
+/// If the song doesn't end or nthreads <= 1, falls back to render_song().
+RenderStats render_song_parallel(
+    doc::Document const& document,
+    RenderOptions const& options,
+    ParallelOptions const& parallel,
+    WriteBlock const& write_block);
+
+}
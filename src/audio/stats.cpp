@@ -0,0 +1,304 @@
+#include "stats.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>  // std::max
+#include <bit>  // std::bit_width
+#include <cmath>  // std::ceil
+
+namespace audio::stats {
+
+static size_t bucket_index(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    return std::min((size_t) std::bit_width(us), NBUCKET - 1);
+}
+
+/// Returns the exclusive upper bound of a bucket, in µs.
+static double bucket_end_us(size_t bucket) {
+    return double(uint64_t(1) << bucket);
+}
+
+// impl HistogramSnapshot
+double HistogramSnapshot::mean_us() const {
+    if (count == 0) {
+        return 0.;
+    }
+    return double(total_ns) / double(count) / 1000.;
+}
+
+double HistogramSnapshot::quantile_us(double quantile) const {
+    uint64_t total = 0;
+    for (uint64_t n : buckets) {
+        total += n;
+    }
+    if (total == 0) {
+        return 0.;
+    }
+
+    auto const target = (uint64_t) std::ceil(quantile * double(total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NBUCKET - 1; i++) {
+        seen += buckets[i];
+        if (seen >= target && seen > 0) {
+            return bucket_end_us(i);
+        }
+    }
+    // The last bucket has no upper bound.
+    return double(max_ns) / 1000.;
+}
+
+HistogramSnapshot & HistogramSnapshot::operator+=(HistogramSnapshot const& other) {
+    for (size_t i = 0; i < NBUCKET; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    total_ns += other.total_ns;
+    max_ns = std::max(max_ns, other.max_ns);
+    return *this;
+}
+
+// impl TimeHistogram
+void TimeHistogram::record(uint64_t ns) noexcept {
+    // Only the audio thread writes, so load-then-store is enough,
+    // and avoids locked read-modify-write instructions on x86.
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    auto & bucket = _buckets[bucket_index(ns)];
+    bucket.store(bucket.load(relaxed) + 1, relaxed);
+    _count.store(_count.load(relaxed) + 1, relaxed);
+    _total_ns.store(_total_ns.load(relaxed) + ns, relaxed);
+    if (ns > _max_ns.load(relaxed)) {
+        _max_ns.store(ns, relaxed);
+    }
+}
+
+HistogramSnapshot TimeHistogram::snapshot() const noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    HistogramSnapshot out;
+    for (size_t i = 0; i < NBUCKET; i++) {
+        out.buckets[i] = _buckets[i].load(relaxed);
+    }
+    out.count = _count.load(relaxed);
+    out.total_ns = _total_ns.load(relaxed);
+    out.max_ns = _max_ns.load(relaxed);
+    return out;
+}
+
+// impl StatsSnapshot
+StatsSnapshot & StatsSnapshot::operator+=(StatsSnapshot const& other) {
+    callback += other.callback;
+    synth += other.synth;
+    commands += other.commands;
+    dsp += other.dsp;
+    resample += other.resample;
+    driver_ticks += other.driver_ticks;
+    register_writes += other.register_writes;
+    max_tick_writes = std::max(max_tick_writes, other.max_tick_writes);
+    dropped_writes += other.dropped_writes;
+    driver_clocks += other.driver_clocks;
+    max_tick_driver_clocks = std::max(max_tick_driver_clocks, other.max_tick_driver_clocks);
+    underflows += other.underflows;
+    overloads += other.overloads;
+    block_ns = std::max(block_ns, other.block_ns);
+    return *this;
+}
+
+// impl AudioStats
+void AudioStats::record_callback(
+    uint64_t elapsed_ns, uint64_t block_ns, bool underflow
+) noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    callback.record(elapsed_ns);
+    _block_ns.store(block_ns, relaxed);
+    if (elapsed_ns > block_ns) {
+        _overloads.store(_overloads.load(relaxed) + 1, relaxed);
+    }
+    if (underflow) {
+        _underflows.store(_underflows.load(relaxed) + 1, relaxed);
+    }
+}
+
+void AudioStats::record_driver_tick(
+    uint64_t writes, uint64_t dropped, uint64_t clocks
+) noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    auto add = [](std::atomic<uint64_t> & counter, uint64_t value) {
+        counter.store(counter.load(relaxed) + value, relaxed);
+    };
+    auto max = [](std::atomic<uint64_t> & counter, uint64_t value) {
+        if (value > counter.load(relaxed)) {
+            counter.store(value, relaxed);
+        }
+    };
+
+    add(_driver_ticks, 1);
+    add(_register_writes, writes);
+    max(_max_tick_writes, writes);
+    add(_dropped_writes, dropped);
+    add(_driver_clocks, clocks);
+    max(_max_tick_driver_clocks, clocks);
+}
+
+StatsSnapshot AudioStats::snapshot() const noexcept {
+    constexpr auto relaxed = std::memory_order_relaxed;
+
+    return StatsSnapshot {
+        .callback = callback.snapshot(),
+        .synth = synth.snapshot(),
+        .commands = commands.snapshot(),
+        .dsp = dsp.snapshot(),
+        .resample = resample.snapshot(),
+        .driver_ticks = _driver_ticks.load(relaxed),
+        .register_writes = _register_writes.load(relaxed),
+        .max_tick_writes = _max_tick_writes.load(relaxed),
+        .dropped_writes = _dropped_writes.load(relaxed),
+        .driver_clocks = _driver_clocks.load(relaxed),
+        .max_tick_driver_clocks = _max_tick_driver_clocks.load(relaxed),
+        .underflows = _underflows.load(relaxed),
+        .overloads = _overloads.load(relaxed),
+        .block_ns = _block_ns.load(relaxed),
+    };
+}
+
+std::string format_stats(StatsSnapshot const& stats) {
+    std::string out;
+
+    struct Row {
+        char const* name;
+        HistogramSnapshot const& hist;
+    };
+    Row const rows[] = {
+        {"callback", stats.callback},
+        {"synth", stats.synth},
+        {"  commands", stats.commands},
+        {"  dsp", stats.dsp},
+        {"  resample", stats.resample},
+    };
+
+    out += fmt::format("{:<12} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+        "time (us)", "count", "mean", "p50 <", "p99 <", "max");
+    for (auto const& row : rows) {
+        if (row.hist.count == 0) {
+            continue;
+        }
+        out += fmt::format(
+            "{:<12} {:>10} {:>10.1f} {:>10.0f} {:>10.0f} {:>10.1f}\n",
+            row.name,
+            row.hist.count,
+            row.hist.mean_us(),
+            row.hist.quantile_us(0.5),
+            row.hist.quantile_us(0.99),
+            double(row.hist.max_ns) / 1000.);
+    }
+
+    if (stats.callback.count > 0) {
+        out += fmt::format(
+            "\nblock length: {:.2f} ms\n", double(stats.block_ns) / 1e6);
+        out += fmt::format(
+            "overloads (callback longer than block): {}\n", stats.overloads);
+        out += fmt::format(
+            "underflows (reported by audio output): {}\n", stats.underflows);
+    }
+
+    if (stats.driver_ticks > 0) {
+        auto const nticks = double(stats.driver_ticks);
+        out += fmt::format(
+            "\ndriver ticks: {}\n", stats.driver_ticks);
+        out += fmt::format(
+            "register writes per tick: mean {:.1f}, max {}\n",
+            double(stats.register_writes) / nticks, stats.max_tick_writes);
+        out += fmt::format(
+            "driver clocks per tick: mean {:.1f}, max {}\n",
+            double(stats.driver_clocks) / nticks, stats.max_tick_driver_clocks);
+        out += fmt::format(
+            "dropped register writes (queue full): {}\n", stats.dropped_writes);
+    }
+
+    // Show the distribution of the outermost measured time.
+    HistogramSnapshot const& hist =
+        stats.callback.count > 0 ? stats.callback : stats.synth;
+    uint64_t max_bucket = 0;
+    for (uint64_t n : hist.buckets) {
+        max_bucket = std::max(max_bucket, n);
+    }
+    if (max_bucket > 0) {
+        constexpr uint64_t BAR_WIDTH = 40;
+
+        out += fmt::format("\n{} time distribution:\n",
+            stats.callback.count > 0 ? "callback" : "synth");
+        for (size_t i = 0; i < NBUCKET; i++) {
+            if (hist.buckets[i] == 0) {
+                continue;
+            }
+            auto bar_len = (size_t) ((hist.buckets[i] * BAR_WIDTH + max_bucket - 1)
+                / max_bucket);
+            std::string const label = i == NBUCKET - 1
+                ? fmt::format(">= {} us", bucket_end_us(i - 1))
+                : fmt::format("< {} us", bucket_end_us(i));
+            out += fmt::format("  {:>12} {:>10} {}\n",
+                label, hist.buckets[i], std::string(bar_len, '#'));
+        }
+    }
+
+    return out;
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+namespace audio::stats {
+
+TEST_CASE("TimeHistogram buckets durations by powers of 2 microseconds") {
+    TimeHistogram hist;
+    hist.record(500);  // 0.5 µs
+    hist.record(1'000);  // 1 µs
+    hist.record(3'000);  // 3 µs
+    hist.record(3'999);
+    hist.record(1'000'000'000);  // 1 s
+
+    auto snap = hist.snapshot();
+    CHECK(snap.count == 5);
+    CHECK(snap.buckets[0] == 1);
+    CHECK(snap.buckets[1] == 1);
+    CHECK(snap.buckets[2] == 2);
+    CHECK(snap.buckets[NBUCKET - 1] == 1);
+    CHECK(snap.max_ns == 1'000'000'000);
+
+    CHECK(snap.quantile_us(0.) == 1.);
+    CHECK(snap.quantile_us(0.5) == 4.);
+    CHECK(snap.quantile_us(1.) == 1e6);
+
+    StatsSnapshot merged;
+    merged.synth += snap;
+    merged.synth += snap;
+    CHECK(merged.synth.count == 10);
+    CHECK(merged.synth.buckets[2] == 4);
+}
+
+TEST_CASE("AudioStats records driver ticks") {
+    AudioStats stats;
+    stats.record_driver_tick(10, 0, 400);
+    stats.record_driver_tick(30, 2, 100);
+
+    auto snap = stats.snapshot();
+    CHECK(snap.driver_ticks == 2);
+    CHECK(snap.register_writes == 40);
+    CHECK(snap.max_tick_writes == 30);
+    CHECK(snap.dropped_writes == 2);
+    CHECK(snap.driver_clocks == 500);
+    CHECK(snap.max_tick_driver_clocks == 400);
+
+    snap += snap;
+    CHECK(snap.driver_ticks == 4);
+    CHECK(snap.max_tick_writes == 30);
+}
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+
+/// Realtime instrumentation for the audio thread.
+///
+/// The audio thread records how long each callback (and each part of it) takes,
+/// into histograms of atomic counters. The GUI thread (or a headless tool)
+/// can take snapshots at any time without locking or blocking the audio thread.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <string>
+
+namespace audio::stats {
+
+using Clock = std::chrono::steady_clock;
+
+/// Bucket 0 holds durations below 1 µs.
+/// Bucket i > 0 holds durations in [2^(i-1), 2^i) µs.
+/// The last bucket also holds all longer durations (above 65 ms).
+constexpr size_t NBUCKET = 18;
+
+inline uint64_t elapsed_ns(Clock::time_point begin, Clock::time_point end) {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - begin
+    ).count();
+}
+
+struct HistogramSnapshot {
+    std::array<uint64_t, NBUCKET> buckets{};
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+
+    double mean_us() const;
+
+    /// Returns the upper bound (in µs) of the bucket containing the given quantile
+    /// (in [0, 1]), or 0 if the histogram is empty.
+    double quantile_us(double quantile) const;
+
+    /// Merges the histograms of several synths (eg. when rendering in parallel).
+    HistogramSnapshot & operator+=(HistogramSnapshot const& other);
+};
+
+/// Histogram of durations.
+/// Only one thread may call record() (it's not atomic read-modify-write),
+/// but any thread may call snapshot() concurrently.
+class TimeHistogram {
+    std::array<std::atomic<uint64_t>, NBUCKET> _buckets{};
+    std::atomic<uint64_t> _count{0};
+    std::atomic<uint64_t> _total_ns{0};
+    std::atomic<uint64_t> _max_ns{0};
+
+public:
+    /// Called by the audio thread. Wait-free.
+    void record(uint64_t ns) noexcept;
+
+    /// Buckets are not read atomically with each other,
+    /// so the snapshot may be slightly out of sync with count.
+    HistogramSnapshot snapshot() const noexcept;
+};
+
+struct StatsSnapshot {
+    /// Time spent in the audio output's callback.
+    /// Empty when rendering without an audio output (eg. exotracker-render).
+    HistogramSnapshot callback;
+
+    /// Time spent in OverallSynth::synthesize_overall(), per call.
+    HistogramSnapshot synth;
+
+    /// Time spent handling commands from the GUI, per synthesize_overall() call.
+    HistogramSnapshot commands;
+
+    /// Time spent running sequencers, drivers, and S-DSP emulation,
+    /// and mixing chips into the resampler's input, per synthesize_overall() call.
+    HistogramSnapshot dsp;
+
+    /// The rest of synthesize_overall() (mostly resampling).
+    HistogramSnapshot resample;
+
+    /// Number of driver ticks (timer periods) run, summed over all chips.
+    uint64_t driver_ticks = 0;
+
+    /// Register writes generated by drivers, and the most in a single tick.
+    uint64_t register_writes = 0;
+    uint64_t max_tick_writes = 0;
+
+    /// Register writes dropped because a chip's RegisterWriteQueue was full.
+    uint64_t dropped_writes = 0;
+
+    /// SPC700 clocks the drivers spent between register writes,
+    /// and the most in a single tick. Measures how busy drivers are.
+    uint64_t driver_clocks = 0;
+    uint64_t max_tick_driver_clocks = 0;
+
+    /// Number of times the audio output reported an underflow (xrun).
+    uint64_t underflows = 0;
+
+    /// Number of callbacks which took longer than the audio they generated.
+    /// This will cause an underflow unless the audio output has spare buffers.
+    uint64_t overloads = 0;
+
+    /// Duration of audio generated by the most recent callback.
+    uint64_t block_ns = 0;
+
+    StatsSnapshot & operator+=(StatsSnapshot const& other);
+};
+
+/// Written by the audio thread, read by other threads.
+class AudioStats {
+public:
+    TimeHistogram callback;
+    TimeHistogram synth;
+    TimeHistogram commands;
+    TimeHistogram dsp;
+    TimeHistogram resample;
+
+private:
+    std::atomic<uint64_t> _underflows{0};
+    std::atomic<uint64_t> _overloads{0};
+    std::atomic<uint64_t> _block_ns{0};
+
+    std::atomic<uint64_t> _driver_ticks{0};
+    std::atomic<uint64_t> _register_writes{0};
+    std::atomic<uint64_t> _max_tick_writes{0};
+    std::atomic<uint64_t> _dropped_writes{0};
+    std::atomic<uint64_t> _driver_clocks{0};
+    std::atomic<uint64_t> _max_tick_driver_clocks{0};
+
+public:
+    /// Called by the audio output callback, after generating block_ns of audio.
+    void record_callback(uint64_t elapsed_ns, uint64_t block_ns, bool underflow) noexcept;
+
+    /// Called by the synth once per chip per tick,
+    /// with the RegisterWriteQueue's music_driver::TickStats.
+    void record_driver_tick(uint64_t writes, uint64_t dropped, uint64_t clocks) noexcept;
+
+    StatsSnapshot snapshot() const noexcept;
+};
+
+/// Formats a snapshot as a human-readable table, with a trailing newline.
+std::string format_stats(StatsSnapshot const& stats);
+
+}
@@ -1,5 +1,6 @@
 #include "synth.h"
 #include "synth/spc700.h"
+#include "synth/upsample.h"
 #include "tempo_calc.h"
 #include "chip_kinds.h"
 #include "edit/modified.h"
@@ -8,9 +9,11 @@
 #include <stdexcept>
 #include <fmt/core.h>
 
+#include <algorithm>  // std::min, std::max
 #include <cmath>  // round
 #include <cstddef>  // size_t
 #include <optional>
+#include <thread>  // std::thread::hardware_concurrency
 #include <utility>  // std::move
 
 namespace audio::synth {
@@ -24,13 +27,15 @@ using chip_kinds::ChipKind;
 /// and the longest timer period (~8000/256 Hz) is only ~32 ms or 1024 sample frames.
 constexpr size_t MAX_SNES_BLOCK_SIZE = 10'000;
 
-//#define DONT_RESAMPLE
+using upsample::OVERSAMPLING_FACTOR;
 
-#ifdef DONT_RESAMPLE
-constexpr uint32_t OVERSAMPLING_FACTOR = 1;
-#else
-constexpr uint32_t OVERSAMPLING_FACTOR = 4;
-#endif
+/// How many checkpoints each OverallSynth's SeekCache holds.
+/// Each checkpoint takes around 70 KB per chip (mostly ARAM).
+constexpr size_t MAX_CHECKPOINTS = 64;
+
+/// When seeking in realtime, the fraction of each SPC timer period
+/// the audio thread spends fast-forwarding.
+constexpr double SEEK_DUTY_CYCLE = 0.5;
 
 SpcResampler::SpcResampler(
     uint32_t stereo_nchan, uint32_t smp_per_s, AudioOptions const& audio_options
@@ -120,6 +125,8 @@ void SpcResampler::resample(Fn generate_input, gsl::span<float> out) {
 
 using tempo_calc::calc_sequencer_rate;
 using tempo_calc::calc_clocks_per_timer;
+using tempo_calc::CLOCKS_PER_SAMPLE;
+using tempo_calc::CLOCKS_PER_S_IDEAL;
 
 SequencerTiming::SequencerTiming(doc::SequencerOptions const& options)
     : _clocks_per_timer(calc_clocks_per_timer(options.spc_timer_period))
@@ -140,6 +147,11 @@ void SequencerTiming::play() {
     _phase = DEFAULT_SEQUENCER_PHASE;
 }
 
+void SequencerTiming::play_from_phase(uint8_t phase) {
+    _running = true;
+    _phase = phase;
+}
+
 void SequencerTiming::stop() {
     _running = false;
     // TODO port back to std::optional.
@@ -169,11 +181,13 @@ OverallSynth::OverallSynth(
     uint32_t stereo_nchan,
     uint32_t smp_per_s,
     doc::Document document_moved_from,
-    AudioCommand * stub_command,
+    CommandReceiver commands,
     AudioOptions audio_options
 )
     : _document(std::move(document_moved_from))
-    , _resampler(stereo_nchan, smp_per_s, audio_options)
+    , _audio_options(audio_options)
+    , _smp_per_s(smp_per_s)
+    , _commands(commands)
     , _sequencer_timing(_document.sequencer_options)
 {
     release_assert_equal(stereo_nchan, STEREO_NCHAN);
@@ -181,12 +195,24 @@ OverallSynth::OverallSynth(
     // Reserve enough space.
     _temp_buf.resize(MAX_SNES_BLOCK_SIZE * stereo_nchan);
 
-    int const max_oversamples = MAX_SNES_BLOCK_SIZE * OVERSAMPLING_FACTOR;
-    _resampler_input.resize(max_oversamples * stereo_nchan);
+    switch (audio_options.resampler) {
+    case ResamplerKind::Libsamplerate: {
+        _resampler.emplace(stereo_nchan, smp_per_s, audio_options);
+
+        int const max_oversamples = MAX_SNES_BLOCK_SIZE * OVERSAMPLING_FACTOR;
+        _resampler_input.resize(max_oversamples * stereo_nchan);
+        break;
+    }
+    case ResamplerKind::Polyphase:
+    default:
+        _polyphase.emplace(
+            smp_per_s, audio_options.polyphase_quality, MAX_SNES_BLOCK_SIZE
+        );
+        break;
+    }
 
     // Constructor runs on GUI thread. Fields later be read on audio thread.
     _maybe_seq_time.store(MaybeSequencerTime{}, std::memory_order_relaxed);
-    _seen_command.store(stub_command, std::memory_order_relaxed);
 
     // Thread creation will act as a memory barrier, so we don't need a fence.
 
@@ -196,10 +222,11 @@ OverallSynth::OverallSynth(
         switch (chip_kind) {
             case ChipKind::Spc700: {
                 auto instance = spc700::make_Spc700Instance(
-                   chip_index, _document.frequency_table
+                   chip_index, _document.frequency_table, audio_options.dsp_core
                 );
 
-                instance->reload_samples(_document);
+                // Initialize the S-DSP's registers and load all samples.
+                instance->reset_state(_document);
 
                 _chip_instances.emplace_back(std::move(instance));
                 break;
@@ -211,6 +238,27 @@ OverallSynth::OverallSynth(
                 ));
         }
     }
+
+    if (audio_options.recall_on_seek) {
+        _seek_cache = seek_cache::SeekCache(_chip_instances, MAX_CHECKPOINTS);
+        _seek_cache.invalidate(_document);
+    }
+
+    size_t const nthread = std::min<size_t>(
+        _chip_instances.size(),
+        audio_options.chip_threads
+            ? audio_options.chip_threads
+            : std::max(std::thread::hardware_concurrency(), 1u));
+
+    if (nthread > 1) {
+        // The audio thread runs chips too.
+        _chip_workers.emplace(nthread - 1);
+        _chip_bufs.resize(_chip_instances.size());
+        for (auto & buf : _chip_bufs) {
+            buf.resize(MAX_SNES_BLOCK_SIZE * stereo_nchan);
+        }
+        _chip_nsamp.resize(_chip_instances.size());
+    }
 }
 
 using edit::ModifiedInt;
@@ -221,12 +269,75 @@ void OverallSynth::synthesize_overall(
     size_t const mono_smp_per_block)
 {
     release_assert_equal(output_buffer.size(), mono_smp_per_block * STEREO_NCHAN);
-    _resampler.resample([&]() { return synthesize_tick_oversampled(); }, output_buffer);
+
+    auto const begin = stats::Clock::now();
+    _commands_ns = 0;
+    _dsp_ns = 0;
+
+    if (_polyphase) {
+        // The polyphase resampler reads the S-DSP's output directly,
+        // so we don't need to upsample it first.
+        auto generate_input = [&]() {
+            synthesize_tick([&](gsl::span<SpcAmplitude const> chip_out, upsample::Mix mix) {
+                _polyphase->write_input(chip_out, mix);
+            });
+        };
+        _polyphase->resample(generate_input, output_buffer);
+    } else {
+        _resampler->resample(
+            [&]() { return synthesize_tick_oversampled(); }, output_buffer
+        );
+    }
+
+    uint64_t const total_ns = stats::elapsed_ns(begin, stats::Clock::now());
+    _stats.synth.record(total_ns);
+    _stats.commands.record(_commands_ns);
+    _stats.dsp.record(_dsp_ns);
+    _stats.resample.record(total_ns - std::min(total_ns, _commands_ns + _dsp_ns));
+}
+
+void OverallSynth::record_callback(
+    stats::Clock::duration elapsed, size_t mono_smp_per_block, bool underflow
+) {
+    using namespace std::chrono;
+
+    auto const block_ns = uint64_t(mono_smp_per_block) * 1'000'000'000 / _smp_per_s;
+    _stats.record_callback(
+        (uint64_t) duration_cast<nanoseconds>(elapsed).count(), block_ns, underflow
+    );
 }
 
 gsl::span<float> OverallSynth::synthesize_tick_oversampled() {
+    size_t nsamp_written = 0;
+
+    synthesize_tick([&](gsl::span<SpcAmplitude const> chip_out, upsample::Mix mix) {
+        if (mix == upsample::Mix::Overwrite) {
+            nsamp_written = chip_out.size() / STEREO_NCHAN;
+            _resampler_input.resize(nsamp_written * STEREO_NCHAN * OVERSAMPLING_FACTOR);
+        }
+
+        // Convert data from short to float, perform ZOH upsampling,
+        // and mix into the resampler input.
+        upsample::upsample_zoh(chip_out, _resampler_input, mix);
+    });
+
+    // TODO filter _resampler_input.
+
+    return gsl::span<float>(
+        _resampler_input.data(), nsamp_written * OVERSAMPLING_FACTOR * STEREO_NCHAN
+    );
+}
+
+void OverallSynth::synthesize_tick_raw(std::vector<SpcAmplitude> & out) {
+    synthesize_tick([&out](gsl::span<SpcAmplitude const> chip_out, upsample::Mix) {
+        out.insert(out.end(), chip_out.begin(), chip_out.end());
+    });
+}
+
+template<typename MixChip>
+void OverallSynth::synthesize_tick(MixChip mix_chip) {
     // Thread creation will act as a memory barrier, so we don't need a fence.
-    // Only the audio thread writes to _maybe_seq_time and _seen_command.
+    // Only the audio thread writes to _maybe_seq_time and pops from _commands.
 
     MaybeSequencerTime const orig_seq_time =
         _maybe_seq_time.load(std::memory_order_relaxed);
@@ -239,30 +350,25 @@ gsl::span<float> OverallSynth::synthesize_tick_oversampled() {
     /// This is a minor timing discrepancy, but not worth fixing.
     MaybeSequencerTime seq_time = orig_seq_time;
 
-    AudioCommand * const orig_cmd = _seen_command.load(std::memory_order_relaxed);
-    AudioCommand * cmd = orig_cmd;
+    bool any_command = false;
+    auto const commands_begin = stats::Clock::now();
 
     /// Handle all commands we haven't seen yet. This may result in register writes.
     {
         ModifiedInt total_modified = 0;
 
-        // Paired with CommandQueue::push() store(release).
-        for (
-            ; AudioCommand * next = cmd->next.load(std::memory_order_acquire); cmd = next
-        ) {
-            cmd_queue::MessageBody * msg = &next->msg;
+        // If all edits touched the same channel's blocks, that channel.
+        std::optional<edit::modified::EditedChannel> edited_channel;
+        bool all_channels_edited = false;
+        SampleSet edited_samples;
+
+        for (; cmd_queue::MessageBody * msg = _commands.peek(); _commands.pop()) {
+            any_command = true;
 
             // Process each command from the GUI.
             if (auto play_from = std::get_if<cmd_queue::PlayFrom>(msg)) {
-                // Seek chip sequencers.
-                for (auto & chip : _chip_instances) {
-                    // chip->stop_playback();
-                    chip->reset_state(_document);
-                    chip->seek(_document, play_from->time);
-                }
-
-                // Begin playback (start ticking sequencers).
-                _sequencer_timing.play();
+                // Seek chip sequencers and begin playback.
+                this->play_from(play_from->time);
                 // If _sequencer_running == true, SynthEvent::Tick unconditionally
                 // overwrites seq_time after calling handle_commands().
             } else
@@ -274,6 +380,8 @@ gsl::span<float> OverallSynth::synthesize_tick_oversampled() {
 
                 // Stop playback.
                 _sequencer_timing.stop();
+                _seek_target = std::nullopt;
+                _save_checkpoints = false;
                 seq_time = std::nullopt;
             } else
             if (auto edit_ptr = std::get_if<cmd_queue::EditBox>(msg)) {
@@ -294,7 +402,38 @@ gsl::span<float> OverallSynth::synthesize_tick_oversampled() {
                 //   must be called even when stopped.
                 auto modified = edit.modified();
                 total_modified |= modified;
+
+                if (modified & (ModifiedFlags::Patterns | ModifiedFlags::SamplesEdited)) {
+                    auto const scope = edit.modified_scope();
+                    if (modified & ModifiedFlags::Patterns) {
+                        if (!scope.channel || (edited_channel && (
+                            edited_channel->chip != scope.channel->chip
+                            || edited_channel->channel != scope.channel->channel
+                        ))) {
+                            all_channels_edited = true;
+                        } else if (!edited_channel) {
+                            edited_channel = scope.channel;
+                        } else {
+                            edited_channel->begin_tick = std::min(
+                                edited_channel->begin_tick, scope.channel->begin_tick
+                            );
+                        }
+                    }
+                    if (modified & ModifiedFlags::SamplesEdited) {
+                        edited_samples |= scope.samples;
+                    }
+                }
+            }
+        }
+
+        // Checkpoints were saved from the previous document.
+        if (total_modified) {
+            if (total_modified == ModifiedFlags::Patterns && !all_channels_edited) {
+                _seek_cache.invalidate_from(_document, edited_channel->begin_tick);
+            } else {
+                _seek_cache.invalidate(_document);
             }
+            _save_checkpoints = false;
         }
 
         // Tempo changes
@@ -303,22 +442,75 @@ gsl::span<float> OverallSynth::synthesize_tick_oversampled() {
         }
 
         if (total_modified & ModifiedFlags::Patterns) {
-            for (auto & chip : _chip_instances) {
-                chip->doc_edited(_document);
+            if (all_channels_edited) {
+                for (auto & chip : _chip_instances) {
+                    chip->doc_edited(_document);
+                }
+            } else {
+                _chip_instances[edited_channel->chip]->channel_edited(
+                    _document, edited_channel->channel
+                );
             }
         }
 
         if (total_modified & ModifiedFlags::SamplesEdited) {
             for (auto & chip : _chip_instances) {
-                chip->reload_samples(_document);
+                chip->reload_samples(_document, edited_samples);
+            }
+        }
+
+        // Replacing or editing samples can change their tuning.
+        constexpr ModifiedInt TUNING_CHANGED = ModifiedFlags::InstrumentsEdited
+            | ModifiedFlags::SampleMetadataEdited | ModifiedFlags::SamplesEdited;
+        if (total_modified & TUNING_CHANGED) {
+            for (auto & chip : _chip_instances) {
+                chip->instruments_edited(_document);
             }
         }
     }
 
-    // TODO Instrument/tuning edits might invalidate driver or cause OOB reads.
+    auto const dsp_begin = stats::Clock::now();
+    _commands_ns += stats::elapsed_ns(commands_begin, dsp_begin);
 
     ClockT nclk_to_play = _sequencer_timing.clocks_per_timer();
 
+    auto finish_tick = [&]() {
+        // Store final time after synthesis completes.
+        if (seq_time != orig_seq_time) {
+            _maybe_seq_time.store(seq_time, std::memory_order_seq_cst);
+        }
+
+        // Mark commands as seen after storing timestamp.
+        // This way, if GUI sees we're done with commands, it sees the right time.
+        // Paired with CommandQueue::is_caught_up().
+        if (any_command) {
+            _commands.mark_seen();
+        }
+    };
+
+    if (_seek_target) {
+        auto const budget = std::chrono::duration<double>(
+            SEEK_DUTY_CYCLE * double(nclk_to_play) / double(CLOCKS_PER_S_IDEAL)
+        );
+        auto const deadline =
+            dsp_begin + std::chrono::duration_cast<stats::Clock::duration>(budget);
+
+        if (!fast_forward(deadline)) {
+            // Still seeking. Show the starting point, and output one timer period
+            // of silence.
+            seq_time = SequencerTime(*_seek_target);
+
+            auto const nsamp = (size_t) (nclk_to_play / CLOCKS_PER_SAMPLE);
+            auto silence = gsl::span(_temp_buf).first(nsamp * STEREO_NCHAN);
+            std::fill(silence.begin(), silence.end(), SpcAmplitude(0));
+            mix_chip(silence, upsample::Mix::Overwrite);
+
+            _dsp_ns += stats::elapsed_ns(dsp_begin, stats::Clock::now());
+            finish_tick();
+            return;
+        }
+    }
+
     TimerEvent const action = _sequencer_timing.run_timer();
 
     ChipIndex const nchip = (ChipIndex) _chip_instances.size();
@@ -348,57 +540,185 @@ gsl::span<float> OverallSynth::synthesize_tick_oversampled() {
     }
 
     // Synthesize audio (synth's time passes).
-    NsampT nsamp_written = 0;
+    if (_chip_workers) {
+        // Chips have independent state, so they can run concurrently.
+        auto run_chip = [this, nclk_to_play](size_t chip_index) {
+            _chip_nsamp[chip_index] = _chip_instances[chip_index]->run_chip_for(
+                nclk_to_play, _chip_bufs[chip_index]
+            );
+        };
+        _chip_workers->run(nchip, run_chip);
+    }
+
+    [[maybe_unused]] NsampT nsamp_written = 0;
     for (ChipIndex chip_index = 0; chip_index < nchip; chip_index++) {
-        auto & chip = *_chip_instances[chip_index];
+        gsl::span<SpcAmplitude const> chip_buf;
+        NsampT chip_written;
 
-        NsampT chip_written = chip.run_chip_for(nclk_to_play, _temp_buf);
+        if (_chip_workers) {
+            chip_buf = _chip_bufs[chip_index];
+            chip_written = _chip_nsamp[chip_index];
+        } else {
+            auto & chip = *_chip_instances[chip_index];
+            chip_buf = _temp_buf;
+            chip_written = chip.run_chip_for(nclk_to_play, _temp_buf);
+        }
 
         if (chip_index == 0) {
             nsamp_written = chip_written;
-            _resampler_input.resize(nsamp_written * STEREO_NCHAN * OVERSAMPLING_FACTOR);
-            std::fill(_resampler_input.begin(), _resampler_input.end(), 0.f);
         } else {
             assert(chip_written == nsamp_written);
         }
 
-        for (size_t i = 0; i < chip_written; i++) {
-            // Convert data from short to float.
-            float in_left = _temp_buf[i * STEREO_NCHAN + 0] / (1.0f * 0x8000);
-            float in_right = _temp_buf[i * STEREO_NCHAN + 1] / (1.0f * 0x8000);
-
-            // Perform ZOH upsampling on data.
-            for (size_t j = 0; j < OVERSAMPLING_FACTOR; j++) {
-                _resampler_input[(i * OVERSAMPLING_FACTOR + j) * STEREO_NCHAN + 0] += in_left;
-                _resampler_input[(i * OVERSAMPLING_FACTOR + j) * STEREO_NCHAN + 1] += in_right;
-            }
-        }
+        mix_chip(
+            chip_buf.first(chip_written * STEREO_NCHAN),
+            chip_index == 0 ? upsample::Mix::Overwrite : upsample::Mix::Accumulate);
     }
 
+    _dsp_ns += stats::elapsed_ns(dsp_begin, stats::Clock::now());
+
     // Make sure all register writes have been processed by the synth.
     // Set both read and write pointers to 0,
     // so RegisterWriteQueue won't reject writes on the next tick.
     for (auto & chip : _chip_instances) {
-        chip->flush_register_writes();
+        auto const tick = chip->flush_register_writes();
+        _stats.record_driver_tick(tick.writes, tick.dropped, tick.wait_clocks);
     }
 
-    // TODO filter _resampler_input.
+    maybe_save_checkpoint();
+    finish_tick();
+}
 
-    // Store final time after synthesis completes.
-    if (seq_time != orig_seq_time) {
-        _maybe_seq_time.store(seq_time, std::memory_order_seq_cst);
+void OverallSynth::seek_without_recall(doc::TickT time) {
+    bool const warm_up = !_audio_options.realtime_seek
+        && time > 0
+        && time < _document.extent.song_length
+        && _sequencer_timing.ticks();
+
+    // Seek chip sequencers.
+    for (auto & chip : _chip_instances) {
+        // chip->stop_playback();
+        chip->reset_state(_document);
+        chip->seek(_document, warm_up ? 0 : time);
     }
 
-    // Store "seen command" after timestamp.
-    // This way, if GUI sees we're done with commands, it sees the right time.
-    // Paired with seen_command().
-    if (cmd != orig_cmd) {
-        _seen_command.store(cmd, std::memory_order_release);
+    // Begin playback (start ticking sequencers).
+    _sequencer_timing.play();
+
+    if (warm_up) {
+        // Running only the drivers is far cheaper than running the S-DSP,
+        // so offline renders can afford to do it on every seek.
+        while (!(
+            _sequencer_timing.next_timer_ticks()
+            && _chip_instances[0]->next_tick_time() == time
+        )) {
+            run_timer_silent(false);
+        }
+        for (auto & chip : _chip_instances) {
+            chip->load_shadow_regs();
+        }
     }
+}
 
-    return gsl::span<float>(
-        _resampler_input.data(), nsamp_written * OVERSAMPLING_FACTOR * STEREO_NCHAN
-    );
+void OverallSynth::play_from(doc::TickT time) {
+    _seek_target = std::nullopt;
+
+    bool const recall = _seek_cache.enabled()
+        && time > 0
+        && time < _document.extent.song_length
+        && _sequencer_timing.ticks();
+    if (!recall) {
+        seek_without_recall(time);
+        // Playing from the beginning produces the same state as checkpoints hold.
+        _save_checkpoints = _seek_cache.enabled() && time == 0;
+        return;
+    }
+
+    if (auto checkpoint = _seek_cache.find(time)) {
+        for (size_t chip_index = 0; chip_index < _chip_instances.size(); chip_index++) {
+            _chip_instances[chip_index]->load_snapshot(*checkpoint->chips[chip_index]);
+        }
+        _sequencer_timing.play_from_phase(checkpoint->phase);
+    } else {
+        seek_without_recall(0);
+    }
+
+    _seek_target = time;
+    _save_checkpoints = true;
+}
+
+void OverallSynth::run_timer_silent(bool run_synth) {
+    ClockT const nclk = _sequencer_timing.clocks_per_timer();
+    TimerEvent const action = _sequencer_timing.run_timer();
+
+    for (auto & chip : _chip_instances) {
+        switch (action) {
+        case TimerEvent::TickSequencer:
+            (void) chip->tick_sequencer(_document);
+            break;
+        case TimerEvent::RunDriver:
+            chip->run_driver(_document);
+            break;
+        }
+        if (run_synth) {
+            chip->run_chip_for(nclk, _temp_buf);
+        } else {
+            chip->run_chip_silent();
+        }
+        (void) chip->flush_register_writes();
+    }
+}
+
+bool OverallSynth::fast_forward(stats::Clock::time_point deadline) {
+    doc::TickT const target = *_seek_target;
+
+    // If edits made the starting point unreachable, give up on recalling state.
+    if (target >= _document.extent.song_length || !_sequencer_timing.ticks()) {
+        seek_without_recall(target);
+        _seek_target = std::nullopt;
+        _save_checkpoints = false;
+        return true;
+    }
+
+    while (true) {
+        // Stop right before the timer which plays the starting point.
+        if (_sequencer_timing.next_timer_ticks()
+            && _chip_instances[0]->next_tick_time() == target
+        ) {
+            _seek_target = std::nullopt;
+            return true;
+        }
+        if (_audio_options.realtime_seek && stats::Clock::now() >= deadline) {
+            return false;
+        }
+
+        run_timer_silent(true);
+        maybe_save_checkpoint();
+    }
+}
+
+void OverallSynth::maybe_save_checkpoint() {
+    if (!_save_checkpoints) {
+        return;
+    }
+
+    doc::TickT const time = _chip_instances[0]->next_tick_time();
+    if (time == 0) {
+        // The song looped, so channel state no longer matches playing
+        // from the beginning.
+        _save_checkpoints = false;
+        return;
+    }
+    if (!_sequencer_timing.next_timer_ticks()) {
+        return;
+    }
+    if (auto checkpoint = _seek_cache.slot_to_save(time)) {
+        for (size_t chip_index = 0; chip_index < _chip_instances.size(); chip_index++) {
+            _chip_instances[chip_index]->save_snapshot(*checkpoint->chips[chip_index]);
+        }
+        checkpoint->phase = _sequencer_timing.phase();
+        checkpoint->time = time;
+    }
 }
 
 // end namespace
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "synth/chip_instance_common.h"
+#include "synth/polyphase.h"
+#include "synth/seek_cache.h"
+#include "synth/worker_pool.h"
 #include "audio_common.h"
 #include "callback.h"
 #include "doc.h"
@@ -20,7 +23,7 @@ namespace audio {
 namespace synth {
 
 using chip_instance::ChipInstance;
-using cmd_queue::AudioCommand;
+using cmd_queue::CommandReceiver;
 using timing::MaybeSequencerTime;
 
 class SpcResampler {
@@ -153,6 +156,24 @@ public:
     void play();
     void stop();
 
+    /// If false, the sequencer never advances.
+    bool ticks() const {
+        return _phase_step > 0;
+    }
+
+    /// Whether the next run_timer() call will tick the sequencer.
+    bool next_timer_ticks() const {
+        return _running && uint8_t(_phase + _phase_step) < _phase;
+    }
+
+    uint8_t phase() const {
+        return _phase;
+    }
+
+    /// Begin playback with a phase returned by phase(),
+    /// to resume playback from a checkpoint.
+    void play_from_phase(uint8_t phase);
+
     /// Called once per emulated SNES timer.
     /// Increments the phase accumulator if the song is playing.
     ///
@@ -171,22 +192,52 @@ class OverallSynth : public callback::CallbackInterface {
 private:
     doc::Document _document;
     AudioOptions _audio_options;
+    uint32_t _smp_per_s;
 
     // fields
-    SpcResampler _resampler;
+    /// Exactly one of _resampler and _polyphase is non-empty,
+    /// depending on AudioOptions::resampler.
+    std::optional<SpcResampler> _resampler;
+    std::optional<polyphase::PolyphaseResampler> _polyphase;
+
     std::vector<SpcAmplitude> _temp_buf;
+
+    /// Only used by _resampler.
     std::vector<float> _resampler_input;
 
     /// vector<ChipIndex -> unique_ptr<ChipInstance subclass>>
     /// _chip_instances.size() in [1..MAX_NCHIP] inclusive. Derived from Document::chips.
     std::vector<std::unique_ptr<ChipInstance>> _chip_instances = {};
 
+    /// Only created if AudioOptions::chip_threads > 1 (or 0)
+    /// and the document has multiple chips.
+    std::optional<worker_pool::WorkerPool> _chip_workers;
+
+    /// When running chips on _chip_workers, each chip writes its output
+    /// for the current tick to its own buffer, and the length to _chip_nsamp.
+    /// Chips are then mixed in order on the audio thread.
+    std::vector<std::vector<SpcAmplitude>> _chip_bufs;
+    std::vector<NsampT> _chip_nsamp;
+
     // Playback tracking
-    /// Last seen/processed command.
-    std::atomic<AudioCommand *> _seen_command;
+    /// Commands from the GUI thread.
+    CommandReceiver _commands;
 
     SequencerTiming _sequencer_timing;
 
+    /// Checkpoints for recalling channel state when playback begins mid-song.
+    /// Disabled unless AudioOptions::recall_on_seek.
+    seek_cache::SeekCache _seek_cache;
+
+    /// True if the chips' state matches playing the current document
+    /// from the beginning, so checkpoints may be saved.
+    /// Cleared when playback stops or the document is edited.
+    bool _save_checkpoints = false;
+
+    /// If set, the chips are silently fast-forwarding to this tick,
+    /// and begin playing audio once the next timer plays it.
+    std::optional<doc::TickT> _seek_target;
+
     using AtomicSequencerTime = std::atomic<MaybeSequencerTime>;
     static_assert(
         AtomicSequencerTime::is_always_lock_free,
@@ -195,6 +246,13 @@ private:
 
     AtomicSequencerTime _maybe_seq_time{MaybeSequencerTime{}};
 
+    // Instrumentation
+    stats::AudioStats _stats;
+
+    /// Time spent in each part of the current synthesize_overall() call.
+    uint64_t _commands_ns = 0;
+    uint64_t _dsp_ns = 0;
+
 public:
     // impl
     /// Preconditions:
@@ -205,7 +263,7 @@ public:
         uint32_t stereo_nchan,
         uint32_t smp_per_s,
         doc::Document document,
-        AudioCommand * stub_command,
+        CommandReceiver commands,
         AudioOptions audio_options
     );
 
@@ -221,21 +279,65 @@ public:
         size_t const mono_smp_per_block
     );
 
+    /// Handles commands and runs one SPC timer period like synthesize_overall(),
+    /// but appends the S-DSP's 32 kHz output to `out` instead of resampling it.
+    /// (With multiple chips, each chip's output is appended in turn.)
+    ///
+    /// Used by golden-audio tests, since S-DSP output is bit-exact on every platform,
+    /// unlike the resamplers' floating-point output.
+    void synthesize_tick_raw(std::vector<SpcAmplitude> & out);
+
 private:
-    /// lmfao
+    /// Begins playback at `time`. If _seek_cache is enabled,
+    /// restores the latest checkpoint and sets _seek_target.
+    void play_from(doc::TickT time);
+
+    /// Begins playback at `time`, with the S-DSP reset. Unless
+    /// AudioOptions::realtime_seek, warms up the drivers by running them silently
+    /// from the beginning of the song; otherwise resets them too.
+    void seek_without_recall(doc::TickT time);
+
+    /// Runs the sequencers and drivers for one SPC timer period without output.
+    /// If `run_synth`, runs the S-DSP and discards the audio; otherwise only records
+    /// register writes in each chip's shadow register file.
+    void run_timer_silent(bool run_synth);
+
+    /// Fast-forwards towards _seek_target until reaching it
+    /// or (if AudioOptions::realtime_seek) until `deadline`.
+    /// Returns true (and clears _seek_target) once the seek is finished.
+    bool fast_forward(stats::Clock::time_point deadline);
+
+    /// Saves a checkpoint if the next timer plays a tick at a checkpoint interval.
+    /// Called at the end of each timer, after register writes are flushed.
+    void maybe_save_checkpoint();
+
+    /// Handles GUI commands, then runs the sequencer, driver, and S-DSP
+    /// for one SPC timer period.
+    ///
+    /// Calls mix_chip(gsl::span<SpcAmplitude const>, upsample::Mix) once per chip,
+    /// passing Mix::Overwrite for the first chip and Mix::Accumulate for the rest.
+    template<typename MixChip>
+    void synthesize_tick(MixChip mix_chip);
+
+    /// Runs synthesize_tick() and returns 4x ZOH-upsampled float audio
+    /// for libsamplerate.
     gsl::span<float> synthesize_tick_oversampled();
 
 public:
     /// Called by GUI thread.
-    AudioCommand * seen_command() const override {
-        // Paired with synthesize_overall() store(release).
-        return _seen_command.load(std::memory_order_acquire);
+    MaybeSequencerTime play_time() const override {
+        return _maybe_seq_time.load(std::memory_order_seq_cst);
     }
 
     /// Called by GUI thread.
-    MaybeSequencerTime play_time() const override {
-        return _maybe_seq_time.load(std::memory_order_seq_cst);
+    stats::AudioStats const& stats() const override {
+        return _stats;
     }
+
+    /// Called by the audio output callback after synthesize_overall() returns.
+    void record_callback(
+        stats::Clock::duration elapsed, size_t mono_smp_per_block, bool underflow
+    );
 };
 
 
@@ -68,7 +68,9 @@ NsampWritten ChipInstance::run_chip_for(ClockT num_clocks, WriteTo write_to) {
         case ChipEvent::RegWrite: {
             // This assumes that there is a register write command,
             // and asserts that its time_before == 0.
-            synth_write_reg(_register_writes.pop());
+            RegisterWrite const write = _register_writes.pop();
+            _shadow_regs[write.address] = write.value;
+            synth_write_reg(write);
             fetch_next_reg(_register_writes, chip_events);
             break;
         }
@@ -82,10 +84,25 @@ NsampWritten ChipInstance::run_chip_for(ClockT num_clocks, WriteTo write_to) {
     return nsamp_total;
 }
 
-void ChipInstance::flush_register_writes() {
+void ChipInstance::run_chip_silent() {
+    // Register write times only matter to the synth, so apply writes in order.
+    while (auto * next_reg = _register_writes.peek_mut()) {
+        next_reg->time_before = 0;
+        RegisterWrite const write = _register_writes.pop();
+        _shadow_regs[write.address] = write.value;
+    }
+}
+
+void ChipInstance::load_shadow_regs() {
+    synth_load_regs(_shadow_regs);
+}
+
+music_driver::TickStats ChipInstance::flush_register_writes() {
     // You should not tick the driver before the previous tick finishes playing.
     release_assert_equal(_register_writes.num_unread(), 0);
+    auto const tick_stats = _register_writes.tick_stats();
     _register_writes.clear();
+    return tick_stats;
 }
 
 // end namespace
@@ -7,12 +7,14 @@
 #include "audio/tempo_calc.h"
 #include "doc.h"
 #include "chip_common.h"
+#include "aram_layout.h"
 #include "timing_common.h"
 #include "util/enum_map.h"
 #include "util/copy_move.h"
 
 #include <gsl/span>
 
+#include <memory>
 #include <vector>
 
 namespace audio::synth::chip_instance {
@@ -21,9 +23,18 @@ using namespace chip_common;
 using timing::SequencerTime;
 using music_driver::RegisterWrite;
 using music_driver::RegisterWriteQueue;
+using music_driver::RegisterFile;
+using aram_layout::SampleSet;
 
 using audio::tempo_calc::SAMPLES_PER_S_IDEAL;
 
+/// A copy of a ChipInstance's sequencer, driver, and synth state,
+/// saved by ChipInstance::save_snapshot().
+class ChipSnapshot {
+public:
+    virtual ~ChipSnapshot() = default;
+};
+
 /// Base class (interface-ish) for a single SPC-700's (software driver + sequencers
 /// + hardware emulator synth).
 class ChipInstance {
@@ -35,6 +46,10 @@ protected:
     /// One register write queue per chip.
     RegisterWriteQueue _register_writes;
 
+    /// Every register write popped from _register_writes,
+    /// whether or not it was sent to the synth.
+    RegisterFile _shadow_regs{};
+
 // impl
 public:
     explicit ChipInstance() = default;
@@ -65,23 +80,50 @@ public:
     /// If not playing, ignored.
     virtual void doc_edited(doc::Document const& document) = 0;
 
+    /// Only the blocks of one channel in this chip were edited.
+    /// Recomputes only that channel's position in its event list.
+    virtual void channel_edited(doc::Document const& document, ChannelIndex channel) = 0;
+
 // # Driver methods
 
-    /// Reset driver and synth state. Called before seek() whenever playback begins.
+    /// Reset driver and synth state, and clear the shadow register file.
+    /// Called before seek() whenever playback begins.
     /// You are required to call tick_sequencer() or run_driver() afterwards on the
     /// same tick.
     virtual void reset_state(doc::Document const& document) = 0;
 
     /// Must be called upon construction, or when samples change.
-    /// Repack all samples into RAM, and stops all running notes
-    /// (which would be playing at the wrong point).
-    ///
-    /// TODO only stop samples being played, and remap addresses of running samples
-    /// (construct a mapping table using additional sample allocation/mapping metadata).
-    virtual void reload_samples(doc::Document const& document) = 0;
+    /// Rewrites samples in `edited` (and samples which must move to make room)
+    /// into RAM, and stops notes playing samples which were rewritten or moved.
+    /// Samples outside `edited` must be unchanged since the last call.
+    virtual void reload_samples(doc::Document const& document, SampleSet const& edited)
+        = 0;
+
+    /// Called when instruments or sample tuning change.
+    /// Recomputes the driver's cached instrument data (keysplits and tuning).
+    /// Keeps playing existing notes.
+    virtual void instruments_edited(doc::Document const& document) = 0;
+
+// # Checkpoint methods
+
+    /// Allocates a snapshot to pass to save_snapshot(). Called on the GUI thread.
+    virtual std::unique_ptr<ChipSnapshot> new_snapshot() const = 0;
+
+    /// Copies the sequencer, driver, and synth state (including ARAM)
+    /// into a snapshot returned by new_snapshot(). Doesn't allocate memory.
+    /// Only call at the end of a tick, after flush_register_writes().
+    virtual void save_snapshot(ChipSnapshot & out) = 0;
+
+    /// Restores state saved by save_snapshot(), and discards pending register writes.
+    /// The snapshot must have been saved from a document whose samples, instruments,
+    /// and patterns are unchanged since.
+    virtual void load_snapshot(ChipSnapshot const& in) = 0;
+
+    /// The tick which the next tick_sequencer() call will play.
+    virtual doc::TickT next_tick_time() const = 0;
 
 // # Tick methods. On every SNES timer, call exactly 1 of these,
-// # followed by run_chip_for().
+// # followed by run_chip_for() or run_chip_silent().
 
     /// Run the sequencer to obtain a list of events, then pass them to the driver.
     /// Tell the driver that a sequencer tick has occurred.
@@ -110,8 +152,27 @@ public:
     /// and synth_run_clocks() in between to advance time.
     NsampWritten run_chip_for(ClockT const num_clocks, WriteTo write_to);
 
+    /// Fast-forward mode, for seeking and analysis: records the tick's register writes
+    /// in shadow_regs() without running the synth or generating audio.
+    /// Much faster than run_chip_for(), but leaves the synth behind the driver
+    /// until load_shadow_regs() is called.
+    void run_chip_silent();
+
+    /// The last value the driver wrote to each register since reset_state().
+    /// Updated by both run_chip_for() and run_chip_silent().
+    RegisterFile const& shadow_regs() const {
+        return _shadow_regs;
+    }
+
+    /// After run_chip_silent(), writes the shadow register file into the synth,
+    /// except for registers which trigger notes or only report synth state.
+    /// Afterwards the synth plays with the driver's current settings,
+    /// but with all voices silent until the driver triggers new notes.
+    void load_shadow_regs();
+
     /// Call at the end of each tick.
-    void flush_register_writes();
+    /// Returns the driver's register writes and timing during the tick.
+    music_driver::TickStats flush_register_writes();
 
 // # Implemented by subclasses, called by base class.
 private:
@@ -124,6 +185,9 @@ private:
     virtual NsampWritten synth_run_clocks(
         ClockT nclk,
         WriteTo write_to) = 0;
+
+    /// Called by load_shadow_regs(). Time does not pass.
+    virtual void synth_load_regs(RegisterFile const& regs) = 0;
 };
 
 // end namespaces
@@ -0,0 +1,175 @@
+#include "echo_fir.h"
+#include "util/simd.h"
+
+#include <algorithm>  // std::clamp
+
+namespace audio::synth::echo_fir {
+
+/// The FIR sum of the first 7 taps wraps to int16,
+/// then the last tap is added and clamped (and the LSB cleared).
+static inline int finish(int sum_0_6, int tap_7) {
+    int out = (int16_t) sum_0_6;
+    out += (int16_t) tap_7;
+    return std::clamp(out, -0x8000, 0x7FFF) & ~1;
+}
+
+static inline int scalar_channel(int16_t const* taps, int8_t const* coefs) {
+    int sum = 0;
+    for (size_t i = 0; i < NTAP - 1; i++) {
+        sum += (taps[i] * coefs[i]) >> 6;
+    }
+    return finish(sum, (taps[NTAP - 1] * coefs[NTAP - 1]) >> 6);
+}
+
+static inline void scalar_push(EchoHistory & hist, int sample_shr1) {
+    for (size_t i = 0; i < NTAP - 1; i++) {
+        hist.taps[i] = hist.taps[i + 1];
+    }
+    hist.taps[NTAP - 1] = (int16_t) sample_shr1;
+}
+
+StereoInt echo_fir_scalar(
+    EchoHistory & left, EchoHistory & right, StereoInt new_shr1, int8_t const* coefs
+) {
+    scalar_push(left, new_shr1[0]);
+    scalar_push(right, new_shr1[1]);
+    return {
+        scalar_channel(left.taps.data(), coefs),
+        scalar_channel(right.taps.data(), coefs),
+    };
+}
+
+#if defined(SIMD_SSE2)
+
+/// Returns each tap's product (shifted right by 6) as int32,
+/// for taps 0-3 and 4-7.
+static inline void products(__m128i taps, __m128i coefs, __m128i & p03, __m128i & p47) {
+    // 16x16 -> 32 bit multiply, from the low and high halves of each product.
+    __m128i lo = _mm_mullo_epi16(taps, coefs);
+    __m128i hi = _mm_mulhi_epi16(taps, coefs);
+    p03 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 6);
+    p47 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 6);
+}
+
+/// Sign-extends the low 16 bits of each int32 lane.
+static inline __m128i wrap_int16(__m128i x) {
+    return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+/// Discards the oldest sample and appends a new sample, returning the new taps.
+static inline __m128i simd_push(EchoHistory & hist, int sample_shr1) {
+    auto * taps = (__m128i *) hist.taps.data();
+    __m128i out = _mm_insert_epi16(_mm_srli_si128(_mm_load_si128(taps), 2), sample_shr1, 7);
+    _mm_store_si128(taps, out);
+    return out;
+}
+
+StereoInt echo_fir(
+    EchoHistory & left, EchoHistory & right, StereoInt new_shr1, int8_t const* coefs
+) {
+    // Sign-extend the 8 coefficients to int16.
+    __m128i coefs16 = _mm_loadl_epi64((__m128i const*) coefs);
+    coefs16 = _mm_srai_epi16(_mm_unpacklo_epi8(coefs16, coefs16), 8);
+
+    // Excludes tap 7 from the sum.
+    __m128i const mask_0_6 = _mm_setr_epi32(-1, -1, -1, 0);
+
+    __m128i l03, l47, r03, r47;
+    products(simd_push(left, new_shr1[0]), coefs16, l03, l47);
+    products(simd_push(right, new_shr1[1]), coefs16, r03, r47);
+
+    // [l tap 7, r tap 7, ...]
+    __m128i tap7 = _mm_unpackhi_epi32(l47, r47);
+    tap7 = _mm_unpackhi_epi64(tap7, tap7);
+
+    __m128i l = _mm_add_epi32(l03, _mm_and_si128(l47, mask_0_6));
+    __m128i r = _mm_add_epi32(r03, _mm_and_si128(r47, mask_0_6));
+
+    // Horizontal sums: [l0+l1, r0+r1, l2+l3, r2+r3], then [l, r, ...].
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+    sum = _mm_add_epi32(sum, _mm_unpackhi_epi64(sum, sum));
+
+    // Same as finish(), on both channels: wrap, add tap 7, then clamp to int16
+    // (through saturating packing) and clear the LSB.
+    sum = _mm_add_epi32(wrap_int16(sum), wrap_int16(tap7));
+    sum = _mm_and_si128(_mm_packs_epi32(sum, sum), _mm_set1_epi16(~1));
+
+    auto const out = (uint32_t) _mm_cvtsi128_si32(sum);
+    return {(int16_t) out, (int16_t) (out >> 16)};
+}
+
+#else
+
+StereoInt echo_fir(
+    EchoHistory & left, EchoHistory & right, StereoInt new_shr1, int8_t const* coefs
+) {
+    return echo_fir_scalar(left, right, new_shr1, coefs);
+}
+
+#endif
+
+char const* echo_fir_isa() {
+#if defined(SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+#include <random>
+
+namespace audio::synth::echo_fir {
+
+TEST_CASE("echo_fir() matches scalar implementation") {
+    std::minstd_rand rng{1};
+    std::uniform_int_distribution<int> sample_dist{-0x8000, 0x7fff};
+    std::uniform_int_distribution<int> coef_dist{-0x80, 0x7f};
+
+    EchoHistory left, right;
+    EchoHistory left_ref, right_ref;
+    int8_t coefs[NTAP];
+
+    for (int i = 0; i < 10000; i++) {
+        CAPTURE(i);
+        StereoInt in{sample_dist(rng) >> 1, sample_dist(rng) >> 1};
+        for (auto & coef : coefs) {
+            coef = (int8_t) coef_dist(rng);
+        }
+        // Include extremes, where the last tap's product overflows int16.
+        if (i % 16 == 0) {
+            coefs[NTAP - 1] = -0x80;
+            in[0] = -0x4000;
+        }
+        REQUIRE(
+            echo_fir(left, right, in, coefs)
+            == echo_fir_scalar(left_ref, right_ref, in, coefs));
+        REQUIRE(left.taps == left_ref.taps);
+        REQUIRE(right.taps == right_ref.taps);
+    }
+}
+
+TEST_CASE("echo_fir() wraps the sum of the first 7 taps") {
+    EchoHistory left, right;
+    EchoHistory left_ref, right_ref;
+    int8_t coefs[NTAP] = {0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0};
+
+    StereoInt out, ref;
+    for (size_t i = 0; i < NTAP; i++) {
+        out = echo_fir(left, right, {0x3fff, -0x4000}, coefs);
+        ref = echo_fir_scalar(left_ref, right_ref, {0x3fff, -0x4000}, coefs);
+    }
+
+    // 7 * (0x3fff * 0x7f >> 6) = 227570 overflows int16.
+    CHECK(out[0] == ((int16_t) (7 * ((0x3fff * 0x7f) >> 6)) & ~1));
+    CHECK(out == ref);
+}
+
+}
+
+#endif
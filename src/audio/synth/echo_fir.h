@@ -0,0 +1,52 @@
+#pragma once
+
+/// The S-DSP's echo FIR filter, computed for both channels at once.
+///
+/// SPC_DSP spreads the filter over phases 22-25 (echo_22() to echo_25()),
+/// multiplying one tap at a time through the CALC_FIR macro.
+/// SoaDsp computes the whole filter at once, since it only runs at
+/// sample boundaries. (SoaDsp is the default DspCore, so this runs during
+/// realtime playback. SPC_DSP, selected by DspCore::ClockAccurate, doesn't use it.)
+///
+/// Only the FIR is vectorized. Reading and writing the echo buffer, echo volume,
+/// and feedback are a few scalar operations per channel, in SoaDsp::run_echo_misc().
+
+#include <array>
+#include <cstddef>  // size_t
+#include <cstdint>
+
+namespace audio::synth::echo_fir {
+
+constexpr size_t NTAP = 8;
+
+/// Echo history for one channel. Holds the 8 most recent samples read from
+/// the echo buffer (each shifted right by 1), oldest first.
+struct EchoHistory {
+    alignas(16) std::array<int16_t, NTAP> taps{};
+};
+
+/// A stereo pair of samples, or the echo FIR filter's output.
+using StereoInt = std::array<int, 2>;
+
+/// Appends a new sample (shifted right by 1) to each channel's history,
+/// then runs the echo FIR filter on both channels (where coefs[0] is
+/// FIR register C0, applied to the oldest sample).
+/// Returns the input to echo feedback and echo volume.
+/// Bit-exact with SPC_DSP's echo_22() through echo_25().
+///
+/// Uses SSE2 if enabled at compile time, otherwise scalar code.
+/// (The SSE2 version shifts each history with full-width loads and stores,
+/// since loading 16 bytes right after a 2-byte store stalls store forwarding.)
+StereoInt echo_fir(
+    EchoHistory & left, EchoHistory & right, StereoInt new_shr1, int8_t const* coefs
+);
+
+/// Scalar version of echo_fir(), used as a reference in tests and benchmarks.
+StereoInt echo_fir_scalar(
+    EchoHistory & left, EchoHistory & right, StereoInt new_shr1, int8_t const* coefs
+);
+
+/// Name of the instruction set used by echo_fir(), for benchmark output.
+char const* echo_fir_isa();
+
+}
@@ -5,6 +5,7 @@
 #include "timing_common.h"
 #include "util/enum_map.h"
 
+#include <memory>
 #include <utility>  // std::move
 
 namespace audio::synth::impl_chip {
@@ -13,6 +14,8 @@ using std::move;
 using chip_instance::ChipInstance;
 using chip_instance::RegisterWrite;
 using chip_common::ChipIndex;
+using chip_common::ChannelIndex;
+using chip_instance::SampleSet;
 using timing::SequencerTime;
 
 template<
@@ -68,11 +71,63 @@ public:
     }
 
     void reset_state(doc::Document const& document) override {
+        _shadow_regs = {};
         _driver.reset_state(document, /*mut*/ _synth, /*mut*/ _register_writes);
     }
 
-    void reload_samples(doc::Document const& document) override {
-        _driver.reload_samples(document, /*mut*/ _synth, /*mut*/ _register_writes);
+    void channel_edited(doc::Document const& document, ChannelIndex channel) override {
+        _chip_sequencer.channel_edited(document, channel);
+    }
+
+    void reload_samples(doc::Document const& document, SampleSet const& edited)
+    override {
+        _driver.reload_samples(
+            document, /*mut*/ _synth, /*mut*/ _register_writes, edited
+        );
+    }
+
+    void instruments_edited(doc::Document const& document) override {
+        _driver.update_note_tables(document);
+    }
+
+    struct Snapshot : chip_instance::ChipSnapshot {
+        sequencer::ChipSequencer<ChannelID> chip_sequencer;
+        typename DriverT::State driver;
+        typename SynthT::State synth;
+        chip_instance::RegisterFile shadow_regs{};
+
+        Snapshot(
+            sequencer::ChipSequencer<ChannelID> chip_sequencer,
+            typename DriverT::State driver)
+            : chip_sequencer(move(chip_sequencer))
+            , driver(move(driver))
+            , synth()
+        {}
+    };
+
+    std::unique_ptr<chip_instance::ChipSnapshot> new_snapshot() const override {
+        return std::make_unique<Snapshot>(_chip_sequencer, _driver.state());
+    }
+
+    void save_snapshot(chip_instance::ChipSnapshot & out) override {
+        auto & snapshot = static_cast<Snapshot &>(out);
+        _chip_sequencer.save_to(snapshot.chip_sequencer);
+        _driver.save_state(snapshot.driver);
+        _synth.save_state(snapshot.synth);
+        snapshot.shadow_regs = _shadow_regs;
+    }
+
+    void load_snapshot(chip_instance::ChipSnapshot const& in) override {
+        auto const& snapshot = static_cast<Snapshot const&>(in);
+        _chip_sequencer.load_from(snapshot.chip_sequencer);
+        _driver.load_state(snapshot.driver);
+        _synth.load_state(snapshot.synth);
+        _shadow_regs = snapshot.shadow_regs;
+        _register_writes.clear();
+    }
+
+    doc::TickT next_tick_time() const override {
+        return _chip_sequencer.next_tick_time();
     }
 
     SequencerTime tick_sequencer(doc::Document const& document) override {
@@ -98,6 +153,10 @@ private:  // called by ChipInstance
     override {
         return _synth.run_clocks(nclk, write_to);
     }
+
+    void synth_load_regs(chip_instance::RegisterFile const& regs) override {
+        _synth.load_regs(regs);
+    }
 };
 
 }
@@ -5,7 +5,9 @@
 #include "util/copy_move.h"
 #include "util/release_assert.h"
 
-#include <vector>
+#include <array>
+#include <cstddef>  // size_t
+#include <cstdint>
 
 namespace audio::synth::music_driver {
 
@@ -30,7 +32,28 @@ struct RegisterWrite {
     Byte value;
 };
 
-/// Maybe just inline the methods, don't move to .cpp?
+/// The last value written to each register address.
+using RegisterFile = std::array<Byte, 0x100>;
+
+/// Driver activity during one tick, recorded by RegisterWriteQueue.
+struct TickStats {
+    /// Register writes queued.
+    uint32_t writes = 0;
+    /// Register writes dropped because the queue was full.
+    uint32_t dropped = 0;
+    /// Total clocks passed to RegisterWriteQueue::wait().
+    /// Approximates how long the driver would run on a real SPC700.
+    ClockT wait_clocks = 0;
+};
+
+/// Register writes generated by a driver during one tick, with the time between
+/// writes. The synth reads them back while running the S-DSP for that tick,
+/// then calls clear().
+///
+/// The queue has a fixed capacity, so writing never allocates on the audio thread.
+/// If a tick generates more than CAPACITY writes, the excess writes are dropped
+/// and counted in TickStats::dropped (and the time before them is kept,
+/// so the remaining writes are not shifted in time).
 class RegisterWriteQueue {
 public:
     struct RelativeRegisterWrite {
@@ -38,34 +61,42 @@ public:
         ClockT time_before;
     };
 
+    /// Must be a power of 2.
+    static constexpr size_t CAPACITY = 4 * 1024;
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0);
+
     // fields
 private:
-    std::vector<RelativeRegisterWrite> vec;
+    /// Ring buffer indexed by [index % CAPACITY].
+    std::array<RelativeRegisterWrite, CAPACITY> _ring;
 
     struct WriteState {
         ClockT accum_dtime = 0;
+        /// Total writes queued since clear().
+        size_t index = 0;
     } input;
 
     struct ReadState {
         ClockT prev_time = 0;
+        /// Total writes read since clear(). Never exceeds input.index.
         size_t index = 0;
         bool pending() const {
             return prev_time != 0 || index != 0;
         }
     } output;
 
+    TickStats _tick_stats;
+
     // impl
 public:
     DISABLE_COPY_MOVE(RegisterWriteQueue)
 
-    RegisterWriteQueue() : input{}, output{} {
-        vec.reserve(4 * 1024);
-    }
+    RegisterWriteQueue() : input{}, output{} {}
 
     void clear() {
-        vec.clear();
         input = {};
         output = {};
+        _tick_stats = {};
     }
 
     // Called by OverallDriver’s member drivers.
@@ -74,6 +105,7 @@ public:
     // I think music_driver::TimeRef will make it easier to use.
     void wait(ClockT dtime) {
         input.accum_dtime += dtime;
+        _tick_stats.wait_clocks += dtime;
     }
 
     void wait_write(ClockT dtime, Address address, Byte value) {
@@ -91,32 +123,43 @@ public:
 
     void write(Address address, Byte value) {
         assert(!output.pending());
+        if (input.index - output.index >= CAPACITY) {
+            _tick_stats.dropped++;
+            return;
+        }
+
         RelativeRegisterWrite relative{.write={address, value}, .time_before=input.accum_dtime};
         input.accum_dtime = 0;
 
-        vec.push_back(relative);
+        _ring[input.index++ % CAPACITY] = relative;
+        _tick_stats.writes++;
+    }
+
+    /// Driver activity since the last clear().
+    TickStats const& tick_stats() const {
+        return _tick_stats;
     }
 
     // Called by Synth.
 
     /// Returns a nullable pointer to a RelativeRegisterWrite.
     RelativeRegisterWrite * peek_mut() {  // -> &'Self mut RelativeRegisterWrite
-        if (output.index < vec.size()) {
-            return &vec[output.index];
+        if (output.index < input.index) {
+            return &_ring[output.index % CAPACITY];
         }
 
         return nullptr;
     }
 
     RegisterWrite pop() {
-        release_assert(output.index < vec.size());
-        RelativeRegisterWrite out = vec[output.index++];
+        release_assert(output.index < input.index);
+        RelativeRegisterWrite out = _ring[output.index++ % CAPACITY];
         assert(out.time_before == 0);
         return out.write;
     }
 
     size_t num_unread() {
-        return vec.size() - output.index;
+        return input.index - output.index;
     }
 };
 
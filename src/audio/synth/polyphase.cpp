@@ -0,0 +1,349 @@
+#include "polyphase.h"
+#include "audio/tempo_calc.h"
+#include "util/release_assert.h"
+#include "util/simd.h"
+
+#include <algorithm>  // std::copy, std::min
+#include <cmath>
+#include <numbers>  // std::numbers::pi
+#include <numeric>  // std::gcd
+
+namespace audio::synth::polyphase {
+
+using tempo_calc::SAMPLES_PER_S_IDEAL;
+
+/// Upper bound on the number of coefficient sets, to bound memory usage
+/// (and cache footprint) for output rates sharing few factors with 32040 Hz.
+/// Common rates need fewer: 44100 Hz needs 245, 48000 Hz 400, 96000 Hz 800.
+constexpr uint32_t MAX_PHASES = 1024;
+
+struct FilterParams {
+    uint32_t ntaps;
+    /// Kaiser window shape. Higher values trade transition width for stopband attenuation.
+    double beta;
+    /// Cutoff frequency, as a fraction of the lower Nyquist frequency.
+    double rolloff;
+};
+
+static FilterParams filter_params(PolyphaseQuality quality) {
+    switch (quality) {
+    case PolyphaseQuality::Low:
+        return {8, 5., 0.80};
+    case PolyphaseQuality::Medium:
+        return {16, 7., 0.88};
+    case PolyphaseQuality::High:
+    default:
+        return {32, 9., 0.92};
+    }
+}
+
+uint32_t taps_per_phase(PolyphaseQuality quality) {
+    return filter_params(quality).ntaps;
+}
+
+/// Zeroth-order modified Bessel function of the first kind, used by the Kaiser window.
+static double bessel_i0(double x) {
+    double sum = 1.;
+    double term = 1.;
+    for (int k = 1; k < 50; k++) {
+        double half_x_k = x / (2. * k);
+        term *= half_x_k * half_x_k;
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static double sinc(double x) {
+    if (x == 0.) {
+        return 1.;
+    }
+    return std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+}
+
+PolyphaseResampler::PolyphaseResampler(
+    uint32_t smp_per_s, PolyphaseQuality quality, size_t max_input_frames
+) {
+    release_assert(smp_per_s > 0);
+
+    FilterParams const params = filter_params(quality);
+    _ntaps = params.ntaps;
+
+    uint32_t const in_rate = SAMPLES_PER_S_IDEAL;
+    uint32_t const common = std::gcd(in_rate, smp_per_s);
+    _up = smp_per_s / common;
+    _down = in_rate / common;
+    _nphase = std::min(_up, MAX_PHASES);
+
+    // discard_old_input() assumes each output frame advances by fewer input frames
+    // than the filter length.
+    release_assert(_down < _up * _ntaps);
+
+    // Lowpass below the lower of the input and output Nyquist frequencies.
+    // Measured in cycles per input sample.
+    double const cutoff =
+        0.5 * params.rolloff * std::min(1., double(smp_per_s) / double(in_rate));
+    double const center = _ntaps / 2.;
+
+    _coeffs.resize(size_t(_nphase) * _ntaps);
+    for (uint32_t phase = 0; phase < _nphase; phase++) {
+        float * coeffs = &_coeffs[size_t(phase) * _ntaps];
+        double const frac = double(phase) / double(_nphase);
+
+        double sum = 0.;
+        for (uint32_t tap = 0; tap < _ntaps; tap++) {
+            // Distance (in input samples) from the output sample back to the input
+            // sample multiplied by this tap. The last tap is the newest input sample.
+            double dist = double(_ntaps - 1 - tap) + frac;
+
+            double window_pos = (2. * dist / _ntaps) - 1.;
+            double window = bessel_i0(params.beta * std::sqrt(
+                std::max(0., 1. - window_pos * window_pos)
+            )) / bessel_i0(params.beta);
+
+            double value = 2. * cutoff * sinc(2. * cutoff * (dist - center)) * window;
+            coeffs[tap] = (float) value;
+            sum += value;
+        }
+
+        // Normalize each phase to unity DC gain,
+        // so constant input doesn't produce ripple at the phase rate.
+        for (uint32_t tap = 0; tap < _ntaps; tap++) {
+            coeffs[tap] = (float) (coeffs[tap] / sum);
+        }
+    }
+
+    // Begin with silent history, so the first output frames fade in
+    // rather than reading uninitialized memory.
+    size_t const capacity = _ntaps + max_input_frames;
+    _left.resize(capacity);
+    _right.resize(capacity);
+    _end = _ntaps - 1;
+    _pos = _ntaps - 1;
+}
+
+void PolyphaseResampler::write_input(gsl::span<SpcAmplitude const> in, Mix mix) {
+    constexpr float SCALE = 1.f / float(0x8000);
+    size_t const nframe = in.size() / STEREO_NCHAN;
+
+    if (mix == Mix::Overwrite) {
+        release_assert(_end + nframe <= _left.size());
+        _block_begin = _end;
+        _end += nframe;
+        for (size_t i = 0; i < nframe; i++) {
+            _left[_block_begin + i] = in[i * STEREO_NCHAN + 0] * SCALE;
+            _right[_block_begin + i] = in[i * STEREO_NCHAN + 1] * SCALE;
+        }
+    } else {
+        release_assert_equal(_block_begin + nframe, _end);
+        for (size_t i = 0; i < nframe; i++) {
+            _left[_block_begin + i] += in[i * STEREO_NCHAN + 0] * SCALE;
+            _right[_block_begin + i] += in[i * STEREO_NCHAN + 1] * SCALE;
+        }
+    }
+}
+
+void PolyphaseResampler::discard_old_input() {
+    // The next output frame reads frames (_pos - _ntaps, _pos].
+    size_t const keep_begin = _pos + 1 - _ntaps;
+    if (keep_begin == 0) {
+        return;
+    }
+    std::copy(_left.data() + keep_begin, _left.data() + _end, _left.data());
+    std::copy(_right.data() + keep_begin, _right.data() + _end, _right.data());
+    _end -= keep_begin;
+    _pos -= keep_begin;
+}
+
+#if defined(SIMD_SSE2)
+/// Sums the elements of each accumulator.
+static inline void hsum_stereo(__m128 acc_l, __m128 acc_r, float & out_l, float & out_r) {
+    __m128 lo = _mm_movelh_ps(acc_l, acc_r);  // l0 l1 r0 r1
+    __m128 hi = _mm_movehl_ps(acc_r, acc_l);  // l2 l3 r2 r3
+    __m128 sum = _mm_add_ps(lo, hi);
+    // Add adjacent pairs: [l, l, r, r].
+    sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    out_l = _mm_cvtss_f32(sum);
+    out_r = _mm_cvtss_f32(_mm_movehl_ps(sum, sum));
+}
+#endif
+
+/// Computes the dot product of `coeffs` with both channels' history.
+/// `ntaps` must be a multiple of 8.
+static inline void dot_stereo(
+    float const* left,
+    float const* right,
+    float const* coeffs,
+    size_t ntaps,
+    float & out_left,
+    float & out_right)
+{
+#if defined(SIMD_AVX2)
+    __m256 acc_l = _mm256_setzero_ps();
+    __m256 acc_r = _mm256_setzero_ps();
+    for (size_t i = 0; i < ntaps; i += 8) {
+        __m256 c = _mm256_loadu_ps(coeffs + i);
+        acc_l = _mm256_add_ps(acc_l, _mm256_mul_ps(_mm256_loadu_ps(left + i), c));
+        acc_r = _mm256_add_ps(acc_r, _mm256_mul_ps(_mm256_loadu_ps(right + i), c));
+    }
+    hsum_stereo(
+        _mm_add_ps(_mm256_castps256_ps128(acc_l), _mm256_extractf128_ps(acc_l, 1)),
+        _mm_add_ps(_mm256_castps256_ps128(acc_r), _mm256_extractf128_ps(acc_r, 1)),
+        out_left,
+        out_right);
+#elif defined(SIMD_SSE2)
+    __m128 acc_l = _mm_setzero_ps();
+    __m128 acc_r = _mm_setzero_ps();
+    for (size_t i = 0; i < ntaps; i += 4) {
+        __m128 c = _mm_loadu_ps(coeffs + i);
+        acc_l = _mm_add_ps(acc_l, _mm_mul_ps(_mm_loadu_ps(left + i), c));
+        acc_r = _mm_add_ps(acc_r, _mm_mul_ps(_mm_loadu_ps(right + i), c));
+    }
+    hsum_stereo(acc_l, acc_r, out_left, out_right);
+#else
+    float acc_l[4] = {};
+    float acc_r[4] = {};
+    for (size_t i = 0; i < ntaps; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            acc_l[j] += left[i + j] * coeffs[i + j];
+            acc_r[j] += right[i + j] * coeffs[i + j];
+        }
+    }
+    out_left = (acc_l[0] + acc_l[2]) + (acc_l[1] + acc_l[3]);
+    out_right = (acc_r[0] + acc_r[2]) + (acc_r[1] + acc_r[3]);
+#endif
+}
+
+size_t PolyphaseResampler::process(gsl::span<float> out) {
+    size_t const nframe = out.size() / STEREO_NCHAN;
+    bool const exact_phases = _nphase == _up;
+
+    size_t i = 0;
+    for (; i < nframe && _pos < _end; i++) {
+        uint32_t phase = exact_phases
+            ? _frac
+            : uint32_t(uint64_t(_frac) * _nphase / _up);
+
+        size_t const first = _pos + 1 - _ntaps;
+        dot_stereo(
+            &_left[first],
+            &_right[first],
+            &_coeffs[size_t(phase) * _ntaps],
+            _ntaps,
+            out[i * STEREO_NCHAN + 0],
+            out[i * STEREO_NCHAN + 1]);
+
+        _frac += _down;
+        _pos += _frac / _up;
+        _frac %= _up;
+    }
+    return i;
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+namespace audio::synth::polyphase {
+
+/// Resamples a stereo sine wave (left) and DC (right) from SAMPLES_PER_S_IDEAL,
+/// and returns nframe frames of output.
+static std::vector<float> resample_sine(
+    uint32_t smp_per_s, PolyphaseQuality quality, double freq, size_t nframe
+) {
+    // Approximately one SPC timer period.
+    constexpr size_t BLOCK = 160;
+
+    PolyphaseResampler resampler{smp_per_s, quality, BLOCK};
+    std::vector<SpcAmplitude> in(BLOCK * STEREO_NCHAN);
+    size_t in_time = 0;
+
+    auto generate_input = [&]() {
+        for (size_t i = 0; i < BLOCK; i++) {
+            double t = double(in_time++) / SAMPLES_PER_S_IDEAL;
+            in[i * STEREO_NCHAN + 0] = (SpcAmplitude) std::lround(
+                0x4000 * std::sin(2 * std::numbers::pi * freq * t)
+            );
+            in[i * STEREO_NCHAN + 1] = 0x4000;
+        }
+        // Write the block as two half-amplitude chips, to test Mix::Accumulate.
+        for (auto & smp : in) {
+            smp = SpcAmplitude(smp / 2);
+        }
+        resampler.write_input(in, Mix::Overwrite);
+        resampler.write_input(in, Mix::Accumulate);
+    };
+
+    std::vector<float> out(nframe * STEREO_NCHAN);
+    // Resample in irregularly sized chunks, like an audio callback would.
+    size_t const chunks[] = {1, 64, 480, 1000, 7};
+    size_t done = 0;
+    for (size_t i = 0; done < nframe; i++) {
+        size_t chunk = std::min(chunks[i % std::size(chunks)], nframe - done);
+        resampler.resample(
+            generate_input,
+            gsl::span(out).subspan(done * STEREO_NCHAN, chunk * STEREO_NCHAN));
+        done += chunk;
+    }
+    return out;
+}
+
+static void check_sine(uint32_t smp_per_s, PolyphaseQuality quality) {
+    CAPTURE(smp_per_s);
+    CAPTURE((int) quality);
+
+    constexpr double FREQ = 1000.;
+    size_t const nframe = smp_per_s / 4;
+    auto out = resample_sine(smp_per_s, quality, FREQ, nframe);
+
+    // Skip the initial fade-in from silence.
+    size_t const begin = 256;
+
+    // Correlate the output against sin and cos at the expected frequency.
+    // If the resampler has the wrong ratio, the correlation will be small.
+    double sin_sum = 0, cos_sum = 0, dc_sum = 0, sq_sum = 0;
+    for (size_t i = begin; i < nframe; i++) {
+        double t = double(i) / smp_per_s;
+        double left = out[i * STEREO_NCHAN + 0];
+        sin_sum += left * std::sin(2 * std::numbers::pi * FREQ * t);
+        cos_sum += left * std::cos(2 * std::numbers::pi * FREQ * t);
+        sq_sum += left * left;
+        dc_sum += out[i * STEREO_NCHAN + 1];
+    }
+    double const n = double(nframe - begin);
+    double const amplitude = 2 * std::hypot(sin_sum, cos_sum) / n;
+    double const rms = std::sqrt(sq_sum / n);
+
+    // 0x4000 / 0x8000.
+    CHECK(amplitude == doctest::Approx(0.5).epsilon(0.01));
+    // All output energy should be at the expected frequency.
+    CHECK(rms == doctest::Approx(0.5 / std::sqrt(2.)).epsilon(0.01));
+    CHECK(dc_sum / n == doctest::Approx(0.5).epsilon(0.001));
+}
+
+TEST_CASE("PolyphaseResampler preserves sine amplitude and frequency") {
+    PolyphaseQuality const qualities[] = {
+        PolyphaseQuality::Low, PolyphaseQuality::Medium, PolyphaseQuality::High
+    };
+    uint32_t const rates[] = {32040, 44100, 48000, 96000};
+
+    for (auto quality : qualities) {
+        for (uint32_t rate : rates) {
+            check_sine(rate, quality);
+        }
+    }
+}
+
+TEST_CASE("PolyphaseResampler handles rates with too many phases") {
+    // gcd(32040, 44056) = 8, so the resampler needs 5507 phases
+    // and rounds them to MAX_PHASES.
+    check_sine(44056, PolyphaseQuality::Medium);
+}
+
+}
+
+#endif
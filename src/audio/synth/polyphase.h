@@ -0,0 +1,104 @@
+#pragma once
+
+#include "audio/audio_common.h"
+#include "audio/synth_common.h"
+#include "upsample.h"
+#include "util/copy_move.h"
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <vector>
+
+namespace audio::synth::polyphase {
+
+using upsample::Mix;
+
+/// Number of input samples (filter taps) used to compute each output sample.
+/// Always a multiple of 8, so SIMD loops need no scalar tail.
+uint32_t taps_per_phase(PolyphaseQuality quality);
+
+/// Fixed-ratio polyphase FIR resampler from the S-DSP's nominal sampling rate
+/// (SAMPLES_PER_S_IDEAL) to an output rate.
+///
+/// The ratio out/in is reduced to L/M. Output sample n lies at input time n * M/L,
+/// between two input samples at a fraction p/L (the "phase").
+/// Each phase has its own precomputed set of Kaiser-windowed sinc coefficients,
+/// so producing an output sample is a single dot product over the input history.
+///
+/// Unlike SpcResampler (libsamplerate), this reads the S-DSP's int16 output directly,
+/// without converting it to 4x oversampled float audio first.
+class PolyphaseResampler {
+    uint32_t _ntaps;
+
+    /// Output sampling rate divided by gcd(input rate, output rate).
+    uint32_t _up;
+
+    /// Input sampling rate divided by gcd(input rate, output rate).
+    uint32_t _down;
+
+    /// Number of coefficient sets. Equal to _up unless _up is unreasonably large
+    /// (for unusual output rates), in which case phases are rounded down
+    /// to the nearest of MAX_PHASES evenly spaced phases.
+    uint32_t _nphase;
+
+    /// [phase][tap] float. Taps are stored in order of increasing input time,
+    /// so they line up with the input history.
+    std::vector<float> _coeffs;
+
+    /// Deinterleaved input history, converted from int16 to float.
+    /// Frames [0, _end) are valid.
+    std::vector<float> _left;
+    std::vector<float> _right;
+    size_t _end;
+
+    /// The most recent input frame used to compute the next output frame.
+    /// If _pos >= _end, we need more input.
+    size_t _pos;
+
+    /// Numerator of the next output frame's phase, in [0, _up).
+    uint32_t _frac = 0;
+
+    /// Start of the frames written by the most recent Mix::Overwrite write_input().
+    size_t _block_begin = 0;
+
+public:
+    /// The S-DSP must generate no more than max_input_frames per write_input() call.
+    PolyphaseResampler(
+        uint32_t smp_per_s, PolyphaseQuality quality, size_t max_input_frames
+    );
+    DISABLE_COPY(PolyphaseResampler)
+    DEFAULT_MOVE(PolyphaseResampler)
+
+    /// Called by generate_input() (passed to resample()) once per chip.
+    /// The first chip must pass Mix::Overwrite, which appends frames to the history.
+    /// Other chips must pass Mix::Accumulate with the same number of frames,
+    /// which adds them to the frames just appended.
+    ///
+    /// `in` holds interleaved [smp#, * STEREO_NCHAN + chan#] SpcAmplitude.
+    void write_input(gsl::span<SpcAmplitude const> in, Mix mix);
+
+    /// Fills `out` with interleaved stereo audio, calling generate_input()
+    /// whenever more input is needed.
+    template<typename Fn>
+    void resample(Fn generate_input, gsl::span<float> out) {
+        size_t const nframe = out.size() / STEREO_NCHAN;
+        size_t done = process(out);
+        while (done < nframe) {
+            discard_old_input();
+            generate_input();
+            done += process(out.subspan(done * STEREO_NCHAN));
+        }
+    }
+
+private:
+    /// Writes output frames until `out` is full or input runs out.
+    /// Returns the number of frames written.
+    size_t process(gsl::span<float> out);
+
+    /// Moves the input history needed by future output frames
+    /// to the start of the buffers, making space for write_input().
+    void discard_old_input();
+};
+
+}
@@ -0,0 +1,157 @@
+#include "seek_cache.h"
+
+#include <algorithm>  // std::max
+
+namespace audio::synth::seek_cache {
+
+SeekCache::SeekCache(
+    std::vector<std::unique_ptr<ChipInstance>> const& chips, size_t ncheckpoint
+)
+    : _checkpoints(ncheckpoint)
+{
+    for (auto & checkpoint : _checkpoints) {
+        checkpoint.chips.reserve(chips.size());
+        for (auto const& chip : chips) {
+            checkpoint.chips.push_back(chip->new_snapshot());
+        }
+    }
+}
+
+TickT SeekCache::calc_interval(doc::Document const& document) const {
+    if (_checkpoints.empty()) {
+        return 0;
+    }
+
+    auto const& options = document.sequencer_options;
+    TickT const measure = std::max<TickT>(
+        options.ticks_per_beat * std::max(options.beats_per_measure, 1), 1
+    );
+
+    // Space checkpoints a whole number of measures apart,
+    // so the song (excluding tick 0) fits in _checkpoints.
+    auto const ncheckpoint = (TickT) _checkpoints.size();
+    TickT const nmeasure = (document.extent.song_length + measure - 1) / measure;
+    TickT const measures_per_checkpoint =
+        std::max<TickT>((nmeasure + ncheckpoint - 1) / ncheckpoint, 1);
+
+    return measure * measures_per_checkpoint;
+}
+
+void SeekCache::invalidate(doc::Document const& document) {
+    for (auto & checkpoint : _checkpoints) {
+        checkpoint.time = -1;
+    }
+    _interval = calc_interval(document);
+}
+
+void SeekCache::invalidate_from(doc::Document const& document, TickT begin_tick) {
+    if (calc_interval(document) != _interval) {
+        invalidate(document);
+        return;
+    }
+    // A checkpoint at `time` holds the state before playing `time`.
+    for (auto & checkpoint : _checkpoints) {
+        if (checkpoint.time > begin_tick) {
+            checkpoint.time = -1;
+        }
+    }
+}
+
+Checkpoint * SeekCache::slot_to_save(TickT time) {
+    if (_interval == 0 || time <= 0 || time % _interval != 0) {
+        return nullptr;
+    }
+    auto const idx = (size_t) (time / _interval - 1);
+    if (idx >= _checkpoints.size() || _checkpoints[idx].time != -1) {
+        return nullptr;
+    }
+    return &_checkpoints[idx];
+}
+
+Checkpoint const* SeekCache::find(TickT time) const {
+    if (_interval == 0 || time < _interval) {
+        return nullptr;
+    }
+    auto idx = (size_t) (time / _interval - 1);
+    if (idx >= _checkpoints.size()) {
+        idx = _checkpoints.size() - 1;
+    }
+
+    // Checkpoints are saved lazily, so earlier ones may be missing.
+    for (size_t i = idx + 1; i-- > 0; ) {
+        if (_checkpoints[i].time != -1) {
+            return &_checkpoints[i];
+        }
+    }
+    return nullptr;
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+namespace audio::synth::seek_cache {
+
+TEST_CASE("SeekCache spaces checkpoints by measures and finds earlier checkpoints") {
+    doc::Document document{doc::DocumentCopy{}};
+    document.sequencer_options.ticks_per_beat = 48;
+    document.sequencer_options.beats_per_measure = 4;
+
+    // No chips, so checkpoints hold no snapshots.
+    std::vector<std::unique_ptr<ChipInstance>> const chips;
+    SeekCache cache{chips, 4};
+    REQUIRE(cache.enabled());
+
+    SUBCASE("Short songs get a checkpoint every measure") {
+        document.extent.song_length = 192 * 3;
+        cache.invalidate(document);
+        CHECK(cache.interval() == 192);
+    }
+
+    SUBCASE("Long songs space checkpoints multiple measures apart") {
+        document.extent.song_length = 192 * 9;
+        cache.invalidate(document);
+        CHECK(cache.interval() == 192 * 3);
+
+        CHECK(cache.slot_to_save(0) == nullptr);
+        CHECK(cache.slot_to_save(192) == nullptr);
+        CHECK(cache.find(192 * 5) == nullptr);
+
+        Checkpoint * slot = cache.slot_to_save(192 * 3);
+        REQUIRE(slot);
+        slot->time = 192 * 3;
+        // Already saved.
+        CHECK(cache.slot_to_save(192 * 3) == nullptr);
+
+        CHECK(cache.find(192 * 3 - 1) == nullptr);
+        CHECK(cache.find(192 * 3) == slot);
+        // The checkpoint at 192 * 6 is missing, so find the previous one.
+        CHECK(cache.find(192 * 8) == slot);
+
+        SUBCASE("Editing events after a checkpoint keeps it") {
+            cache.invalidate_from(document, 192 * 3);
+            CHECK(cache.find(192 * 8) == slot);
+        }
+        SUBCASE("Editing events before a checkpoint discards it") {
+            cache.invalidate_from(document, 192 * 3 - 1);
+            CHECK(cache.find(192 * 8) == nullptr);
+        }
+        SUBCASE("Changing the song length can move checkpoints") {
+            document.extent.song_length = 192 * 20;
+            cache.invalidate_from(document, 192 * 8);
+            CHECK(cache.interval() == 192 * 5);
+            CHECK(cache.find(192 * 8) == nullptr);
+        }
+        SUBCASE("Other edits discard all checkpoints") {
+            cache.invalidate(document);
+            CHECK(cache.find(192 * 8) == nullptr);
+            CHECK(cache.slot_to_save(192 * 3) == slot);
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+/// Checkpoints of playback state, saved at measure boundaries while the song plays
+/// from the beginning. When playback begins in the middle of the song,
+/// OverallSynth restores the latest checkpoint before the starting point
+/// and silently fast-forwards from there, so channels play with the same state
+/// (instruments, volumes, held notes, and S-DSP envelopes and echo)
+/// as if the song had played from the beginning.
+///
+/// SeekCache allocates all checkpoints upfront (on the GUI thread),
+/// so saving and restoring checkpoints on the audio thread doesn't allocate memory.
+
+#include "chip_instance_common.h"
+#include "doc.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace audio::synth::seek_cache {
+
+using chip_instance::ChipInstance;
+using chip_instance::ChipSnapshot;
+using doc::TickT;
+
+struct Checkpoint {
+    /// The tick which the timer following this checkpoint plays,
+    /// or -1 if this checkpoint is empty.
+    TickT time = -1;
+
+    /// SequencerTiming's phase accumulator.
+    uint8_t phase = 0;
+
+    /// vector<ChipIndex -> ChipSnapshot>
+    std::vector<std::unique_ptr<ChipSnapshot>> chips;
+};
+
+class SeekCache {
+    /// Ticks between checkpoints. 0 if the cache is disabled.
+    TickT _interval = 0;
+
+    /// Checkpoint i is saved at time (i + 1) * _interval.
+    /// (Tick 0 is never saved, since it's recreated by resetting the chips.)
+    std::vector<Checkpoint> _checkpoints;
+
+public:
+    /// Creates a disabled cache, with no checkpoints.
+    SeekCache() = default;
+
+    /// Allocates `ncheckpoint` checkpoints for `chips`. Called on the GUI thread.
+    /// Call invalidate() before saving checkpoints.
+    SeekCache(std::vector<std::unique_ptr<ChipInstance>> const& chips, size_t ncheckpoint);
+
+    bool enabled() const {
+        return !_checkpoints.empty();
+    }
+
+    TickT interval() const {
+        return _interval;
+    }
+
+    /// Discards all checkpoints, and spaces them one or more measures apart
+    /// so they cover the whole song. Call whenever the document is edited.
+    /// Doesn't allocate memory.
+    void invalidate(doc::Document const& document);
+
+    /// Called when only events playing at or after `begin_tick` changed.
+    /// Keeps checkpoints saved before `begin_tick`, unless the spacing between
+    /// checkpoints changed. Doesn't allocate memory.
+    void invalidate_from(doc::Document const& document, TickT begin_tick);
+
+    /// If a checkpoint should be saved before the timer which plays `time`
+    /// (and hasn't been saved yet), returns the empty checkpoint to fill in.
+    Checkpoint * slot_to_save(TickT time);
+
+    /// Returns the latest checkpoint at or before `time`, if any.
+    Checkpoint const* find(TickT time) const;
+
+private:
+    /// Returns the spacing between checkpoints which covers the whole document.
+    TickT calc_interval(doc::Document const& document) const;
+};
+
+}
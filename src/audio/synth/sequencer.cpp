@@ -22,7 +22,6 @@ namespace audio::synth::sequencer {
 static_assert(std::is_signed_v<TickT>, "TickT must be signed");
 
 using namespace doc;
-using doc_util::track_util::song_length;
 using doc_util::event_search::EventSearch;
 
 static TickT time_in_pattern(TickT now, PatternRef pattern) {
@@ -119,6 +118,24 @@ ChannelSequencer::ChannelSequencer() {
     stop_playback();
 }
 
+void ChannelSequencer::save_to(ChannelSequencer & out) const {
+    // Copying _events_this_tick would allocate memory in `out`.
+    out._chip_index = _chip_index;
+    out._chan_index = _chan_index;
+    out._now = _now;
+    out._ignore_ordering_errors = _ignore_ordering_errors;
+    out._curr_pattern_next_ev = _curr_pattern_next_ev;
+}
+
+void ChannelSequencer::load_from(ChannelSequencer const& in) {
+    _chip_index = in._chip_index;
+    _chan_index = in._chan_index;
+    _events_this_tick.clear();
+    _now = in._now;
+    _ignore_ordering_errors = in._ignore_ordering_errors;
+    _curr_pattern_next_ev = in._curr_pattern_next_ev;
+}
+
 void ChannelSequencer::stop_playback() {
     // Reset fields.
     // Unnecessary?
@@ -261,7 +278,7 @@ std::tuple<SequencerTime, EventsRef> ChannelSequencer::next_tick(
                 pattern_ended = true;
 
                 // May take us past the last pattern in the song. If so, do nothing and
-                // loop once we reach song_length().
+                // loop once we reach document.extent.song_length.
                 ev_next_pattern(events, track);
                 continue;
 
@@ -319,12 +336,12 @@ std::tuple<SequencerTime, EventsRef> ChannelSequencer::next_tick(
     // Next tick (not processed yet). We must increment _now *after* processing notes,
     // otherwise we'd fail to process notes at tick 0 (or seek(_)).
     _now++;
-    if (_now >= song_length(document.sequence)) {
+    if (_now >= document.extent.song_length) {
         #ifdef SEQUENCER_DEBUG
         fmt::print(stderr,
             "\t{} >= length {}, looping song to time 0\n",
             _now,
-            song_length(document.sequence));
+            document.extent.song_length);
         #endif
 
         // TODO add user-specified loop point alongside bookmarks and tsig changes
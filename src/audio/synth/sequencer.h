@@ -103,6 +103,19 @@ public:
         _chan_index = chan_index;
     }
 
+    /// The tick which the next call to next_tick() will play.
+    TickT next_tick_time() const {
+        return _now;
+    }
+
+    /// Copies playback state into a checkpoint, except for _events_this_tick
+    /// (which is only used until the next tick). Doesn't allocate memory.
+    void save_to(ChannelSequencer & out) const;
+
+    /// Restores playback state from a checkpoint, and clears _events_this_tick.
+    /// Doesn't allocate memory.
+    void load_from(ChannelSequencer const& in);
+
     /// Sets _now to 0, and _curr_pattern_next_ev ("is playing") to nullopt.
     ///
     /// Postconditions:
@@ -153,6 +166,18 @@ public:
         }
     }
 
+    void save_to(ChipSequencer & out) const {
+        for (ChannelIndex chan = 0; chan < enum_count<ChannelID>; chan++) {
+            _channel_sequencers[chan].save_to(out._channel_sequencers[chan]);
+        }
+    }
+
+    void load_from(ChipSequencer const& in) {
+        for (ChannelIndex chan = 0; chan < enum_count<ChannelID>; chan++) {
+            _channel_sequencers[chan].load_from(in._channel_sequencers[chan]);
+        }
+    }
+
     void stop_playback() {
         for (ChannelIndex chan = 0; chan < enum_count<ChannelID>; chan++) {
             _channel_sequencers[chan].stop_playback();
@@ -171,6 +196,17 @@ public:
         }
     }
 
+    /// Only one channel's blocks were edited.
+    void channel_edited(doc::Document const & document, ChannelIndex chan) {
+        release_assert(chan < enum_count<ChannelID>);
+        _channel_sequencers[chan].doc_edited(document);
+    }
+
+    /// All channels' sequencers stay in sync, so return the first one's time.
+    TickT next_tick_time() const {
+        return _channel_sequencers[0].next_tick_time();
+    }
+
     std::tuple<SequencerTime, EnumMap<ChannelID, EventsRef>> sequencer_tick(
         doc::Document const & document
     ) {
@@ -0,0 +1,866 @@
+#include "soa_dsp.h"
+#include "util/simd.h"
+
+#include <snes9x-dsp/SPC_DSP.h>
+
+#include <algorithm>  // std::clamp, std::copy
+#include <array>
+#include <cassert>
+
+namespace audio::synth::soa_dsp {
+
+using Dsp = SPC_DSP;
+
+static constexpr int BRR_BLOCK_SIZE = 9;
+static constexpr int SIMPLE_COUNTER_RANGE = 2048 * 5 * 3;  // 30720
+
+enum EnvMode : int32_t {
+    Release = Dsp::env_release,
+    Attack = Dsp::env_attack,
+    Decay = Dsp::env_decay,
+    Sustain = Dsp::env_sustain,
+};
+
+static inline int clamp16(int x) {
+    // Same as SPC_DSP's CLAMP16().
+    return std::clamp(x, -0x8000, 0x7FFF);
+}
+
+static inline size_t vreg_addr(size_t v, int reg) {
+    return v * 0x10 + (size_t) reg;
+}
+
+/// For each rate, Dsp::counter_rates[rate] divides x if and only if
+/// uint32_t(x * mul) <= max, for all x < 0x10000 (Lemire's divisibility test).
+/// This avoids dividing on every voice's envelope, on every sample.
+struct CounterDivisor {
+    uint32_t mul;
+    uint32_t max;
+};
+
+static std::array<CounterDivisor, 32> const COUNTER_DIVISORS = [] {
+    std::array<CounterDivisor, 32> out;
+    for (size_t rate = 0; rate < out.size(); rate++) {
+        // ceil(2^32 / d), which wraps to 0 when d = 1 (so every x passes).
+        uint64_t const c = 0xFFFF'FFFFu / Dsp::counter_rates[rate] + 1;
+        out[rate] = {(uint32_t) c, (uint32_t) (c - 1)};
+    }
+    return out;
+}();
+
+#if defined(SIMD_SSE2)
+
+static inline __m128i select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/// Multiplies 8 int16 lanes, returning (a * b) >> shift as int32 lanes 0-3 and 4-7.
+static inline void mul_shr(__m128i a, __m128i b, int shift, __m128i & lo, __m128i & hi) {
+    __m128i const prod_lo = _mm_mullo_epi16(a, b);
+    __m128i const prod_hi = _mm_mulhi_epi16(a, b);
+    lo = _mm_srai_epi32(_mm_unpacklo_epi16(prod_lo, prod_hi), shift);
+    hi = _mm_srai_epi32(_mm_unpackhi_epi16(prod_lo, prod_hi), shift);
+}
+
+/// Sign-extends the low 16 bits of each int32 lane.
+static inline __m128i wrap_int16(__m128i x) {
+    return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+/// Adds 4 voices' amplitudes to `total` ([main L, main R, echo L, echo R]),
+/// clamping to int16 after each voice. `echo` selects which voices are added
+/// to the echo total.
+static inline __m128i mix_4_voices(__m128i total, __m128i l, __m128i r, __m128i echo) {
+    __m128i const echo_l = _mm_and_si128(l, echo);
+    __m128i const echo_r = _mm_and_si128(r, echo);
+    __m128i const lr_01 = _mm_unpacklo_epi32(l, r);
+    __m128i const lr_23 = _mm_unpackhi_epi32(l, r);
+    __m128i const echo_01 = _mm_unpacklo_epi32(echo_l, echo_r);
+    __m128i const echo_23 = _mm_unpackhi_epi32(echo_l, echo_r);
+
+    __m128i const voices[4] = {
+        _mm_unpacklo_epi64(lr_01, echo_01),
+        _mm_unpackhi_epi64(lr_01, echo_01),
+        _mm_unpacklo_epi64(lr_23, echo_23),
+        _mm_unpackhi_epi64(lr_23, echo_23),
+    };
+    for (__m128i const voice : voices) {
+        // Clamp through saturating packing, then sign-extend back to int32.
+        __m128i const sum = _mm_add_epi32(total, voice);
+        __m128i const clamped = _mm_packs_epi32(sum, sum);
+        total = _mm_srai_epi32(_mm_unpacklo_epi16(clamped, clamped), 16);
+    }
+    return total;
+}
+
+#endif
+
+void SoaDsp::init(uint8_t * ram_64k) {
+    _ram = ram_64k;
+
+    auto const& regs = Dsp::initial_regs;
+    std::copy(std::begin(regs), std::end(regs), _regs);
+
+    _brr_offset.fill(1);
+    _new_kon = _regs[Dsp::r_kon];
+    _t_dir = _regs[Dsp::r_dir];
+    _t_esa = _regs[Dsp::r_esa];
+
+    _noise = 0x4000;
+    _every_other_sample = 1;
+
+    // After reset, all voice state is zero, so running voice 0's V3c and V4
+    // on the first sample (which SPC_DSP doesn't) has no effect.
+    _v0_regs = Voice0Regs {
+        .flg = _regs[Dsp::r_flg],
+        .adsr1 = _regs[vreg_addr(0, Dsp::v_adsr1)],
+        .gain = _regs[vreg_addr(0, Dsp::v_gain)],
+        .voll = _regs[vreg_addr(0, Dsp::v_voll)],
+    };
+}
+
+void SoaDsp::set_output(sample_t * out, size_t size) {
+    assert(size % 2 == 0);
+    _out = out;
+    _out_end = out + size;
+}
+
+void SoaDsp::copy_state(SoaDsp const& other) {
+    uint8_t * const ram = _ram;
+    sample_t * const out = _out;
+    sample_t * const out_end = _out_end;
+
+    *this = other;
+
+    _ram = ram;
+    _out = out;
+    _out_end = out_end;
+}
+
+void SoaDsp::write(int addr, int data) {
+    assert((unsigned) addr < REGISTER_COUNT);
+    _regs[addr] = (uint8_t) data;
+
+    // ENVX and OUTX writes are overwritten before the DSP reads them back,
+    // since all writes take effect at sample boundaries.
+    if (addr == Dsp::r_kon) {
+        _new_kon = (uint8_t) data;
+    }
+    if (addr == Dsp::r_endx) {
+        // always cleared, regardless of data written
+        _regs[Dsp::r_endx] = 0;
+    }
+}
+
+void SoaDsp::run(int clocks) {
+    _clocks += clocks;
+    while (_clocks >= CLOCKS_PER_SAMPLE) {
+        _clocks -= CLOCKS_PER_SAMPLE;
+        run_sample();
+    }
+}
+
+void SoaDsp::run_sample() {
+    // Voices 1-7's V1-V3b (phases 0-19) only read ARAM and registers,
+    // so they can run before every voice's V3c.
+    // Voices 1 and 2 read SRCN during the previous sample.
+    for (size_t v = 1; v < NVOICE; v++) {
+        int const srcn = v < 3
+            ? _srcn_latch[v]
+            : _regs[vreg_addr(v, Dsp::v_srcn)];
+        read_voice(v, srcn);
+    }
+
+    if (voices_idle()) {
+        run_idle_voices();
+        run_echo_misc(Mix{});
+    } else {
+        run_echo_misc(run_voices());
+    }
+
+    _v0_regs = Voice0Regs {
+        .flg = _regs[Dsp::r_flg],
+        .adsr1 = _regs[vreg_addr(0, Dsp::v_adsr1)],
+        .gain = _regs[vreg_addr(0, Dsp::v_gain)],
+        .voll = _regs[vreg_addr(0, Dsp::v_voll)],
+    };
+}
+
+void SoaDsp::read_voice(size_t v, int srcn) {
+    // V1
+    int const dir_addr = (_t_dir * 0x100 + srcn * 4) & 0xFFFF;
+
+    // V2: Read sample pointer (ignored if not needed)
+    uint8_t const* entry = &_ram[(size_t) dir_addr];
+    if (!_kon_delay[v]) {
+        entry += 2;
+    }
+    _brr_next_addr[v] = entry[0] | entry[1] << 8;
+    _adsr0[v] = _regs[vreg_addr(v, Dsp::v_adsr0)];
+
+    // V2, V3a: Read pitch
+    _pitch[v] = _regs[vreg_addr(v, Dsp::v_pitchl)]
+        + ((_regs[vreg_addr(v, Dsp::v_pitchh)] & 0x3F) << 8);
+
+    // V3b: Read BRR header and byte
+    _brr_byte[v] = _ram[(_brr_addr[v] + _brr_offset[v]) & 0xFFFF];
+    _brr_header[v] = _ram[_brr_addr[v]];  // brr_addr doesn't need masking
+}
+
+bool SoaDsp::counter_fires(int rate) const {
+    // Same as !SPC_DSP::read_counter(rate).
+    auto const x = (uint32_t) _counter + Dsp::counter_offsets[rate];
+    CounterDivisor const div = COUNTER_DIVISORS[(size_t) rate];
+    return x * div.mul <= div.max;
+}
+
+void SoaDsp::decode_brr(size_t v) {
+    // Arrange the four input nybbles in 0xABCD order for easy decoding
+    int nybbles = _brr_byte[v] * 0x100
+        + _ram[(_brr_addr[v] + _brr_offset[v] + 1) & 0xFFFF];
+
+    int const header = _brr_header[v];
+
+    // Write to next four samples in circular buffer
+    int32_t * pos = &_buf[v][(size_t) _buf_pos[v]];
+    if ((_buf_pos[v] += 4) >= BRR_BUF_SIZE) {
+        _buf_pos[v] = 0;
+    }
+
+    // Decode four samples
+    for (int32_t * end = pos + 4; pos < end; pos++, nybbles <<= 4) {
+        // Extract nybble and sign-extend
+        int s = (int16_t) nybbles >> 12;
+
+        // Shift sample based on header
+        int const shift = header >> 4;
+        s = (s << shift) >> 1;
+        if (shift >= 0xD) {  // handle invalid range
+            s = (s >> 25) << 11;  // same as: s = (s < 0 ? -0x800 : 0)
+        }
+
+        // Apply IIR filter (8 is the most commonly used)
+        int const filter = header & 0x0C;
+        int const p1 = pos[BRR_BUF_SIZE - 1];
+        int const p2 = pos[BRR_BUF_SIZE - 2] >> 1;
+        if (filter >= 8) {
+            s += p1;
+            s -= p2;
+            if (filter == 8) {  // s += p1 * 0.953125 - p2 * 0.46875
+                s += p2 >> 4;
+                s += (p1 * -3) >> 6;
+            } else {  // s += p1 * 0.8984375 - p2 * 0.40625
+                s += (p1 * -13) >> 7;
+                s += (p2 * 3) >> 4;
+            }
+        } else if (filter) {  // s += p1 * 0.46875
+            s += p1 >> 1;
+            s += (-p1) >> 5;
+        }
+
+        // Adjust and write sample
+        s = clamp16(s);
+        s = (int16_t) (s * 2);
+        pos[BRR_BUF_SIZE] = pos[0] = s;  // second copy simplifies wrap-around
+    }
+}
+
+void SoaDsp::step_brr(size_t v) {
+    _looped[v] = 0;
+    if (_interp_pos[v] >= 0x4000) {
+        decode_brr(v);
+
+        if ((_brr_offset[v] += 2) >= BRR_BLOCK_SIZE) {
+            // Start decoding next BRR block
+            assert(_brr_offset[v] == BRR_BLOCK_SIZE);
+            _brr_addr[v] = (_brr_addr[v] + BRR_BLOCK_SIZE) & 0xFFFF;
+            if (_brr_header[v] & 1) {
+                _brr_addr[v] = _brr_next_addr[v];
+                _looped[v] = 1 << v;
+            }
+            _brr_offset[v] = 1;
+        }
+    }
+}
+
+/// A voice is silent if it's released with a zero envelope.
+/// It stays silent until KON.
+static inline bool is_silent(int kon_delay, int env_mode, int env) {
+    return !kon_delay && env_mode == Release && !env;
+}
+
+bool SoaDsp::voices_idle() const {
+    // KON takes effect during this sample.
+    if (_every_other_sample && _kon) {
+        return false;
+    }
+    bool idle = true;
+    for (size_t v = 0; v < NVOICE; v++) {
+        idle &= is_silent(_kon_delay[v], _env_mode[v], _env[v]);
+    }
+    return idle;
+}
+
+void SoaDsp::run_idle_voices() {
+    // Silent voices output 0 and their envelopes stay at 0 (even on KOFF or
+    // soft reset), and PMON from a silent voice has no effect. But they still
+    // play through BRR data and set ENDX at each end block. And they must decode
+    // it, since the first BRR block after KON filters the previous samples.
+    int endx = _regs[Dsp::r_endx];
+    for (size_t v = 0; v < NVOICE; v++) {
+        _output[v] = 0;
+        _envx_out[v] = 0;
+
+        step_brr(v);
+        _interp_pos[v] = std::min((_interp_pos[v] & 0x3FFF) + _pitch[v], 0x7FFF);
+
+        endx |= _looped[v];
+        _regs[vreg_addr(v, Dsp::v_outx)] = 0;
+        _regs[vreg_addr(v, Dsp::v_envx)] = 0;
+    }
+    _regs[Dsp::r_endx] = (uint8_t) endx;
+
+    read_voice(0, _regs[vreg_addr(0, Dsp::v_srcn)]);
+    _srcn_latch[1] = _regs[vreg_addr(1, Dsp::v_srcn)];
+    _srcn_latch[2] = _regs[vreg_addr(2, Dsp::v_srcn)];
+}
+
+SoaDsp::Mix SoaDsp::run_voices() {
+    // Each loop over `v` runs one stage for all voices.
+    // Loops without a serial dependency between voices are written branch-free
+    // so the compiler can vectorize them.
+
+    // Registers read by V3c-V5. Voice 0 reads the previous sample's values.
+    alignas(32) Lanes<int32_t> flg, adsr1, gain, voll, volr;
+    for (size_t v = 0; v < NVOICE; v++) {
+        flg[v] = _regs[Dsp::r_flg];
+        adsr1[v] = _regs[vreg_addr(v, Dsp::v_adsr1)];
+        gain[v] = _regs[vreg_addr(v, Dsp::v_gain)];
+        voll[v] = (int8_t) _regs[vreg_addr(v, Dsp::v_voll)];
+        volr[v] = (int8_t) _regs[vreg_addr(v, Dsp::v_volr)];
+    }
+    flg[0] = _v0_regs.flg;
+    adsr1[0] = _v0_regs.adsr1;
+    gain[0] = _v0_regs.gain;
+    voll[0] = (int8_t) _v0_regs.voll;
+
+    // V3c: Get ready to start BRR decoding on KON.
+    alignas(32) Lanes<int32_t> konning;
+    for (size_t v = 0; v < NVOICE; v++) {
+        int const kon_delay = _kon_delay[v];
+        bool const start = kon_delay == 5;
+        konning[v] = kon_delay != 0;
+
+        _brr_addr[v] = start ? _brr_next_addr[v] : _brr_addr[v];
+        _brr_offset[v] = start ? 1 : _brr_offset[v];
+        _buf_pos[v] = start ? 0 : _buf_pos[v];
+        // header is ignored on this sample
+        _brr_header[v] = start ? 0 : _brr_header[v];
+
+        // Envelope is never run during KON
+        _env[v] = konning[v] ? 0 : _env[v];
+        _hidden_env[v] = konning[v] ? 0 : _hidden_env[v];
+
+        // Disable BRR decoding until last three samples
+        int const next_delay = kon_delay - konning[v];
+        _kon_delay[v] = next_delay;
+        _interp_pos[v] = konning[v]
+            ? (next_delay & 3 ? 0x4000 : 0)
+            : _interp_pos[v];
+    }
+
+    // V3c: Gaussian interpolation.
+    // Input samples and gaussian coefficients both fit in int16.
+    alignas(16) Lanes<int16_t> in0, in1, in2, in3, fwd0, fwd1, rev1, rev0;
+    for (size_t v = 0; v < NVOICE; v++) {
+        int32_t const* in = &_buf[v][size_t((_interp_pos[v] >> 12) + _buf_pos[v])];
+        in0[v] = (int16_t) in[0];
+        in1[v] = (int16_t) in[1];
+        in2[v] = (int16_t) in[2];
+        in3[v] = (int16_t) in[3];
+
+        // Mirror left half of gaussian
+        int const offset = _interp_pos[v] >> 4 & 0xFF;
+        fwd0[v] = Dsp::gauss[255 - offset];
+        fwd1[v] = Dsp::gauss[511 - offset];
+        rev1[v] = Dsp::gauss[256 + offset];
+        rev0[v] = Dsp::gauss[offset];
+    }
+
+    int const noise = (int16_t) (_noise * 2);
+#if defined(SIMD_SSE2)
+    {
+        auto load = [](Lanes<int16_t> const& x) {
+            return _mm_load_si128((__m128i const*) x.data());
+        };
+        __m128i p0_lo, p0_hi, p1_lo, p1_hi, p2_lo, p2_hi, p3_lo, p3_hi;
+        mul_shr(load(fwd0), load(in0), 11, p0_lo, p0_hi);
+        mul_shr(load(fwd1), load(in1), 11, p1_lo, p1_hi);
+        mul_shr(load(rev1), load(in2), 11, p2_lo, p2_hi);
+        mul_shr(load(rev0), load(in3), 11, p3_lo, p3_hi);
+
+        // The first three products wrap to int16, then the last is added.
+        // Clamp to int16 (through saturating packing) and clear the LSB.
+        __m128i const out_lo = _mm_add_epi32(
+            wrap_int16(_mm_add_epi32(_mm_add_epi32(p0_lo, p1_lo), p2_lo)), p3_lo
+        );
+        __m128i const out_hi = _mm_add_epi32(
+            wrap_int16(_mm_add_epi32(_mm_add_epi32(p0_hi, p1_hi), p2_hi)), p3_hi
+        );
+        __m128i out = _mm_and_si128(
+            _mm_packs_epi32(out_lo, out_hi), _mm_set1_epi16(~1)
+        );
+
+        // Noise
+        __m128i const voice_bits = _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128);
+        __m128i const is_noise = _mm_cmpeq_epi16(
+            _mm_and_si128(_mm_set1_epi16((int16_t) _t_non), voice_bits), voice_bits
+        );
+        out = select(is_noise, _mm_set1_epi16((int16_t) noise), out);
+
+        // Apply envelope (which fits in int16).
+        auto * env = (__m128i const*) _env.data();
+        __m128i const env_lo = _mm_load_si128(env);
+        __m128i const env_hi = _mm_load_si128(env + 1);
+        __m128i amp_lo, amp_hi;
+        mul_shr(out, _mm_packs_epi32(env_lo, env_hi), 11, amp_lo, amp_hi);
+
+        auto * output = (__m128i *) _output.data();
+        _mm_store_si128(output, _mm_and_si128(amp_lo, _mm_set1_epi32(~1)));
+        _mm_store_si128(output + 1, _mm_and_si128(amp_hi, _mm_set1_epi32(~1)));
+
+        auto * envx_out = (__m128i *) _envx_out.data();
+        _mm_store_si128(envx_out, _mm_srai_epi32(env_lo, 4));
+        _mm_store_si128(envx_out + 1, _mm_srai_epi32(env_hi, 4));
+    }
+#else
+    for (size_t v = 0; v < NVOICE; v++) {
+        int out = (fwd0[v] * in0[v]) >> 11;
+        out += (fwd1[v] * in1[v]) >> 11;
+        out += (rev1[v] * in2[v]) >> 11;
+        out = (int16_t) out;
+        out += (rev0[v] * in3[v]) >> 11;
+        out = clamp16(out) & ~1;
+
+        // Noise
+        out = _t_non >> v & 1 ? noise : out;
+
+        // Apply envelope
+        _output[v] = (out * _env[v]) >> 11 & ~1;
+        _envx_out[v] = (uint8_t) (_env[v] >> 4);
+    }
+#endif
+
+    // V3c: Pitch modulation using previous voice's output.
+    // Voice 0 doesn't support PMON.
+    for (size_t v = 1; v < NVOICE; v++) {
+        if (_t_pmon >> v & 1) {
+            _pitch[v] += ((_output[v - 1] >> 5) * _pitch[v]) >> 10;
+        }
+    }
+    for (size_t v = 0; v < NVOICE; v++) {
+        // Pitch is never added during KON
+        _pitch[v] = konning[v] ? 0 : _pitch[v];
+    }
+
+    // V3c: Immediate silence due to end of sample or soft reset, then KOFF and KON.
+    for (size_t v = 0; v < NVOICE; v++) {
+        bool const silence = flg[v] & 0x80 || (_brr_header[v] & 3) == 1;
+        _env_mode[v] = silence ? Release : _env_mode[v];
+        _env[v] = silence ? 0 : _env[v];
+
+        if (_every_other_sample) {
+            _env_mode[v] = _t_koff >> v & 1 ? Release : _env_mode[v];
+
+            bool const kon = _kon >> v & 1;
+            _kon_delay[v] = kon ? 5 : _kon_delay[v];
+            _env_mode[v] = kon ? Attack : _env_mode[v];
+        }
+    }
+
+    // V3c: Run envelope for next sample.
+#if defined(SIMD_SSE2)
+    // Four voices per iteration, in int32 lanes.
+    for (size_t v = 0; v < NVOICE; v += 4) {
+        auto load = [v](Lanes<int32_t> const& x) {
+            return _mm_load_si128((__m128i const*) &x[v]);
+        };
+        auto store = [v](Lanes<int32_t> & x, __m128i value) {
+            _mm_store_si128((__m128i *) &x[v], value);
+        };
+        auto set1 = [](int32_t x) { return _mm_set1_epi32(x); };
+        __m128i const zero = _mm_setzero_si128();
+
+        __m128i const env = load(_env);
+        __m128i const mode = load(_env_mode);
+        __m128i const hidden = load(_hidden_env);
+        __m128i const adsr0 = load(_adsr0);
+        __m128i const adsr1_v = load(adsr1);
+        __m128i const gain_v = load(gain);
+
+        // Compute each voice's next envelope (if the counter fires) and rate.
+        __m128i const is_attack = _mm_cmpeq_epi32(mode, set1(Attack));
+        __m128i const is_decay = _mm_cmpeq_epi32(mode, set1(Decay));
+        __m128i const env_m1 = _mm_sub_epi32(env, set1(1));
+        __m128i const exp_decrease = _mm_sub_epi32(env_m1, _mm_srai_epi32(env_m1, 8));
+
+        // ADSR
+        __m128i const attack_nybble = _mm_and_si128(adsr0, set1(0x0F));
+        __m128i const adsr_rate = select(
+            is_attack,
+            _mm_add_epi32(_mm_slli_epi32(attack_nybble, 1), set1(1)),
+            select(
+                is_decay,
+                _mm_add_epi32(
+                    _mm_and_si128(_mm_srli_epi32(adsr0, 3), set1(0x0E)), set1(0x10)
+                ),
+                _mm_and_si128(adsr1_v, set1(0x1F))));
+        // attack_rate < 31 unless the nybble is 0xF.
+        __m128i const attack_step = select(
+            _mm_cmpeq_epi32(attack_nybble, set1(0x0F)), set1(0x400), set1(0x20)
+        );
+        __m128i const adsr_env =
+            select(is_attack, _mm_add_epi32(env, attack_step), exp_decrease);
+
+        // GAIN
+        __m128i const gain_mode = _mm_srli_epi32(gain_v, 5);
+        __m128i const direct = _mm_cmplt_epi32(gain_mode, set1(4));
+        // (unsigned) _hidden_env >= 0x600
+        __m128i const hidden_high = _mm_or_si128(
+            _mm_cmpgt_epi32(hidden, set1(0x5FF)), _mm_cmplt_epi32(hidden, zero)
+        );
+        __m128i const bent = _mm_and_si128(
+            _mm_cmpgt_epi32(gain_mode, set1(6)), hidden_high
+        );
+        __m128i const bent_increase =
+            _mm_add_epi32(env, select(bent, set1(0x8), set1(0x20)));
+        __m128i const gain_rate =
+            select(direct, set1(31), _mm_and_si128(gain_v, set1(0x1F)));
+        __m128i const gain_env = select(
+            direct,
+            _mm_slli_epi32(gain_v, 4),  // direct
+            select(
+                _mm_cmpeq_epi32(gain_mode, set1(4)),
+                _mm_sub_epi32(env, set1(0x20)),  // linear decrease
+                select(
+                    _mm_cmpeq_epi32(gain_mode, set1(5)),
+                    exp_decrease,  // exponential decrease
+                    bent_increase)));  // linear or two-slope linear increase
+
+        __m128i const adsr = _mm_cmpeq_epi32(_mm_and_si128(adsr0, set1(0x80)), set1(0x80));
+        __m128i const env_data = select(adsr, adsr1_v, gain_v);
+        __m128i out_env = select(adsr, adsr_env, gain_env);
+        __m128i const rate = select(adsr, adsr_rate, gain_rate);
+
+        // Sustain level
+        __m128i const sustain = _mm_and_si128(
+            is_decay,
+            _mm_cmpeq_epi32(_mm_srai_epi32(out_env, 8), _mm_srli_epi32(env_data, 5))
+        );
+        __m128i out_mode = select(sustain, set1(Sustain), mode);
+        __m128i const next_hidden = out_env;
+
+        // (unsigned) out_env <= 0x7FF, since linear decrease can go negative.
+        __m128i const in_range =
+            _mm_cmpeq_epi32(_mm_and_si128(out_env, set1(~0x7FF)), zero);
+        out_mode = select(
+            _mm_andnot_si128(in_range, _mm_cmpeq_epi32(out_mode, set1(Attack))),
+            set1(Decay),
+            out_mode);
+        out_env = select(
+            in_range,
+            out_env,
+            _mm_andnot_si128(_mm_cmplt_epi32(out_env, zero), set1(0x7FF)));
+
+        alignas(16) int32_t rates[4];
+        _mm_store_si128((__m128i *) rates, rate);
+        __m128i const fires = _mm_setr_epi32(
+            -(int32_t) counter_fires(rates[0]),
+            -(int32_t) counter_fires(rates[1]),
+            -(int32_t) counter_fires(rates[2]),
+            -(int32_t) counter_fires(rates[3]));
+
+        // Envelopes don't run during KON. Released envelopes decrease
+        // on every sample, and nothing else is controlled by the counter.
+        __m128i const konning = _mm_andnot_si128(
+            _mm_cmpeq_epi32(load(_kon_delay), zero), set1(-1)
+        );
+        __m128i const release = _mm_cmpeq_epi32(mode, set1(Release));
+        __m128i const env_minus_8 = _mm_sub_epi32(env, set1(0x8));
+        __m128i const release_env =
+            _mm_andnot_si128(_mm_cmplt_epi32(env_minus_8, zero), env_minus_8);
+        __m128i const fixed = _mm_or_si128(konning, release);
+
+        store(_env, select(
+            konning, env, select(release, release_env, select(fires, out_env, env))
+        ));
+        store(_env_mode, select(fixed, mode, out_mode));
+        store(_hidden_env, select(fixed, hidden, next_hidden));
+    }
+#else
+    // Compute each voice's next envelope (if the counter fires) and rate.
+    alignas(32) Lanes<int32_t> next_env, next_mode, next_hidden, rate;
+    for (size_t v = 0; v < NVOICE; v++) {
+        int const env = _env[v];
+        int const mode = _env_mode[v];
+        int const adsr0 = _adsr0[v];
+        int const exp_decrease = (env - 1) - ((env - 1) >> 8);
+
+        // ADSR
+        int const attack_rate = (adsr0 & 0x0F) * 2 + 1;
+        int const adsr_rate = mode == Attack ? attack_rate
+            : mode == Decay ? (adsr0 >> 3 & 0x0E) + 0x10
+            : adsr1[v] & 0x1F;
+        int const adsr_env = mode == Attack
+            ? env + (attack_rate < 31 ? 0x20 : 0x400)
+            : exp_decrease;
+
+        // GAIN
+        int const gain_mode = gain[v] >> 5;
+        int const bent_increase = gain_mode > 6 && (unsigned) _hidden_env[v] >= 0x600
+            ? env + 0x8
+            : env + 0x20;
+        int const gain_rate = gain_mode < 4 ? 31 : gain[v] & 0x1F;
+        int const gain_env = gain_mode < 4 ? gain[v] * 0x10  // direct
+            : gain_mode == 4 ? env - 0x20  // linear decrease
+            : gain_mode == 5 ? exp_decrease  // exponential decrease
+            : bent_increase;  // linear increase, or two-slope linear increase
+
+        bool const adsr = adsr0 & 0x80;
+        int const env_data = adsr ? adsr1[v] : gain[v];
+        int out_env = adsr ? adsr_env : gain_env;
+        rate[v] = adsr ? adsr_rate : gain_rate;
+
+        // Sustain level
+        int out_mode = (out_env >> 8) == (env_data >> 5) && mode == Decay
+            ? Sustain
+            : mode;
+        next_hidden[v] = out_env;
+
+        // unsigned cast because linear decrease going negative also triggers this
+        bool const overflow = (unsigned) out_env > 0x7FF;
+        out_mode = overflow && out_mode == Attack ? Decay : out_mode;
+        out_env = overflow ? (out_env < 0 ? 0 : 0x7FF) : out_env;
+
+        next_env[v] = out_env;
+        next_mode[v] = out_mode;
+    }
+
+    alignas(32) Lanes<int32_t> fires;
+    for (size_t v = 0; v < NVOICE; v++) {
+        fires[v] = counter_fires(rate[v]);
+    }
+
+    for (size_t v = 0; v < NVOICE; v++) {
+        if (_kon_delay[v]) {
+            continue;
+        }
+        if (_env_mode[v] == Release) {
+            _env[v] = std::max(_env[v] - 0x8, 0);
+        } else {
+            _env_mode[v] = next_mode[v];
+            _hidden_env[v] = next_hidden[v];
+            // nothing else is controlled by the counter
+            _env[v] = fires[v] ? next_env[v] : _env[v];
+        }
+    }
+#endif
+
+    // V4: Decode BRR.
+    for (size_t v = 0; v < NVOICE; v++) {
+        step_brr(v);
+    }
+
+    // V4: Apply pitch, and keep from getting too far ahead
+    // (when using pitch modulation).
+    for (size_t v = 0; v < NVOICE; v++) {
+        _interp_pos[v] = std::min((_interp_pos[v] & 0x3FFF) + _pitch[v], 0x7FFF);
+    }
+
+    Mix mix{};
+#if defined(SIMD_SSE2)
+    {
+        auto load = [](Lanes<int32_t> const& x, size_t v) {
+            return _mm_load_si128((__m128i const*) &x[v]);
+        };
+        auto load_int16 = [&load](Lanes<int32_t> const& x) {
+            return _mm_packs_epi32(load(x, 0), load(x, 4));
+        };
+
+        // V4, V5: Apply left/right volume. Outputs and volumes fit in int16,
+        // but amplitudes can reach 0x8000, so they're kept in int32 lanes.
+        __m128i const output = load_int16(_output);
+        __m128i l_lo, l_hi, r_lo, r_hi;
+        mul_shr(output, load_int16(voll), 7, l_lo, l_hi);
+        mul_shr(output, load_int16(volr), 7, r_lo, r_hi);
+
+        // V4, V5: Add to output total (saturating after each voice),
+        // and optionally add to echo total.
+        __m128i const eon = _mm_set1_epi32(_t_eon);
+        __m128i const bits_lo = _mm_setr_epi32(1, 2, 4, 8);
+        __m128i const bits_hi = _mm_setr_epi32(16, 32, 64, 128);
+        __m128i total = _mm_setzero_si128();
+        total = mix_4_voices(total, l_lo, r_lo,
+            _mm_cmpeq_epi32(_mm_and_si128(eon, bits_lo), bits_lo));
+        total = mix_4_voices(total, l_hi, r_hi,
+            _mm_cmpeq_epi32(_mm_and_si128(eon, bits_hi), bits_hi));
+
+        alignas(16) int32_t totals[4];
+        _mm_store_si128((__m128i *) totals, total);
+        mix = Mix {
+            .main = {totals[0], totals[1]},
+            .echo = {totals[2], totals[3]},
+        };
+    }
+#else
+    // V4, V5: Apply left/right volume.
+    alignas(32) Lanes<int32_t> amp_l, amp_r;
+    for (size_t v = 0; v < NVOICE; v++) {
+        amp_l[v] = (_output[v] * voll[v]) >> 7;
+        amp_r[v] = (_output[v] * volr[v]) >> 7;
+    }
+
+    // V4, V5: Add to output total (saturating after each voice),
+    // and optionally add to echo total.
+    for (size_t v = 0; v < NVOICE; v++) {
+        mix.main[0] = clamp16(mix.main[0] + amp_l[v]);
+        mix.main[1] = clamp16(mix.main[1] + amp_r[v]);
+        if (_t_eon >> v & 1) {
+            mix.echo[0] = clamp16(mix.echo[0] + amp_l[v]);
+            mix.echo[1] = clamp16(mix.echo[1] + amp_r[v]);
+        }
+    }
+#endif
+
+    // V5-V9: Update ENDX, OUTX, and ENVX.
+    int endx = _regs[Dsp::r_endx];
+    for (size_t v = 0; v < NVOICE; v++) {
+        endx |= _looped[v];
+
+        // Clear bit in ENDX if KON just began
+        if (_kon_delay[v] == 5) {
+            endx &= ~(1 << v);
+        }
+        _regs[vreg_addr(v, Dsp::v_outx)] = (uint8_t) (_output[v] >> 8);
+        _regs[vreg_addr(v, Dsp::v_envx)] = (uint8_t) _envx_out[v];
+    }
+    _regs[Dsp::r_endx] = (uint8_t) endx;
+
+    // V1-V3b for voice 0 (phases 17-25), which reads SRCN during this sample.
+    // Voices 1 and 2 read SRCN now, but only use it next sample (phases 0-4).
+    read_voice(0, _regs[vreg_addr(0, Dsp::v_srcn)]);
+    _srcn_latch[1] = _regs[vreg_addr(1, Dsp::v_srcn)];
+    _srcn_latch[2] = _regs[vreg_addr(2, Dsp::v_srcn)];
+
+    return mix;
+}
+
+void SoaDsp::run_echo_misc(Mix mix) {
+    // Current echo buffer pointer. The left and right samples are adjacent.
+    // (t_echo_ptr is always a multiple of 4, so this never reads past ARAM.)
+    uint8_t * const echo_ptr = &_ram[(_t_esa * 0x100 + _echo_offset) & 0xFFFF];
+
+    // echo_22-23: Read echo buffer.
+    echo_fir::StereoInt echo_read;
+    for (size_t ch = 0; ch < 2; ch++) {
+        auto const s = (int16_t) (echo_ptr[ch * 2] | echo_ptr[ch * 2 + 1] << 8);
+        echo_read[ch] = s >> 1;
+    }
+
+    // echo_22-25: Append to history, and FIR.
+    // If the history and new sample are all zero, the FIR outputs zero
+    // and the history is unchanged.
+    bool const read_zero = echo_read == echo_fir::StereoInt{};
+    echo_fir::StereoInt echo_in{};
+    if (!read_zero || _echo_zeros < echo_fir::NTAP) {
+        int8_t coefs[echo_fir::NTAP];
+        for (size_t i = 0; i < echo_fir::NTAP; i++) {
+            coefs[i] = (int8_t) _regs[Dsp::r_fir + i * 0x10];
+        }
+        echo_in = echo_fir::echo_fir(_echo_hist[0], _echo_hist[1], echo_read, coefs);
+        _echo_zeros = read_zero ? std::min(_echo_zeros + 1, echo_fir::NTAP) : 0;
+    }
+
+    // echo_26-27: Output
+    int out[2];
+    for (size_t ch = 0; ch < 2; ch++) {
+        int const s =
+            (int16_t) ((mix.main[ch] * (int8_t) _regs[Dsp::r_mvoll + ch * 0x10]) >> 7)
+            + (int16_t) ((echo_in[ch] * (int8_t) _regs[Dsp::r_evoll + ch * 0x10]) >> 7);
+        out[ch] = clamp16(s);
+    }
+
+    // echo_26: Echo feedback
+    int echo_out[2];
+    for (size_t ch = 0; ch < 2; ch++) {
+        int const s = mix.echo[ch]
+            + (int16_t) ((echo_in[ch] * (int8_t) _regs[Dsp::r_efb]) >> 7);
+        echo_out[ch] = clamp16(s) & ~1;
+    }
+
+    // misc_27
+    _t_pmon = _regs[Dsp::r_pmon] & 0xFE;  // voice 0 doesn't support PMON
+
+    // echo_27
+    if (_regs[Dsp::r_flg] & 0x40) {
+        out[0] = 0;
+        out[1] = 0;
+    }
+    if (_out + 2 <= _out_end) {
+        _out[0] = (sample_t) out[0];
+        _out[1] = (sample_t) out[1];
+        _out += 2;
+    }
+
+    // misc_28
+    _t_non = _regs[Dsp::r_non];
+    _t_eon = _regs[Dsp::r_eon];
+    _t_dir = _regs[Dsp::r_dir];
+
+    // echo_28-29: FLG is read before writing each channel, but registers
+    // don't change within a sample.
+    bool const echo_enabled = !(_regs[Dsp::r_flg] & 0x20);
+
+    // misc_29
+    if ((_every_other_sample ^= 1) != 0) {
+        _new_kon &= ~_kon;  // clears KON 63 clocks after it was last read
+    }
+
+    // echo_29
+    _t_esa = _regs[Dsp::r_esa];
+
+    if (!_echo_offset) {
+        _echo_length = (_regs[Dsp::r_edl] & 0x0F) * 0x800;
+    }
+    _echo_offset += 4;
+    if (_echo_offset >= _echo_length) {
+        _echo_offset = 0;
+    }
+
+    // misc_30
+    if (_every_other_sample) {
+        _kon = _new_kon;
+        _t_koff = _regs[Dsp::r_koff];
+    }
+
+    // run_counters()
+    if (--_counter < 0) {
+        _counter = SIMPLE_COUNTER_RANGE - 1;
+    }
+
+    // Noise
+    if (counter_fires(_regs[Dsp::r_flg] & 0x1F)) {
+        int const feedback = (_noise << 13) ^ (_noise << 14);
+        _noise = (feedback & 0x4000) ^ (_noise >> 1);
+    }
+
+    // echo_29-30: Write left and right echo
+    if (echo_enabled) {
+        for (size_t ch = 0; ch < 2; ch++) {
+            echo_ptr[ch * 2] = (uint8_t) echo_out[ch];
+            echo_ptr[ch * 2 + 1] = (uint8_t) (echo_out[ch] >> 8);
+        }
+    }
+}
+
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+/// A sample-granular S-DSP emulator, which stores per-voice state
+/// as structure-of-arrays (one array lane per voice).
+///
+/// SPC_DSP emulates each of the 32 clocks per sample separately,
+/// running one voice's pipeline stage at a time. SoaDsp instead runs
+/// each stage of the voice pipeline (gaussian interpolation, envelope,
+/// and volume) for all 8 voices at once. Interpolation and envelopes use SSE2
+/// (util/simd.h) where available, and other stages are loops the compiler
+/// turns into SIMD instructions. Stages with serial dependencies between voices
+/// (pitch modulation, mixing with saturation, ENDX) are run one voice at a time.
+///
+/// Its output is bit-exact with SPC_DSP::run(), as long as registers are only
+/// written at sample boundaries (multiples of 32 clocks since reset).
+/// Writes in the middle of a sample take effect at the next sample boundary.
+///
+/// When all voices are silent (released with a zero envelope), the voice stages
+/// only decode BRR data (to track ENDX and the BRR filter's history), skipping
+/// interpolation, envelopes, and mixing. When the echo history and buffer hold
+/// zeros, the echo FIR is skipped.
+
+#include "echo_fir.h"
+
+#include <array>
+#include <cstddef>  // size_t
+#include <cstdint>
+
+namespace audio::synth::soa_dsp {
+
+constexpr size_t NVOICE = 8;
+constexpr int CLOCKS_PER_SAMPLE = 32;
+
+/// One value per voice.
+template<typename T>
+using Lanes = std::array<T, NVOICE>;
+
+class SoaDsp {
+public:
+    using sample_t = int16_t;
+    static constexpr int REGISTER_COUNT = 128;
+
+private:
+    static constexpr int BRR_BUF_SIZE = 12;
+
+    uint8_t * _ram = nullptr;
+    uint8_t _regs[REGISTER_COUNT] = {};
+
+    sample_t * _out = nullptr;
+    sample_t * _out_end = nullptr;
+
+    /// Clocks run since the last sample boundary.
+    int _clocks = 0;
+
+    // Per-voice state.
+    /// Decoded samples (twice the size to simplify wrap handling).
+    alignas(32) std::array<int32_t, BRR_BUF_SIZE * 2> _buf[NVOICE] = {};
+    alignas(32) Lanes<int32_t> _buf_pos = {};
+    alignas(32) Lanes<int32_t> _interp_pos = {};
+    alignas(32) Lanes<int32_t> _brr_addr = {};
+    alignas(32) Lanes<int32_t> _brr_offset = {};
+    alignas(32) Lanes<int32_t> _kon_delay = {};
+    alignas(32) Lanes<int32_t> _env_mode = {};
+    alignas(32) Lanes<int32_t> _env = {};
+    alignas(32) Lanes<int32_t> _hidden_env = {};
+    alignas(32) Lanes<int32_t> _envx_out = {};
+
+    // Per-voice values read from ARAM and registers a few clocks
+    // before the voice is run (SPC_DSP's t_* temporaries).
+    alignas(32) Lanes<int32_t> _brr_next_addr = {};
+    alignas(32) Lanes<int32_t> _adsr0 = {};
+    alignas(32) Lanes<int32_t> _pitch = {};
+    alignas(32) Lanes<int32_t> _brr_header = {};
+    alignas(32) Lanes<int32_t> _brr_byte = {};
+
+    /// Each voice's most recent output (after envelope), used for PMON and OUTX.
+    alignas(32) Lanes<int32_t> _output = {};
+    alignas(32) Lanes<int32_t> _looped = {};
+
+    /// SRCN of voices 1 and 2, which the S-DSP reads during the previous sample.
+    uint8_t _srcn_latch[3] = {};
+
+    /// Voice 0's V3c and V4 stages run at the end of the previous sample
+    /// (SPC_DSP phases 30-31). We run them along with voices 1-7 at the beginning
+    /// of the next sample, using the registers as they were in the previous sample.
+    struct Voice0Regs {
+        uint8_t flg;
+        uint8_t adsr1;
+        uint8_t gain;
+        uint8_t voll;
+    } _v0_regs = {};
+
+    // Global state.
+    echo_fir::EchoHistory _echo_hist[2] = {};
+    /// How many of the most recent echo history samples are zero (up to NTAP).
+    /// Once the history is all zero, the echo FIR is skipped until
+    /// a nonzero sample is read from the echo buffer.
+    size_t _echo_zeros = echo_fir::NTAP;
+    int _every_other_sample = 0;
+    int _kon = 0;
+    int _new_kon = 0;
+    int _noise = 0;
+    int _counter = 0;
+    int _echo_offset = 0;
+    int _echo_length = 0;
+
+    // Registers latched once per sample.
+    int _t_pmon = 0;
+    int _t_non = 0;
+    int _t_eon = 0;
+    int _t_dir = 0;
+    int _t_koff = 0;
+    int _t_esa = 0;
+
+public:
+    /// Like SPC_DSP, a default-constructed SoaDsp must be initialized with init().
+    /// To reset the DSP, assign SoaDsp() and call init() again.
+    SoaDsp() = default;
+
+    /// Uses the supplied 64K RAM (not owned by SoaDsp),
+    /// and loads the same power-on registers as SPC_DSP::reset().
+    void init(uint8_t * ram_64k);
+
+    void set_output(sample_t * out, size_t size);
+
+    /// Copies another SoaDsp's registers and emulation state (used to save and
+    /// restore playback checkpoints), but keeps this DSP's RAM and output buffer.
+    void copy_state(SoaDsp const& other);
+
+    sample_t const* out_pos() const {
+        return _out;
+    }
+
+    int read(int addr) const {
+        return _regs[addr];
+    }
+
+    void write(int addr, int data);
+
+    /// Runs the DSP for the specified number of clocks.
+    /// A stereo sample is generated at each multiple of 32 clocks.
+    void run(int clocks);
+
+    /// Whether every voice is silent through the next sample: released with
+    /// a zero envelope, and not keyed on.
+    bool voices_idle() const;
+
+private:
+    /// Emulates 32 clocks of SPC_DSP, starting from phase 0.
+    void run_sample();
+
+    /// SPC_DSP's V2, V3a, and V3b (reading the sample directory, pitch,
+    /// and BRR data for the next sample).
+    void read_voice(size_t v, int srcn);
+
+    /// Same as !SPC_DSP::read_counter(rate), without dividing.
+    bool counter_fires(int rate) const;
+    void decode_brr(size_t v);
+
+    /// SPC_DSP's V4 BRR decoding and block advance, except for applying pitch.
+    void step_brr(size_t v);
+
+    /// Runs the voice stages when voices_idle(). Only decodes BRR data
+    /// (updating ENDX), and clears OUTX and ENVX.
+    void run_idle_voices();
+
+    struct Mix {
+        int main[2];
+        int echo[2];
+    };
+
+    /// Runs the voice stages of SPC_DSP phases 0-21 (and voice 0's stages
+    /// in phases 22-25 and the previous sample's 30-31).
+    /// Returns the voices mixed together.
+    Mix run_voices();
+
+    /// Runs the echo and misc stages (SPC_DSP phases 22-30),
+    /// and writes a stereo sample to the output.
+    void run_echo_misc(Mix mix);
+};
+
+}
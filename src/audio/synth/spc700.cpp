@@ -9,12 +9,14 @@ using spc700_synth::Spc700Synth;
 using impl_chip::ImplChipInstance;
 
 std::unique_ptr<ChipInstance> make_Spc700Instance(
-    chip_common::ChipIndex chip_index, doc::FrequenciesRef frequencies
+    chip_common::ChipIndex chip_index,
+    doc::FrequenciesRef frequencies,
+    DspCore dsp_core
 ) {
     return std::make_unique<ImplChipInstance<Spc700Driver, Spc700Synth>>(
         chip_index,
         Spc700Driver(frequencies),
-        Spc700Synth());
+        Spc700Synth(dsp_core));
 }
 
 }
@@ -9,7 +9,9 @@ namespace audio::synth::spc700 {
 using chip_instance::ChipInstance;
 
 std::unique_ptr<ChipInstance> make_Spc700Instance(
-    chip_common::ChipIndex chip_index, doc::FrequenciesRef frequencies
+    chip_common::ChipIndex chip_index,
+    doc::FrequenciesRef frequencies,
+    DspCore dsp_core = DspCore::ClockAccurate
 );
 
 }
@@ -36,6 +36,8 @@ Spc700ChannelDriver::Spc700ChannelDriver(uint8_t channel_id)
     }
     , _prev_note(0)
     , _note_playing(false)
+    , _prev_sample()
+    , _volume_muted(false)
     , _prev_instr()
 {
     DEBUG_PRINT("initializing channel {}\n", _channel_id);
@@ -161,6 +163,27 @@ void Spc700ChannelDriver::restore_state(
     // TODO set GAIN (not used yet).
 }
 
+bool Spc700ChannelDriver::samples_moved(
+    aram_layout::SampleSet const& moved, Spc700Synth & synth
+) {
+    if (_prev_sample && moved[*_prev_sample]) {
+        DEBUG_PRINT("  channel {} sample {:02x} moved, stopping note\n",
+            _channel_id, *_prev_sample
+        );
+        _prev_sample = {};
+        _note_playing = false;
+
+        // KOFF only starts a release envelope, which keeps decoding BRR data
+        // from the sample's old address (now holding other data). Bypass the
+        // register queue, so the voice is silent before the S-DSP runs again.
+        synth.write_reg({calc_voice_reg(_channel_id, SPC_DSP::v_voll), 0});
+        synth.write_reg({calc_voice_reg(_channel_id, SPC_DSP::v_volr), 0});
+        _volume_muted = true;
+        return true;
+    }
+    return false;
+}
+
 void Spc700ChannelDriver::write_volume(RegisterWriteQueue & regs) const {
     DEBUG_PRINT("    volume {}\n", _prev_volume);
 
@@ -202,13 +225,7 @@ static uint16_t calc_tuning(
     // Pitch registers are played back modulo 0x4000.
     // Clamp out-of-range registers instead of letting them wrap around.
     // (This could be reconfigurable?)
-    auto out = (uint16_t) std::round(std::clamp(tuning_reg_f, double(0), double(0x3fff)));
-
-    DEBUG_PRINT("    calc_tuning(): note {} -> pitch register {:04x}\n",
-        note, out
-    );
-
-    return out;
+    return (uint16_t) std::round(std::clamp(tuning_reg_f, double(0), double(0x3fff)));
 }
 
 static doc::InstrumentPatch const* find_patch(
@@ -288,29 +305,36 @@ void Spc700ChannelDriver::run_driver(
         // TODO perhaps return pitch || 0, and don't run voice_reg16(),
         // but instead return a pitch directly and let the caller cache it
         // for pitch bends and vibrato.
-        // TODO perhaps cache the currently loaded keysplit tuning?! idk if practical
 
         if (!_prev_instr) {
             DEBUG_PRINT("    cannot play note, no instrument set\n");
             return false;
         }
 
-        if (!document.instruments[*_prev_instr]) {
+        auto const& instr = document.instruments[*_prev_instr];
+        if (!instr) {
             DEBUG_PRINT("    cannot play note, instrument {:02x} does not exist\n", *_prev_instr);
             return false;
         }
 
-        auto patch = find_patch(document.instruments[*_prev_instr]->keysplit, note);
-        if (!patch) {
+        NoteMapping const mapping = chip_driver.note_mapping(*_prev_instr, note);
+        if (mapping.patch_idx == NO_PATCH) {
             DEBUG_PRINT("    cannot play note, instrument {:02x} does not contain note {}\n",
                 *_prev_instr, note
             );
             return false;
         }
+        // The note table should be rebuilt whenever instruments are edited.
+        // Don't index out of bounds if it's stale.
+        assert(mapping.patch_idx < instr->keysplit.size());
+        if (mapping.patch_idx >= instr->keysplit.size()) {
+            return false;
+        }
+        auto patch = &instr->keysplit[mapping.patch_idx];
 
         // Check to see if the sample has been loaded into ARAM or not
         // (due to missing sample or ARAM being full).
-        if (!chip_driver._samples_valid[patch->sample_idx]) {
+        if (!chip_driver._aram.is_loaded(patch->sample_idx)) {
             DEBUG_PRINT("    cannot play note, instrument {:02x} + note {} = sample {:02x} not loaded\n",
                 *_prev_instr, note, patch->sample_idx
             );
@@ -331,6 +355,7 @@ void Spc700ChannelDriver::run_driver(
 
         // Write sample index.
         voice_reg8(SPC_DSP::v_srcn, patch->sample_idx);
+        _prev_sample = patch->sample_idx;
 
         // Write ADSR.
         auto adsr = patch->adsr.to_hex();
@@ -338,7 +363,7 @@ void Spc700ChannelDriver::run_driver(
         voice_reg8(SPC_DSP::v_adsr1, adsr[1]);
 
         // Write pitch.
-        auto pitch = calc_tuning(chip_driver._freq_table, sample_maybe->tuning, note);
+        auto pitch = mapping.pitch;
         voice_reg16(SPC_DSP::v_pitchl, pitch);
 
         DEBUG_PRINT(
@@ -388,6 +413,10 @@ void Spc700ChannelDriver::run_driver(
                 if (try_play_note(_prev_note)) {
                     flags.kon |= channel_flag;
                     _note_playing = true;
+                    if (_volume_muted) {
+                        _volume_muted = false;
+                        volumes_changed = true;
+                    }
                     // TODO save current note's base pitch register, for vibrato and pitch bends
                 } else {
                     note_cut();
@@ -422,11 +451,18 @@ void Spc700ChannelDriver::run_driver(
         }
     }
 
-    if (volumes_changed) {
+    // Don't unmute a voice which may still be releasing a moved sample.
+    if (volumes_changed && !_volume_muted) {
         write_volume(regs);
     }
 }
 
+static NoteTable empty_note_table() {
+    NoteTable table;
+    table.fill(NoteMapping{.patch_idx = NO_PATCH, .pitch = 0});
+    return table;
+}
+
 Spc700Driver::Spc700Driver(doc::FrequenciesRef frequencies)
     : _channels{
         Spc700ChannelDriver(0),
@@ -440,6 +476,7 @@ Spc700Driver::Spc700Driver(doc::FrequenciesRef frequencies)
     }
     // c++ is... special(ized).
     , _freq_table(frequencies)
+    , _note_tables(doc::MAX_INSTRUMENTS, empty_note_table())
 {
     // TODO, samples_per_sec is ignored.
     // Should calc_tuning() be based off the actual playback frequency,
@@ -458,18 +495,25 @@ void Spc700Driver::reset_state(
 {
     DEBUG_PRINT("Spc700Driver::reset_state()\n");
 
-    // Reset Spc700Driver and all Spc700ChannelDriver, except for the frequency table.
+    // Reset Spc700Driver and all Spc700ChannelDriver, except for the frequency table
+    // and note table storage.
     auto freq_table = std::move(_freq_table);
+    auto note_tables = std::move(_note_tables);
     *this = Spc700Driver();
     _freq_table = std::move(freq_table);
+    _note_tables = std::move(note_tables);
 
-    // TODO store "initial" state as member state instead, so "reset synth" =
-    // "reset state" + "setup synth". Then when samples are reloaded,
-    // we can setup synth without resetting state.
+    // The frequency table can't change after construction, but the document may
+    // differ from the one the note tables were built from.
+    update_note_tables(document);
 
-    // Reset Spc700Synth, reinitialize _samples_valid and synth's ARAM,
+    // Reset Spc700Synth (stops all notes and clears ARAM),
     // and write default driver state to sound chips.
-    reload_samples(document, synth, regs);  // writes SAMPLE_DIR to $5D.
+    synth.reset();
+    restore_state(document, regs);
+
+    // _aram was cleared above, so this loads all samples.
+    reload_samples(document, synth, regs);  // writes sample directory address to $5D.
 }
 
 Spc700Driver::Spc700Driver()
@@ -525,122 +569,66 @@ void Spc700Driver::restore_state(
     }
 }
 
-/// Placeholder fixed address. TODO find a better filling algorithm.
-/// Layout: [0x100] four-byte entries, but we don't have to fill in the whole thing.
-constexpr size_t SAMPLE_DIR = 0x100;
-
-/// Each sample directory entry is:
-/// - 2 bytes (little endian) for sample start address
-/// - 2 bytes (little endian) for sample loop address
-/// We write raw bytes instead of casting to a struct pointer,
-/// due to C++ endian/alignment/strict aliasing issues.
-constexpr size_t SAMPLE_DIR_ENTRY_SIZE = 4;
-
-using spc700_synth::SPC_MEMORY_SIZE;
-
-// TODO test this method.
-// Issue is, it's not the most test-friendly method, due to debug assertions,
-// writing directly to RAM, and the sample-reloading API still being in flux.
 void Spc700Driver::reload_samples(
     doc::Document const& document,
     Spc700Synth & synth,
-    RegisterWriteQueue & regs)
+    RegisterWriteQueue & regs,
+    aram_layout::SampleSet const& edited)
 {
     DEBUG_PRINT("Spc700Driver::reload_samples()\n");
 
-    // When samples are moved around in RAM, playing notes must be stopped.
-    // Reset the APU (stops all notes), then rewrite the current volume/etc.
-    // (but not notes) to the APU.
-
-    synth.reset();
-    restore_state(document, regs);
-
-    std::fill(std::begin(_samples_valid), std::end(_samples_valid), false);
-
-    bool samples_found = false;
-    // Contains the index of the last sample present.
-    size_t last_smp_idx;
+    // Only rewrite samples which changed. If samples were moved around in RAM,
+    // notes playing them must be stopped, since the S-DSP keeps reading BRR data
+    // from the old address. Other notes keep playing.
+    aram_layout::SampleSet moved =
+        _aram.update(document.samples, synth.ram_64k(), edited);
 
-    // Loops from MAX_SAMPLES - 1 through 0.
-    for (last_smp_idx = doc::MAX_SAMPLES; last_smp_idx--; ) {
-        if (document.samples[last_smp_idx]) {
-            samples_found = true;
-            break;
+    uint8_t koff = 0;
+    for (size_t i = 0; i < enum_count<ChannelID>; i++) {
+        if (_channels[i].samples_moved(moved, synth)) {
+            koff |= uint8_t(1 << i);
         }
     }
+    if (koff != 0) {
+        regs.write(SPC_DSP::r_koff, koff);
+        // Hold KOFF long enough for the S-DSP to see it,
+        // before run_driver() clears it.
+        regs.wait(CLOCKS_PER_TWO_SAMPLES);
+    }
 
-    if (samples_found) {
-        size_t first_unused_slot = last_smp_idx + 1;
-
-        uint8_t * ram_64k = synth.ram_64k();
-
-        /// The offset in SPC memory to write the next sample to.
-        size_t sample_start_addr = SAMPLE_DIR + first_unused_slot * SAMPLE_DIR_ENTRY_SIZE;
-
-        // This loop was *seriously* overengineered... :(
-        for (size_t i = 0; i < first_unused_slot; i++) {
-            // We can't assert <, because the previously loaded sample
-            // might've entirely filled up RAM to the last byte.
-            assert(sample_start_addr <= SPC_MEMORY_SIZE);
-            // If RAM is entirely filled, break.
-            if (sample_start_addr >= SPC_MEMORY_SIZE) {
-                break;
-            }
-
-            if (!document.samples[i]) continue;
-            auto & smp = *document.samples[i];
-
-            // Debug assertions. Samples which violate these properties are probably wrong,
-            // but are safe to load anyway (though they won't play right).
-            assert(!smp.brr.empty());
-            assert(smp.brr.size() < 0x10000);
-            assert(smp.brr.size() % 9 == 0);
-            assert(smp.loop_byte < smp.brr.size());
-
-            // Every sample must have a positive length. Skip any samples with zero length.
-            if (smp.brr.empty()) {
-                continue;
-            }
-
-            size_t brr_size_clamped = std::min(smp.brr.size(), (size_t) 0x10000);
-            size_t sample_end_addr = sample_start_addr + brr_size_clamped;
-            if (sample_end_addr > SPC_MEMORY_SIZE) {
-                // Sample data overflow. TODO indicate error to user.
+    // Set base address.
+    regs.write(SPC_DSP::r_dir, uint8_t(_aram.dir_begin() >> 8));
+}
 
-                // Continue trying to load later samples, hopefully they're smaller
-                // and fit in the remaining space.
-                continue;
-            }
+void Spc700Driver::update_note_tables(doc::Document const& document) {
+    DEBUG_PRINT("Spc700Driver::update_note_tables()\n");
+    assert(_note_tables.size() == doc::MAX_INSTRUMENTS);
 
-            size_t sample_loop_addr = sample_start_addr + smp.loop_byte;
-            if (sample_loop_addr >= SPC_MEMORY_SIZE) {
-                // Corrupted sample, the loop byte >= the BRR size. IDK what to do.
+    for (size_t instr_idx = 0; instr_idx < doc::MAX_INSTRUMENTS; instr_idx++) {
+        NoteTable & table = _note_tables[instr_idx];
+        auto const& instr = document.instruments[instr_idx];
+        if (!instr) {
+            table.fill(NoteMapping{.patch_idx = NO_PATCH, .pitch = 0});
+            continue;
+        }
 
-                // Continue trying to load later samples, hopefully they're smaller
-                // and fit in the remaining space.
+        auto const& keysplit = instr->keysplit;
+        for (size_t note = 0; note < doc::CHROMATIC_COUNT; note++) {
+            auto patch = find_patch(keysplit, (doc::Chromatic) note);
+            if (!patch) {
+                table[note] = {.patch_idx = NO_PATCH, .pitch = 0};
                 continue;
             }
 
-            // Write the sample entry.
-            size_t sample_entry_addr = SAMPLE_DIR + i * SAMPLE_DIR_ENTRY_SIZE;
-            ram_64k[sample_entry_addr + 0] = (uint8_t) sample_start_addr;
-            ram_64k[sample_entry_addr + 1] = (uint8_t) (sample_start_addr >> 8);
-            ram_64k[sample_entry_addr + 2] = (uint8_t) sample_loop_addr;
-            ram_64k[sample_entry_addr + 3] = (uint8_t) (sample_loop_addr >> 8);
-
-            // Write the sample data.
-            std::copy(
-                smp.brr.begin(),
-                smp.brr.begin() + (ptrdiff_t) brr_size_clamped,
-                &ram_64k[sample_start_addr]);
-
-            sample_start_addr = sample_end_addr;
-            _samples_valid[i] = true;
+            auto const& sample_maybe = document.samples[patch->sample_idx];
+            table[note] = {
+                .patch_idx = (uint8_t) (patch - keysplit.data()),
+                .pitch = sample_maybe
+                    ? calc_tuning(_freq_table, sample_maybe->tuning, (doc::Chromatic) note)
+                    : uint16_t(0),
+            };
         }
     }
-
-    // Set base address.
-    regs.write(SPC_DSP::r_dir, SAMPLE_DIR >> 8);
 }
 
 void Spc700Driver::stop_playback(RegisterWriteQueue /*mut*/& regs) {
@@ -685,6 +673,8 @@ void Spc700Driver::run_driver(
 }
 
 #ifdef UNITTEST
+#include "sample_docs.h"
+
 #include <doctest.h>
 
 namespace audio::synth::spc700_driver {
@@ -747,6 +737,60 @@ TEST_CASE("Test that keysplits with out-of-order patches prefer earlier patches.
     CHECK_EQ(find_patch(keysplit, CHROMATIC_COUNT - 1), &keysplit[1]);
 }
 
+static void check_note_tables(Spc700Driver const& driver, Document const& document) {
+    for (size_t instr_idx = 0; instr_idx < MAX_INSTRUMENTS; instr_idx++) {
+        CAPTURE(instr_idx);
+        auto const& instr = document.instruments[instr_idx];
+
+        for (size_t note = 0; note < CHROMATIC_COUNT; note++) {
+            CAPTURE(note);
+            auto mapping = driver.note_mapping((InstrumentIndex) instr_idx, (Chromatic) note);
+
+            auto patch = instr ? find_patch(instr->keysplit, (Chromatic) note) : nullptr;
+            if (!patch) {
+                CHECK(mapping.patch_idx == NO_PATCH);
+                continue;
+            }
+            REQUIRE(mapping.patch_idx < instr->keysplit.size());
+            CHECK(&instr->keysplit[mapping.patch_idx] == patch);
+
+            auto const& sample = document.samples[patch->sample_idx];
+            CHECK(mapping.pitch == (sample
+                ? calc_tuning(document.frequency_table, sample->tuning, (Chromatic) note)
+                : 0));
+        }
+    }
+}
+
+TEST_CASE("Test that note tables match find_patch() and calc_tuning().") {
+    for (auto const& [name, sample_doc] : sample_docs::DOCUMENTS) {
+        CAPTURE(name);
+        Document document = DocumentCopy(sample_doc);
+        Spc700Driver driver{document.frequency_table};
+        driver.update_note_tables(document);
+        check_note_tables(driver, document);
+
+        // Edit an instrument's keysplit and a sample's tuning, then rebuild.
+        for (auto & instr : document.instruments) {
+            if (instr && !instr->keysplit.empty()) {
+                instr->keysplit[0].min_note = 30;
+                instr->keysplit.push_back(InstrumentPatch {
+                    .min_note = 90, .sample_idx = instr->keysplit[0].sample_idx
+                });
+                break;
+            }
+        }
+        for (auto & sample : document.samples) {
+            if (sample) {
+                sample->tuning.detune_cents += 50;
+                break;
+            }
+        }
+        driver.update_note_tables(document);
+        check_note_tables(driver, document);
+    }
+}
+
 TEST_CASE("Test that calc_volume_reg() matches forked AMK driver behavior.") {
     static_assert(PAN_MAX == 32);
 
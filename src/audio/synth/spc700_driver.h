@@ -1,12 +1,15 @@
 #pragma once
 
+#include "aram_layout.h"
 #include "audio/synth_common.h"
 #include "music_driver_common.h"
 #include "doc.h"
 #include "chip_kinds.h"
 #include "util/enum_map.h"
 
+#include <array>
 #include <cstdint>
+#include <vector>
 
 namespace audio::synth::spc700_synth {
     // this class is friends with Spc700Driver, so we can load samples directly.
@@ -39,6 +42,22 @@ struct SurroundState {
     bool right_invert;
 };
 
+/// The patch and pitch register an instrument plays at a given note.
+struct NoteMapping {
+    /// Index into Instrument::keysplit, or NO_PATCH if no patch contains the note.
+    uint8_t patch_idx;
+    /// Pitch register for the patch's sample at this note,
+    /// or 0 if the sample doesn't exist.
+    uint16_t pitch;
+};
+
+/// MAX_KEYSPLITS <= 0xFF, so no patch has this index.
+constexpr uint8_t NO_PATCH = 0xFF;
+static_assert(doc::MAX_KEYSPLITS <= NO_PATCH);
+
+/// Each note's mapping for one instrument, indexed by doc::Chromatic.
+using NoteTable = std::array<NoteMapping, doc::CHROMATIC_COUNT>;
+
 using spc700_synth::Spc700Synth;
 class Spc700Driver;
 
@@ -52,6 +71,14 @@ class Spc700ChannelDriver {
     doc::Chromatic _prev_note;
     bool _note_playing;
 
+    /// The sample most recently written to this voice's SRCN register.
+    /// If the sample is edited or moved in ARAM, the note must be stopped.
+    std::optional<doc::SampleIndex> _prev_sample;
+
+    /// Set when samples_moved() zeroed this voice's volume registers,
+    /// so the next note must rewrite them.
+    bool _volume_muted;
+
     // TODO how to handle "no instrument" state?
     // A separate "unset" state wastes RAM in SPC export.
     std::optional<doc::InstrumentIndex> _prev_instr;
@@ -59,11 +86,18 @@ class Spc700ChannelDriver {
 public:
     Spc700ChannelDriver(uint8_t channel_id);
 
-    /// When samples are edited, this gets called after APU has been reset.
-    /// Writes current volume/etc. to the sound chip, but not currently playing note
-    /// (since the sample has changed or moved).
+    /// Called after APU has been reset.
+    /// Writes current volume/etc. to the sound chip, but not currently playing note.
     void restore_state(doc::Document const& document, RegisterWriteQueue & regs) const;
 
+    /// When samples are edited or moved, stops the note if it uses one of them,
+    /// and immediately mutes the voice in `synth` (since released notes keep
+    /// reading BRR data, which was just overwritten). Returns true if the note was
+    /// stopped.
+    [[nodiscard]] bool samples_moved(
+        aram_layout::SampleSet const& moved, Spc700Synth & synth
+    );
+
 private:
     void write_volume(RegisterWriteQueue & regs) const;
 
@@ -80,15 +114,22 @@ public:
 
 class Spc700Driver {
 private:
-    // TODO save the address of each sample
-    Spc700ChannelDriver _channels[enum_count<Spc700ChannelID>];
+    using Channels = std::array<Spc700ChannelDriver, enum_count<Spc700ChannelID>>;
+    Channels _channels;
 
     /// Every instrument has its own tuning system, so compute tuning at runtime.
     FrequenciesOwned _freq_table;
 
-    // Used to determine whether to attempt to play certain samples,
-    // or avoid them and reject all notes using the sample.
-    bool _samples_valid[doc::MAX_SAMPLES] = {false};
+    /// The address of each sample in ARAM.
+    /// Used to determine whether to attempt to play certain samples,
+    /// or avoid them and reject all notes using the sample.
+    aram_layout::AramLayout _aram{aram_layout::playback_config()};
+
+    /// vector<InstrumentIndex -> NoteTable>, of size MAX_INSTRUMENTS.
+    /// Precomputed from instruments, sample tuning, and _freq_table, so playing
+    /// a note doesn't search keysplits or compute tuning on the audio thread.
+    /// Allocated upon construction, and rebuilt in place when instruments change.
+    std::vector<NoteTable> _note_tables;
 
 public:
     using ChannelID = chip_kinds::Spc700ChannelID;
@@ -98,6 +139,7 @@ public:
     DEFAULT_MOVE(Spc700Driver)
 
     /// Called when beginning playback from a clean slate.
+    /// Resets the S-DSP and loads all samples from scratch.
     void reset_state(
         doc::Document const& document, Spc700Synth & synth, RegisterWriteQueue & regs
     );
@@ -106,19 +148,56 @@ private:
     // Only used in reset_state().
     Spc700Driver();
 
-    /// When samples are edited, this gets called after APU has been reset.
+    /// Called after APU has been reset.
     /// Reinitialize SPC700 and write current volume/etc. to the sound chip,
-    /// but not currently playing notes (since the samples have changed or moved).
+    /// but not currently playing notes.
     void restore_state(
         doc::Document const& document, RegisterWriteQueue & regs
     ) const;
 
 public:
-    /// Called when samples are edited.
+    /// Called when samples are edited. Only rewrites samples in `edited` which
+    /// changed, and only stops notes playing samples which were changed or moved.
     void reload_samples(
-        doc::Document const& document, Spc700Synth & synth, RegisterWriteQueue & regs
+        doc::Document const& document,
+        Spc700Synth & synth,
+        RegisterWriteQueue & regs,
+        aram_layout::SampleSet const& edited = aram_layout::SampleSet{}.set()
     );
 
+    /// Called when instruments or sample tuning are edited.
+    /// Rebuilds _note_tables without allocating memory.
+    void update_note_tables(doc::Document const& document);
+
+    NoteMapping note_mapping(doc::InstrumentIndex instr, doc::Chromatic note) const {
+        return _note_tables[instr][note];
+    }
+
+    /// Driver state saved by save_state(). Excludes _freq_table and _note_tables,
+    /// which are derived from the document.
+    struct State {
+        Channels channels;
+        aram_layout::AramLayout aram;
+    };
+
+    /// Returns a copy of the driver state, to be overwritten by save_state().
+    /// Allocates memory.
+    State state() const {
+        return State{_channels, _aram};
+    }
+
+    /// Copies the driver state into `out` (returned by state()).
+    /// Doesn't allocate memory.
+    void save_state(State & out) const {
+        out.channels = _channels;
+        out.aram = _aram;
+    }
+
+    void load_state(State const& in) {
+        _channels = in.channels;
+        _aram = in.aram;
+    }
+
     void stop_playback(RegisterWriteQueue /*mut*/& regs);
 
     void run_driver(
@@ -2,13 +2,15 @@
 #include "spc700_driver.h"
 #include "impl_chip_common.h"
 
-#include <algorithm>  // std::fill
+#include <algorithm>  // std::copy, std::fill
+#include <cstring>  // memcpy
 #include <memory>
 
 namespace audio::synth::spc700_synth {
 
 Spc700Inner::Spc700Inner() {
     chip.init(ram_64k);
+    soa_chip.init(ram_64k);
 }
 
 void Spc700Inner::reset() {
@@ -17,23 +19,86 @@ void Spc700Inner::reset() {
 
     chip = SPC_DSP();
     chip.init(ram_64k);
+    soa_chip = soa_dsp::SoaDsp();
+    soa_chip.init(ram_64k);
 }
 
-Spc700Synth::Spc700Synth()
+Spc700Synth::Spc700Synth(DspCore dsp_core)
     : _p(std::make_unique<Spc700Inner>())
+    , _dsp_core(dsp_core)
 {}
 
 void Spc700Synth::reset() {
     _p->reset();
 }
 
+static void save_chip_bytes(unsigned char ** io, void * state, size_t size) {
+    memcpy(*io, state, size);
+    *io += size;
+}
+
+static void load_chip_bytes(unsigned char ** io, void * state, size_t size) {
+    memcpy(state, *io, size);
+    *io += size;
+}
+
+void Spc700Synth::save_state(State & out) {
+    using std::begin, std::end;
+    std::copy(begin(_p->ram_64k), end(_p->ram_64k), out.ram_64k);
+
+    // SPC_DSP::copy_state() writes at most state_size bytes.
+    unsigned char * io = out.chip;
+    _p->chip.copy_state(&io, save_chip_bytes);
+    assert(io <= std::end(out.chip));
+
+    out.soa_chip.copy_state(_p->soa_chip);
+}
+
+void Spc700Synth::load_state(State const& in) {
+    using std::begin, std::end;
+    std::copy(begin(in.ram_64k), end(in.ram_64k), _p->ram_64k);
+
+    // SPC_DSP::copy_state() only reads from `io` when given load_chip_bytes().
+    unsigned char * io = const_cast<unsigned char *>(in.chip);
+    _p->chip.copy_state(&io, load_chip_bytes);
+
+    _p->soa_chip.copy_state(in.soa_chip);
+}
+
 void Spc700Synth::write_reg(RegisterWrite write) {
+    if (_dsp_core == DspCore::SoaSimd) {
+        _p->soa_chip.write(write.address, write.value);
+        return;
+    }
     _p->chip.write(write.address, write.value);
 }
 
+void Spc700Synth::load_regs(RegisterFile const& regs) {
+    for (int addr = 0; addr < SPC_DSP::register_count; addr++) {
+        switch (addr) {
+        case SPC_DSP::r_kon:
+        case SPC_DSP::r_koff:
+        case SPC_DSP::r_endx:
+            continue;
+        }
+        // Every voice's ENVX and OUTX.
+        if ((addr & 0x0f) == SPC_DSP::v_envx || (addr & 0x0f) == SPC_DSP::v_outx) {
+            continue;
+        }
+        write_reg({(music_driver::Address) addr, regs[(size_t) addr]});
+    }
+}
+
 NsampWritten Spc700Synth::run_clocks(
     ClockT const nclk, WriteTo write_to
 ) {
+    if (_dsp_core == DspCore::SoaSimd) {
+        auto & chip = _p->soa_chip;
+        chip.set_output(write_to.data(), write_to.size());
+        chip.run((int) nclk);
+        return NsampT(chip.out_pos() - write_to.data()) / STEREO_NCHAN;
+    }
+
     _p->chip.set_output(write_to.data(), write_to.size());
     _p->chip.run((int) nclk);
     return NsampT(_p->chip.out_pos() - write_to.data()) / STEREO_NCHAN;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "spc700.h"
+#include "soa_dsp.h"
 #include "music_driver_common.h"
 #include "../synth_common.h"
 #include "util/copy_move.h"
@@ -17,6 +18,7 @@ namespace audio::synth::spc700_driver {
 namespace audio::synth::spc700_synth {
 
 using music_driver::RegisterWrite;
+using music_driver::RegisterFile;
 
 constexpr size_t SPC_MEMORY_SIZE = 0x1'0000;
 
@@ -29,8 +31,11 @@ struct Spc700Inner {
     uint8_t ram_64k[SPC_MEMORY_SIZE] = {};
     SPC_DSP chip;
 
+    /// Only used if Spc700Synth runs DspCore::SoaSimd.
+    soa_dsp::SoaDsp soa_chip;
+
 // impl
-    /// SPC_DSP is self-referential and points to ram_64k.
+    /// SPC_DSP and SoaDsp point to ram_64k.
     DISABLE_COPY_MOVE(Spc700Inner)
 
     Spc700Inner();
@@ -39,18 +44,40 @@ struct Spc700Inner {
 
 class Spc700Synth {
     std::unique_ptr<Spc700Inner> _p;
+    DspCore _dsp_core;
 
 // impl
 public:
-    Spc700Synth();
+    explicit Spc700Synth(DspCore dsp_core = DspCore::ClockAccurate);
 
     void reset();
 
+    /// ARAM and S-DSP state saved by save_state(). Around 66 KB,
+    /// so it should be heap-allocated.
+    struct State {
+        uint8_t ram_64k[SPC_MEMORY_SIZE] = {};
+        /// Serialized by SPC_DSP::copy_state().
+        unsigned char chip[SPC_DSP::state_size] = {};
+        soa_dsp::SoaDsp soa_chip;
+    };
+
+    /// Copies ARAM and the state of both S-DSP cores into `out`.
+    /// Doesn't allocate memory.
+    void save_state(State & out);
+
+    /// Restores state saved by save_state() (on this or another Spc700Synth).
+    void load_state(State const& in);
+
     /// Write to a S-DSP register (not to ARAM).
     /// (In the actual SNES, this corresponds to a $F2 write followed by $F3.)
     /// (Writing sample data should be accomplished by mutating _ram_64k directly.)
     void write_reg(RegisterWrite write);
 
+    /// Writes S-DSP registers from a shadow register file,
+    /// skipping KON/KOFF (so no notes are triggered or released)
+    /// and the registers which report voice state (ENVX, OUTX, and ENDX).
+    void load_regs(RegisterFile const& regs);
+
     NsampWritten run_clocks(
         ClockT const nclk,
         WriteTo write_to);
@@ -0,0 +1,218 @@
+#include "upsample.h"
+#include "util/release_assert.h"
+#include "util/simd.h"
+
+namespace audio::synth::upsample {
+
+/// Converts int16 to float in [-1, 1). Multiplying by a power of 2
+/// gives the same result as dividing by 0x8000.
+constexpr float SCALE = 1.f / float(0x8000);
+
+template<Mix mix>
+static inline void store(float * out, float value) {
+    if constexpr (mix == Mix::Overwrite) {
+        *out = value;
+    } else {
+        *out += value;
+    }
+}
+
+/// Processes frames [begin, end) of `in`.
+template<Mix mix>
+static void upsample_scalar_range(
+    SpcAmplitude const* in, float * out, size_t begin, size_t end
+) {
+    for (size_t i = begin; i < end; i++) {
+        float left = in[i * STEREO_NCHAN + 0] * SCALE;
+        float right = in[i * STEREO_NCHAN + 1] * SCALE;
+
+        float * frame_out = out + i * OVERSAMPLING_FACTOR * STEREO_NCHAN;
+        for (size_t j = 0; j < OVERSAMPLING_FACTOR; j++) {
+            store<mix>(&frame_out[j * STEREO_NCHAN + 0], left);
+            store<mix>(&frame_out[j * STEREO_NCHAN + 1], right);
+        }
+    }
+}
+
+#if defined(SIMD_AVX2)
+
+template<Mix mix>
+static inline void store_ps(float * out, __m256 value) {
+    if constexpr (mix == Mix::Accumulate) {
+        value = _mm256_add_ps(_mm256_loadu_ps(out), value);
+    }
+    _mm256_storeu_ps(out, value);
+}
+
+/// Processes 4 stereo frames per iteration.
+/// Each input frame becomes one 8-float vector (4 copies of left/right).
+template<Mix mix>
+static void upsample_simd(SpcAmplitude const* in, float * out, size_t nframe) {
+    __m256 const scale = _mm256_set1_ps(SCALE);
+    __m256i const frame_idx[4] = {
+        _mm256_setr_epi32(0, 1, 0, 1, 0, 1, 0, 1),
+        _mm256_setr_epi32(2, 3, 2, 3, 2, 3, 2, 3),
+        _mm256_setr_epi32(4, 5, 4, 5, 4, 5, 4, 5),
+        _mm256_setr_epi32(6, 7, 6, 7, 6, 7, 6, 7),
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= nframe; i += 4) {
+        // L0 R0 L1 R1 L2 R2 L3 R3
+        __m128i raw = _mm_loadu_si128((__m128i const*) (in + i * STEREO_NCHAN));
+        __m256 smp = _mm256_mul_ps(
+            _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(raw)), scale
+        );
+
+        float * frame_out = out + i * OVERSAMPLING_FACTOR * STEREO_NCHAN;
+        for (size_t k = 0; k < 4; k++) {
+            store_ps<mix>(
+                frame_out + 8 * k, _mm256_permutevar8x32_ps(smp, frame_idx[k])
+            );
+        }
+    }
+    upsample_scalar_range<mix>(in, out, i, nframe);
+}
+
+#elif defined(SIMD_SSE2)
+
+template<Mix mix>
+static inline void store_ps(float * out, __m128 value) {
+    if constexpr (mix == Mix::Accumulate) {
+        value = _mm_add_ps(_mm_loadu_ps(out), value);
+    }
+    _mm_storeu_ps(out, value);
+}
+
+/// Processes 4 stereo frames per iteration.
+/// Each input frame becomes two 4-float vectors (2 copies of left/right each).
+template<Mix mix>
+static void upsample_simd(SpcAmplitude const* in, float * out, size_t nframe) {
+    __m128 const scale = _mm_set1_ps(SCALE);
+
+    size_t i = 0;
+    for (; i + 4 <= nframe; i += 4) {
+        // L0 R0 L1 R1 L2 R2 L3 R3
+        __m128i raw = _mm_loadu_si128((__m128i const*) (in + i * STEREO_NCHAN));
+
+        // Sign-extend int16 to int32 by placing each value in the high half,
+        // then shifting right.
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(raw, raw), 16);
+        __m128 smp01 = _mm_mul_ps(_mm_cvtepi32_ps(lo), scale);
+        __m128 smp23 = _mm_mul_ps(_mm_cvtepi32_ps(hi), scale);
+
+        __m128 frames[4] = {
+            _mm_movelh_ps(smp01, smp01),
+            _mm_movehl_ps(smp01, smp01),
+            _mm_movelh_ps(smp23, smp23),
+            _mm_movehl_ps(smp23, smp23),
+        };
+
+        float * frame_out = out + i * OVERSAMPLING_FACTOR * STEREO_NCHAN;
+        for (size_t k = 0; k < 4; k++) {
+            store_ps<mix>(frame_out + 8 * k, frames[k]);
+            store_ps<mix>(frame_out + 8 * k + 4, frames[k]);
+        }
+    }
+    upsample_scalar_range<mix>(in, out, i, nframe);
+}
+
+#else
+
+template<Mix mix>
+static void upsample_simd(SpcAmplitude const* in, float * out, size_t nframe) {
+    upsample_scalar_range<mix>(in, out, 0, nframe);
+}
+
+#endif
+
+char const* upsample_zoh_isa() {
+    return util::simd::ISA_NAME;
+}
+
+void upsample_zoh(gsl::span<SpcAmplitude const> in, gsl::span<float> out, Mix mix) {
+    release_assert_equal(out.size(), in.size() * OVERSAMPLING_FACTOR);
+    size_t const nframe = in.size() / STEREO_NCHAN;
+
+    // The SIMD kernels are written for 4x oversampling.
+    if constexpr (OVERSAMPLING_FACTOR != 4) {
+        upsample_zoh_scalar(in, out, mix);
+        return;
+    }
+
+    if (mix == Mix::Overwrite) {
+        upsample_simd<Mix::Overwrite>(in.data(), out.data(), nframe);
+    } else {
+        upsample_simd<Mix::Accumulate>(in.data(), out.data(), nframe);
+    }
+}
+
+void upsample_zoh_scalar(
+    gsl::span<SpcAmplitude const> in, gsl::span<float> out, Mix mix
+) {
+    release_assert_equal(out.size(), in.size() * OVERSAMPLING_FACTOR);
+    size_t const nframe = in.size() / STEREO_NCHAN;
+
+    if (mix == Mix::Overwrite) {
+        upsample_scalar_range<Mix::Overwrite>(in.data(), out.data(), 0, nframe);
+    } else {
+        upsample_scalar_range<Mix::Accumulate>(in.data(), out.data(), 0, nframe);
+    }
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+#include <random>
+#include <vector>
+
+namespace audio::synth::upsample {
+
+TEST_CASE("upsample_zoh() matches scalar implementation") {
+    std::minstd_rand rng{1};
+    std::uniform_int_distribution<int> dist{-0x8000, 0x7fff};
+
+    // Test odd frame counts to cover the scalar tail after SIMD blocks.
+    size_t const nframes[] = {0, 1, 3, 4, 7, 64, 257};
+    for (size_t nframe : nframes) {
+        std::vector<SpcAmplitude> chip0(nframe * STEREO_NCHAN);
+        std::vector<SpcAmplitude> chip1(nframe * STEREO_NCHAN);
+        for (auto & smp : chip0) {
+            smp = (SpcAmplitude) dist(rng);
+        }
+        for (auto & smp : chip1) {
+            smp = (SpcAmplitude) dist(rng);
+        }
+        // Include extremes.
+        if (nframe > 0) {
+            chip0[0] = -0x8000;
+            chip0[1] = 0x7fff;
+        }
+
+        size_t const nout = nframe * STEREO_NCHAN * OVERSAMPLING_FACTOR;
+        std::vector<float> expected(nout, 123.f);
+        std::vector<float> actual(nout, -456.f);
+
+        upsample_zoh_scalar(chip0, expected, Mix::Overwrite);
+        upsample_zoh(chip0, actual, Mix::Overwrite);
+        CHECK(actual == expected);
+
+        upsample_zoh_scalar(chip1, expected, Mix::Accumulate);
+        upsample_zoh(chip1, actual, Mix::Accumulate);
+        CHECK(actual == expected);
+
+        if (nframe > 0) {
+            CHECK(expected[0] == -1.f + chip1[0] / (1.0f * 0x8000));
+            CHECK(expected[STEREO_NCHAN * OVERSAMPLING_FACTOR - 1]
+                == 0x7fff / (1.0f * 0x8000) + chip1[1] / (1.0f * 0x8000));
+        }
+    }
+}
+
+}
+
+#endif
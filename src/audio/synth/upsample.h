@@ -0,0 +1,45 @@
+#pragma once
+
+#include "audio/synth_common.h"
+
+#include <gsl/span>
+
+#include <cstdint>
+
+namespace audio::synth::upsample {
+
+//#define DONT_RESAMPLE
+
+/// The S-DSP's output is repeated (zero-order hold) this many times
+/// before being passed to the resampler.
+#ifdef DONT_RESAMPLE
+constexpr uint32_t OVERSAMPLING_FACTOR = 1;
+#else
+constexpr uint32_t OVERSAMPLING_FACTOR = 4;
+#endif
+
+enum class Mix {
+    /// Overwrite the output buffer. Used for the first chip.
+    Overwrite,
+    /// Add to the output buffer. Used for all other chips.
+    Accumulate,
+};
+
+/// Converts one chip's stereo S-DSP output from int16 to float,
+/// repeats each frame OVERSAMPLING_FACTOR times,
+/// and writes or adds the result to `out`, in a single pass.
+///
+/// `in` holds interleaved [smp#, * STEREO_NCHAN + chan#] SpcAmplitude.
+/// `out.size()` must equal `in.size() * OVERSAMPLING_FACTOR`.
+///
+/// Uses AVX2 or SSE2 if enabled at compile time, otherwise scalar code.
+/// All versions produce identical output.
+void upsample_zoh(gsl::span<SpcAmplitude const> in, gsl::span<float> out, Mix mix);
+
+/// Scalar version of upsample_zoh(), used as a reference in tests and benchmarks.
+void upsample_zoh_scalar(gsl::span<SpcAmplitude const> in, gsl::span<float> out, Mix mix);
+
+/// Name of the instruction set used by upsample_zoh(), for benchmark output.
+char const* upsample_zoh_isa();
+
+}
@@ -0,0 +1,162 @@
+#include "worker_pool.h"
+#include "util/simd.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace audio::synth::worker_pool {
+
+/// How many times to poll for the next job before parking.
+/// Each poll takes roughly 10-150 cycles, depending on the CPU's pause latency.
+static constexpr int SPIN_COUNT = 2000;
+
+static inline void cpu_relax() {
+#if defined(SIMD_SSE2)
+    _mm_pause();
+#endif
+}
+
+/// Spins until `value` differs from `old` or SPIN_COUNT polls elapse,
+/// then parks until it changes. Returns the new value.
+static uint32_t wait_until_changed(
+    std::atomic<uint32_t> const& value, uint32_t old
+) {
+    for (int i = 0; i < SPIN_COUNT; i++) {
+        uint32_t const curr = value.load(std::memory_order_acquire);
+        if (curr != old) {
+            return curr;
+        }
+        cpu_relax();
+    }
+
+    uint32_t curr;
+    while ((curr = value.load(std::memory_order_acquire)) == old) {
+        value.wait(old, std::memory_order_acquire);
+    }
+    return curr;
+}
+
+#if defined(__linux__)
+static void pin_thread(std::thread & thread, size_t cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    // Best-effort; if it fails (eg. due to a cgroup CPU limit),
+    // the worker runs unpinned.
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+}
+#endif
+
+WorkerPool::WorkerPool(size_t nworker) {
+    _threads.reserve(nworker);
+    for (size_t worker = 0; worker < nworker; worker++) {
+        _threads.emplace_back([this, worker] { worker_main(worker); });
+
+#if defined(__linux__)
+        if (auto const ncpu = std::thread::hardware_concurrency(); ncpu > 1) {
+            pin_thread(_threads.back(), (worker + 1) % ncpu);
+        }
+#endif
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    _quit.store(true, std::memory_order_relaxed);
+    _generation.fetch_add(1, std::memory_order_release);
+    _generation.notify_all();
+
+    for (auto & thread : _threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run_tasks(size_t first_task) const {
+    size_t const stride = _threads.size() + 1;
+    for (size_t task = first_task; task < _ntask; task += stride) {
+        _fn(_ctx, task);
+    }
+}
+
+void WorkerPool::run(TaskFn fn, void * ctx, size_t ntask) {
+    if (_threads.empty() || ntask <= 1) {
+        for (size_t task = 0; task < ntask; task++) {
+            fn(ctx, task);
+        }
+        return;
+    }
+
+    _fn = fn;
+    _ctx = ctx;
+    _ntask = ntask;
+    _nbusy.store((uint32_t) _threads.size(), std::memory_order_relaxed);
+
+    // Publish the job. notify_all() only makes a syscall if a worker is parked.
+    _generation.fetch_add(1, std::memory_order_release);
+    _generation.notify_all();
+
+    run_tasks(0);
+
+    // Wait for the workers to finish.
+    uint32_t nbusy;
+    while ((nbusy = _nbusy.load(std::memory_order_acquire)) != 0) {
+        wait_until_changed(_nbusy, nbusy);
+    }
+}
+
+void WorkerPool::worker_main(size_t worker) {
+    // Don't load _generation, since run() may have already started a job
+    // before this thread began.
+    uint32_t generation = 0;
+
+    while (true) {
+        generation = wait_until_changed(_generation, generation);
+        if (_quit.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        run_tasks(worker + 1);
+
+        // The last worker to finish wakes the thread in run().
+        if (_nbusy.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _nbusy.notify_one();
+        }
+    }
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+#include <vector>
+
+namespace audio::synth::worker_pool {
+
+TEST_CASE("WorkerPool runs each task exactly once") {
+    for (size_t nworker : {0u, 1u, 3u}) {
+        CAPTURE(nworker);
+        WorkerPool pool{nworker};
+
+        // Repeat, so workers go through many generations (spinning and parking).
+        for (size_t ntask = 0; ntask < 10; ntask++) {
+            CAPTURE(ntask);
+            for (int rep = 0; rep < 100; rep++) {
+                std::vector<int> ran(ntask);
+                auto fn = [&](size_t task) {
+                    ran[task]++;
+                };
+                pool.run(ntask, fn);
+
+                std::vector<int> const expected(ntask, 1);
+                REQUIRE(ran == expected);
+            }
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+
+/// A pool of worker threads which the audio thread uses to synthesize
+/// multiple chips concurrently.
+///
+/// WorkerPool::run() is realtime-safe: it doesn't allocate or lock mutexes.
+/// Workers spin briefly waiting for the next job (so back-to-back jobs within
+/// an audio callback don't pay for a wakeup), then park on an atomic wait
+/// (a futex on Linux) until the audio thread publishes a new job.
+
+#include "util/copy_move.h"
+
+#include <atomic>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace audio::synth::worker_pool {
+
+class WorkerPool {
+public:
+    using TaskFn = void (*)(void * ctx, size_t task);
+
+private:
+    std::vector<std::thread> _threads;
+
+    // The current job. Written by run() before incrementing _generation,
+    // and read by workers after they observe the new _generation.
+    TaskFn _fn = nullptr;
+    void * _ctx = nullptr;
+    size_t _ntask = 0;
+
+    /// Incremented by run() to start a job (and by the destructor to quit).
+    /// Starts at 0 when workers are spawned.
+    std::atomic<uint32_t> _generation = 0;
+    /// Number of workers still running the current job.
+    std::atomic<uint32_t> _nbusy = 0;
+    std::atomic<bool> _quit = false;
+
+public:
+    /// Spawns `nworker` threads. Called on the GUI thread.
+    /// On Linux, worker i is pinned to CPU core (i + 1) modulo the core count,
+    /// leaving core 0 to the OS scheduler.
+    explicit WorkerPool(size_t nworker);
+    ~WorkerPool();
+
+    DISABLE_COPY_MOVE(WorkerPool)
+
+    size_t nworker() const {
+        return _threads.size();
+    }
+
+    /// Runs fn(ctx, task) for each task in [0, ntask), and returns once all
+    /// have finished. The calling thread runs tasks 0, nworker() + 1, ...,
+    /// and worker i runs tasks i + 1, i + 1 + (nworker() + 1), ...
+    ///
+    /// Only one thread may call run() at a time.
+    void run(TaskFn fn, void * ctx, size_t ntask);
+
+    /// Runs fn(task) for each task in [0, ntask). `fn` is called by reference,
+    /// and must be safe to call concurrently on different tasks.
+    template<typename Fn>
+    void run(size_t ntask, Fn & fn) {
+        run(
+            [](void * ctx, size_t task) { (*static_cast<Fn *>(ctx))(task); },
+            &fn,
+            ntask);
+    }
+
+private:
+    void worker_main(size_t worker);
+    void run_tasks(size_t first_task) const;
+};
+
+}
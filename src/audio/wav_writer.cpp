@@ -0,0 +1,179 @@
+#include "wav_writer.h"
+#include "util/release_assert.h"
+
+#include <fmt/core.h>
+#include <kj/filesystem.h>
+
+#include <algorithm>  // std::min
+#include <cstring>  // memcpy
+#include <limits>
+#include <string_view>
+#include <utility>  // std::move
+
+namespace audio::wav_writer {
+
+struct WavFile {
+    kj::Own<const kj::File> file;
+};
+
+namespace {
+
+/// RIFF header + "fmt " chunk (WAVE_FORMAT_IEEE_FLOAT, cbSize = 0)
+/// + "fact" chunk + "data" chunk header.
+constexpr size_t HEADER_SIZE = 12 + (8 + 18) + (8 + 4) + 8;
+
+/// Byte offsets of the size fields patched by finish().
+constexpr size_t RIFF_SIZE_OFFSET = 4;
+constexpr size_t FACT_NFRAMES_OFFSET = 12 + (8 + 18) + 8;
+constexpr size_t DATA_SIZE_OFFSET = HEADER_SIZE - 4;
+
+constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+
+void put_u16(uint8_t * out, uint16_t value) {
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+}
+
+void put_u32(uint8_t * out, uint32_t value) {
+    out[0] = uint8_t(value);
+    out[1] = uint8_t(value >> 8);
+    out[2] = uint8_t(value >> 16);
+    out[3] = uint8_t(value >> 24);
+}
+
+void put_tag(uint8_t * out, char const (&tag)[5]) {
+    memcpy(out, tag, 4);
+}
+
+/// RIFF sizes are 32-bit. If a render exceeds 4 GB, the header saturates
+/// (most readers then fall back to reading until end of file).
+uint32_t clamp_u32(uint64_t value) {
+    return (uint32_t) std::min<uint64_t>(value, std::numeric_limits<uint32_t>::max());
+}
+
+std::string_view string_view(kj::StringPtr str) {
+    return std::string_view(str.begin(), str.size());
+}
+
+}
+
+WavWriter::WavWriter(std::unique_ptr<WavFile> file, uint32_t nchan, uint32_t smp_per_s)
+    : _file(std::move(file))
+    , _nchan(nchan)
+    , _smp_per_s(smp_per_s)
+{}
+
+WavWriter::~WavWriter() = default;
+WavWriter::WavWriter(WavWriter && other) noexcept = default;
+WavWriter & WavWriter::operator=(WavWriter && other) noexcept = default;
+
+std::variant<WavWriter, std::string> WavWriter::create(
+    char const* path, uint32_t nchan, uint32_t smp_per_s
+) {
+    release_assert(nchan > 0);
+
+    std::unique_ptr<WavFile> out;
+    auto maybe_exception = kj::runCatchingExceptions([&]() {
+        kj::Own<kj::Filesystem> fs = kj::newDiskFilesystem();
+        kj::Path abs_path = fs->getCurrentPath().evalNative(path);
+
+        auto dir_open = fs->getRoot().openSubdir(abs_path.parent(), kj::WriteMode::MODIFY);
+        auto file = dir_open->openFile(
+            abs_path.basename(), kj::WriteMode::CREATE | kj::WriteMode::MODIFY
+        );
+        file->truncate(0);
+
+        out = std::make_unique<WavFile>(WavFile{std::move(file)});
+    });
+    KJ_IF_MAYBE(e, maybe_exception) {
+        return fmt::format("Error creating file: {}", string_view(e->getDescription()));
+    }
+
+    WavWriter writer{std::move(out), nchan, smp_per_s};
+
+    // Write a header with zero-length data. finish() fills in the sizes.
+    uint8_t header[HEADER_SIZE] = {};
+    uint32_t const block_align = nchan * (uint32_t) sizeof(float);
+    {
+        uint8_t * p = header;
+        put_tag(p, "RIFF"); p += 4;
+        put_u32(p, 0); p += 4;
+        put_tag(p, "WAVE"); p += 4;
+
+        put_tag(p, "fmt "); p += 4;
+        put_u32(p, 18); p += 4;
+        put_u16(p, WAVE_FORMAT_IEEE_FLOAT); p += 2;
+        put_u16(p, (uint16_t) nchan); p += 2;
+        put_u32(p, smp_per_s); p += 4;
+        put_u32(p, smp_per_s * block_align); p += 4;
+        put_u16(p, (uint16_t) block_align); p += 2;
+        put_u16(p, 8 * sizeof(float)); p += 2;
+        put_u16(p, 0); p += 2;
+
+        // Non-PCM formats require a fact chunk holding the number of frames.
+        put_tag(p, "fact"); p += 4;
+        put_u32(p, 4); p += 4;
+        put_u32(p, 0); p += 4;
+
+        put_tag(p, "data"); p += 4;
+        put_u32(p, 0); p += 4;
+
+        release_assert(p == header + HEADER_SIZE);
+    }
+
+    maybe_exception = kj::runCatchingExceptions([&]() {
+        writer._file->file->write(0, kj::arrayPtr(header, HEADER_SIZE));
+    });
+    KJ_IF_MAYBE(e, maybe_exception) {
+        return fmt::format("Error writing file: {}", string_view(e->getDescription()));
+    }
+
+    return writer;
+}
+
+std::optional<std::string> WavWriter::write(gsl::span<Amplitude const> samples) {
+    static_assert(sizeof(Amplitude) == 4, "WAV writer assumes 32-bit float samples");
+    release_assert(samples.size() % _nchan == 0);
+
+    _byte_buf.resize(samples.size() * sizeof(float));
+    uint8_t * p = _byte_buf.data();
+    for (Amplitude const smp : samples) {
+        uint32_t bits;
+        memcpy(&bits, &smp, sizeof(bits));
+        put_u32(p, bits);
+        p += 4;
+    }
+
+    auto maybe_exception = kj::runCatchingExceptions([&]() {
+        _file->file->write(
+            HEADER_SIZE + _data_bytes, kj::arrayPtr(_byte_buf.data(), _byte_buf.size())
+        );
+    });
+    KJ_IF_MAYBE(e, maybe_exception) {
+        return fmt::format("Error writing file: {}", string_view(e->getDescription()));
+    }
+
+    _data_bytes += _byte_buf.size();
+    return {};
+}
+
+std::optional<std::string> WavWriter::finish() {
+    uint8_t size_buf[4];
+    auto patch = [&](size_t offset, uint32_t value) {
+        put_u32(size_buf, value);
+        _file->file->write(offset, kj::arrayPtr(size_buf, 4));
+    };
+
+    auto maybe_exception = kj::runCatchingExceptions([&]() {
+        patch(RIFF_SIZE_OFFSET, clamp_u32(HEADER_SIZE - 8 + _data_bytes));
+        patch(FACT_NFRAMES_OFFSET, clamp_u32(frames_written()));
+        patch(DATA_SIZE_OFFSET, clamp_u32(_data_bytes));
+    });
+    KJ_IF_MAYBE(e, maybe_exception) {
+        return fmt::format("Error writing file: {}", string_view(e->getDescription()));
+    }
+
+    return {};
+}
+
+}
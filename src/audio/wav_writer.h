@@ -0,0 +1,68 @@
+#pragma once
+
+#include "audio_common.h"
+#include "util/copy_move.h"
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace audio::wav_writer {
+
+/// Opaque handle to an open file. Defined in wav_writer.cpp,
+/// so we don't #include Cap'n Proto (kj) in the public interface.
+struct WavFile;
+
+/// Writes interleaved float samples to a 32-bit float WAV file,
+/// without holding the entire file in memory.
+///
+/// The header is written with placeholder sizes when the file is created,
+/// and patched with the final sizes by finish().
+/// If finish() is never called, the file is left with a zero-length data chunk.
+class WavWriter {
+    std::unique_ptr<WavFile> _file;
+    uint32_t _nchan;
+    uint32_t _smp_per_s;
+
+    /// Number of bytes of sample data written so far.
+    uint64_t _data_bytes = 0;
+
+    /// Scratch space for converting samples to little-endian bytes.
+    std::vector<uint8_t> _byte_buf;
+
+    WavWriter(std::unique_ptr<WavFile> file, uint32_t nchan, uint32_t smp_per_s);
+
+public:
+    /// Creates (or overwrites) a WAV file at `path`, and writes a placeholder header.
+    /// If creating the file fails, returns a string error message (currently not localized).
+    ///
+    /// See comments for serialize::save_to_path, for overview of path encoding.
+    [[nodiscard]] static std::variant<WavWriter, std::string> create(
+        char const* path, uint32_t nchan, uint32_t smp_per_s
+    );
+
+    ~WavWriter();
+    DISABLE_COPY(WavWriter)
+    WavWriter(WavWriter && other) noexcept;
+    WavWriter & operator=(WavWriter && other) noexcept;
+
+    /// Appends interleaved samples, [smp#, * nchan + chan#] Amplitude.
+    /// samples.size() must be a multiple of nchan.
+    /// If writing fails, returns a string error message.
+    [[nodiscard]] std::optional<std::string> write(gsl::span<Amplitude const> samples);
+
+    /// Writes the final RIFF and data chunk sizes into the header.
+    /// Afterwards, write() must not be called.
+    [[nodiscard]] std::optional<std::string> finish();
+
+    uint64_t frames_written() const {
+        return _data_bytes / (sizeof(float) * _nchan);
+    }
+};
+
+}
@@ -5,74 +5,171 @@
 
 namespace cmd_queue {
 
-// impl
-static void init(CommandQueue & self) {
-    self._begin = self._end = new AudioCommand{StopPlayback{}};
+// impl CommandReceiver
+void CommandReceiver::pop() {
+    MessageBody * msg = _channel->commands.front();
+    release_assert(msg);
+
+    if (auto edit = std::get_if<EditBox>(msg)) {
+        // CommandQueue::can_push() ensures there is space.
+        // Paired with CommandQueue::collect_garbage() load(acquire).
+        bool const pushed = _channel->consumed.try_push(std::move(*edit));
+        release_assert(pushed);
+    }
+
+    // Destroys *msg. If it held an EditBox, it's now a null pointer,
+    // so this does not free memory.
+    _channel->commands.pop();
+    _channel->npopped++;
 }
 
-/// Only run this when there are no live readers left.
-static void destroy_all(CommandQueue & self) {
-    if (self._begin == nullptr) {
-        return;
-    }
+void CommandReceiver::mark_seen() noexcept {
+    // Paired with CommandQueue::is_caught_up() load(acquire).
+    _channel->nseen.store(_channel->npopped, std::memory_order_release);
+}
 
-    while (auto next = self._begin->next.load(std::memory_order_relaxed)) {
-        auto destroy = self._begin;
-        self._begin = next;
-        delete destroy;
+// impl CommandQueue
+CommandQueue::CommandQueue()
+    : _channel(std::make_unique<CommandChannel>())
+{}
+
+void CommandQueue::clear() {
+    // The audio thread is not running, so we can access its end of the queue.
+    // Edits it never popped are destroyed here instead of returned through
+    // `consumed`.
+    while (MessageBody * msg = _channel->commands.front()) {
+        if (std::holds_alternative<EditBox>(*msg)) {
+            release_assert(_nedit_live > 0);
+            _nedit_live--;
+        }
+        _channel->commands.pop();
     }
+    collect_garbage();
+    release_assert_equal(_nedit_live, 0);
 
-    // release_assert_equal() doesn't support non-void pointers.
-    release_assert(self._begin == self._end);
-    delete self._begin;
-    self._begin = self._end = nullptr;
+    _channel->npopped = 0;
+    _channel->nseen.store(0, std::memory_order_relaxed);
+    _npushed = 0;
 }
 
-CommandQueue::CommandQueue() {
-    init(*this);
+bool CommandQueue::can_push() const noexcept {
+    // The audio thread updates nseen after popping commands,
+    // so this underestimates the free space in CommandChannel::commands.
+    uint64_t const nseen = _channel->nseen.load(std::memory_order_acquire);
+    return _npushed - nseen < COMMAND_CAPACITY && _nedit_live < COMMAND_CAPACITY;
 }
 
-CommandQueue::~CommandQueue() {
-    destroy_all(*this);
-}
+bool CommandQueue::try_push(MessageBody && msg) {
+    if (!can_push()) {
+        return false;
+    }
+    bool const is_edit = std::holds_alternative<EditBox>(msg);
 
-void CommandQueue::clear() {
-    destroy_all(*this);
-    init(*this);
+    // Paired with CommandReceiver::peek() load(acquire).
+    bool const pushed = _channel->commands.try_push(std::move(msg));
+    release_assert(pushed);
+
+    _npushed++;
+    if (is_edit) {
+        _nedit_live++;
+    }
+    return true;
 }
 
-CommandQueue::CommandQueue(CommandQueue && other) noexcept
-    : _begin{other._begin}, _end{other._end}
-{
-    other._begin = other._end = nullptr;
+void CommandQueue::push(MessageBody msg) {
+    bool const pushed = try_push(std::move(msg));
+    release_assert(pushed);
 }
 
-CommandQueue & CommandQueue::operator=(CommandQueue && other) noexcept {
-    // If we're not trying to move the object into itself...
-    if (this != &other) {
-        destroy_all(*this);
-        _begin = other._begin;
-        _end = other._end;
-        other._begin = other._end = nullptr;
+void CommandQueue::collect_garbage() {
+    // Paired with CommandReceiver::pop() store(release).
+    while (EditBox * edit = _channel->consumed.front()) {
+        (void) edit;
+        _channel->consumed.pop();
+        release_assert(_nedit_live > 0);
+        _nedit_live--;
     }
-    return *this;
 }
 
-void CommandQueue::push_ptr(AudioCommand * elem) {
-    // Paired with synthesize_overall() load(acquire).
-    _end->next.store(elem, std::memory_order_release);
-    _end = elem;
+bool CommandQueue::is_caught_up() const noexcept {
+    // Paired with CommandReceiver::mark_seen() store(release).
+    return _channel->nseen.load(std::memory_order_acquire) == _npushed;
 }
 
-void CommandQueue::pop() {
-    release_assert(_begin != _end);
+}
+
+#ifdef UNITTEST
+
+#include "edit/edit_doc.h"
 
-    auto next = _begin->next.load(std::memory_order_relaxed);
-    release_assert(next);
+#include <doctest.h>
 
-    auto destroy = _begin;
-    _begin = next;
-    delete destroy;
+namespace cmd_queue {
+
+TEST_CASE("CommandQueue reports back-pressure and returns edits") {
+    CommandQueue queue;
+    CommandReceiver receiver = queue.receiver();
+    CHECK(queue.is_empty());
+
+    // Fill the queue while the "audio thread" isn't running.
+    for (size_t i = 0; i < COMMAND_CAPACITY; i++) {
+        REQUIRE(queue.can_push());
+        REQUIRE(queue.try_push(edit::edit_doc::set_tempo(100. + double(i))));
+    }
+    CHECK_FALSE(queue.can_push());
+
+    MessageBody rejected = edit::edit_doc::set_tempo(1.);
+    CHECK_FALSE(queue.try_push(std::move(rejected)));
+    // A rejected command is not consumed.
+    CHECK(std::get<EditBox>(rejected) != nullptr);
+
+    // Popping commands doesn't free space until the audio thread marks them seen.
+    size_t npopped = 0;
+    for (; receiver.peek(); receiver.pop()) {
+        CHECK(std::get<EditBox>(*receiver.peek()) != nullptr);
+        npopped++;
+    }
+    CHECK(npopped == COMMAND_CAPACITY);
+    CHECK_FALSE(queue.is_caught_up());
+    CHECK_FALSE(queue.can_push());
+
+    receiver.mark_seen();
+    CHECK(queue.is_caught_up());
+
+    // Edits are still alive until the GUI thread collects them.
+    CHECK_FALSE(queue.is_empty());
+    CHECK_FALSE(queue.can_push());
+
+    queue.collect_garbage();
+    CHECK(queue.is_empty());
+    CHECK(queue.can_push());
+    CHECK(queue.try_push(std::move(rejected)));
+}
+
+TEST_CASE("CommandQueue::clear() discards edits the audio thread never popped") {
+    CommandQueue queue;
+    CommandReceiver receiver = queue.receiver();
+
+    // Fill the queue, like a stalled audio thread which the GUI then restarts.
+    // The audio thread returned one edit, and never popped the rest.
+    for (size_t i = 0; i + 1 < COMMAND_CAPACITY; i++) {
+        REQUIRE(queue.try_push(edit::edit_doc::set_tempo(100. + double(i))));
+    }
+    queue.push(StopPlayback{});
+    CHECK_FALSE(queue.can_push());
+    receiver.pop();
+
+    queue.clear();
+    CHECK(queue.is_empty());
+    CHECK(receiver.peek() == nullptr);
+
+    REQUIRE(queue.try_push(edit::edit_doc::set_tempo(120.)));
+    receiver.pop();
+    receiver.mark_seen();
+    queue.collect_garbage();
+    CHECK(queue.is_empty());
 }
 
 }
+
+#endif
@@ -4,7 +4,11 @@
 #include "timing_common.h"
 #include "util/copy_move.h"
 
+#include <rigtorp/SPSCQueue.h>
+
 #include <atomic>
+#include <cstddef>  // size_t
+#include <cstdint>
 #include <memory>
 #include <variant>
 
@@ -35,60 +39,112 @@ using edit::EditBox;
 
 using MessageBody = std::variant<PlayFrom, StopPlayback, EditBox>;
 
-/// Exposed to audio thread.
-struct AudioCommand {
-    MessageBody msg;
-    std::atomic<AudioCommand *> next;  // noncopyable, immovable
+/// Maximum number of commands the GUI can send before the audio thread processes them.
+/// The audio thread processes commands once per SPC timer period (several ms),
+/// so the queue only fills up if the audio thread is stalled or stopped.
+constexpr size_t COMMAND_CAPACITY = 1024;
+
+/// State shared between the GUI and audio threads. Preallocated upon construction;
+/// neither thread allocates or frees memory when sending commands.
+struct CommandChannel {
+    /// GUI to audio.
+    rigtorp::SPSCQueue<MessageBody> commands{COMMAND_CAPACITY};
+
+    /// Audio to GUI. When the audio thread is done with an EditBox,
+    /// it returns it to the GUI thread to be destroyed,
+    /// since freeing memory is not bounded-time.
+    rigtorp::SPSCQueue<EditBox> consumed{COMMAND_CAPACITY};
+
+    /// Number of commands popped by the audio thread. Only accessed by the audio thread.
+    uint64_t npopped = 0;
+
+    /// Number of commands processed by the audio thread,
+    /// whose effects (eg. playback time) have been published to the GUI thread.
+    std::atomic<uint64_t> nseen = 0;
+};
+
+/// The audio thread's end of a CommandQueue.
+/// All methods must only be called by the audio thread.
+class CommandReceiver {
+    CommandChannel * _channel;
 
-    explicit AudioCommand(MessageBody && body)
-        : msg{std::move(body)}
-    {
-        next.store(nullptr, std::memory_order_relaxed);
+public:
+    explicit CommandReceiver(CommandChannel & channel)
+        : _channel(&channel)
+    {}
+
+    /// Returns the oldest unprocessed command, or nullptr if there are none.
+    MessageBody * peek() const noexcept {
+        // Paired with CommandQueue::try_push() store(release).
+        return _channel->commands.front();
     }
+
+    /// Removes the command returned by peek().
+    /// If it holds an EditBox, returns it to the GUI thread to be destroyed.
+    void pop();
+
+    /// Tells the GUI thread that all popped commands have been processed.
+    /// Call this after publishing state the GUI expects to change after a command
+    /// (like the playback time).
+    void mark_seen() noexcept;
 };
 
+/// The GUI thread's end of a command queue to the audio thread.
 /// All methods are not thread-safe.
 /// This class should only be held/called by the GUI thread.
 class [[nodiscard]] CommandQueue {
 audio_cmd_INTERNAL:
-    AudioCommand * _begin;  // non-null
-    AudioCommand * _end;  // non-null, may be equal
+    /// Heap-allocated so CommandQueue can be moved while a CommandReceiver
+    /// points to the channel.
+    std::unique_ptr<CommandChannel> _channel;
+
+    /// Number of commands pushed.
+    uint64_t _npushed = 0;
+
+    /// Number of EditBox pushed, but not yet returned by the audio thread
+    /// and destroyed. Bounded by COMMAND_CAPACITY so
+    /// CommandChannel::consumed never overflows.
+    size_t _nedit_live = 0;
 
 public:
     CommandQueue();
-    ~CommandQueue();
-    void clear();
 
     DISABLE_COPY(CommandQueue)
-    CommandQueue(CommandQueue && other) noexcept;
-    CommandQueue & operator=(CommandQueue && other) noexcept;
+    DEFAULT_MOVE(CommandQueue)
 
-    /// The return value is atomically stored into the audio synth,
-    /// and read by the audio thread.
-    AudioCommand * begin() const noexcept {
-        return _begin;
-    }
+    /// Discards all commands (sent or returned).
+    /// Only run this when the audio thread is not running.
+    void clear();
 
-    AudioCommand * end() const noexcept {
-        return _end;
+    /// Returns an object which the audio thread uses to receive commands.
+    /// The CommandQueue must outlive the receiver.
+    CommandReceiver receiver() const {
+        return CommandReceiver(*_channel);
     }
 
-    bool is_empty() const noexcept {
-        return _begin == _end;
-    }
+    /// Returns false if the audio thread has fallen too far behind
+    /// to accept more commands.
+    bool can_push() const noexcept;
 
-    template <typename ...Args>
-    void push(Args && ...args) {
-        push_ptr(new AudioCommand(std::forward<Args>(args)...));
-    }
+    /// If can_push(), sends a command to the audio thread and returns true.
+    /// Otherwise returns false, and `msg` is unchanged.
+    [[nodiscard]] bool try_push(MessageBody && msg);
 
-private:
-    void push_ptr(AudioCommand * elem);
+    /// Sends a command to the audio thread.
+    /// Only call this if can_push() (or the audio thread is known to keep up).
+    void push(MessageBody msg);
 
-public:
-    // no return value because exception safety or something?
-    // what is exception safety help
-    void pop();
+    /// Destroys EditBox returned by the audio thread, freeing up queue space.
+    void collect_garbage();
+
+    /// Returns true if the audio thread has processed every pushed command.
+    bool is_caught_up() const noexcept;
+
+    /// Returns true if the audio thread has processed every pushed command,
+    /// and all consumed EditBox have been destroyed.
+    bool is_empty() const noexcept {
+        return is_caught_up() && _nedit_live == 0;
+    }
 };
 
 }
@@ -4,6 +4,7 @@
 #include "util/enumerate.h"
 #include "util/release_assert.h"
 
+#include <algorithm>  // std::max
 #include <cmath>  // pow
 
 #ifdef UNITTEST
@@ -52,6 +53,22 @@ static void post_init(Document & document) {
             track.blocks.reserve(MAX_BLOCKS_PER_TRACK);
         }
     }
+
+    document.update_extent();
+}
+
+void Document::update_extent() {
+    TickT song_length = 0;
+    for (auto const& chan_tracks : sequence) {
+        for (SequenceTrack const& track : chan_tracks) {
+            if (!track.blocks.empty()) {
+                TrackBlock const& block = track.blocks.back();
+                song_length = std::max(song_length, block.begin_tick
+                    + (int) block.loop_count * block.pattern->length_ticks);
+            }
+        }
+    }
+    extent.song_length = song_length;
 }
 
 Document::Document(const DocumentCopy & other) : DocumentCopy(other) {
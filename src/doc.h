@@ -197,11 +197,21 @@ struct DocumentCopy {
 
 /// Non-copyable version of Document. You must call clone() explicitly.
 struct Document : DocumentCopy {
+    /// Cached from `sequence`. Edit commands which return ModifiedFlags::Patterns
+    /// recompute it after being applied. If you modify `sequence` directly,
+    /// call update_extent() afterwards.
+    SequenceExtent extent;
+
     Document clone() const;
 
     Document(DocumentCopy const & other);
     Document(DocumentCopy && other);
 
+    /// Recomputes `extent` from `sequence`.
+    /// Only allocates memory if the number of chips or channels changed,
+    /// so it can be called on the audio thread.
+    void update_extent();
+
     DISABLE_COPY(Document)
     DEFAULT_MOVE(Document)
 };
@@ -7,7 +7,12 @@
 #include "util/compare.h"
 #endif
 
+#include <gsl/span>
+
+#include <algorithm>  // std::equal
+#include <cstddef>  // size_t
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -36,12 +41,88 @@ struct SampleTuning {
 
 inline constexpr size_t BRR_BLOCK_SIZE = 9;
 
+/// BRR-encoded sample data, which is immutable once constructed and shared between
+/// copies of a Sample (the GUI and audio threads' documents, and edit commands).
+/// Cloning a document bumps a reference count instead of copying megabytes of samples.
+/// To edit sample data, build a new vector and assign it, or call mut().
+///
+/// The reference count is atomic, but only destroy the last handle
+/// on the GUI thread, since it frees memory.
+class SharedBrr {
+    using Vec = std::vector<uint8_t>;
+
+    /// Null if empty.
+    std::shared_ptr<Vec> _ptr;
+
+public:
+    /// Holds no data. Does not allocate memory.
+    SharedBrr() = default;
+
+    /// Implicit, so samples can be initialized with `.brr = std::move(vec)`.
+    SharedBrr(Vec brr)
+        : _ptr(brr.empty() ? nullptr : std::make_shared<Vec>(std::move(brr)))
+    {}
+
+    uint8_t const* data() const {
+        return _ptr ? _ptr->data() : nullptr;
+    }
+    size_t size() const {
+        return _ptr ? _ptr->size() : 0;
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+
+    uint8_t const* begin() const {
+        return data();
+    }
+    uint8_t const* end() const {
+        return data() + size();
+    }
+    uint8_t operator[](size_t idx) const {
+        return (*_ptr)[idx];
+    }
+
+    gsl::span<uint8_t const> span() const {
+        return {data(), size()};
+    }
+
+    /// Returns whether `other` points to the same data.
+    bool shares_with(SharedBrr const& other) const {
+        return _ptr == other._ptr;
+    }
+
+    /// Returns the heap memory held by this data, counted in full even if shared.
+    size_t heap_size() const {
+        return _ptr ? sizeof(Vec) + _ptr->capacity() : 0;
+    }
+
+    /// Returns a mutable reference to this handle's data, first copying the data
+    /// if it's shared with other handles (including ones held by the audio thread).
+    /// Only call on the GUI thread.
+    Vec & mut() {
+        if (!_ptr) {
+            _ptr = std::make_shared<Vec>();
+        } else if (_ptr.use_count() > 1) {
+            _ptr = std::make_shared<Vec>(*_ptr);
+        }
+        return *_ptr;
+    }
+
+#ifdef UNITTEST
+    /// Compares sample data, not identity.
+    bool operator==(SharedBrr const& other) const {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+#endif
+};
+
 // TODO copy whatever amktools uses
 struct Sample {
     std::string name;
 
     /// Length should be a multiple of 9. The last block determines whether it loops.
-    std::vector<uint8_t> brr;
+    SharedBrr brr;
 
     // TODO import process:
     // - source data (wav or brr)
@@ -16,6 +16,9 @@ namespace doc::timed_events {
 /// shouldn't be an issue in practice.
 using TickT = int32_t;
 
+/// Gxx effects move events by at most this many ticks (earlier or later).
+constexpr TickT MAX_TICK_OFFSET = 0x7F;
+
 struct TimedRowEvent {
     /// Relative to pattern start. May be offset further through signed Gxx delay
     /// effects.
@@ -15,7 +15,9 @@
 
 #include <gsl/span>
 
+#include <atomic>  // std::atomic_thread_fence
 #include <compare>
+#include <memory>
 #include <optional>
 
 namespace doc::timeline {
@@ -65,6 +67,93 @@ struct [[nodiscard]] Pattern {
 };
 
 
+/// A reference-counted handle to an immutable Pattern body. Copying a SharedPattern
+/// shares the body instead of copying its events, so blocks repeating the same
+/// material (and copies of the document) store it once. On disk, each distinct
+/// pattern is saved once in Document.patterns and referenced by a PatternID.
+///
+/// To edit a pattern, either build a new Pattern (as edit commands do),
+/// or call mut() to obtain a copy-on-write reference.
+///
+/// The reference count is atomic, so the GUI and audio threads' documents can share
+/// pattern bodies. Only destroy handles on the GUI thread, since dropping the last
+/// handle frees memory.
+class SharedPattern {
+    /// Never null.
+    std::shared_ptr<Pattern> _ptr;
+
+public:
+    /// Holds an empty pattern. Allocates memory.
+    SharedPattern() : SharedPattern(Pattern{.length_ticks = 0, .events = {}}) {}
+
+    /// Allocates a body holding `pattern`. Implicit,
+    /// so blocks can be initialized with `.pattern = Pattern{...}`.
+    SharedPattern(Pattern pattern)
+        : _ptr(std::make_shared<Pattern>(std::move(pattern)))
+    {}
+
+    Pattern const& operator*() const {
+        return *_ptr;
+    }
+    Pattern const* operator->() const {
+        return _ptr.get();
+    }
+    Pattern const* get() const {
+        return _ptr.get();
+    }
+
+    /// Returns whether `other` points to the same body.
+    bool shares_with(SharedPattern const& other) const {
+        return _ptr == other._ptr;
+    }
+
+    /// Returns whether any other handle points to this body.
+    /// Only reliable if no other thread is copying or dropping handles to it.
+    bool is_shared() const {
+        return _ptr.use_count() > 1;
+    }
+
+    /// Returns the heap memory held by this body, counted in full even if shared.
+    size_t heap_size() const {
+        auto const& events = _ptr->events;
+        return sizeof(Pattern) + events.capacity() * sizeof(events[0]);
+    }
+
+    /// Returns a mutable pointer to this handle's body if no other handle
+    /// points to it, otherwise nullptr. Never allocates memory,
+    /// so single-cell edits can call it on the audio thread.
+    ///
+    /// If the count is 1, no other thread holds a handle to copy,
+    /// so the result can't become shared until this thread copies the handle.
+    Pattern * get_mut_if_unique() {
+        if (_ptr.use_count() == 1) {
+            // Observe all writes made by other threads before dropping their handles.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return _ptr.get();
+        }
+        return nullptr;
+    }
+
+    /// Returns a mutable reference to this handle's body, first copying the body
+    /// if it's shared with other handles (including ones held by the audio thread).
+    /// Only call on the GUI thread.
+    Pattern & mut() {
+        if (auto pattern = get_mut_if_unique()) {
+            return *pattern;
+        }
+        _ptr = std::make_shared<Pattern>(*_ptr);
+        return *_ptr;
+    }
+
+#ifdef UNITTEST
+    /// Compares pattern contents, not identity.
+    bool operator==(SharedPattern const& other) const {
+        return *_ptr == *other._ptr;
+    }
+#endif
+};
+
+
 constexpr int MAX_BEATS_PER_MEASURE = 128;
 
 
@@ -85,11 +174,10 @@ struct [[nodiscard]] TrackBlock {
 
     uint32_t loop_count = 1;
 
-    /// For now, `TrackBlock` owns a `Pattern`.
-    /// Eventually it should store a `PatternID` indexing into an
-    /// (either global or per-channel) store of shared patterns.
-    /// Or maybe a variant of these two.
-    Pattern pattern;
+    /// May be shared with other blocks (in any track), and with other copies of the
+    /// document. Editing a block's pattern replaces the handle or calls mut(),
+    /// so other blocks are unaffected.
+    SharedPattern pattern;
 
 // impl
     static TrackBlock from_events(
@@ -154,6 +242,15 @@ struct [[nodiscard]] SequenceTrack {
 using ChipChannelTracks = ChipChannelTo<SequenceTrack>;
 using Sequence = ChipChannelTracks;
 
+/// Cached end time of a Sequence, stored in Document.
+/// The sequencer checks for the end of the song on every tick of every channel,
+/// so it reads this instead of scanning every track.
+struct SequenceExtent {
+    /// End time of the last block in any track. The song loops once playback
+    /// reaches this time.
+    TickT song_length = 0;
+};
+
 
 using SequenceTrackRef = SequenceTrack const&;
 using SequenceTrackRefMut = SequenceTrack &;
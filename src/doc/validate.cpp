@@ -415,13 +415,13 @@ optional<TrackBlock> validate_track_block(ErrorState & state, TrackBlock block)
         return {};
     }
 
-    // block.pattern.length_ticks is gracefully validated in validate_pattern(), called
+    // block.pattern->length_ticks is gracefully validated in validate_pattern(), called
     // before this function.
-    release_assert(block.pattern.length_ticks >= 0);
-    release_assert(block.pattern.length_ticks <= MAX_TICK);
+    release_assert(block.pattern->length_ticks >= 0);
+    release_assert(block.pattern->length_ticks <= MAX_TICK);
 
     const auto length_ticks =
-        (int64_t) block.loop_count * (int64_t) block.pattern.length_ticks;
+        (int64_t) block.loop_count * (int64_t) block.pattern->length_ticks;
     release_assert(length_ticks >= 0);
 
     if (length_ticks > (int64_t) MAX_TICK) {
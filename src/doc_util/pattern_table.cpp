@@ -0,0 +1,114 @@
+#include "pattern_table.h"
+
+#include <cstddef>  // size_t
+#include <unordered_map>
+
+namespace doc_util::pattern_table {
+
+using doc::timed_events::TimedRowEvent;
+
+static void hash_combine(size_t & seed, size_t value) {
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+static size_t hash_pattern(Pattern const& pattern) {
+    size_t seed = (size_t) pattern.length_ticks;
+    for (TimedRowEvent const& ev : pattern.events) {
+        hash_combine(seed, (size_t) ev.anchor_tick);
+        auto const& v = ev.v;
+        hash_combine(seed, v.note ? (size_t) (uint16_t) v.note->value : 0x10000);
+        hash_combine(seed, v.instr ? (size_t) *v.instr : 0x100);
+        hash_combine(seed, v.volume ? (size_t) *v.volume : 0x100);
+        for (auto const& eff : v.effects) {
+            hash_combine(seed, eff
+                ? (size_t) eff->name[0] << 16 | (size_t) eff->name[1] << 8 | eff->value
+                : 0x1000000);
+        }
+    }
+    return seed;
+}
+
+static bool same_contents(Pattern const& a, Pattern const& b) {
+    return a.length_ticks == b.length_ticks && a.events == b.events;
+}
+
+PatternTable build_pattern_table(Sequence const& sequence) {
+    PatternTable out;
+    // Patterns are usually unique (or shared by identity),
+    // so most lookups don't need to compare events.
+    std::unordered_map<Pattern const*, PatternID> by_identity;
+    std::unordered_multimap<size_t, PatternID> by_hash;
+
+    auto get_id = [&](SharedPattern const& pattern) -> PatternID {
+        if (auto it = by_identity.find(pattern.get()); it != by_identity.end()) {
+            return it->second;
+        }
+
+        size_t const hash = hash_pattern(*pattern);
+        auto [begin, end] = by_hash.equal_range(hash);
+        for (auto it = begin; it != end; ++it) {
+            if (same_contents(*out.patterns[it->second], *pattern)) {
+                by_identity.emplace(pattern.get(), it->second);
+                return it->second;
+            }
+        }
+
+        auto const id = (PatternID) out.patterns.size();
+        out.patterns.push_back(pattern);
+        by_identity.emplace(pattern.get(), id);
+        by_hash.emplace(hash, id);
+        return id;
+    };
+
+    out.block_ids.reserve(sequence.size());
+    for (auto const& chip_tracks : sequence) {
+        auto & chip_ids = out.block_ids.emplace_back();
+        chip_ids.reserve(chip_tracks.size());
+        for (SequenceTrack const& track : chip_tracks) {
+            auto & track_ids = chip_ids.emplace_back();
+            track_ids.reserve(track.blocks.size());
+            for (TrackBlock const& block : track.blocks) {
+                track_ids.push_back(get_id(block.pattern));
+            }
+        }
+    }
+    return out;
+}
+
+}
+
+#ifdef UNITTEST
+
+#include <doctest.h>
+
+namespace doc_util::pattern_table {
+
+TEST_CASE("build_pattern_table() stores shared and identical patterns once") {
+    using doc::events::RowEvent;
+    using doc::event_list::EventList;
+
+    SharedPattern const loop = Pattern{4, EventList{{0, RowEvent{60}}}};
+    Pattern const other{4, EventList{{0, RowEvent{62}}}};
+
+    Sequence sequence{{
+        SequenceTrack{
+            TrackBlock{.begin_tick = 0, .loop_count = 1, .pattern = loop},
+            TrackBlock{.begin_tick = 4, .loop_count = 1, .pattern = other},
+            TrackBlock{.begin_tick = 8, .loop_count = 1, .pattern = loop},
+        },
+        SequenceTrack{
+            // A separate copy with the same contents.
+            TrackBlock{.begin_tick = 0, .loop_count = 2, .pattern = Pattern(*loop)},
+        },
+    }};
+
+    auto table = build_pattern_table(sequence);
+    REQUIRE(table.patterns.size() == 2);
+    CHECK(table.patterns[0].shares_with(loop));
+    CHECK(*table.patterns[1] == other);
+    CHECK(table.block_ids == ChipChannelTo<std::vector<PatternID>>{{{0, 1, 0}, {0}}});
+}
+
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+/// Lists the distinct patterns used by a sequence, so each can be saved once
+/// and referenced by ID.
+
+#include "doc/timeline.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace doc_util::pattern_table {
+
+using namespace doc::timeline;
+
+/// Index into PatternTable::patterns (and serialized Document.patterns).
+using PatternID = uint32_t;
+
+struct PatternTable {
+    /// Each distinct pattern, in order of first use (by chip, channel, then block).
+    std::vector<SharedPattern> patterns;
+
+    /// The PatternID of each block in the sequence.
+    ChipChannelTo<std::vector<PatternID>> block_ids;
+};
+
+/// Blocks sharing a pattern body, or holding patterns with equal contents,
+/// get the same PatternID.
+[[nodiscard]] PatternTable build_pattern_table(Sequence const& sequence);
+
+}
@@ -8,11 +8,11 @@ namespace doc_util::track_util {
 // Cross-track search
 
 static TickT end_time(TrackBlock const& block) {
-    return block.begin_tick + (int) block.loop_count * block.pattern.length_ticks;
+    return block.begin_tick + (int) block.loop_count * block.pattern->length_ticks;
 }
 
 static TickT loop_time(TrackBlock const& block, uint32_t loop_idx) {
-    return block.begin_tick + (int) loop_idx * block.pattern.length_ticks;
+    return block.begin_tick + (int) loop_idx * block.pattern->length_ticks;
 }
 
 TickT song_length(Sequence const& tracks) {
@@ -60,7 +60,7 @@ IterResult TrackPatternIter::at_time(SequenceTrackRef track, TickT now) {
         const bool snapped_later = now < block.begin_tick;
         uint32_t loop_idx = snapped_later
             ? 0
-            : (uint32_t) ((now - block.begin_tick) / block.pattern.length_ticks);
+            : (uint32_t) ((now - block.begin_tick) / block.pattern->length_ticks);
         return IterResult {
             .iter = TrackPatternIter(block_idx, loop_idx),
             .snapped_later = snapped_later,
@@ -80,7 +80,7 @@ MaybePatternRef TrackPatternIter::peek(SequenceTrackRef track) const {
             .end_tick = loop_time(block, _loop_idx + 1),
             .is_block_begin = _loop_idx == 0,
             .is_block_end = _loop_idx + 1 == block.loop_count,
-            .events = TimedEventsRef(block.pattern.events)
+            .events = TimedEventsRef(block.pattern->events)
         };
     } else {
         return {};
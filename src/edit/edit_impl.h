@@ -38,7 +38,10 @@ struct ImplEditCommand : BaseEditCommand, Body {
     }
 
     void apply_swap(doc::Document & document) override {
-        return Body::apply_swap(document);
+        Body::apply_swap(document);
+        if (modified() & ModifiedFlags::Patterns) {
+            document.update_extent();
+        }
     }
 
     bool save_in_history() const override {
@@ -53,9 +56,25 @@ struct ImplEditCommand : BaseEditCommand, Body {
         }
     }
 
+    [[nodiscard]] size_t heap_size() const override {
+        if constexpr (requires (Body const& body) { body.heap_size(); }) {
+            return sizeof(*this) + Body::heap_size();
+        } else {
+            return sizeof(*this);
+        }
+    }
+
     [[nodiscard]] ModifiedFlags modified() const override {
         return Body::_modified;
     }
+
+    [[nodiscard]] ModifiedScope modified_scope() const override {
+        if constexpr (requires (Body const& body) { body.scope(); }) {
+            return Body::scope();
+        } else {
+            return ModifiedScope{};
+        }
+    }
 };
 
 template<typename Body>
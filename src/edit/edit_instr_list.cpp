@@ -6,8 +6,11 @@
 #include "util/release_assert.h"
 #include "util/typeid_cast.h"
 
+#include <algorithm>  // std::none_of
+#include <cstddef>  // size_t
 #include <limits>
 #include <optional>
+#include <unordered_map>
 #include <utility>  // std::move
 
 namespace edit::edit_instr_list {
@@ -28,6 +31,14 @@ struct AddRemoveInstrument {
         std::swap(instr, doc.instruments[index]);
     }
 
+    size_t heap_size() const {
+        if (!instr) {
+            return 0;
+        }
+        return instr->name.capacity()
+            + instr->keysplit.capacity() * sizeof(InstrumentPatch);
+    }
+
     static constexpr ModifiedFlags _modified = ModifiedFlags::InstrumentsEdited;
     using Impl = ImplEditCommand<AddRemoveInstrument, Override::None>;
 };
@@ -143,6 +154,10 @@ struct RenameInstrument {
         std::swap(doc.instruments[path.instr_idx]->name, name);
     }
 
+    size_t heap_size() const {
+        return name.capacity();
+    }
+
     using Impl = ImplEditCommand<RenameInstrument, Override::CanMerge>;
     bool can_merge(BaseEditCommand & prev) const {
         if (auto * p = typeid_cast<Impl *>(&prev)) {
@@ -173,16 +188,40 @@ MaybeEditBox try_rename_instrument(
 static void sequence_swap_instruments(
     Sequence & sequence, InstrumentIndex a, InstrumentIndex b
 ) {
+    auto uses_instr = [a, b](TimedRowEvent const& ev) {
+        return ev.v.instr == a || ev.v.instr == b;
+    };
+
+    struct Remapped {
+        /// Keeps the old body alive, so its address isn't reused by a new pattern.
+        SharedPattern old;
+        SharedPattern remapped;
+    };
+    // Only copy patterns using either instrument,
+    // and copy each shared pattern once so blocks sharing it still do.
+    std::unordered_map<Pattern const*, Remapped> remapped;
+
     for (auto & channel_tracks : sequence) {
         for (SequenceTrack & track : channel_tracks) {
             for (TrackBlock & block : track.blocks) {
-                for (auto & ev : block.pattern.events) {
+                auto const& events = block.pattern->events;
+                if (std::none_of(events.begin(), events.end(), uses_instr)) {
+                    continue;
+                }
+                if (auto it = remapped.find(block.pattern.get()); it != remapped.end()) {
+                    block.pattern = it->second.remapped;
+                    continue;
+                }
+
+                SharedPattern old = block.pattern;
+                for (auto & ev : block.pattern.mut().events) {
                     if (ev.v.instr == a) {
                         ev.v.instr = b;
                     } else if (ev.v.instr == b) {
                         ev.v.instr = a;
                     }
                 }
+                remapped.emplace(old.get(), Remapped{old, block.pattern});
             }
         }
     }
@@ -12,9 +12,11 @@
 
 #include <cpp11-on-multicore/bitfield.h>
 
+#include <algorithm>  // std::min, std::max, std::swap_ranges
 #include <utility>  // std::swap
 #include <cassert>
 #include <memory>  // make_unique. <memory> is already included for EditBox though.
+#include <optional>
 #include <stdexcept>
 #include <variant>
 
@@ -26,17 +28,114 @@ using namespace edit_impl;
 
 namespace edit {
     struct EditPattern {
-        doc::Pattern pattern;
+        doc::SharedPattern pattern;
+    };
+    /// Replaces the events anchored to one tick of a pattern (usually 0 or 1 events),
+    /// so single-cell edits don't copy the entire pattern.
+    struct EditEvents {
+        /// Relative to the block's begin tick.
+        TickT rel_tick;
+        /// All anchored to rel_tick.
+        EventList events;
+        /// Only set in commands sent to the audio thread. A new, empty pattern body
+        /// with enough capacity to hold the edited pattern, used if the document's
+        /// pattern is shared or lacks capacity, so apply_swap() doesn't allocate.
+        std::optional<doc::SharedPattern> spare;
     };
     struct AddBlock {
         doc::TrackBlock block;
     };
     struct RemoveBlock {};
 
-    using Edit = std::variant<EditPattern, AddBlock, RemoveBlock>;
+    using Edit = std::variant<EditPattern, EditEvents, AddBlock, RemoveBlock>;
 }
 
 using edit::Edit;
+using doc_util::event_search::EventSearch;
+
+/// The indices of the events anchored to a tick.
+struct TickRange {
+    size_t begin;
+    size_t end;
+};
+
+static TickRange tick_range(EventList const& events, TickT tick) {
+    TimedEventsRef ref = events;
+    EventSearch kv{ref};
+    return TickRange {
+        .begin = size_t(kv.tick_begin(tick) - ref.begin()),
+        .end = size_t(kv.tick_end(tick) - ref.begin()),
+    };
+}
+
+/// Returns a copy of the events anchored to a tick.
+static EventList events_at(Pattern const& pattern, TickT tick) {
+    auto [begin, end] = tick_range(pattern.events, tick);
+    auto const& events = pattern.events;
+    return EventList(events.begin() + (ptrdiff_t) begin, events.begin() + (ptrdiff_t) end);
+}
+
+/// Swaps the events anchored to `delta.rel_tick` in `doc_pattern` with `delta.events`.
+///
+/// Edits the pattern in place if it's unshared. Otherwise (or if it lacks capacity)
+/// copies it into `delta.spare` if present (which holds enough capacity),
+/// leaving the old body in `delta.spare` to be freed by the GUI thread.
+/// Doesn't allocate memory if `delta.spare` is present (or the pattern is unshared
+/// and has enough capacity), and `delta.events` has capacity for the events
+/// being swapped out.
+static void swap_events(SharedPattern & doc_pattern, edit::EditEvents & delta) {
+    auto const [begin, end] = tick_range(doc_pattern->events, delta.rel_tick);
+    size_t const nold = end - begin;
+    size_t const nnew = delta.events.size();
+    size_t const new_size = doc_pattern->events.size() - nold + nnew;
+
+    // Reject all edits that create 64k or more events, like EditPattern.
+    if (new_size > (size_t) MAX_EVENTS_PER_PATTERN) {
+        return;
+    }
+    for (auto & ev : delta.events) {
+        assert(ev.anchor_tick == delta.rel_tick);
+        assert(ev.v != doc::RowEvent{});
+        (void) ev;
+    }
+
+    Pattern * pattern = doc_pattern.get_mut_if_unique();
+    if (!pattern || new_size > pattern->events.capacity()) {
+        if (delta.spare) {
+            Pattern * spare = delta.spare->get_mut_if_unique();
+            release_assert(spare);
+            release_assert(spare->events.capacity() >= new_size);
+
+            spare->length_ticks = doc_pattern->length_ticks;
+            spare->events.assign(doc_pattern->events.begin(), doc_pattern->events.end());
+            std::swap(doc_pattern, *delta.spare);
+            pattern = spare;
+        } else {
+            // Only reached on the GUI thread.
+            pattern = &doc_pattern.mut();
+        }
+    }
+
+    EventList & doc_events = pattern->events;
+    EventList & cmd_events = delta.events;
+    auto const doc_begin = doc_events.begin() + (ptrdiff_t) begin;
+
+    size_t const ncommon = std::min(nold, nnew);
+    std::swap_ranges(doc_begin, doc_begin + (ptrdiff_t) ncommon, cmd_events.begin());
+    if (nnew > nold) {
+        doc_events.insert(
+            doc_begin + (ptrdiff_t) nold,
+            cmd_events.begin() + (ptrdiff_t) nold,
+            cmd_events.end());
+        cmd_events.erase(cmd_events.begin() + (ptrdiff_t) nold, cmd_events.end());
+    } else if (nold > nnew) {
+        cmd_events.insert(
+            cmd_events.end(),
+            doc_begin + (ptrdiff_t) nnew,
+            doc_begin + (ptrdiff_t) nold);
+        doc_events.erase(doc_begin + (ptrdiff_t) nnew, doc_begin + (ptrdiff_t) nold);
+    }
+}
 
 /// Implements EditCommand. Other classes can store a vector of multiple PatternEdit.
 struct PatternEdit {
@@ -48,32 +147,41 @@ struct PatternEdit {
 
     ModifiedFlags _modified = ModifiedFlags::Patterns;
 
+    /// Where the edited block begins. Set by apply_swap().
+    TickT _begin_tick = 0;
+
     void apply_swap(doc::Document & document) {
         auto & doc_blocks = document.sequence[_chip][_channel].blocks;
 
         auto p = &_edit;
-
         if (auto edit = std::get_if<edit::EditPattern>(p)) {
-            Pattern & doc_pattern = doc_blocks[_block].pattern;
+            _begin_tick = doc_blocks[_block].begin_tick;
+            SharedPattern & doc_pattern = doc_blocks[_block].pattern;
 
             // Reject all edits that create 64k or more events in a single edit.
             // Don't assert that this never happens,
             // because a user can perform this through valid inputs only.
-            if (edit->pattern.events.size() > MAX_EVENTS_PER_PATTERN) {
+            if (edit->pattern->events.size() > MAX_EVENTS_PER_PATTERN) {
                 return;
             }
             // Why do we check for too many events at apply_swap time, but too many
             // blocks at create time?
 
-            for (auto & ev : edit->pattern.events) {
+            for (auto & ev : edit->pattern->events) {
                 assert(ev.v != doc::RowEvent{});
                 (void) ev;
             }
             std::swap(doc_pattern, edit->pattern);
 
+        } else
+        if (auto delta = std::get_if<edit::EditEvents>(p)) {
+            _begin_tick = doc_blocks[_block].begin_tick;
+            swap_events(doc_blocks[_block].pattern, *delta);
+
         } else
         if (auto add = std::get_if<edit::AddBlock>(p)) {
-            for (auto & ev : add->block.pattern.events) {
+            _begin_tick = add->block.begin_tick;
+            for (auto & ev : add->block.pattern->events) {
                 assert(ev.v != doc::RowEvent{});
                 (void) ev;
             }
@@ -82,6 +190,7 @@ struct PatternEdit {
 
         } else
         if (std::get_if<edit::RemoveBlock>(p)) {
+            _begin_tick = doc_blocks[_block].begin_tick;
             *p = edit::AddBlock{std::move(doc_blocks[_block])};
             doc_blocks.erase(doc_blocks.begin() + _block);
 
@@ -93,14 +202,86 @@ struct PatternEdit {
         for (auto const& block : doc_blocks) {
             assert(block.begin_tick >= prev_end);
             assert(block.loop_count > 0);
-            assert(block.pattern.length_ticks > 0);
+            assert(block.pattern->length_ticks > 0);
             prev_end =
-                block.begin_tick + (int) block.loop_count * block.pattern.length_ticks;
+                block.begin_tick + (int) block.loop_count * block.pattern->length_ticks;
         }
 #endif
     }
 
-    using Impl = ImplEditCommand<PatternEdit, Override::None>;
+    ModifiedScope scope() const {
+        return ModifiedScope{.channel = modified::EditedChannel{
+            .chip = _chip,
+            .channel = _channel,
+            .begin_tick = _begin_tick - timed_events::MAX_TICK_OFFSET,
+        }};
+    }
+
+    size_t heap_size() const {
+        auto p = &_edit;
+        if (auto edit = std::get_if<edit::EditPattern>(p)) {
+            return edit->pattern.heap_size();
+        }
+        if (auto delta = std::get_if<edit::EditEvents>(p)) {
+            size_t out = delta->events.capacity() * sizeof(TimedRowEvent);
+            if (delta->spare) {
+                out += delta->spare->heap_size();
+            }
+            return out;
+        }
+        if (auto add = std::get_if<edit::AddBlock>(p)) {
+            return add->block.pattern.heap_size();
+        }
+        return 0;
+    }
+
+    EditBox clone_for_audio(doc::Document const& doc) const {
+        auto clone = [this](Edit edit) {
+            return make_command(PatternEdit {
+                ._chip = _chip,
+                ._channel = _channel,
+                ._block = _block,
+                ._edit = std::move(edit),
+                ._modified = _modified,
+                ._begin_tick = _begin_tick,
+            });
+        };
+        if (auto delta = std::get_if<edit::EditEvents>(&_edit)) {
+            return clone(reserve_for_audio(doc, *delta));
+        }
+        return std::make_unique<Impl>(*this);
+    }
+
+    /// Copies `delta`, preallocating all memory apply_swap() may need
+    /// on the audio thread's copy of `doc` (which matches `doc` when applied).
+    edit::EditEvents reserve_for_audio(
+        doc::Document const& doc, edit::EditEvents const& delta
+    ) const {
+        SharedPattern const& doc_pattern =
+            doc.sequence[_chip][_channel].blocks[_block].pattern;
+        auto const [begin, end] = tick_range(doc_pattern->events, delta.rel_tick);
+        size_t const nold = end - begin;
+        size_t const size = doc_pattern->events.size();
+        size_t const new_size = size - nold + delta.events.size();
+
+        edit::EditEvents out{.rel_tick = delta.rel_tick, .events = {}, .spare = {}};
+        out.events.reserve(std::max(nold, delta.events.size()));
+        out.events.insert(out.events.end(), delta.events.begin(), delta.events.end());
+
+        // The audio thread's pattern body may be shared (with our document,
+        // or other blocks), and we can't tell how much capacity it has.
+        // Give it room to grow, so later insertions don't need a spare.
+        if (doc_pattern.is_shared() || new_size > size) {
+            Pattern spare{.length_ticks = 0, .events = {}};
+            spare.events.reserve(std::max(
+                new_size, std::min(2 * new_size, (size_t) MAX_EVENTS_PER_PATTERN)
+            ));
+            out.spare = std::move(spare);
+        }
+        return out;
+    }
+
+    using Impl = ImplEditCommand<PatternEdit, Override::CloneForAudio>;
 };
 
 /// Erase all empty elements of an entire EventList (not a slice).
@@ -141,21 +322,18 @@ EditBox delete_cell(
     const TickT rel_tick = now - pattern_ref.begin_tick;
     assert(rel_tick >= 0);
 
-    // Copy pattern.
-    doc::Pattern pattern =
-        document.sequence[chip][channel].blocks[pattern_ref.block].pattern;
+    // Copy the events at the cursor.
+    EventList events = events_at(
+        *document.sequence[chip][channel].blocks[pattern_ref.block].pattern, rel_tick
+    );
 
     // Erase certain event fields, based on where the cursor was positioned.
     {
-        EventSearchMut kv{pattern.events};
-
         // TODO erase a full row of events?
-        auto ev_begin = kv.tick_begin(rel_tick);
-        auto ev_end = kv.tick_end(rel_tick);
         auto p = &subcolumn;
 
-        for (auto it = ev_begin; it != ev_end; it++) {
-            auto & event = it->v;
+        for (auto & timed_event : events) {
+            auto & event = timed_event.v;
 
             if (std::get_if<SubColumn_::Note>(p)) {
                 event.note = {};
@@ -176,13 +354,15 @@ EditBox delete_cell(
     }
 
     // If we erase all fields from an event, remove the event entirely.
-    erase_empty(pattern.events);
+    erase_empty(events);
 
     return make_command(PatternEdit {
         ._chip = chip,
         ._channel = channel,
         ._block = pattern_ref.block,
-        ._edit = edit::EditPattern{std::move(pattern)},
+        ._edit = edit::EditEvents{
+            .rel_tick = rel_tick, .events = std::move(events), .spare = {}
+        },
     });
 }
 
@@ -203,7 +383,7 @@ struct CreateOrEdit {
     ChipIndex chip;
     ChannelIndex channel;
     BlockIndex block;
-    std::variant<edit::EditPattern, edit::AddBlock> edit;
+    std::variant<edit::EditEvents, edit::EditPattern, edit::AddBlock> edit;
     TickT rel_tick;
 
     /// Returns nullopt if we need to create a block, but MAX_BLOCKS_PER_TRACK blocks
@@ -219,19 +399,22 @@ struct CreateOrEdit {
 
         const IterResultRef p = TrackPatternIterRef::at_time(track, now);
         if (!p.snapped_later) {
-            // When editing a block/pattern, return a pattern copy in-place.
+            // When editing a block/pattern, only copy the events at the cursor.
             const PatternRef pattern_ref = p.iter.peek().value();
             const TickT rel_tick = now - pattern_ref.begin_tick;
             assert(rel_tick >= 0);
 
-            // Copy pattern.
+            auto const& pattern =
+                *doc.sequence[chip][channel].blocks[pattern_ref.block].pattern;
             return CreateOrEdit {
                 .chip = chip,
                 .channel = channel,
                 .block = pattern_ref.block,
-                .edit = edit::EditPattern{doc::Pattern(
-                    doc.sequence[chip][channel].blocks[pattern_ref.block].pattern
-                )},
+                .edit = edit::EditEvents{
+                    .rel_tick = rel_tick,
+                    .events = events_at(pattern, rel_tick),
+                    .spare = {},
+                },
                 .rel_tick = rel_tick,
             };
         }
@@ -283,7 +466,7 @@ struct CreateOrEdit {
             release_assert(measure_end > block_begin);
 
             // Copy pattern and extend to measure_end.
-            auto pattern = block.pattern;
+            Pattern pattern = *block.pattern;
             pattern.length_ticks = measure_end - block_begin;
             return CreateOrEdit {
                 .chip = chip,
@@ -348,14 +531,20 @@ struct CreateOrEdit {
         );
     }
 
-    Pattern & pattern() {
+    /// Returns the events to edit. When editing an existing block, only holds
+    /// the events at rel_tick. Otherwise holds the entire pattern, which was copied
+    /// by try_make(), so mut() doesn't copy it again.
+    EventList & events() {
+        if (auto delta = std::get_if<edit::EditEvents>(&edit)) {
+            return delta->events;
+        } else
         if (auto edit_ = std::get_if<edit::EditPattern>(&edit)) {
-            return edit_->pattern;
+            return edit_->pattern.mut().events;
         } else
         if (auto add = std::get_if<edit::AddBlock>(&edit)) {
-            return add->block.pattern;
+            return add->block.pattern.mut().events;
         } else
-            throw std::logic_error("CreateOrEdit pattern(), edit holds nothing");
+            throw std::logic_error("CreateOrEdit events(), edit holds nothing");
     }
 
     PatternEdit into_edit() && {
@@ -387,7 +576,7 @@ EditBox insert_note(
     }
     CreateOrEdit & edit = *maybe_edit;
 
-    EventList & pattern_events = edit.pattern().events;
+    EventList & pattern_events = edit.events();
 
     // Insert note.
     EventSearchMut kv{pattern_events};
@@ -434,7 +623,7 @@ std::tuple<uint8_t, EditBox> add_digit(
     }
     CreateOrEdit & edit = *maybe_edit;
 
-    EventList & pattern_events = edit.pattern().events;
+    EventList & pattern_events = edit.events();
 
     // Insert instrument/volume, edit effect. No-op if no effect present.
 
@@ -531,7 +720,7 @@ std::tuple<uint8_t, EditBox> add_digit(
     }
     CreateOrEdit & edit = *maybe_edit;
 
-    EventList & pattern_events = edit.pattern().events;
+    EventList & pattern_events = edit.events();
 
     // field: ('events = 'edit).
     auto & field = [&] () -> doc::Effect & {
@@ -24,7 +24,7 @@ static Sample & get_sample_mut(doc::Document & doc, size_t sample_idx) {
 
 class SetSampleMetadata {
     SampleIndex _path;
-    // .brr is empty to conserve RAM.
+    // .brr is empty, so the command doesn't keep the old sample data alive.
     // Ideally I'd only store the single field being edited,
     // but that's difficult to achieve with C++ templates.
     Sample _value;
@@ -38,9 +38,8 @@ public:
         _path = (SampleIndex) sample_idx;
         _value = std::move(value);
 
-        // Deallocate the sample data to save RAM in the undo history.
-        _value.brr.clear();
-        _value.brr.shrink_to_fit();
+        // Release our reference to the sample data (shared with the document).
+        _value.brr = {};
 
         _modified = modified;
     }
@@ -6,6 +6,7 @@
 #include "util/release_assert.h"
 #include "util/typeid_cast.h"
 
+#include <cstddef>  // size_t
 #include <limits>
 #include <optional>
 #include <utility>  // std::move
@@ -14,6 +15,12 @@ namespace edit::edit_sample_list {
 
 using namespace doc;
 using namespace edit_impl;
+using modified::SampleSet;
+
+/// Returns the heap memory held by a sample stored in an edit command.
+static size_t sample_heap_size(std::optional<Sample> const& sample) {
+    return sample ? sample->name.capacity() + sample->brr.heap_size() : 0;
+}
 
 struct AddRemoveSample {
     SampleIndex index;
@@ -29,6 +36,15 @@ struct AddRemoveSample {
     }
 
     static constexpr ModifiedFlags _modified = ModifiedFlags::SamplesEdited;
+
+    ModifiedScope scope() const {
+        return {.samples = SampleSet{}.set(index)};
+    }
+
+    size_t heap_size() const {
+        return sample_heap_size(sample);
+    }
+
     using Impl = ImplEditCommand<AddRemoveSample, Override::None>;
 };
 
@@ -67,6 +83,15 @@ struct ReplaceSample {
     }
 
     static constexpr ModifiedFlags _modified = ModifiedFlags::SamplesEdited;
+
+    ModifiedScope scope() const {
+        return {.samples = SampleSet{}.set(index)};
+    }
+
+    size_t heap_size() const {
+        return sample_heap_size(sample);
+    }
+
     using Impl = ImplEditCommand<ReplaceSample, Override::None>;
 };
 
@@ -147,6 +172,10 @@ struct RenameSample {
         std::swap(doc.samples[path.sample_idx]->name, name);
     }
 
+    size_t heap_size() const {
+        return name.capacity();
+    }
+
     using Impl = ImplEditCommand<RenameSample, Override::CanMerge>;
     bool can_merge(BaseEditCommand & prev) const {
         if (auto * p = typeid_cast<Impl *>(&prev)) {
@@ -209,6 +238,10 @@ struct SwapSamples {
         instrument_swap_samples(doc.instruments, a, b);
     }
 
+    ModifiedScope scope() const {
+        return {.samples = SampleSet{}.set(a).set(b)};
+    }
+
     using Impl = ImplEditCommand<SwapSamples, Override::CloneForAudio>;
     EditBox clone_for_audio(doc::Document const& doc) const;
 
@@ -237,6 +270,10 @@ struct SwapSamplesCached {
         std::swap(doc.instruments, instruments);
     }
 
+    ModifiedScope scope() const {
+        return {.samples = SampleSet{}.set(a).set(b)};
+    }
+
     using Impl = ImplEditCommand<SwapSamplesCached, Override::None>;
     static constexpr ModifiedFlags _modified = ModifiedFlags::SamplesEdited;
 };
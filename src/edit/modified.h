@@ -1,16 +1,24 @@
 #pragma once
 
 #include "modified_common.h"
+#include "chip_common.h"
+#include "doc/sample.h"
+#include "doc/timed_events.h"
+
+#include <bitset>
+#include <optional>
 
 namespace edit::modified {
 
+using chip_common::ChipIndex;
+using chip_common::ChannelIndex;
+using doc::timed_events::TickT;
+
 // TODO flesh out sample editing.
-// Perhaps instead of ModifiedFlags, we can return a unique_ptr<ModifiedMetadata>
-// consisting of bitflags, as well as std::optional/variant for sample rearranging
-// (which sample changed, add/remove metadata, etc.) allowing the driver to compute
-// the old and new address of each sample.
-// Or perhaps just add a method returning `AnonymousVariant &`
-// (only by including a specific header), or allow downcasting, or idk even...
+// ModifiedScope says which samples changed, but not how they were rearranged
+// (add/remove metadata, etc.) Passing that along would let the driver compute
+// the old and new address of each sample, instead of stopping notes playing
+// moved samples.
 
 enum ModifiedFlags : ModifiedInt {
     /// Song length, blocks or patterns, or events have changed. The playback point may
@@ -25,16 +33,44 @@ enum ModifiedFlags : ModifiedInt {
     AllSequencerOptions = EngineTempo,
 
     /// Sample metadata has changed, but the actual data has not.
-    /// Keep playing existing notes. (TODO reload tuning/loop points)
+    /// Keep playing existing notes, and recompute tuning for new notes.
+    /// (TODO reload loop points)
     SampleMetadataEdited = 0x100,
     /// Sample data and/or sizes have changed.
-    /// Repack all samples into RAM, and stop currently-playing notes.
+    /// Reload changed samples into RAM, and stop notes playing samples
+    /// which were changed or moved.
     /// If set, SampleMetadataEdited is ignored.
     SamplesEdited = 0x200,
 
-    /// Instruments edited. Nothing checks for this so far,
-    /// but include it for completeness.
+    /// Instruments edited. Recompute keysplits for new notes.
     InstrumentsEdited = 0x1000,
 };
 
+/// Set of sample indexes (same type as aram_layout::SampleSet).
+using SampleSet = std::bitset<doc::sample::MAX_SAMPLES>;
+
+/// The one channel whose blocks an edit changed.
+struct EditedChannel {
+    ChipIndex chip;
+    ChannelIndex channel;
+    /// Events before this tick play the same as before the edit
+    /// (including events moved by Gxx effects).
+    TickT begin_tick;
+};
+
+/// Which parts of the document an edit changed, in more detail than ModifiedFlags.
+/// The audio thread only recomputes state for the edited channel or samples,
+/// so an edit's cost doesn't grow with the size of the document.
+///
+/// Defaults to "anything may have changed".
+struct ModifiedScope {
+    /// If ModifiedFlags::Patterns is set: the only channel whose blocks changed,
+    /// or nullopt if any channel may have changed.
+    std::optional<EditedChannel> channel = {};
+
+    /// If ModifiedFlags::SamplesEdited is set: the samples which were added, removed,
+    /// or replaced. Other samples must be unchanged.
+    SampleSet samples = SampleSet{}.set();
+};
+
 }
@@ -11,4 +11,6 @@ using ModifiedInt = uint32_t;
 // If each flag was a method, adding new methods would trigger recompiles.
 enum ModifiedFlags : ModifiedInt;
 
+struct ModifiedScope;
+
 }
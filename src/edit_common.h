@@ -3,6 +3,7 @@
 #include "edit/modified_common.h"
 #include "doc.h"
 
+#include <cstddef>  // size_t
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -25,6 +26,7 @@ using MaybeEditBox = std::unique_ptr<BaseEditCommand>;
 
 using modified::ModifiedInt;
 using modified::ModifiedFlags;
+using modified::ModifiedScope;
 
 class [[nodiscard]] BaseEditCommand {
 public:
@@ -90,11 +92,22 @@ public:
     /// both must entirely replace the same section of the document.
     virtual bool can_merge(BaseEditCommand & prev) const = 0;
 
+    /// Returns the number of bytes this command occupies, including the heap memory
+    /// it owns. Pattern and sample bodies are counted in full even if shared
+    /// with the document, so the result only changes when the command is applied.
+    /// Called by History to bound the memory used by undo history.
+    [[nodiscard]] virtual size_t heap_size() const = 0;
+
     /// Returns a bitflag specifying which parts of the document are modified.
     /// Called by the audio thread to invalidate/recompute sequencer state.
     ///
     /// (This could be a base-class field instead, I guess.)
     [[nodiscard]] virtual ModifiedFlags modified() const = 0;
+
+    /// Returns which channel or samples were modified, so the audio thread can skip
+    /// recomputing state for the rest of the document.
+    /// Only called after apply_swap(). (Include edit/modified.h to call this.)
+    [[nodiscard]] virtual ModifiedScope modified_scope() const = 0;
 };
 
 }
@@ -0,0 +1,182 @@
+#include "audio_settings_dialog.h"
+#include "lib/layout_macros.h"
+
+#include <verdigris/wobjectimpl.h>
+
+// widgets
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+
+// layouts
+#include <QBoxLayout>
+#include <QFormLayout>
+
+#include <utility>  // std::move
+
+namespace gui::audio_settings_dialog {
+
+namespace latency = audio::latency;
+
+W_OBJECT_IMPL(AudioSettingsDialog)
+
+namespace {
+
+class AudioSettingsDialogImpl final : public AudioSettingsDialog {
+    ApplyLatency _apply_latency;
+
+    QComboBox * _smp_per_s;
+    QComboBox * _block_size;
+    QSpinBox * _nblocks;
+    QCheckBox * _adaptive;
+    QLabel * _latency_ms;
+
+    QPushButton * _ok;
+    QPushButton * _cancel;
+    QPushButton * _apply;
+
+public:
+    AudioSettingsDialogImpl(
+        LatencyOptions latency, ApplyLatency apply_latency, QWidget * parent
+    )
+        : AudioSettingsDialog(parent)
+        , _apply_latency(std::move(apply_latency))
+    {
+        setWindowTitle(tr("Audio Settings"));
+        // prevent leaking dialogs.
+        setAttribute(Qt::WA_DeleteOnClose);
+        setWindowFlags(windowFlags().setFlag(Qt::WindowContextHelpButtonHint, false));
+
+        latency = latency::clamp(latency);
+
+        auto l = new QVBoxLayout();
+        setLayout(l);
+        l->setSizeConstraint(QLayout::SetFixedSize);
+
+        // Both combo boxes store the number in Qt::UserRole.
+        // If the current value isn't one of the presets, add it too.
+        auto add_items = [](
+            QComboBox * w, auto const& presets, uint32_t curr, QString const& suffix
+        ) {
+            bool found = false;
+            for (uint32_t value : presets) {
+                found |= value == curr;
+            }
+            for (uint32_t value : presets) {
+                if (!found && curr < value) {
+                    w->addItem(QString::number(curr) + suffix, curr);
+                    found = true;
+                }
+                w->addItem(QString::number(value) + suffix, value);
+            }
+            if (!found) {
+                w->addItem(QString::number(curr) + suffix, curr);
+            }
+            w->setCurrentIndex(w->findData(curr));
+        };
+
+        {l__form(QFormLayout);
+            {form__label_w(tr("Sampling rate"), QComboBox);
+                _smp_per_s = w;
+                add_items(w, latency::SAMPLE_RATES, latency.smp_per_s, tr(" Hz"));
+            }
+            {form__label_w(tr("Block size"), QComboBox);
+                _block_size = w;
+                add_items(
+                    w, latency::BLOCK_SIZES, latency.mono_smp_per_block, tr(" samples")
+                );
+            }
+            {form__label_w(tr("Buffers"), QSpinBox);
+                _nblocks = w;
+                w->setRange((int) latency::MIN_NBLOCKS, (int) latency::MAX_NBLOCKS);
+                w->setValue((int) latency.nblocks);
+            }
+            {form__label_w(tr("Latency:"), QLabel);
+                _latency_ms = w;
+            }
+        }
+        {l__w(QCheckBox(tr("Adaptive (raise latency only if audio drops out)")));
+            _adaptive = w;
+            w->setChecked(latency.adaptive);
+            w->setToolTip(tr(
+                "Start with small blocks, and increase the block size "
+                "(up to the size chosen above) and buffer count "
+                "whenever audio cannot be generated in time."
+            ));
+        }
+
+        {l__w(QDialogButtonBox);
+            _ok = w->addButton(QDialogButtonBox::Ok);
+            _cancel = w->addButton(QDialogButtonBox::Cancel);
+            _apply = w->addButton(QDialogButtonBox::Apply);
+        }
+
+        update_state();
+
+        connect(
+            _smp_per_s, qOverload<int>(&QComboBox::currentIndexChanged),
+            this, &AudioSettingsDialogImpl::update_state);
+        connect(
+            _block_size, qOverload<int>(&QComboBox::currentIndexChanged),
+            this, &AudioSettingsDialogImpl::update_state);
+        connect(
+            _nblocks, qOverload<int>(&QSpinBox::valueChanged),
+            this, &AudioSettingsDialogImpl::update_state);
+        connect(
+            _adaptive, &QCheckBox::toggled,
+            this, &AudioSettingsDialogImpl::update_state);
+
+        connect(
+            _ok, &QPushButton::clicked,
+            this, [this]() {
+                _apply_latency(latency());
+                accept();
+            });
+        connect(_apply, &QPushButton::clicked, this, [this]() {
+            _apply_latency(latency());
+        });
+        connect(_cancel, &QPushButton::clicked, this, &AudioSettingsDialogImpl::reject);
+    }
+
+    LatencyOptions latency() const {
+        return LatencyOptions {
+            .smp_per_s = _smp_per_s->currentData().toUInt(),
+            .mono_smp_per_block = _block_size->currentData().toUInt(),
+            .nblocks = (uint32_t) _nblocks->value(),
+            .adaptive = _adaptive->isChecked(),
+        };
+    }
+
+    void update_state() {
+        auto const curr = latency();
+
+        // In adaptive mode, the buffer count is chosen automatically.
+        _nblocks->setEnabled(!curr.adaptive);
+
+        if (curr.adaptive) {
+            _latency_ms->setText(tr("at most %1 ms")
+                .arg(latency::latency_ms(LatencyOptions {
+                    .smp_per_s = curr.smp_per_s,
+                    .mono_smp_per_block = curr.mono_smp_per_block,
+                    .nblocks = latency::MAX_NBLOCKS,
+                }), 0, 'f', 1));
+        } else {
+            _latency_ms->setText(
+                tr("%1 ms").arg(latency::latency_ms(curr), 0, 'f', 1)
+            );
+        }
+    }
+};
+
+}  // anonymous namespace
+
+AudioSettingsDialog * AudioSettingsDialog::make(
+    LatencyOptions latency, ApplyLatency apply, QWidget * parent
+) {
+    return new AudioSettingsDialogImpl(latency, std::move(apply), parent);
+}
+
+}
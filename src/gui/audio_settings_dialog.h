@@ -0,0 +1,30 @@
+#pragma once
+
+#include "audio/latency.h"
+
+#include <verdigris/wobjectdefs.h>
+
+#include <QDialog>
+
+#include <functional>
+
+namespace gui::audio_settings_dialog {
+
+using audio::latency::LatencyOptions;
+
+/// Called when the user presses OK or Apply.
+using ApplyLatency = std::function<void(LatencyOptions)>;
+
+/// Lets the user pick the audio output's sampling rate and buffer sizes.
+class AudioSettingsDialog : public QDialog {
+    W_OBJECT(AudioSettingsDialog)
+protected:
+    using QDialog::QDialog;
+
+public:
+    static AudioSettingsDialog * make(
+        LatencyOptions latency, ApplyLatency apply, QWidget * parent
+    );
+};
+
+}
@@ -0,0 +1,139 @@
+#include "audio_stats_dialog.h"
+#include "lib/layout_macros.h"
+
+#include <verdigris/wobjectimpl.h>
+
+// widgets
+#include <QDialogButtonBox>
+#include <QPlainTextEdit>
+#include <QPushButton>
+
+// layouts
+#include <QBoxLayout>
+
+// misc
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QTimer>
+
+#include <algorithm>  // std::min
+#include <utility>  // std::move
+
+namespace gui::audio_stats_dialog {
+
+using audio::stats::StatsSnapshot;
+
+W_OBJECT_IMPL(AudioStatsDialog)
+
+namespace {
+
+/// How often to reload statistics from the audio thread.
+constexpr int REFRESH_MS = 250;
+
+class AudioStatsDialogImpl final : public AudioStatsDialog {
+    GetStats _get_stats;
+
+    /// Subtracted from the audio thread's counters when "Reset" is pressed.
+    /// Histograms can't be reset from the GUI thread,
+    /// since only the audio thread may write to them.
+    StatsSnapshot _baseline{};
+
+    QPlainTextEdit * _text;
+    QTimer _refresh_timer;
+
+public:
+    AudioStatsDialogImpl(GetStats get_stats, QWidget * parent)
+        : AudioStatsDialog(parent)
+        , _get_stats(std::move(get_stats))
+    {
+        setWindowTitle(tr("Audio Statistics"));
+        // prevent leaking dialogs.
+        setAttribute(Qt::WA_DeleteOnClose);
+        setWindowFlags(windowFlags().setFlag(Qt::WindowContextHelpButtonHint, false));
+
+        auto l = new QVBoxLayout();
+        setLayout(l);
+
+        QPushButton * reset;
+        QPushButton * close;
+
+        {l__w(QPlainTextEdit);
+            _text = w;
+            w->setReadOnly(true);
+            w->setLineWrapMode(QPlainTextEdit::NoWrap);
+            w->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+            // Fit the table without scrolling.
+            QFontMetrics metrics{w->font()};
+            w->setMinimumSize(
+                metrics.horizontalAdvance(QString(72, 'x')),
+                metrics.lineSpacing() * 30);
+        }
+        {l__w(QDialogButtonBox);
+            reset = w->addButton(tr("Reset"), QDialogButtonBox::ResetRole);
+            close = w->addButton(QDialogButtonBox::Close);
+        }
+
+        connect(reset, &QPushButton::clicked, this, [this]() {
+            _baseline = _get_stats().value_or(StatsSnapshot{});
+            reload();
+        });
+        connect(close, &QPushButton::clicked, this, &AudioStatsDialogImpl::close);
+
+        connect(&_refresh_timer, &QTimer::timeout, this, &AudioStatsDialogImpl::reload);
+        _refresh_timer.start(REFRESH_MS);
+        reload();
+    }
+
+    void reload() {
+        auto maybe_stats = _get_stats();
+        if (!maybe_stats) {
+            _text->setPlainText(tr("Audio is not running."));
+            return;
+        }
+
+        StatsSnapshot stats = subtract(*maybe_stats, _baseline);
+        _text->setPlainText(QString::fromStdString(audio::stats::format_stats(stats)));
+    }
+
+private:
+    /// If the audio thread was restarted, its counters were reset to zero,
+    /// so ignore the baseline.
+    static StatsSnapshot subtract(StatsSnapshot now, StatsSnapshot const& baseline) {
+        if (now.synth.count < baseline.synth.count) {
+            return now;
+        }
+
+        auto sub_hist = [](auto & hist, auto const& base) {
+            for (size_t i = 0; i < hist.buckets.size(); i++) {
+                hist.buckets[i] -= std::min(hist.buckets[i], base.buckets[i]);
+            }
+            hist.count -= std::min(hist.count, base.count);
+            hist.total_ns -= std::min(hist.total_ns, base.total_ns);
+            // The maximum can't be un-merged. Keep the all-time maximum.
+        };
+        sub_hist(now.callback, baseline.callback);
+        sub_hist(now.synth, baseline.synth);
+        sub_hist(now.commands, baseline.commands);
+        sub_hist(now.dsp, baseline.dsp);
+        sub_hist(now.resample, baseline.resample);
+        auto sub = [](uint64_t & count, uint64_t base) {
+            count -= std::min(count, base);
+        };
+        sub(now.driver_ticks, baseline.driver_ticks);
+        sub(now.register_writes, baseline.register_writes);
+        sub(now.dropped_writes, baseline.dropped_writes);
+        sub(now.driver_clocks, baseline.driver_clocks);
+        sub(now.underflows, baseline.underflows);
+        sub(now.overloads, baseline.overloads);
+        return now;
+    }
+};
+
+}  // anonymous namespace
+
+AudioStatsDialog * AudioStatsDialog::make(GetStats get_stats, QWidget * parent) {
+    return new AudioStatsDialogImpl(std::move(get_stats), parent);
+}
+
+}
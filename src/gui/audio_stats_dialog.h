@@ -0,0 +1,29 @@
+#pragma once
+
+#include "audio/stats.h"
+
+#include <verdigris/wobjectdefs.h>
+
+#include <QDialog>
+
+#include <functional>
+#include <optional>
+
+namespace gui::audio_stats_dialog {
+
+/// Returns a snapshot of the audio thread's timing statistics,
+/// or nullopt if audio is not running.
+using GetStats = std::function<std::optional<audio::stats::StatsSnapshot>()>;
+
+/// Non-modal window showing how long the audio callback takes,
+/// and how often it misses its deadline. Refreshes periodically.
+class AudioStatsDialog : public QDialog {
+    W_OBJECT(AudioStatsDialog)
+protected:
+    using QDialog::QDialog;
+
+public:
+    static AudioStatsDialog * make(GetStats get_stats, QWidget * parent);
+};
+
+}
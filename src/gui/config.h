@@ -4,6 +4,7 @@
 #include "gui/config/cursor_config.h"
 #include "gui/lib/color.h"
 #include "doc/accidental_common.h"
+#include "audio/latency.h"
 
 #include <qkeycode/qkeycode.h>
 
@@ -288,6 +289,13 @@ struct Options {
     };
 
     AccidentalMode default_accidental_mode = AccidentalMode::Sharp;
+
+    /// Audio output sampling rate and buffering.
+    audio::latency::LatencyOptions latency{};
+
+    /// Once undo history holds more than this many bytes,
+    /// the oldest undo steps are discarded.
+    size_t history_memory_limit = 256 << 20;
 };
 
 // Persistent application fields are stored directly in GuiApp.
@@ -1,13 +1,52 @@
 #include "history.h"
 
+#include <cassert>
 #include <utility>  // std::move, std::exchange
 
 namespace gui::history {
 
-History::History(doc::Document initial_state)
+History::History(doc::Document initial_state, size_t memory_limit)
     : _document(std::move(initial_state))
+    , _memory_limit(memory_limit)
 {}
 
+/// Removes the oldest frames from `stack` while `over_limit()` holds,
+/// keeping at least the newest frame. Returns the number of bytes freed.
+template<typename OverLimit>
+static size_t evict_front(std::vector<UndoFrame> & stack, OverLimit over_limit) {
+    size_t freed = 0;
+    size_t nevict = 0;
+    while (nevict + 1 < stack.size() && over_limit(freed)) {
+        freed += stack[nevict].edit->heap_size();
+        nevict++;
+    }
+    stack.erase(stack.begin(), stack.begin() + (ptrdiff_t) nevict);
+    return freed;
+}
+
+void History::evict_old_frames() {
+    auto over_limit = [this](size_t freed) {
+        return memory_usage() - freed > _memory_limit;
+    };
+
+    // heap_size() only changes when a command is applied, so
+    // subtracting a stored command's current size keeps the totals exact.
+    // Commands in history are never sent to the audio thread, so we can free them.
+    size_t freed = evict_front(_undo_stack, over_limit);
+    assert(freed <= _undo_bytes);
+    _undo_bytes -= freed;
+
+    // The bottom of the redo stack is furthest from the current document.
+    freed = evict_front(_redo_stack, over_limit);
+    assert(freed <= _redo_bytes);
+    _redo_bytes -= freed;
+}
+
+void History::set_memory_limit(size_t memory_limit) {
+    _memory_limit = memory_limit;
+    evict_old_frames();
+}
+
 void History::push(UndoFrame command) {
     // Preconditions: `_document` holds the initial state, and `command` holds the new
     // state.
@@ -27,6 +66,7 @@ void History::push(UndoFrame command) {
         // redo stack based on whether the next older undo command is a tempo change or
         // not.
         _redo_stack.clear();
+        _redo_bytes = 0;
 
         bool command_merged = false;
         if (_undo_stack.size()) {
@@ -52,8 +92,10 @@ void History::push(UndoFrame command) {
         // If we want to preserve the initial state as an undo step, push the `command`
         // we applied onto the undo stack.
         if (!command_merged) {
+            _undo_bytes += command.edit->heap_size();
             _undo_stack.push_back(std::move(command));
         }
+        evict_old_frames();
     }
 }
 
@@ -77,6 +119,7 @@ MaybeCursorEdit History::try_undo() {
     // Pop undo command.
     UndoFrame command = std::move(_undo_stack.back());
     _undo_stack.pop_back();
+    _undo_bytes -= command.edit->heap_size();
 
     // Clone undo command for audio thread.
     auto cursor_edit = CursorEdit {
@@ -89,7 +132,9 @@ MaybeCursorEdit History::try_undo() {
     _dirty = true;
 
     // Push to redo.
+    _redo_bytes += command.edit->heap_size();
     _redo_stack.push_back(std::move(command));
+    evict_old_frames();
 
     return cursor_edit;
 }
@@ -102,6 +147,7 @@ MaybeCursorEdit History::try_redo() {
     // Pop redo command.
     UndoFrame command = std::move(_redo_stack.back());
     _redo_stack.pop_back();
+    _redo_bytes -= command.edit->heap_size();
 
     // Clone redo command for audio thread.
     auto cursor_edit = CursorEdit {
@@ -114,7 +160,9 @@ MaybeCursorEdit History::try_redo() {
     _dirty = true;
 
     // Push to undo.
+    _undo_bytes += command.edit->heap_size();
     _undo_stack.push_back(std::move(command));
+    evict_old_frames();
 
     return cursor_edit;
 }
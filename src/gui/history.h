@@ -5,6 +5,8 @@
 #include "gui/cursor.h"
 #include "util/copy_move.h"
 
+#include <cstddef>  // size_t
+#include <limits>
 #include <optional>
 #include <vector>
 
@@ -28,20 +30,34 @@ struct UndoFrame {
     MaybeCursor after_cursor;
 };
 
+/// Used by History if no memory limit is passed in.
+constexpr size_t UNLIMITED_MEMORY = std::numeric_limits<size_t>::max();
+
 /// Class is not thread-safe, and is only called from GUI thread.
 ///
 /// All mutations occurring in History must be sent over to the audio thread
 /// to keep it in sync.
+///
+/// Undo history holds copies of replaced patterns and samples,
+/// so long sessions can use a lot of memory. Once the commands in both
+/// stacks exceed the memory limit, History discards the oldest undo steps
+/// (and then the redo steps furthest from the current state),
+/// but always keeps the newest undo and redo step.
 class History {
 private:
     doc::Document _document;
     std::vector<UndoFrame> _undo_stack;
     std::vector<UndoFrame> _redo_stack;
 
+    /// Sum of BaseEditCommand::heap_size() over each stack.
+    size_t _undo_bytes = 0;
+    size_t _redo_bytes = 0;
+    size_t _memory_limit;
+
     bool _dirty = false;
 
 public:
-    History(doc::Document initial_state);
+    History(doc::Document initial_state, size_t memory_limit = UNLIMITED_MEMORY);
     DISABLE_COPY(History)
     DEFAULT_MOVE(History)
 
@@ -69,6 +85,16 @@ public:
     /// Returns whether the redo stack is non-empty.
     bool can_redo() const;
 
+    /// Returns the number of bytes held by commands in the undo and redo stacks.
+    size_t memory_usage() const {
+        return _undo_bytes + _redo_bytes;
+    }
+    size_t memory_limit() const {
+        return _memory_limit;
+    }
+    /// Discards old undo steps until memory_usage() fits within `memory_limit`.
+    void set_memory_limit(size_t memory_limit);
+
     /*
     Currently we use an unbounded linked-list queue from main to audio thread.
     But if we switch to a bounded queue (ring buffer), the audio thread may reject
@@ -86,6 +112,9 @@ public:
     /// and returns a clone of the command (which gets sent to the audio thread)
     /// and the new GUI cursor location (or nullopt).
     MaybeCursorEdit try_redo();
+
+private:
+    void evict_old_frames();
 };
 
 /// Cannot be used at static initialization time, before main() begins.
@@ -7,6 +7,8 @@
 #include "gui/instrument_dialog.h"
 #include "gui/instrument_list.h"
 #include "gui/sample_dialog.h"
+#include "gui/audio_settings_dialog.h"
+#include "gui/audio_stats_dialog.h"
 #include "gui/tempo_dialog.h"
 #include "gui/lib/icon_toolbar.h"
 // Other
@@ -42,6 +44,7 @@
 #include <QMenuBar>
 #include <QPushButton>
 #include <QSpinBox>
+#include <QStatusBar>
 #include <QToolButton>
 // Layouts
 #include <QBoxLayout>
@@ -56,6 +59,7 @@
 #include <QFlags>
 #include <QGuiApplication>
 #include <QIcon>
+#include <QLocale>
 #include <QMessageBox>
 #include <QPointer>
 #include <QScreen>
@@ -269,7 +273,7 @@ W_OBJECT_IMPL(MainWindow)
 
 MainWindow::MainWindow(doc::Document document, QWidget *parent)
     : QMainWindow(parent)
-    , _state(std::move(document))
+    , _state(std::move(document), get_app().options().history_memory_limit)
 {}
 
 namespace {
@@ -312,7 +316,7 @@ public:
 // # MainWindow components
 
 using cmd_queue::CommandQueue;
-using cmd_queue::AudioCommand;
+using cmd_queue::CommandReceiver;
 
 struct MainWindowUi : MainWindow {
     using MainWindow::MainWindow;
@@ -346,6 +350,9 @@ struct MainWindowUi : MainWindow {
     QAction * _zoom_out;
     QAction * _zoom_in;
 
+    QAction * _audio_settings;
+    QAction * _show_audio_stats;
+
     // Instrument menu
     QAction * _show_sample_dialog;
 
@@ -361,6 +368,9 @@ struct MainWindowUi : MainWindow {
 
     PatternEditor * _pattern_editor;
 
+    /// Shows how much memory undo history uses.
+    QLabel * _history_memory;
+
     // Control panel
     // Per-song ephemeral state
 
@@ -442,6 +452,9 @@ struct MainWindowUi : MainWindow {
                 _zoom_out = m->addAction(tr("Zoom &Out"));
                 _zoom_in_triplet = m->addAction(tr("Zoom In (Triplet)"));
                 _zoom_out_triplet = m->addAction(tr("Zoom Out (Triplet)"));
+                m->addSeparator();
+                _audio_settings = m->addAction(tr("Audio &Settings..."));
+                _show_audio_stats = m->addAction(tr("&Audio Statistics"));
             }
 
             {m__m(tr("&Instrument"));
@@ -479,6 +492,10 @@ struct MainWindowUi : MainWindow {
             // Main body is the pattern editor.
             pattern_editor_panel(l);
         }
+
+        // Status bar
+        _history_memory = new QLabel;
+        main->statusBar()->addPermanentWidget(_history_memory);
     }
 
     static constexpr int MAX_TICKS_PER_ROW = 48;
@@ -633,15 +650,24 @@ struct MainWindowUi : MainWindow {
 
 using timing::MaybeSequencerTime;
 using timing::SequencerTime;
+using audio::latency::AdaptiveLatency;
+using audio::latency::LatencyOptions;
 
 class AudioComponent {
     // GUI/audio communication.
     AudioState _audio_state = AudioState::Stopped;
     CommandQueue _command_queue{};
 
+    /// Set if an edit could not be sent to the audio thread
+    /// (because the command queue was full).
+    /// The audio thread's document no longer matches the GUI's,
+    /// so the audio thread must be restarted with a fresh copy.
+    bool _audio_desynced = false;
+
     // Audio.
     RtAudio _rt{};
     unsigned int _curr_audio_device{};
+    AdaptiveLatency _latency{LatencyOptions{}};
 
     // Points to History and CommandQueue, must be listed after them.
     std::optional<AudioThreadHandle> _audio_handle;
@@ -654,36 +680,33 @@ public:
         return _audio_state;
     }
 
+    bool audio_desynced() const {
+        return _audio_desynced;
+    }
+
+    /// Returns nullopt if the audio thread is not running.
+    std::optional<audio::stats::StatsSnapshot> audio_stats() const {
+        if (_audio_handle.has_value()) {
+            return _audio_handle->stats();
+        }
+        return {};
+    }
+
 // # Command queue.
 private:
-    /// Return a command to be sent to the audio thread.
-    /// It ignores the command's contents,
-    /// but monitors its "next" pointer for new commands.
-    AudioCommand * stub_command() {
-        return _command_queue.begin();
+    /// Return the audio thread's end of the command queue.
+    CommandReceiver command_receiver() const {
+        return _command_queue.receiver();
     }
 
     void gc_command_queue() {
-        // Every time GUI pushes an event, it moves _command_queue.end().
-        // Once the audio thread is done processing events,
-        // the GUI thread's next call to gc_command_queue()
-        // will advance _command_queue.begin().
-        // To run code once after the audio thread catches up on events,
-        // check if we drain 1+ event, then end with an empty queue.
-
-        auto & audio_handle = _audio_handle.value();
-
-        if (_command_queue.begin() != _command_queue.end()) {
-            auto x = audio_handle.seen_command();
-            while (_command_queue.begin() != x) {
-                _command_queue.pop();
-            }
-            if (_command_queue.begin() == _command_queue.end()) {
-                // once GUI sees audio caught up on commands, it must see audio's new time.
-                if (_audio_state == AudioState::Starting) {
-                    _audio_state = AudioState::PlayHasStarted;
-                }
-            }
+        // The audio thread hands back every EditBox it's done with,
+        // so they can be freed here instead of on the audio thread.
+        _command_queue.collect_garbage();
+
+        // Once GUI sees audio caught up on commands, it must see audio's new time.
+        if (_audio_state == AudioState::Starting && _command_queue.is_caught_up()) {
+            _audio_state = AudioState::PlayHasStarted;
         }
     }
 
@@ -731,7 +754,7 @@ private:
 
 public:
     /// Output: _audio_handle.
-    void setup_audio(StateComponent const& state) {
+    void setup_audio(StateComponent const& state, LatencyOptions latency) {
         // TODO should this be handled by the constructor?
         // Initializes _curr_audio_device.
         scan_devices();
@@ -739,9 +762,36 @@ public:
         release_assert(_command_queue.is_empty());
 
         // Begin playing audio. Destroying this variable makes audio stop.
+        _latency = AdaptiveLatency{latency};
         _audio_handle = AudioThreadHandle::make(
-            _rt, _curr_audio_device, state.document().clone(), stub_command()
-        );
+            _rt,
+            _curr_audio_device,
+            _latency.current(),
+            state.document().clone(),
+            command_receiver());
+    }
+
+    /// Reopens the audio output with new settings, stopping playback.
+    void set_latency(StateComponent const& state, LatencyOptions latency) {
+        _latency = AdaptiveLatency{latency};
+        restart_audio_thread(state);
+    }
+
+    /// Called periodically. In adaptive mode, if the audio thread missed deadlines,
+    /// reopens the audio output with more buffering.
+    void adapt_latency(StateComponent const& state) {
+        // Restarting audio stops playback, so wait until the user stops playing.
+        // The counters keep accumulating until then.
+        if (!_audio_handle.has_value() || _audio_state != AudioState::Stopped) {
+            return;
+        }
+        auto const stats = _audio_handle->stats();
+        if (auto latency = _latency.update(stats.overloads, stats.underflows)) {
+            fmt::print(stderr,
+                "Audio missed deadlines, raising latency to {} smp/block, {} buffers\n",
+                latency->mono_smp_per_block, latency->nblocks);
+            restart_audio_thread(state);
+        }
     }
 
     void restart_audio_thread(StateComponent const& state) {
@@ -752,10 +802,15 @@ public:
 
         _audio_state = AudioState::Stopped;
         _command_queue.clear();
+        _audio_desynced = false;
 
         _audio_handle = AudioThreadHandle::make(
-            _rt, _curr_audio_device, state.document().clone(), stub_command()
-        );
+            _rt,
+            _curr_audio_device,
+            _latency.current(),
+            state.document().clone(),
+            command_receiver());
+        _latency.on_restart();
     }
 
 // # Play/pause commands.
@@ -807,7 +862,10 @@ public:
 private:
     void play_from(StateTransaction & tx, std::optional<TickT> time) {
         auto start_time = time.value_or(tx.state().cursor().y);
-        _command_queue.push(cmd_queue::PlayFrom{start_time});
+        if (!_command_queue.try_push(cmd_queue::PlayFrom{start_time})) {
+            // The audio thread is not responding. Don't wait for it to start.
+            return;
+        }
         _audio_state = AudioState::Starting;
 
         if (time) {
@@ -817,16 +875,25 @@ private:
     }
 
     void stop_play() {
-        _command_queue.push(cmd_queue::StopPlayback{});
+        if (!_command_queue.try_push(cmd_queue::StopPlayback{})) {
+            // Restarting the audio thread stops playback.
+            _audio_desynced = true;
+        }
         _audio_state = AudioState::Stopped;
     }
 
 // # Document edit commands.
 private:
     void send_edit(AudioComponent & audio, edit::EditBox command) {
-        if (audio._audio_handle.has_value()) {
+        if (audio._audio_handle.has_value() && !_audio_desynced) {
             gc_command_queue();
-            _command_queue.push(std::move(command));
+            if (!_command_queue.try_push(std::move(command))) {
+                // Don't block the GUI waiting for the audio thread.
+                // Apply the edit to the GUI's document anyway,
+                // and reload the audio thread's document afterwards.
+                fmt::print(stderr, "Audio command queue full, restarting audio\n");
+                _audio_desynced = true;
+            }
         }
     }
 
@@ -894,6 +961,8 @@ public:
 using tempo_dialog::TempoDialog;
 using instrument_dialog::InstrumentDialog;
 using sample_dialog::SampleDialog;
+using audio_settings_dialog::AudioSettingsDialog;
+using audio_stats_dialog::AudioStatsDialog;
 
 struct RowHeight {
     TickT ticks_per_row;
@@ -917,6 +986,7 @@ public:
     QErrorMessage _error_dialog{this};
     QPointer<InstrumentDialog> _maybe_instr_dialog;
     QPointer<SampleDialog> _maybe_sample_dialog;
+    QPointer<AudioStatsDialog> _maybe_audio_stats_dialog;
 
     std::vector<RowHeight> _row_heights;
 
@@ -978,11 +1048,18 @@ public:
         _pattern_editor->set_history(_state.document_getter());
         _timeline_editor->set_history(_state.document_getter());
         _instrument_list->reload_state();
+        reload_history_memory();
 
         // Hook up refresh timer.
         connect(
             &_gui_refresh_timer, &QTimer::timeout,
             this, [this] () {
+                if (_audio.audio_desynced()) {
+                    _audio.restart_audio_thread(_state);
+                } else {
+                    _audio.adapt_latency(_state);
+                }
+
                 MaybeSequencerTime maybe_seq_time = _audio.maybe_seq_time();
                 if (!maybe_seq_time) return;
                 SequencerTime const seq_time = *maybe_seq_time;
@@ -1011,7 +1088,7 @@ public:
         // TODO setup_screen() when primaryScreen changed
         // TODO setup_timer() when refreshRate changed
 
-        _audio.setup_audio(_state);
+        _audio.setup_audio(_state, get_app().options().latency);
 
         // Last thing.
         on_startup(get_app().options());
@@ -1099,6 +1176,13 @@ public:
         _exit->setShortcuts(QKeySequence::Quit);
         connect(_exit, &QAction::triggered, this, &QWidget::close);
 
+        connect(
+            _audio_settings, &QAction::triggered,
+            this, &MainWindowImpl::show_audio_settings_dialog);
+        connect(
+            _show_audio_stats, &QAction::triggered,
+            this, &MainWindowImpl::show_audio_stats_dialog);
+
         connect(
             _show_sample_dialog, &QAction::triggered,
             this, [this]() {
@@ -1264,6 +1348,28 @@ public:
         return _maybe_sample_dialog;
     }
 
+    void show_audio_settings_dialog() {
+        auto apply = [this](LatencyOptions latency) {
+            auto options = get_app().options();
+            options.latency = latency;
+            get_app().set_options(options);
+
+            _audio.set_latency(_state, latency);
+        };
+        AudioSettingsDialog::make(get_app().options().latency, apply, this)->exec();
+    }
+
+    void show_audio_stats_dialog() {
+        if (!_maybe_audio_stats_dialog) {
+            _maybe_audio_stats_dialog = AudioStatsDialog::make(
+                [this]() { return _audio.audio_stats(); }, this
+            );
+            _maybe_audio_stats_dialog->show();
+        } else {
+            focus_dialog(_maybe_audio_stats_dialog);
+        }
+    }
+
     void reload_title() {
         auto calc_title = [this]() -> QString {
             if (!_file_path.isEmpty()) {
@@ -1299,6 +1405,12 @@ public:
         // Additionally it uses hyphens on Windows but en dashes on Linux.
     }
 
+    void reload_history_memory() {
+        _history_memory->setText(tr("Undo history: %1").arg(
+            QLocale().formattedDataSize((qint64) _state.history().memory_usage())
+        ));
+    }
+
     /// Called when closing the document (new/open).
     /// If the document has unsaved changes, asks the user to save, discard, or cancel.
     /// Returns false if the user cancels closing or saving the document.
@@ -1540,14 +1652,27 @@ private:
         // Write SPC file.
         auto result = spc_export::export_spc(get_document(), path.toUtf8());
 
-        if (result.ok) {
-            // Once we add metadata (eg. ARAM usage breakdown), we'll have to display it
-            // upon non-error export.
-        } else {
+        if (!result.ok) {
             // Document failed to load. There should be an error message explaining why.
             assert(!result.errors.empty());
         }
 
+        // Show how much ARAM is left for samples (or how far over the limit we are).
+        QString usage;
+        if (result.aram_usage) {
+            usage = QString::fromStdString(
+                aram_layout::format_usage(*result.aram_usage));
+        }
+
+        if (result.ok && result.errors.empty()) {
+            QString message = tr("SPC file exported.");
+            if (!usage.isEmpty()) {
+                message += QStringLiteral("<p>%1</p><pre>%2</pre>")
+                    .arg(tr("ARAM usage:"), usage.toHtmlEscaped());
+            }
+            QMessageBox::information(this, tr("Export SPC"), message);
+        }
+
         // Show warnings or errors.
         if (!result.ok || !result.errors.empty()) {
             QTextDocument document;
@@ -1578,6 +1703,18 @@ private:
                 cursor.insertText(line);
             }
 
+            if (!usage.isEmpty()) {
+                cursor.insertBlock(non_list_format);
+                cursor.insertText(tr("ARAM usage:"));
+
+                QTextCharFormat mono;
+                mono.setFontFamily(QStringLiteral("monospace"));
+                for (QString const& row : usage.split('\n', Qt::SkipEmptyParts)) {
+                    cursor.insertBlock(non_list_format);
+                    cursor.insertText(row, mono);
+                }
+            }
+
             _error_dialog.close();
             _error_dialog.showMessage(document.toHtml());
         }
@@ -1849,6 +1986,10 @@ StateTransaction::~StateTransaction() noexcept(false) {
     _win->_undo->setEnabled(history.can_undo());
     _win->_redo->setEnabled(history.can_redo());
 
+    if (e & E::DocumentEdited) {
+        _win->reload_history_memory();
+    }
+
     doc::Document const& doc = state.document();
 
     if (e & E::DocumentEdited) {
@@ -1902,7 +2043,8 @@ void StateTransaction::instrument_deleted() {
 }
 
 void StateTransaction::set_document(doc::Document document) {
-    state_mut()._history = History(std::move(document));
+    state_mut()._history =
+        History(std::move(document), get_app().options().history_memory_limit);
     _queued_updates |= E::DocumentReplaced | E::DocumentEdited;
 }
 
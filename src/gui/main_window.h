@@ -197,8 +197,8 @@ public:
 
 // impl
 public:
-    StateComponent(doc::Document document)
-        : _history(std::move(document))
+    StateComponent(doc::Document document, size_t history_memory_limit)
+        : _history(std::move(document), history_memory_limit)
     {}
 
     History const& history() const {
@@ -372,9 +372,7 @@ TickT block_end(
     }
     */
 
-    using doc_util::track_util::song_length;
-
-    return song_length(document.sequence);
+    return document.extent.song_length;
 }
 
 TickT prev_block(
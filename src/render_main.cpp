@@ -0,0 +1,279 @@
+// Headless renderer: plays a module from the beginning and writes it to a WAV file.
+// Also useful for measuring synth performance without an audio device or GUI.
+
+#include "audio/render.h"
+#include "audio/wav_writer.h"
+#include "serialize.h"
+
+#include <fmt/core.h>
+#include <samplerate.h>
+
+#include <algorithm>  // std::min, std::max
+#include <cmath>  // std::abs, std::log10
+#include <cstdlib>  // strtoul, strtod
+#include <cstring>  // strcmp
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+using namespace audio::render;
+using audio::wav_writer::WavWriter;
+
+static constexpr char const* USAGE =
+R"(Usage: exotracker-render [options] INPUT.etm OUTPUT.wav
+
+Plays INPUT.etm from the beginning until the song loops,
+and writes the audio to OUTPUT.wav (32-bit float, stereo).
+
+Options:
+  --rate HZ           Output sampling rate (default 48000).
+  --loops N           Stop after the song loops N times (default 1).
+  --max-seconds S     Stop after S seconds of audio (default 1200).
+  --quality Q         Resampler quality: low, medium (default), or high
+                      (built-in polyphase resampler); src-medium, src-fastest,
+                      or zoh (libsamplerate).
+  --dsp CORE          S-DSP emulator: simd (default, emulates each sample)
+                      or accurate (emulates each clock, with identical output).
+  --chip-threads N    Synthesize chips on N threads (default 1, 0 = one per core),
+                      for documents with multiple chips.
+  --jobs N            Split the song into segments rendered by N threads (default 1).
+  --preroll S         Seconds rendered before each segment begins (default 2).
+  --crossfade N       Frames of crossfade between segments (default 64).
+  --compare-serial    Also render the song on one thread, and report how much
+                      the --jobs output differs from it.
+  --stats             Print histograms of how long the synth spent
+                      in each stage (commands, DSP, resampling).
+)";
+
+[[noreturn]] static void bail(std::string const& error) {
+    fmt::print(stderr, "{}\n\n{}", error, USAGE);
+    exit(1);
+}
+
+/// Returns false if `name` is not a valid quality.
+static bool parse_quality(char const* name, audio::AudioOptions & /*mut*/ options) {
+    using audio::PolyphaseQuality;
+    using audio::ResamplerKind;
+
+    auto polyphase = [&](PolyphaseQuality quality) {
+        options.resampler = ResamplerKind::Polyphase;
+        options.polyphase_quality = quality;
+        return true;
+    };
+    auto libsamplerate = [&](int quality) {
+        options.resampler = ResamplerKind::Libsamplerate;
+        options.resampler_quality = quality;
+        return true;
+    };
+
+    if (!strcmp(name, "low")) return polyphase(PolyphaseQuality::Low);
+    if (!strcmp(name, "medium")) return polyphase(PolyphaseQuality::Medium);
+    if (!strcmp(name, "high")) return polyphase(PolyphaseQuality::High);
+    if (!strcmp(name, "src-medium")) return libsamplerate(SRC_SINC_MEDIUM_QUALITY);
+    if (!strcmp(name, "src-fastest")) return libsamplerate(SRC_SINC_FASTEST);
+    if (!strcmp(name, "zoh")) return libsamplerate(SRC_ZERO_ORDER_HOLD);
+    return false;
+}
+
+static unsigned long parse_uint(char const* flag, char const* value) {
+    char * end;
+    unsigned long out = strtoul(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || out == 0) {
+        bail(fmt::format("Invalid {} \"{}\", expected a positive integer", flag, value));
+    }
+    return out;
+}
+
+static double parse_seconds(char const* flag, char const* value) {
+    char * end;
+    double out = strtod(value, &end);
+    if (*value == '\0' || *end != '\0' || !(out > 0)) {
+        bail(fmt::format("Invalid {} \"{}\", expected a positive number", flag, value));
+    }
+    return out;
+}
+
+/// Measures how far a segment-parallel render deviates from a serial render.
+static void print_comparison(
+    std::vector<float> const& serial, std::vector<float> const& parallel
+) {
+    if (serial.size() != parallel.size()) {
+        fmt::print("Parallel render has {} samples, serial render has {}\n",
+            parallel.size(), serial.size());
+    }
+
+    size_t const n = std::min(serial.size(), parallel.size());
+    size_t ndiffer = 0;
+    std::optional<size_t> first_diff;
+    float max_diff = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        float diff = std::abs(serial[i] - parallel[i]);
+        if (diff != 0) {
+            ndiffer++;
+            if (!first_diff) {
+                first_diff = i;
+            }
+            max_diff = std::max(max_diff, diff);
+        }
+    }
+
+    if (!first_diff) {
+        fmt::print("Parallel render is bit-exact with serial render\n");
+        return;
+    }
+    fmt::print(
+        "Parallel render differs from serial in {} of {} samples "
+        "(first at frame {}), max difference {:.3g} ({:.1f} dBFS)\n",
+        ndiffer, n, *first_diff / 2, max_diff, 20 * std::log10(max_diff));
+}
+
+int main(int argc, char ** argv) {
+    RenderOptions options;
+    ParallelOptions parallel;
+    bool compare_serial = false;
+    bool print_stats = false;
+    char const* in_path = nullptr;
+    char const* out_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            fmt::print("{}", USAGE);
+            return 0;
+        }
+
+        if (arg == "--compare-serial") {
+            compare_serial = true;
+            continue;
+        }
+
+        if (arg == "--stats") {
+            print_stats = true;
+            continue;
+        }
+
+        if (arg.starts_with("--")) {
+            if (i + 1 >= argc) {
+                bail(fmt::format("Missing value for {}", arg));
+            }
+            char const* value = argv[++i];
+
+            if (arg == "--rate") {
+                options.smp_per_s = (uint32_t) parse_uint(argv[i - 1], value);
+            } else if (arg == "--loops") {
+                options.loop_count = (uint32_t) parse_uint(argv[i - 1], value);
+            } else if (arg == "--max-seconds") {
+                options.max_seconds = parse_seconds(argv[i - 1], value);
+            } else if (arg == "--jobs") {
+                parallel.nthreads = (uint32_t) parse_uint(argv[i - 1], value);
+            } else if (arg == "--chip-threads") {
+                // 0 is valid, so we can't use parse_uint().
+                char * end;
+                options.audio_options.chip_threads = (uint32_t) strtoul(value, &end, 10);
+                if (*value == '\0' || *end != '\0') {
+                    bail(fmt::format("Invalid --chip-threads \"{}\"", value));
+                }
+            } else if (arg == "--preroll") {
+                parallel.preroll_seconds = parse_seconds(argv[i - 1], value);
+            } else if (arg == "--crossfade") {
+                char * end;
+                parallel.crossfade_frames = (uint32_t) strtoul(value, &end, 10);
+                if (*value == '\0' || *end != '\0') {
+                    bail(fmt::format("Invalid --crossfade \"{}\"", value));
+                }
+            } else if (arg == "--dsp") {
+                using audio::DspCore;
+                if (!strcmp(value, "accurate")) {
+                    options.audio_options.dsp_core = DspCore::ClockAccurate;
+                } else if (!strcmp(value, "simd")) {
+                    options.audio_options.dsp_core = DspCore::SoaSimd;
+                } else {
+                    bail(fmt::format("Invalid --dsp \"{}\"", value));
+                }
+            } else if (arg == "--quality") {
+                if (!parse_quality(value, options.audio_options)) {
+                    bail(fmt::format("Invalid --quality \"{}\"", value));
+                }
+            } else {
+                bail(fmt::format("Unrecognized option {}", arg));
+            }
+        } else if (!in_path) {
+            in_path = argv[i];
+        } else if (!out_path) {
+            out_path = argv[i];
+        } else {
+            bail("Too many command-line arguments");
+        }
+    }
+
+    if (!in_path || !out_path) {
+        bail("Missing INPUT.etm or OUTPUT.wav");
+    }
+
+    serialize::LoadDocumentResult result = serialize::load_from_path(in_path);
+    for (auto const& err : result.errors) {
+        fmt::print(stderr, "{}: {}\n",
+            (err.type == serialize::ErrorType::Error) ? "Error" : "Warning",
+            err.description);
+    }
+    if (!result.v) {
+        fmt::print(stderr, "Failed to load \"{}\"\n", in_path);
+        return 1;
+    }
+    auto const& [document, metadata] = *result.v;
+
+    auto maybe_writer = WavWriter::create(out_path, 2, options.smp_per_s);
+    if (auto err = std::get_if<std::string>(&maybe_writer)) {
+        fmt::print(stderr, "Failed to write \"{}\": {}\n", out_path, *err);
+        return 1;
+    }
+    auto & writer = std::get<WavWriter>(maybe_writer);
+
+    std::optional<std::string> write_error;
+    std::vector<float> output;
+    RenderStats stats = render_song_parallel(document, options, parallel, [&](auto block) {
+        if (compare_serial) {
+            output.insert(output.end(), block.begin(), block.end());
+        }
+        write_error = writer.write(block);
+        return !write_error;
+    });
+    if (!write_error) {
+        write_error = writer.finish();
+    }
+    if (write_error) {
+        fmt::print(stderr, "Failed to write \"{}\": {}\n", out_path, *write_error);
+        return 1;
+    }
+
+    if (!stats.song_ended) {
+        fmt::print(stderr, "Warning: song did not loop within {} seconds\n",
+            options.max_seconds);
+    }
+    fmt::print(
+        "Rendered {:.2f} s of audio in {:.3f} s ({:.1f}x realtime)\n",
+        stats.audio_seconds(), stats.synth_seconds, stats.realtime_multiple());
+
+    if (print_stats) {
+        fmt::print("\n{}\n", audio::stats::format_stats(stats.audio_stats));
+    }
+
+    if (compare_serial) {
+        std::vector<float> serial_output;
+        RenderStats serial = render_song(document, options, [&](auto block) {
+            serial_output.insert(serial_output.end(), block.begin(), block.end());
+            return true;
+        });
+        fmt::print(
+            "Serial render took {:.3f} s ({:.1f}x realtime), parallel speedup {:.2f}x\n",
+            serial.synth_seconds,
+            serial.realtime_multiple(),
+            serial.synth_seconds / stats.synth_seconds);
+        print_comparison(serial_output, output);
+    }
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "doc/validate.h"
 #include "serialize.h"
+#include "doc_util/pattern_table.h"
 #include "serialize/document.capnp.h"
 #include "chip_kinds.h"
 #include "util/copy_move.h"
@@ -26,6 +27,9 @@ namespace serialize {
 namespace gen = generated;
 using namespace doc;
 using chip_common::MAX_NCHIP;
+using doc_util::pattern_table::PatternID;
+using doc_util::pattern_table::PatternTable;
+using doc_util::pattern_table::build_pattern_table;
 
 /// Cap'n Proto uses 8-byte (64-bit) words.
 static constexpr size_t BYTES_PER_WORD = 8;
@@ -125,7 +129,7 @@ void serialize_sample(
     if (sample) {
         auto gen_sample = gen_maybe_sample.initSome();
         gen_sample.setName(sample->name);
-        gen_sample.setBrr(array_ptr(sample->brr));
+        gen_sample.setBrr(array_ptr(sample->brr.span()));
         gen_sample.setLoopByte(sample->loop_byte);
         {
             SampleTuning const& tuning = sample->tuning;
@@ -220,24 +224,29 @@ void serialize_pattern(Pattern const& pattern, gen::Pattern::Builder gen_pattern
 }
 
 void serialize_track_block(
-    TrackBlock const& block, gen::TrackBlock::Builder gen_block
+    TrackBlock const& block, PatternID pattern_id, gen::TrackBlock::Builder gen_block
 ) {
     gen_block.setBeginTick(block.begin_tick);
     gen_block.setLoopCount(block.loop_count);
-    serialize_pattern(block.pattern, gen_block.initPattern());
+    gen_block.setPatternId(pattern_id);
 }
 
+/// `block_ids` holds the PatternID of each block in `track`.
 void serialize_track(
-    SequenceTrack const& track, gen::SequenceTrack::Builder gen_track
-) {
+    SequenceTrack const& track,
+    gsl::span<PatternID const> block_ids,
+    gen::SequenceTrack::Builder gen_track)
+{
     gsl::span<TrackBlock const> blocks = track.blocks;
     release_assert(blocks.size() <= MAX_BLOCKS_PER_TRACK);
+    release_assert_equal(blocks.size(), block_ids.size());
     auto num_blocks = (uint) blocks.size();
 
     // SequenceTrack::blocks @0 :List(TrackBlock)
-    serialize_all(
-        blocks, gen_track.initBlocks(num_blocks), serialize_track_block
-    );
+    auto gen_blocks = gen_track.initBlocks(num_blocks);
+    for (uint i = 0; i < num_blocks; i++) {
+        serialize_track_block(blocks[i], block_ids[i], MUT gen_blocks[i]);
+    }
 
     // SequenceTrack::nEffectCol @1 :UInt8
     {
@@ -289,7 +298,7 @@ void init_serialize_chips(ChipList const& chips, gen::Document::Builder gen_doc)
 }
 
 void init_serialize_sequence(
-    Sequence const& sequence, gen::Document::Builder gen_doc
+    Sequence const& sequence, PatternTable const& table, gen::Document::Builder gen_doc
 ) {
     auto num_chips = (uint) sequence.size();
     auto gen_sequence = gen_doc.initSequence(num_chips);
@@ -305,11 +314,19 @@ void init_serialize_sequence(
             SequenceTrack const& track = channel_tracks[chan];
             auto gen_track = gen_channel_tracks[chan];
 
-            serialize_track(track, MUT gen_track);
+            serialize_track(track, table.block_ids[chip][chan], MUT gen_track);
         }
     }
 }
 
+void init_serialize_patterns(PatternTable const& table, gen::Document::Builder gen_doc) {
+    auto num_patterns = (uint) table.patterns.size();
+    auto gen_patterns = gen_doc.initPatterns(num_patterns);
+    for (uint i = 0; i < num_patterns; i++) {
+        serialize_pattern(*table.patterns[i], MUT gen_patterns[i]);
+    }
+}
+
 using ::capnp::MallocMessageBuilder;
 
 /// Function called on a serialized document.
@@ -374,8 +391,14 @@ void serialize_impl(
     // @8 Document::chips
     init_serialize_chips(doc.chips, MUT gen_doc);
 
+    // Blocks sharing a pattern (or holding identical patterns) save it once.
+    PatternTable const table = build_pattern_table(doc.sequence);
+
     // @9 Document::sequence
-    init_serialize_sequence(doc.sequence, MUT gen_doc);
+    init_serialize_sequence(doc.sequence, table, MUT gen_doc);
+
+    // @10 Document::patterns
+    init_serialize_patterns(table, MUT gen_doc);
 
     return callback(builder);
 }
@@ -881,17 +904,35 @@ optional<Pattern> load_pattern(ErrorState & state, gen::Pattern::Reader gen_patt
     });
 }
 
+using PatternsRef = gsl::span<SharedPattern const>;
+
 optional<TrackBlock> load_track_block(
-    ErrorState & state, gen::TrackBlock::Reader gen_block
+    ErrorState & state, gen::TrackBlock::Reader gen_block, PatternsRef patterns
 ) {
     auto prefix = ErrorPrefixer(state);
 
     TickT begin_tick = gen_block.getBeginTick();
     uint32_t loop_count = gen_block.getLoopCount();
 
-    PUSH_LITERAL(".pattern");
-    auto pattern = load_pattern(state, gen_block.getPattern());
-    POP();
+    optional<SharedPattern> pattern;
+    if (gen_block.isPatternId()) {
+        PatternID id = gen_block.getPatternId();
+        if (id >= patterns.size()) {
+            PUSH_ERROR(state,
+                ".pattern_id={} >= {}, out of bounds", id, patterns.size()
+            );
+            return {};
+        }
+        pattern = patterns[id];
+    } else {
+        // Version 3 files store patterns inline.
+        PUSH_LITERAL(".pattern");
+        auto inline_pattern = load_pattern(state, gen_block.getPattern());
+        POP();
+        if (inline_pattern) {
+            pattern = move(*inline_pattern);
+        }
+    }
 
     if (!pattern) {
         return {};
@@ -911,7 +952,7 @@ ChannelSettings load_channel_settings(
     });
 }
 optional<SequenceTrack> load_track(
-    ErrorState & state, gen::SequenceTrack::Reader gen_track
+    ErrorState & state, gen::SequenceTrack::Reader gen_track, PatternsRef patterns
 ) {
     auto prefix = ErrorPrefixer(state);
     bool has_fatal = false;
@@ -924,7 +965,7 @@ optional<SequenceTrack> load_track(
         // TODO ensure block start times are monotonic and blocks don't overlap.
         // TODO ensure blocks are within frame bounds. This requires a new parameter.
         PUSH(".blocks[{}]", b);
-        auto block = load_track_block(state, gen_blocks[b]);
+        auto block = load_track_block(state, gen_blocks[b], patterns);
         POP();
         if (block) {
             blocks.push_back(*block);
@@ -941,11 +982,39 @@ optional<SequenceTrack> load_track(
     return {SequenceTrack(move(blocks), settings)};
 }
 
+using GenPatterns = ::capnp::List< ::serialize::generated::Pattern, ::capnp::Kind::STRUCT>::Reader;
+optional<vector<SharedPattern>> load_patterns(
+    ErrorState & state, GenPatterns gen_patterns
+) {
+    auto prefix = ErrorPrefixer(state);
+    bool has_fatal = false;
+
+    auto patterns = with_capacity<SharedPattern>(gen_patterns.size());
+    for (uint i = 0; i < gen_patterns.size(); i++) {
+        PUSH("[{}]", i);
+        auto pattern = load_pattern(state, gen_patterns[i]);
+        POP();
+        if (pattern) {
+            patterns.push_back(move(*pattern));
+        } else {
+            has_fatal = true;
+        }
+    }
+
+    if (has_fatal) {
+        return {};
+    }
+    return {move(patterns)};
+}
+
 using GenSequence =
     ::capnp::List< ::capnp::List< ::serialize::generated::SequenceTrack,  ::capnp::Kind::STRUCT>,  ::capnp::Kind::LIST>::Reader;
 optional<Sequence> load_sequence(
-    ErrorState & state, GenSequence gen_sequence, ChipMetadataRef chips_metadata
-) {
+    ErrorState & state,
+    GenSequence gen_sequence,
+    ChipMetadataRef chips_metadata,
+    PatternsRef patterns)
+{
     auto prefix = ErrorPrefixer(state);
     bool has_fatal = false;
 
@@ -973,7 +1042,7 @@ optional<Sequence> load_sequence(
         auto channel_tracks = with_capacity<SequenceTrack>(nchan);
         for (uint chan_idx = 0; chan_idx < nchan; chan_idx++) {
             PUSH("[{}][{}]", chip_idx, chan_idx);
-            auto track = load_track(state, gen_channel_tracks[chan_idx]);
+            auto track = load_track(state, gen_channel_tracks[chan_idx], patterns);
             POP();
             if (track) {
                 channel_tracks.push_back(move(*track));
@@ -1107,10 +1176,14 @@ LoadDocumentResult load_impl(kj::InputStream & stream, ErrorState & state) {
         chips_metadata = compute_chip_metadata(*chips);
     }
 
+    prefix.push(state, "patterns");
+    auto patterns = load_patterns(state, gen_doc.getPatterns());
+    prefix.pop(state);
+
     optional<Sequence> sequence = {};
-    if (chips) {
+    if (chips && patterns) {
         prefix.push(state, "sequence");
-        sequence = load_sequence(state, gen_doc.getSequence(), chips_metadata);
+        sequence = load_sequence(state, gen_doc.getSequence(), chips_metadata, *patterns);
         prefix.pop(state);
     }
 
@@ -1304,6 +1377,93 @@ TEST_CASE("Ensure that round-tripping to file works.") {
     CHECK_EQ(rt_metadata, metadata);
 }
 
+/// Returns a document where two blocks share one pattern,
+/// and a third holds a separate copy of it.
+static Document shared_pattern_doc() {
+    Document doc = default_doc();
+    auto & track = doc.sequence[0][0];
+    REQUIRE(!track.blocks.empty());
+    auto const& last = track.blocks.back();
+    TickT const end = last.begin_tick + (TickT) last.loop_count * last.pattern->length_ticks;
+
+    SharedPattern shared = track.blocks[0].pattern;
+    auto const len = shared->length_ticks;
+    track.blocks.push_back(TrackBlock{.begin_tick = end, .pattern = shared});
+    track.blocks.push_back(TrackBlock{.begin_tick = end + len, .pattern = Pattern(*shared)});
+    doc.update_extent();
+    return doc;
+}
+
+static LoadDocumentResult load_from_builder(MallocMessageBuilder & builder) {
+    kj::VectorOutputStream stream;
+    auto magic_number = gen::MAGIC_NUMBER.get();
+    stream.write(magic_number.begin(), magic_number.size());
+    capnp::writePackedMessage(stream, builder);
+
+    kj::ArrayInputStream input(stream.getArray());
+    return load(input);
+}
+
+TEST_CASE("Shared patterns are saved once, and stay shared when loaded") {
+    auto doc = shared_pattern_doc();
+    auto const metadata = Metadata { .ticks_per_row = 12 };
+
+    serialize_impl(doc, metadata, [&](MallocMessageBuilder & builder) {
+        auto gen_doc = builder.getRoot<gen::Document>();
+        auto gen_blocks = gen_doc.getSequence()[0][0].getBlocks();
+        uint const nblock = gen_blocks.size();
+        REQUIRE(nblock >= 3);
+
+        auto first_id = gen_blocks[0].getPatternId();
+        CHECK(gen_blocks[nblock - 2].getPatternId() == first_id);
+        CHECK(gen_blocks[nblock - 1].getPatternId() == first_id);
+
+        size_t total_blocks = 0;
+        for (auto const& channel_tracks : doc.sequence) {
+            for (auto const& track : channel_tracks) {
+                total_blocks += track.blocks.size();
+            }
+        }
+        // The shared pattern and its copy are saved once.
+        CHECK(gen_doc.getPatterns().size() <= total_blocks - 2);
+
+        auto rt = load_from_builder(builder);
+        CHECK_UNARY(rt.errors.empty());
+        REQUIRE_UNARY(rt.v.has_value());
+        auto & [rt_doc, rt_metadata] = *rt.v;
+        CHECK_EQ(rt_doc, doc);
+
+        auto const& rt_blocks = rt_doc.sequence[0][0].blocks;
+        CHECK(rt_blocks[0].pattern.shares_with(rt_blocks[nblock - 2].pattern));
+        CHECK(rt_blocks[0].pattern.shares_with(rt_blocks[nblock - 1].pattern));
+    });
+}
+
+TEST_CASE("Version 3 files with inline patterns still load") {
+    auto doc = shared_pattern_doc();
+    auto const metadata = Metadata { .ticks_per_row = 12 };
+
+    serialize_impl(doc, metadata, [&](MallocMessageBuilder & builder) {
+        // Rewrite the message as version 3 would have written it.
+        auto gen_doc = builder.getRoot<gen::Document>();
+        gen_doc.setVersion(3);
+        auto gen_patterns = gen_doc.getPatterns().asReader();
+        for (auto gen_channel_tracks : gen_doc.getSequence()) {
+            for (auto gen_track : gen_channel_tracks) {
+                for (auto gen_block : gen_track.getBlocks()) {
+                    gen_block.setPattern(gen_patterns[gen_block.getPatternId()]);
+                }
+            }
+        }
+        gen_doc.disownPatterns();
+
+        auto rt = load_from_builder(builder);
+        CHECK_UNARY(rt.errors.empty());
+        REQUIRE_UNARY(rt.v.has_value());
+        CHECK_EQ(std::get<0>(*rt.v), doc);
+    });
+}
+
 // TODO add save_to_path() optional error message,
 // for saving to an invalid/nonwritable path.
 
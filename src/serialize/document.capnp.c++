@@ -171,7 +171,7 @@ static const ::capnp::_::AlignedData<26> b_84edce2a246ba21e = {
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-      8,   0,   0,   0,   3,   0,   0,   0,
+      8,   0,   0,   0,   4,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0, }
 };
@@ -613,17 +613,17 @@ const ::capnp::_::RawSchema s_e9bfcd5dae76e2b5 = {
   1, 2, i_e9bfcd5dae76e2b5, nullptr, nullptr, { &s_e9bfcd5dae76e2b5, nullptr, nullptr, 0, 0, nullptr }
 };
 #endif  // !CAPNP_LITE
-static const ::capnp::_::AlignedData<66> b_c302301396455653 = {
+static const ::capnp::_::AlignedData<82> b_c302301396455653 = {
   {   0,   0,   0,   0,   5,   0,   6,   0,
      83,  86,  69, 150,  19,  48,   2, 195,
-     29,   0,   0,   0,   1,   0,   1,   0,
+     29,   0,   0,   0,   1,   0,   2,   0,
     212, 222, 147, 231, 182,  81,  75, 214,
-      1,   0,   7,   0,   0,   0,   0,   0,
-      0,   0,   0,   0,   0,   0,   0,   0,
+      1,   0,   7,   0,   0,   0,   2,   0,
+      4,   0,   0,   0,   0,   0,   0,   0,
      21,   0,   0,   0,  66,   1,   0,   0,
      37,   0,   0,   0,   7,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     33,   0,   0,   0, 175,   0,   0,   0,
+     33,   0,   0,   0, 231,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
     115, 114,  99,  47, 115, 101, 114, 105,
@@ -632,28 +632,35 @@ static const ::capnp::_::AlignedData<66> b_c302301396455653 = {
      97, 112, 110, 112,  58,  84, 114,  97,
      99, 107,  66, 108, 111,  99, 107,   0,
       0,   0,   0,   0,   1,   0,   1,   0,
-     12,   0,   0,   0,   3,   0,   4,   0,
+     16,   0,   0,   0,   3,   0,   4,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   1,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     69,   0,   0,   0,  82,   0,   0,   0,
+     97,   0,   0,   0,  82,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     68,   0,   0,   0,   3,   0,   1,   0,
-     80,   0,   0,   0,   2,   0,   1,   0,
+     96,   0,   0,   0,   3,   0,   1,   0,
+    108,   0,   0,   0,   2,   0,   1,   0,
       1,   0,   0,   0,   1,   0,   0,   0,
       0,   0,   1,   0,   1,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     77,   0,   0,   0,  82,   0,   0,   0,
+    105,   0,   0,   0,  82,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     76,   0,   0,   0,   3,   0,   1,   0,
-     88,   0,   0,   0,   2,   0,   1,   0,
-      2,   0,   0,   0,   0,   0,   0,   0,
+    104,   0,   0,   0,   3,   0,   1,   0,
+    116,   0,   0,   0,   2,   0,   1,   0,
+      2,   0, 255, 255,   0,   0,   0,   0,
       0,   0,   1,   0,   2,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     85,   0,   0,   0,  66,   0,   0,   0,
+    113,   0,   0,   0,  66,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     80,   0,   0,   0,   3,   0,   1,   0,
-     92,   0,   0,   0,   2,   0,   1,   0,
+    108,   0,   0,   0,   3,   0,   1,   0,
+    120,   0,   0,   0,   2,   0,   1,   0,
+      3,   0, 254, 255,   3,   0,   0,   0,
+      0,   0,   1,   0,   3,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    117,   0,   0,   0,  82,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    116,   0,   0,   0,   3,   0,   1,   0,
+    128,   0,   0,   0,   2,   0,   1,   0,
      98, 101, 103, 105, 110,  84, 105,  99,
     107,   0,   0,   0,   0,   0,   0,   0,
       4,   0,   0,   0,   0,   0,   0,   0,
@@ -678,6 +685,15 @@ static const ::capnp::_::AlignedData<66> b_c302301396455653 = {
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
      16,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    112,  97, 116, 116, 101, 114, 110,  73,
+    100,   0,   0,   0,   0,   0,   0,   0,
+      8,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      8,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0, }
 };
@@ -686,11 +702,11 @@ static const ::capnp::_::AlignedData<66> b_c302301396455653 = {
 static const ::capnp::_::RawSchema* const d_c302301396455653[] = {
   &s_e9bfcd5dae76e2b5,
 };
-static const uint16_t m_c302301396455653[] = {0, 1, 2};
-static const uint16_t i_c302301396455653[] = {0, 1, 2};
+static const uint16_t m_c302301396455653[] = {0, 1, 2, 3};
+static const uint16_t i_c302301396455653[] = {2, 3, 0, 1};
 const ::capnp::_::RawSchema s_c302301396455653 = {
-  0xc302301396455653, b_c302301396455653.words, 66, d_c302301396455653, m_c302301396455653,
-  1, 3, i_c302301396455653, nullptr, nullptr, { &s_c302301396455653, nullptr, nullptr, 0, 0, nullptr }
+  0xc302301396455653, b_c302301396455653.words, 82, d_c302301396455653, m_c302301396455653,
+  1, 4, i_c302301396455653, nullptr, nullptr, { &s_c302301396455653, nullptr, nullptr, 0, 0, nullptr }
 };
 #endif  // !CAPNP_LITE
 static const ::capnp::_::AlignedData<55> b_cd4653eb79723f64 = {
@@ -1481,17 +1497,17 @@ const ::capnp::_::RawSchema s_a8a856289ab511b0 = {
 };
 #endif  // !CAPNP_LITE
 CAPNP_DEFINE_ENUM(ChipKind_a8a856289ab511b0, a8a856289ab511b0);
-static const ::capnp::_::AlignedData<201> b_ebd00718fee78c30 = {
+static const ::capnp::_::AlignedData<221> b_ebd00718fee78c30 = {
   {   0,   0,   0,   0,   5,   0,   6,   0,
      48, 140, 231, 254,  24,   7, 208, 235,
      29,   0,   0,   0,   1,   0,   2,   0,
     212, 222, 147, 231, 182,  81,  75, 214,
-      6,   0,   7,   0,   0,   0,   0,   0,
+      7,   0,   7,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
      21,   0,   0,   0,  50,   1,   0,   0,
      37,   0,   0,   0,   7,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     33,   0,   0,   0,  55,   2,   0,   0,
+     33,   0,   0,   0, 111,   2,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
     115, 114,  99,  47, 115, 101, 114, 105,
@@ -1500,77 +1516,84 @@ static const ::capnp::_::AlignedData<201> b_ebd00718fee78c30 = {
      97, 112, 110, 112,  58,  68, 111,  99,
     117, 109, 101, 110, 116,   0,   0,   0,
       0,   0,   0,   0,   1,   0,   1,   0,
-     40,   0,   0,   0,   3,   0,   4,   0,
+     44,   0,   0,   0,   3,   0,   4,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   1,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-      9,   1,   0,   0,  66,   0,   0,   0,
+     37,   1,   0,   0,  66,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-      4,   1,   0,   0,   3,   0,   1,   0,
-     16,   1,   0,   0,   2,   0,   1,   0,
+     32,   1,   0,   0,   3,   0,   1,   0,
+     44,   1,   0,   0,   2,   0,   1,   0,
       1,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   1,   0,   1,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     13,   1,   0,   0, 138,   0,   0,   0,
+     41,   1,   0,   0, 138,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     16,   1,   0,   0,   3,   0,   1,   0,
-     28,   1,   0,   0,   2,   0,   1,   0,
+     44,   1,   0,   0,   3,   0,   1,   0,
+     56,   1,   0,   0,   2,   0,   1,   0,
       2,   0,   0,   0,   1,   0,   0,   0,
       0,   0,   1,   0,   2,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     25,   1,   0,   0, 122,   0,   0,   0,
+     53,   1,   0,   0, 122,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     24,   1,   0,   0,   3,   0,   1,   0,
-     52,   1,   0,   0,   2,   0,   1,   0,
+     52,   1,   0,   0,   3,   0,   1,   0,
+     80,   1,   0,   0,   2,   0,   1,   0,
       3,   0,   0,   0,   2,   0,   0,   0,
       0,   0,   1,   0,   3,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     49,   1,   0,   0, 122,   0,   0,   0,
+     77,   1,   0,   0, 122,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     48,   1,   0,   0,   3,   0,   1,   0,
-     60,   1,   0,   0,   2,   0,   1,   0,
+     76,   1,   0,   0,   3,   0,   1,   0,
+     88,   1,   0,   0,   2,   0,   1,   0,
       4,   0,   0,   0,   3,   0,   0,   0,
       0,   0,   1,   0,   4,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     57,   1,   0,   0,  98,   0,   0,   0,
+     85,   1,   0,   0,  98,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     56,   1,   0,   0,   3,   0,   1,   0,
-     68,   1,   0,   0,   2,   0,   1,   0,
+     84,   1,   0,   0,   3,   0,   1,   0,
+     96,   1,   0,   0,   2,   0,   1,   0,
       5,   0,   0,   0,   8,   0,   0,   0,
       0,   0,   1,   0,   5,   0,   0,   0,
       1,   0,   0,   0,   0,   0,   0,   0,
-     65,   1,   0,   0, 130,   0,   0,   0,
+     93,   1,   0,   0, 130,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     64,   1,   0,   0,   3,   0,   1,   0,
-     76,   1,   0,   0,   2,   0,   1,   0,
+     92,   1,   0,   0,   3,   0,   1,   0,
+    104,   1,   0,   0,   2,   0,   1,   0,
       6,   0,   0,   0,   2,   0,   0,   0,
       0,   0,   1,   0,   6,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     73,   1,   0,   0,  66,   0,   0,   0,
+    101,   1,   0,   0,  66,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     68,   1,   0,   0,   3,   0,   1,   0,
-     96,   1,   0,   0,   2,   0,   1,   0,
+     96,   1,   0,   0,   3,   0,   1,   0,
+    124,   1,   0,   0,   2,   0,   1,   0,
       7,   0,   0,   0,   3,   0,   0,   0,
       0,   0,   1,   0,   7,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     93,   1,   0,   0,  98,   0,   0,   0,
+    121,   1,   0,   0,  98,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-     92,   1,   0,   0,   3,   0,   1,   0,
-    120,   1,   0,   0,   2,   0,   1,   0,
+    120,   1,   0,   0,   3,   0,   1,   0,
+    148,   1,   0,   0,   2,   0,   1,   0,
       8,   0,   0,   0,   4,   0,   0,   0,
       0,   0,   1,   0,   8,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-    117,   1,   0,   0,  50,   0,   0,   0,
+    145,   1,   0,   0,  50,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-    112,   1,   0,   0,   3,   0,   1,   0,
-    140,   1,   0,   0,   2,   0,   1,   0,
+    140,   1,   0,   0,   3,   0,   1,   0,
+    168,   1,   0,   0,   2,   0,   1,   0,
       9,   0,   0,   0,   5,   0,   0,   0,
       0,   0,   1,   0,   9,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-    137,   1,   0,   0,  74,   0,   0,   0,
+    165,   1,   0,   0,  74,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
-    136,   1,   0,   0,   3,   0,   1,   0,
-    180,   1,   0,   0,   2,   0,   1,   0,
+    164,   1,   0,   0,   3,   0,   1,   0,
+    208,   1,   0,   0,   2,   0,   1,   0,
+     10,   0,   0,   0,   6,   0,   0,   0,
+      0,   0,   1,   0,  10,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    205,   1,   0,   0,  74,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    204,   1,   0,   0,   3,   0,   1,   0,
+    232,   1,   0,   0,   2,   0,   1,   0,
     118, 101, 114, 115, 105, 111, 110,   0,
       8,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
@@ -1680,6 +1703,19 @@ static const ::capnp::_::AlignedData<201> b_ebd00718fee78c30 = {
     100,  63, 114, 121, 235,  83,  70, 205,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
+     14,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+    112,  97, 116, 116, 101, 114, 110, 115,
+      0,   0,   0,   0,   0,   0,   0,   0,
+     14,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   3,   0,   1,   0,
+     16,   0,   0,   0,   0,   0,   0,   0,
+    181, 226, 118, 174,  93, 205, 191, 233,
+      0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,
      14,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0,
       0,   0,   0,   0,   0,   0,   0,   0, }
@@ -1693,12 +1729,13 @@ static const ::capnp::_::RawSchema* const d_ebd00718fee78c30[] = {
   &s_a8a856289ab511b0,
   &s_b79be6fd6b53c23a,
   &s_cd4653eb79723f64,
+  &s_e9bfcd5dae76e2b5,
 };
-static const uint16_t m_ebd00718fee78c30[] = {3, 8, 5, 2, 7, 6, 9, 1, 4, 0};
-static const uint16_t i_ebd00718fee78c30[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+static const uint16_t m_ebd00718fee78c30[] = {3, 8, 5, 2, 7, 10, 6, 9, 1, 4, 0};
+static const uint16_t i_ebd00718fee78c30[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
 const ::capnp::_::RawSchema s_ebd00718fee78c30 = {
-  0xebd00718fee78c30, b_ebd00718fee78c30.words, 201, d_ebd00718fee78c30, m_ebd00718fee78c30,
-  6, 10, i_ebd00718fee78c30, nullptr, nullptr, { &s_ebd00718fee78c30, nullptr, nullptr, 0, 0, nullptr }
+  0xebd00718fee78c30, b_ebd00718fee78c30.words, 221, d_ebd00718fee78c30, m_ebd00718fee78c30,
+  7, 11, i_ebd00718fee78c30, nullptr, nullptr, { &s_ebd00718fee78c30, nullptr, nullptr, 0, 0, nullptr }
 };
 #endif  // !CAPNP_LITE
 }  // namespace schemas
@@ -66,7 +66,7 @@ struct Versions {
   class Pipeline;
   static constexpr  ::uint32_t UNKNOWN = 0u;
   static constexpr  ::uint32_t MINIMUM = 3u;
-  static constexpr  ::uint32_t CURRENT = 3u;
+  static constexpr  ::uint32_t CURRENT = 4u;
 
   struct _capnpPrivate {
     CAPNP_DECLARE_STRUCT_HEADER(b9fec0afa09d2253, 0, 0)
@@ -187,9 +187,13 @@ struct TrackBlock {
   class Reader;
   class Builder;
   class Pipeline;
+  enum Which: uint16_t {
+    PATTERN,
+    PATTERN_ID,
+  };
 
   struct _capnpPrivate {
-    CAPNP_DECLARE_STRUCT_HEADER(c302301396455653, 1, 1)
+    CAPNP_DECLARE_STRUCT_HEADER(c302301396455653, 2, 1)
     #if !CAPNP_LITE
     static constexpr ::capnp::_::RawBrandedSchema const* brand() { return &schema->defaultBrand; }
     #endif  // !CAPNP_LITE
@@ -353,7 +357,7 @@ struct Document {
   class Pipeline;
 
   struct _capnpPrivate {
-    CAPNP_DECLARE_STRUCT_HEADER(ebd00718fee78c30, 2, 6)
+    CAPNP_DECLARE_STRUCT_HEADER(ebd00718fee78c30, 2, 7)
     #if !CAPNP_LITE
     static constexpr ::capnp::_::RawBrandedSchema const* brand() { return &schema->defaultBrand; }
     #endif  // !CAPNP_LITE
@@ -987,13 +991,18 @@ public:
   }
 #endif  // !CAPNP_LITE
 
+  inline Which which() const;
   inline  ::int32_t getBeginTick() const;
 
   inline  ::uint32_t getLoopCount() const;
 
+  inline bool isPattern() const;
   inline bool hasPattern() const;
   inline  ::serialize::generated::Pattern::Reader getPattern() const;
 
+  inline bool isPatternId() const;
+  inline  ::uint32_t getPatternId() const;
+
 private:
   ::capnp::_::StructReader _reader;
   template <typename, ::capnp::Kind>
@@ -1022,12 +1031,14 @@ public:
   inline ::kj::StringTree toString() const { return asReader().toString(); }
 #endif  // !CAPNP_LITE
 
+  inline Which which();
   inline  ::int32_t getBeginTick();
   inline void setBeginTick( ::int32_t value);
 
   inline  ::uint32_t getLoopCount();
   inline void setLoopCount( ::uint32_t value);
 
+  inline bool isPattern();
   inline bool hasPattern();
   inline  ::serialize::generated::Pattern::Builder getPattern();
   inline void setPattern( ::serialize::generated::Pattern::Reader value);
@@ -1035,6 +1046,10 @@ public:
   inline void adoptPattern(::capnp::Orphan< ::serialize::generated::Pattern>&& value);
   inline ::capnp::Orphan< ::serialize::generated::Pattern> disownPattern();
 
+  inline bool isPatternId();
+  inline  ::uint32_t getPatternId();
+  inline void setPatternId( ::uint32_t value);
+
 private:
   ::capnp::_::StructBuilder _builder;
   template <typename, ::capnp::Kind>
@@ -1053,7 +1068,6 @@ public:
   inline explicit Pipeline(::capnp::AnyPointer::Pipeline&& typeless)
       : _typeless(kj::mv(typeless)) {}
 
-  inline  ::serialize::generated::Pattern::Pipeline getPattern();
 private:
   ::capnp::AnyPointer::Pipeline _typeless;
   friend class ::capnp::PipelineHook;
@@ -1929,6 +1943,9 @@ public:
   inline bool hasSequence() const;
   inline  ::capnp::List< ::capnp::List< ::serialize::generated::SequenceTrack,  ::capnp::Kind::STRUCT>,  ::capnp::Kind::LIST>::Reader getSequence() const;
 
+  inline bool hasPatterns() const;
+  inline  ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Reader getPatterns() const;
+
 private:
   ::capnp::_::StructReader _reader;
   template <typename, ::capnp::Kind>
@@ -2014,6 +2031,13 @@ public:
   inline void adoptSequence(::capnp::Orphan< ::capnp::List< ::capnp::List< ::serialize::generated::SequenceTrack,  ::capnp::Kind::STRUCT>,  ::capnp::Kind::LIST>>&& value);
   inline ::capnp::Orphan< ::capnp::List< ::capnp::List< ::serialize::generated::SequenceTrack,  ::capnp::Kind::STRUCT>,  ::capnp::Kind::LIST>> disownSequence();
 
+  inline bool hasPatterns();
+  inline  ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Builder getPatterns();
+  inline void setPatterns( ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Reader value);
+  inline  ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Builder initPatterns(unsigned int size);
+  inline void adoptPatterns(::capnp::Orphan< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>&& value);
+  inline ::capnp::Orphan< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>> disownPatterns();
+
 private:
   ::capnp::_::StructBuilder _builder;
   template <typename, ::capnp::Kind>
@@ -2412,6 +2436,15 @@ inline ::capnp::Orphan< ::capnp::List< ::serialize::generated::TimedRowEvent,  :
       ::capnp::bounded<0>() * ::capnp::POINTERS));
 }
 
+inline  ::serialize::generated::TrackBlock::Which TrackBlock::Reader::which() const {
+  return _reader.getDataField<Which>(
+      ::capnp::bounded<4>() * ::capnp::ELEMENTS);
+}
+inline  ::serialize::generated::TrackBlock::Which TrackBlock::Builder::which() {
+  return _builder.getDataField<Which>(
+      ::capnp::bounded<4>() * ::capnp::ELEMENTS);
+}
+
 inline  ::int32_t TrackBlock::Reader::getBeginTick() const {
   return _reader.getDataField< ::int32_t>(
       ::capnp::bounded<0>() * ::capnp::ELEMENTS);
@@ -2440,45 +2473,86 @@ inline void TrackBlock::Builder::setLoopCount( ::uint32_t value) {
       ::capnp::bounded<1>() * ::capnp::ELEMENTS, value);
 }
 
+inline bool TrackBlock::Reader::isPattern() const {
+  return which() == TrackBlock::PATTERN;
+}
+inline bool TrackBlock::Builder::isPattern() {
+  return which() == TrackBlock::PATTERN;
+}
 inline bool TrackBlock::Reader::hasPattern() const {
+  if (which() != TrackBlock::PATTERN) return false;
   return !_reader.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS).isNull();
 }
 inline bool TrackBlock::Builder::hasPattern() {
+  if (which() != TrackBlock::PATTERN) return false;
   return !_builder.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS).isNull();
 }
 inline  ::serialize::generated::Pattern::Reader TrackBlock::Reader::getPattern() const {
+  KJ_IREQUIRE((which() == TrackBlock::PATTERN),
+              "Must check which() before get()ing a union member.");
   return ::capnp::_::PointerHelpers< ::serialize::generated::Pattern>::get(_reader.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS));
 }
 inline  ::serialize::generated::Pattern::Builder TrackBlock::Builder::getPattern() {
+  KJ_IREQUIRE((which() == TrackBlock::PATTERN),
+              "Must check which() before get()ing a union member.");
   return ::capnp::_::PointerHelpers< ::serialize::generated::Pattern>::get(_builder.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS));
 }
-#if !CAPNP_LITE
-inline  ::serialize::generated::Pattern::Pipeline TrackBlock::Pipeline::getPattern() {
-  return  ::serialize::generated::Pattern::Pipeline(_typeless.getPointerField(0));
-}
-#endif  // !CAPNP_LITE
 inline void TrackBlock::Builder::setPattern( ::serialize::generated::Pattern::Reader value) {
+  _builder.setDataField<TrackBlock::Which>(
+      ::capnp::bounded<4>() * ::capnp::ELEMENTS, TrackBlock::PATTERN);
   ::capnp::_::PointerHelpers< ::serialize::generated::Pattern>::set(_builder.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS), value);
 }
 inline  ::serialize::generated::Pattern::Builder TrackBlock::Builder::initPattern() {
+  _builder.setDataField<TrackBlock::Which>(
+      ::capnp::bounded<4>() * ::capnp::ELEMENTS, TrackBlock::PATTERN);
   return ::capnp::_::PointerHelpers< ::serialize::generated::Pattern>::init(_builder.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS));
 }
 inline void TrackBlock::Builder::adoptPattern(
     ::capnp::Orphan< ::serialize::generated::Pattern>&& value) {
+  _builder.setDataField<TrackBlock::Which>(
+      ::capnp::bounded<4>() * ::capnp::ELEMENTS, TrackBlock::PATTERN);
   ::capnp::_::PointerHelpers< ::serialize::generated::Pattern>::adopt(_builder.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS), kj::mv(value));
 }
 inline ::capnp::Orphan< ::serialize::generated::Pattern> TrackBlock::Builder::disownPattern() {
+  KJ_IREQUIRE((which() == TrackBlock::PATTERN),
+              "Must check which() before get()ing a union member.");
   return ::capnp::_::PointerHelpers< ::serialize::generated::Pattern>::disown(_builder.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS));
 }
 
+inline bool TrackBlock::Reader::isPatternId() const {
+  return which() == TrackBlock::PATTERN_ID;
+}
+inline bool TrackBlock::Builder::isPatternId() {
+  return which() == TrackBlock::PATTERN_ID;
+}
+inline  ::uint32_t TrackBlock::Reader::getPatternId() const {
+  KJ_IREQUIRE((which() == TrackBlock::PATTERN_ID),
+              "Must check which() before get()ing a union member.");
+  return _reader.getDataField< ::uint32_t>(
+      ::capnp::bounded<3>() * ::capnp::ELEMENTS);
+}
+
+inline  ::uint32_t TrackBlock::Builder::getPatternId() {
+  KJ_IREQUIRE((which() == TrackBlock::PATTERN_ID),
+              "Must check which() before get()ing a union member.");
+  return _builder.getDataField< ::uint32_t>(
+      ::capnp::bounded<3>() * ::capnp::ELEMENTS);
+}
+inline void TrackBlock::Builder::setPatternId( ::uint32_t value) {
+  _builder.setDataField<TrackBlock::Which>(
+      ::capnp::bounded<4>() * ::capnp::ELEMENTS, TrackBlock::PATTERN_ID);
+  _builder.setDataField< ::uint32_t>(
+      ::capnp::bounded<3>() * ::capnp::ELEMENTS, value);
+}
+
 inline bool SequenceTrack::Reader::hasBlocks() const {
   return !_reader.getPointerField(
       ::capnp::bounded<0>() * ::capnp::POINTERS).isNull();
@@ -3350,6 +3424,40 @@ inline ::capnp::Orphan< ::capnp::List< ::capnp::List< ::serialize::generated::Se
       ::capnp::bounded<5>() * ::capnp::POINTERS));
 }
 
+inline bool Document::Reader::hasPatterns() const {
+  return !_reader.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS).isNull();
+}
+inline bool Document::Builder::hasPatterns() {
+  return !_builder.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS).isNull();
+}
+inline  ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Reader Document::Reader::getPatterns() const {
+  return ::capnp::_::PointerHelpers< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>::get(_reader.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS));
+}
+inline  ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Builder Document::Builder::getPatterns() {
+  return ::capnp::_::PointerHelpers< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>::get(_builder.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS));
+}
+inline void Document::Builder::setPatterns( ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Reader value) {
+  ::capnp::_::PointerHelpers< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>::set(_builder.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS), value);
+}
+inline  ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>::Builder Document::Builder::initPatterns(unsigned int size) {
+  return ::capnp::_::PointerHelpers< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>::init(_builder.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS), size);
+}
+inline void Document::Builder::adoptPatterns(
+    ::capnp::Orphan< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>&& value) {
+  ::capnp::_::PointerHelpers< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>::adopt(_builder.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS), kj::mv(value));
+}
+inline ::capnp::Orphan< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>> Document::Builder::disownPatterns() {
+  return ::capnp::_::PointerHelpers< ::capnp::List< ::serialize::generated::Pattern,  ::capnp::Kind::STRUCT>>::disown(_builder.getPointerField(
+      ::capnp::bounded<6>() * ::capnp::POINTERS));
+}
+
 }  // namespace
 }  // namespace
 
@@ -25,6 +25,10 @@ using link::Symbol;
 using link::Object;
 using link::Linker;
 
+using aram_layout::AramLayout;
+using aram_layout::AramUsage;
+using aram_layout::LayoutConfig;
+
 using namespace doc;
 using doc::validate::ErrorState;
 using doc::validate::ErrorPrefixer;
@@ -44,22 +48,11 @@ template<typename T>
 namespace samples {
     using SamplesRef = gsl::span<const std::optional<Sample>>;
 
-    struct BinSamples {
-        /// no symbol
-        Object sample_dir;
-
-        /// Symbol::SampleBank
-        Object sample_bank;
-    };
-
     static constexpr size_t AMK_SAMPLE_MAX = 0x7F;
 
     // If we change the code to skip unused samples, we must also change the code to
     // create a sample map.
-    [[nodiscard]] static std::optional<BinSamples> compile_samples(
-        ErrorState & state, SamplesRef samples
-    ) {
-        // TODO deduplicate with audio/synth/spc700_driver.cpp#Spc700Driver::reload_samples()
+    [[nodiscard]] static bool validate_samples(ErrorState & state, SamplesRef samples) {
         // TODO reduce MAX_SAMPLES to 0x80 or eventually 0xE0, and add all missing u8
         // bounds checks
 
@@ -68,49 +61,52 @@ namespace samples {
             PUSH_ERROR(state,
                 "Highest sample {:02X} exceeds maximum export sample {:02X}",
                 num_samples - 1, AMK_SAMPLE_MAX);
-            return {};
+            return false;
         }
+        return true;
+    }
 
-        samples = samples.subspan(0, num_samples);
-
-        // List of pointers to samples.
-        auto sample_dir = Object({});
-        // Sample data.
-        auto sample_bank = Object(Symbol::SampleBank);
-
-        for (auto const& [i, sample] : enumerate<size_t>(samples)) {
-            if (sample.has_value()) {
-                auto sample_begin = sample_bank.size();
-                auto sample_loop = sample_begin + sample->loop_byte;
-                if (sample_begin + sample->brr.size() > 0xFFFF) {
-                    PUSH_ERROR(state,
-                        "Sample {:02X} with size {} exceeded 64 KB in samples alone!!!",
-                        i, sample->brr.size());
-                    return {};
-                }
+    /// Writes the sample directory and sample data, using the same layout planner
+    /// as tracker playback (aram_layout.h). Samples with identical data are only
+    /// written once.
+    [[nodiscard]] static std::optional<AramUsage> write_samples(
+        ErrorState & state,
+        gsl::span<uint8_t, 0x1'0000> aram,
+        uint32_t dir_begin,
+        Samples const& samples)
+    {
+        if (dir_begin >= aram_layout::ARAM_SIZE) {
+            PUSH_ERROR(state, "Driver and song data fill ARAM, no room for samples");
+            return {};
+        }
 
-                // Push begin-playback address.
-                sample_dir.push_reloc(Symbol::SampleBank, (uint16_t) sample_begin);
-                // Push loop address.
-                sample_dir.push_reloc(Symbol::SampleBank, (uint16_t) sample_loop);
-                // Push sample data to bank at sample_begin.
-                sample_bank.data().insert(
-                    sample_bank.data().end(), sample->brr.begin(), sample->brr.end()
-                );
+        // Samples are written after song data, so there's no need to round up
+        // the directory size.
+        auto layout = AramLayout(LayoutConfig {
+            .dir_begin = dir_begin,
+        });
+        [[maybe_unused]] auto moved = layout.update(samples, aram.data());
+
+        AramUsage usage = layout.usage();
+        for (size_t i = 0; i < MAX_SAMPLES; i++) {
+            if (!usage.not_loaded[i]) {
+                continue;
+            }
+            auto const& sample = *samples[i];
+            if (!aram_layout::is_loadable(sample)) {
+                PUSH_ERROR(state,
+                    "Sample {:02X} is empty or loops past its end", i);
             } else {
-                sample_dir.push_reloc(Symbol::SampleBank, 0);
-                sample_dir.push_reloc(Symbol::SampleBank, 0);
+                PUSH_ERROR(state,
+                    "Sample {:02X} ({} bytes) does not fit in ARAM, {} bytes free",
+                    i, sample.brr.size(), usage.free_bytes);
             }
         }
-
-        return BinSamples {
-            .sample_dir = std::move(sample_dir),
-            .sample_bank = std::move(sample_bank),
-        };
+        return usage;
     }
 }
-using samples::BinSamples;
-using samples::compile_samples;
+using samples::validate_samples;
+using samples::write_samples;
 
 namespace instr {
     constexpr double CENTS_PER_OCTAVE = 1200.;
@@ -517,14 +513,14 @@ using frame::compile_frames;
     return
 
 static void build_spc(
-    ErrorState & state, std::vector<uint8_t> & spc, Document const& doc
-) {
-    auto maybe_samples = compile_samples(state, doc.samples.dyn_span());
-    if (!maybe_samples) {
+    ErrorState & state,
+    std::vector<uint8_t> & spc,
+    std::optional<AramUsage> & aram_usage,
+    Document const& doc)
+{
+    if (!validate_samples(state, doc.samples.dyn_span())) {
         FAIL(state);
     }
-    // Linker::add_object() takes an Object const&.
-    BinSamples const& samples = *maybe_samples;
 
     auto maybe_instrs = compile_instrs(state, doc);
     if (!maybe_instrs) {
@@ -554,7 +550,7 @@ static void build_spc(
     std::copy(driver::dsp_footer.begin(), driver::dsp_footer.end(), footer.begin());
 
     // Begin laying out ARAM.
-    auto linker = Linker(aram, 0x400);
+    auto linker = Linker(aram, driver::driverPos);
 
     // Write driver.
     {
@@ -602,29 +598,20 @@ static void build_spc(
         }
     }
 
-    // Write sample table and data.
-    linker.align_address();
-    auto sample_dir_reg = (uint8_t) (linker.current_address() >> 8);
-    {
-        auto err = linker.add_object(samples.sample_dir);
-        if (!err.empty()) {
-            PUSH_ERROR(state, "failed to write sample directory: {}", err);
-            return;
-        }
-
-        err = linker.add_object(samples.sample_bank);
-        if (!err.empty()) {
-            PUSH_ERROR(state, "failed to write sample data: {}", err);
-            return;
-        }
-    }
-
     auto unresolved_syms = linker.finalize();
     if (!unresolved_syms.empty()) {
         PUSH_ERROR(state, "Internal error: {} (report this bug!)", unresolved_syms);
         return;
     }
 
+    // Write sample table and data.
+    linker.align_address();
+    auto sample_dir_addr = (uint32_t) linker.current_address();
+    aram_usage = write_samples(state, aram, sample_dir_addr, doc.samples);
+    if (!state.ok) {
+        return;
+    }
+
     // Write SPC metadata and SMP registers.
     {
         strncpy((char *) &header[0x2E], "Title", 32);
@@ -676,7 +663,7 @@ static void build_spc(
     // Write DSP registers.
     {
         // 0x5D = sample directory.
-        footer[0x5D] = sample_dir_reg;
+        footer[0x5D] = (uint8_t) (sample_dir_addr >> 8);
     }
 }
 
@@ -740,10 +727,13 @@ void save_file(ErrorState & state, gsl::span<uint8_t> data, char const* path) {
 }
 
 // Too lazy to std::move on each call. So take a regular reference and move from it.
-[[nodiscard]] ExportSpcResult result(ErrorState & state) {
+[[nodiscard]] ExportSpcResult result(
+    ErrorState & state, std::optional<AramUsage> aram_usage = {}
+) {
     return ExportSpcResult {
         .ok = state.ok,
         .errors = std::move(state.err),
+        .aram_usage = std::move(aram_usage),
     };
 }
 }
@@ -752,11 +742,12 @@ void save_file(ErrorState & state, gsl::span<uint8_t> data, char const* path) {
 ExportSpcResult export_spc(Document const& doc, char const* path) {
     ErrorState state;
     std::vector<uint8_t> spc;
+    std::optional<AramUsage> aram_usage;
 
     // Generate SPC file data.
-    build_spc(state, spc, doc);
+    build_spc(state, spc, aram_usage, doc);
     if (!state.ok) {
-        return result(state);
+        return result(state, std::move(aram_usage));
     }
 
     // Write SPC file to disk.
@@ -765,10 +756,10 @@ ExportSpcResult export_spc(Document const& doc, char const* path) {
     });
     KJ_IF_MAYBE(e, maybe_exception) {
         PUSH_ERROR(state, "Error saving file: {}", string_view(e->getDescription()));
-        return result(state);
+        return result(state, std::move(aram_usage));
     }
 
-    return result(state);
+    return result(state, std::move(aram_usage));
 }
 
 }
@@ -949,6 +940,51 @@ TEST_CASE("Test compile_instrs() and InstrumentMap mapping") {
     }
 }
 
+
+TEST_CASE("Test build_spc() sample layout") {
+    using namespace doc_util::sample_instrs;
+
+    auto doc = DocumentCopy(instrument_test());
+    doc.samples[0] = pulse_50();
+    doc.samples[1] = pulse_50();
+    doc.samples[2] = long_silence();
+    doc.samples[3] = pulse_25();
+
+    ErrorState state;
+    std::vector<uint8_t> spc;
+    std::optional<AramUsage> usage;
+
+    SUBCASE("Identical samples are written once") {
+        build_spc(state, spc, usage, Document(doc));
+        REQUIRE(state.ok);
+        REQUIRE(usage.has_value());
+
+        auto aram = gsl::span<uint8_t const>(spc.data() + 0x100, 0x1'0000);
+        uint32_t const dir = uint32_t(spc[0x1'0100 + 0x5D]) << 8;
+        auto dir_entry = [&](size_t i) {
+            return aram[dir + 4 * i] | aram[dir + 4 * i + 1] << 8;
+        };
+        CHECK(dir_entry(0) == dir_entry(1));
+        CHECK(dir_entry(0) != dir_entry(2));
+
+        size_t const unique_bytes = doc.samples[0]->brr.size()
+            + doc.samples[2]->brr.size() + doc.samples[3]->brr.size();
+        CHECK(usage->sample_bytes == unique_bytes);
+        CHECK(usage->not_loaded.none());
+        CHECK(usage->reserved_bytes >= dir);
+        CHECK(usage->free_bytes > 0);
+    }
+
+    SUBCASE("Samples which do not fit fail to export") {
+        doc.samples[3]->brr.mut().resize(0xF000 / 9 * 9);
+        build_spc(state, spc, usage, Document(doc));
+        CHECK(!state.ok);
+        REQUIRE(usage.has_value());
+        CHECK(usage->not_loaded.count() == 1);
+        CHECK(usage->not_loaded[3]);
+    }
+}
+
 }
 
 #endif
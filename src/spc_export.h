@@ -1,5 +1,6 @@
 #pragma once
 
+#include "aram_layout.h"
 #include "doc.h"
 #include "doc/validate_common.h"  // too lazy to duplicate the types for export validation
 
@@ -24,8 +25,11 @@ using doc::validate::ErrorType;
 /// {false, {}} should never be returned.
 struct ExportSpcResult {
     bool ok;
-    // TODO add metadata about ARAM usage
     Errors errors;
+
+    /// How the exported file's ARAM is used.
+    /// Empty if export failed before samples were laid out.
+    std::optional<aram_layout::AramUsage> aram_usage = {};
 };
 
 [[nodiscard]] ExportSpcResult export_spc(doc::Document const& doc, char const* path);
@@ -4,6 +4,8 @@
 namespace spc_export::driver {
 
 extern const gsl::span<const uint8_t> driver;
+/// Address where the driver is loaded.
+constexpr uint16_t driverPos = 0x0400;
 constexpr uint16_t mainLoopPos = 0x042E;
 
 extern const gsl::span<const uint8_t, 512> spc_header;
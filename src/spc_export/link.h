@@ -26,7 +26,6 @@ enum class Symbol : uint8_t {
     Channel6,
     Channel7,
     LoopBodies,
-    SampleBank,
     COUNT,
 };
 
@@ -0,0 +1,31 @@
+#pragma once
+
+/// Selects which SIMD instruction sets the audio kernels are compiled for.
+///
+/// exotracker has no runtime CPU dispatch, so this depends on compiler flags.
+/// x86-64 always has SSE2; AVX2 requires building with -mavx2 (or -march=...)
+/// or /arch:AVX2. Kernels must have a scalar fallback
+/// for other architectures (eg. ARM), where neither macro is defined.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SIMD_SSE2
+    #include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+    #define SIMD_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace util::simd {
+
+/// Name of the widest instruction set enabled, for benchmark output.
+#if defined(SIMD_AVX2)
+inline constexpr char const* ISA_NAME = "AVX2";
+#elif defined(SIMD_SSE2)
+inline constexpr char const* ISA_NAME = "SSE2";
+#else
+inline constexpr char const* ISA_NAME = "scalar";
+#endif
+
+}
@@ -0,0 +1,199 @@
+#include "test_utils/golden_audio.h"
+#include "sample_docs.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>  // std::max
+#include <cmath>  // std::abs
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <doctest.h>
+
+using namespace test_utils::golden_audio;
+
+/// Hashes of the first RENDER_NSAMP frames of each sample document's S-DSP output
+/// (identical for all DSP cores).
+///
+/// If a change alters the output on purpose (eg. a driver or sample_docs change),
+/// listen to the new output, then update the hashes printed by the failing test.
+static std::map<std::string, uint64_t> const GOLDEN_HASHES = {
+    {"all-channels", 0x0fa09fadce3dde95},
+    // block-test and instruments are silent, so their hashes (the same as
+    // each other) only check that they stay silent.
+    {"block-test", 0x00c79d81ebc76325},
+    {"dream-fragments", 0x9fe5ac71fb536551},
+    {"instruments", 0x00c79d81ebc76325},
+};
+
+TEST_CASE("Sample documents render the same audio as before") {
+    for (auto const& [name, document] : sample_docs::DOCUMENTS) {
+        CAPTURE(name);
+        auto golden = GOLDEN_HASHES.find(name);
+        // New sample documents must be added to GOLDEN_HASHES.
+        REQUIRE(golden != GOLDEN_HASHES.end());
+
+        for (auto dsp_core : {audio::DspCore::ClockAccurate, audio::DspCore::SoaSimd}) {
+            CAPTURE((int) dsp_core);
+            uint64_t const hash = hash_audio(render_raw(document, dsp_core, RENDER_NSAMP));
+            CAPTURE(fmt::format("{:#018x}", hash));
+            CHECK(hash == golden->second);
+        }
+    }
+}
+
+constexpr uint32_t RESAMPLED_SMP_PER_S = 48000;
+
+/// The resampled test compares every RESAMPLED_STRIDE-th frame,
+/// of the first RESAMPLED_NFRAME frames (around 2 seconds).
+constexpr size_t RESAMPLED_STRIDE = 2999;
+constexpr size_t RESAMPLED_NFRAME = 32 * RESAMPLED_STRIDE;
+
+/// Resampled output frames differ by much less than this between compilers and
+/// instruction sets (eg. summation order in SIMD resamplers), but upsampling,
+/// mixing, or resampling bugs change them by much more.
+constexpr float RESAMPLED_TOLERANCE = 1e-5f;
+
+/// Every RESAMPLED_STRIDE-th stereo frame of each audible sample document
+/// (the silent documents are checked by GOLDEN_HASHES), resampled to
+/// RESAMPLED_SMP_PER_S by each resampler. This covers synthesize_overall()'s
+/// upsampling and mixing, and the resamplers, which the raw S-DSP hashes skip.
+///
+/// Floating-point output isn't bit-exact across platforms, so this compares frames
+/// within RESAMPLED_TOLERANCE rather than hashing them. If a change alters the
+/// output on purpose, update the frames printed by the failing test.
+static std::map<std::string, std::vector<float>> const RESAMPLED_FRAMES = {
+    {"all-channels/polyphase", {
+        0.0000000f, 0.0000000f, 0.1353950f, 0.1353950f,
+        -0.0677950f, -0.0677950f, 0.0482884f, 0.0482884f,
+        0.0979666f, 0.0979666f, -0.1730373f, -0.1730373f,
+        0.0114681f, 0.0114681f, 0.0335971f, 0.0335971f,
+        -0.0859523f, -0.0859523f, -0.1328800f, -0.1328800f,
+        -0.0254862f, -0.0254862f, -0.2602047f, -0.2602047f,
+        -0.0783461f, -0.0783461f, -0.0537669f, -0.0537669f,
+        -0.1299392f, -0.1299392f, -0.0156987f, -0.0156987f,
+        -0.1964149f, -0.1964149f, -0.1027644f, -0.1027644f,
+        -0.1210409f, -0.1210409f, 0.0716715f, 0.0716715f,
+        0.1682787f, 0.1682787f, -0.0691571f, -0.0691571f,
+        -0.0293692f, -0.0293692f, 0.1300559f, 0.1300559f,
+        -0.0192214f, -0.0192214f, -0.2087775f, -0.2087775f,
+        0.0139514f, 0.0139514f, 0.1288695f, 0.1288695f,
+        -0.2102972f, -0.2102972f, -0.0272828f, -0.0272828f,
+        0.0878734f, 0.0878734f, -0.1926320f, -0.1926320f,
+    }},
+    {"all-channels/libsamplerate", {
+        0.0000012f, 0.0000012f, 0.1028125f, 0.1028125f,
+        -0.1042038f, -0.1042038f, 0.1281989f, 0.1281989f,
+        0.0227340f, 0.0227340f, -0.1622086f, -0.1622086f,
+        0.1212306f, 0.1212306f, -0.0766739f, -0.0766739f,
+        -0.0318545f, -0.0318545f, -0.1746363f, -0.1746363f,
+        -0.0701001f, -0.0701001f, -0.1617645f, -0.1617645f,
+        -0.0143689f, -0.0143689f, -0.0344689f, -0.0344689f,
+        -0.2287711f, -0.2287711f, -0.0631183f, -0.0631183f,
+        -0.2219831f, -0.2219831f, -0.1237775f, -0.1237775f,
+        0.0027058f, 0.0027058f, -0.1041448f, -0.1041448f,
+        0.1851227f, 0.1851227f, 0.0385262f, 0.0385262f,
+        -0.2688798f, -0.2688798f, 0.0658781f, 0.0658781f,
+        0.1358751f, 0.1358751f, -0.1620385f, -0.1620385f,
+        -0.0246899f, -0.0246899f, 0.2228419f, 0.2228419f,
+        -0.1076319f, -0.1076319f, -0.1092996f, -0.1092996f,
+        0.0858529f, 0.0858529f, -0.1012183f, -0.1012183f,
+    }},
+    {"dream-fragments/polyphase", {
+        0.0000000f, 0.0000000f, 0.0851422f, 0.0851422f,
+        -0.0992593f, -0.0992593f, 0.0775196f, 0.0775196f,
+        -0.0898173f, -0.0898173f, 0.0700605f, 0.0700605f,
+        -0.0811568f, -0.0811568f, 0.0633084f, 0.0633084f,
+        -0.0726863f, -0.0726863f, 0.0574077f, 0.0574077f,
+        -0.0650003f, -0.0650003f, 0.0515709f, 0.0515709f,
+        -0.0642566f, -0.0642566f, 0.1210871f, 0.1210871f,
+        -0.0178687f, -0.0178687f, -0.1068816f, -0.1068816f,
+        0.0491654f, 0.0491654f, 0.0327263f, 0.0327263f,
+        -0.1410076f, -0.1410076f, -0.0286717f, -0.0286717f,
+        0.0497075f, 0.0497075f, -0.0510378f, -0.0510378f,
+        -0.0305372f, -0.0305372f, 0.0608824f, 0.0608824f,
+        0.0510652f, 0.0510652f, -0.1062720f, -0.1062720f,
+        0.0322350f, 0.0322350f, 0.0131303f, 0.0131303f,
+        -0.0791547f, -0.0791547f, 0.0164090f, 0.0164090f,
+        0.0250423f, 0.0250423f, -0.0525121f, -0.0525121f,
+    }},
+    {"dream-fragments/libsamplerate", {
+        -0.0000002f, -0.0000002f, 0.0265682f, 0.0265682f,
+        -0.0446536f, -0.0446536f, 0.0260643f, 0.0260643f,
+        -0.0418239f, -0.0418239f, 0.0251492f, 0.0251492f,
+        -0.0389741f, -0.0389741f, 0.0240450f, 0.0240450f,
+        -0.0358924f, -0.0358924f, 0.0229385f, 0.0229385f,
+        -0.0329809f, -0.0329809f, 0.0214584f, 0.0214584f,
+        -0.1535602f, -0.1535602f, 0.0367497f, 0.0367497f,
+        0.0617074f, 0.0617074f, -0.1017883f, -0.1017883f,
+        -0.0202116f, -0.0202116f, 0.0969196f, 0.0969196f,
+        -0.1968663f, -0.1968663f, -0.2049329f, -0.2049329f,
+        -0.0723714f, -0.0723714f, -0.1113007f, -0.1113007f,
+        -0.1784868f, -0.1784868f, 0.0173719f, 0.0173719f,
+        0.0474597f, 0.0474597f, -0.1057998f, -0.1057998f,
+        0.0445881f, 0.0445881f, -0.0391386f, -0.0391386f,
+        0.0673110f, 0.0673110f, 0.0151184f, 0.0151184f,
+        0.0958115f, 0.0958115f, 0.0891309f, 0.0891309f,
+    }},
+};
+
+TEST_CASE("Sample documents resample the same audio as before") {
+    using audio::AudioOptions;
+    using audio::ResamplerKind;
+
+    std::pair<char const*, AudioOptions> const resamplers[] = {
+        {"polyphase", AudioOptions{
+            .resampler = ResamplerKind::Polyphase,
+            .polyphase_quality = audio::PolyphaseQuality::Medium,
+        }},
+        {"libsamplerate", AudioOptions{
+            .resampler = ResamplerKind::Libsamplerate,
+            .resampler_quality = SRC_SINC_FASTEST,
+        }},
+    };
+
+    for (char const* name : {"all-channels", "dream-fragments"}) {
+        auto const& document = sample_docs::DOCUMENTS.at(name);
+        for (auto const& [resampler, options] : resamplers) {
+            auto const key = fmt::format("{}/{}", name, resampler);
+            CAPTURE(key);
+
+            auto const audio = render_resampled(
+                document, options, RESAMPLED_SMP_PER_S, RESAMPLED_NFRAME
+            );
+
+            // Otherwise the comparison below verifies nothing.
+            float peak = 0;
+            for (float const smp : audio) {
+                peak = std::max(peak, std::abs(smp));
+            }
+            CHECK(peak > 0.01f);
+
+            std::vector<float> frames;
+            for (size_t i = 0; i < RESAMPLED_NFRAME; i += RESAMPLED_STRIDE) {
+                frames.push_back(audio[2 * i]);
+                frames.push_back(audio[2 * i + 1]);
+            }
+
+            auto golden = RESAMPLED_FRAMES.find(key);
+            bool matches = golden != RESAMPLED_FRAMES.end()
+                && golden->second.size() == frames.size();
+            for (size_t i = 0; matches && i < frames.size(); i++) {
+                matches = std::abs(frames[i] - golden->second[i]) <= RESAMPLED_TOLERANCE;
+            }
+
+            if (!matches) {
+                std::string printed;
+                for (size_t i = 0; i < frames.size(); i++) {
+                    printed += fmt::format(
+                        "{}{:.7f}f,", i % 4 == 0 ? "\n        " : " ", frames[i]
+                    );
+                }
+                fmt::print("    {{\"{}\", {{{}\n    }}}},\n", key, printed);
+            }
+            CHECK(matches);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "audio/synth/music_driver_common.h"
+
+#include <doctest.h>
+
+using namespace audio::synth::music_driver;
+
+TEST_CASE("RegisterWriteQueue returns writes with the time before each write") {
+    RegisterWriteQueue regs;
+    regs.wait_write(10, 0x4C, 0x01);
+    regs.write(0x5C, 0x00);
+    regs.wait(5);
+    regs.wait_write(0x2D, 0xFF);
+
+    CHECK(regs.num_unread() == 3);
+    auto const& stats = regs.tick_stats();
+    CHECK(stats.writes == 3);
+    CHECK(stats.dropped == 0);
+    CHECK(stats.wait_clocks == 10 + 5 + 8);
+
+    auto pop = [&regs](ClockT time_before) {
+        auto * next = regs.peek_mut();
+        REQUIRE(next);
+        CHECK(next->time_before == time_before);
+        next->time_before = 0;
+        return regs.pop();
+    };
+    CHECK(pop(10).address == 0x4C);
+    CHECK(pop(0).address == 0x5C);
+    RegisterWrite last = pop(13);
+    CHECK(last.address == 0x2D);
+    CHECK(last.value == 0xFF);
+    CHECK(regs.peek_mut() == nullptr);
+
+    regs.clear();
+    CHECK(regs.num_unread() == 0);
+    CHECK(regs.tick_stats().writes == 0);
+}
+
+TEST_CASE("RegisterWriteQueue drops and counts writes past its capacity") {
+    constexpr size_t CAPACITY = RegisterWriteQueue::CAPACITY;
+    RegisterWriteQueue regs;
+
+    for (int rep = 0; rep < 2; rep++) {
+        CAPTURE(rep);
+        for (size_t i = 0; i < CAPACITY + 10; i++) {
+            regs.wait_write(1, (Address) i, (Byte) i);
+        }
+
+        CHECK(regs.num_unread() == CAPACITY);
+        CHECK(regs.tick_stats().writes == CAPACITY);
+        CHECK(regs.tick_stats().dropped == 10);
+        // Waits before dropped writes are still counted.
+        CHECK(regs.tick_stats().wait_clocks == CAPACITY + 10);
+
+        for (size_t i = 0; i < CAPACITY; i++) {
+            auto * next = regs.peek_mut();
+            REQUIRE(next);
+            next->time_before = 0;
+            REQUIRE(regs.pop().value == (Byte) i);
+        }
+        CHECK(regs.peek_mut() == nullptr);
+
+        // The queue can be refilled after clear().
+        regs.clear();
+    }
+}
@@ -0,0 +1,98 @@
+#include "audio/render.h"
+#include "sample_docs.h"
+
+#include <cmath>  // std::abs
+#include <vector>
+
+#include <doctest.h>
+
+using namespace audio::render;
+
+static std::vector<float> render_serial(
+    doc::Document const& document, RenderOptions const& options, RenderStats & stats
+) {
+    std::vector<float> out;
+    stats = render_song(document, options, [&](auto block) {
+        out.insert(out.end(), block.begin(), block.end());
+        return true;
+    });
+    return out;
+}
+
+static std::vector<float> render_parallel(
+    doc::Document const& document,
+    RenderOptions const& options,
+    ParallelOptions const& parallel,
+    RenderStats & stats)
+{
+    std::vector<float> out;
+    stats = render_song_parallel(document, options, parallel, [&](auto block) {
+        out.insert(out.end(), block.begin(), block.end());
+        return true;
+    });
+    return out;
+}
+
+TEST_CASE("render_song() stops when the song loops") {
+    auto const& document = sample_docs::DOCUMENTS.at("block-test");
+
+    RenderOptions options{.smp_per_s = 32000};
+    RenderStats once;
+    auto audio = render_serial(document, options, once);
+
+    CHECK(once.song_ended);
+    CHECK(once.nframes > 0);
+    CHECK(audio.size() == once.nframes * 2);
+
+    options.loop_count = 2;
+    RenderStats twice;
+    render_serial(document, options, twice);
+
+    CHECK(twice.song_ended);
+    // The second loop can end up to a timer period later,
+    // since the sequencer phase doesn't reset when looping.
+    double once_frames = double(once.nframes);
+    CHECK(std::abs(double(twice.nframes) - 2. * once_frames) < 0.01 * once_frames);
+
+    options.max_seconds = 0.5;
+    RenderStats truncated;
+    render_serial(document, options, truncated);
+
+    CHECK(!truncated.song_ended);
+    CHECK(truncated.nframes == 16000);
+}
+
+TEST_CASE("Segment-parallel rendering lines up with serial rendering") {
+    auto const& document = sample_docs::DOCUMENTS.at("dream-fragments");
+
+    RenderOptions options{.smp_per_s = 48000, .loop_count = 2};
+    RenderStats serial_stats;
+    auto serial = render_serial(document, options, serial_stats);
+
+    // If every segment pre-rolls from the beginning of the song,
+    // each segment plays exactly what a serial render would.
+    // So the output is bit-exact if segments are spliced in the right places.
+    ParallelOptions parallel{
+        .nthreads = 3,
+        .nsegments = 5,
+        .preroll_seconds = 1000,
+        .crossfade_frames = 0,
+    };
+
+    RenderStats parallel_stats;
+    auto spliced = render_parallel(document, options, parallel, parallel_stats);
+    CHECK(parallel_stats.song_ended);
+    CHECK(parallel_stats.nframes == serial_stats.nframes);
+    CHECK(spliced == serial);
+
+    // Crossfading between identical segments only introduces rounding error.
+    parallel.crossfade_frames = 64;
+    auto crossfaded = render_parallel(document, options, parallel, parallel_stats);
+    REQUIRE(crossfaded.size() == serial.size());
+
+    float max_diff = 0;
+    for (size_t i = 0; i < serial.size(); i++) {
+        max_diff = std::max(max_diff, std::abs(crossfaded[i] - serial[i]));
+    }
+    CHECK(max_diff < 1e-6f);
+}
@@ -1,6 +1,11 @@
+#define sequencer_INTERNAL public  // Inspect ChannelSequencer::_events_this_tick.
+
 #include "audio/synth.h"
 #include "audio/synth/chip_instance_common.h"
+#include "audio/synth/spc700.h"
 #include "audio/synth/spc700_driver.h"
+#include "audio/synth/soa_dsp.h"
+#include "audio/synth/sequencer.h"
 #include "doc.h"
 #include "chip_kinds.h"
 #include "cmd_queue.h"
@@ -8,14 +13,18 @@
 #include "doc_util/sample_instrs.h"
 #include "doc_util/event_builder.h"
 #include "edit/edit_sample_list.h"
+#include "sample_docs.h"
 #include "test_utils/parameterize.h"
 
 #include <fmt/core.h>
+#include <snes9x-dsp/SPC_DSP.h>
 
 #include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <random>
 #include <string>
 #include <vector>
 #include <utility>  // std::move
@@ -92,8 +101,8 @@ static doc::Document one_note_document(MaybeChannelID which_channel, doc::Note p
 using audio::Amplitude;
 using audio::AudioOptions;
 using audio::ClockT;
-using cmd_queue::AudioCommand;
 using cmd_queue::CommandQueue;
+using cmd_queue::CommandReceiver;
 
 /// The majority of the entire exotracker test suite was not spent in driver logic
 /// or S-DSP emulation, but in libsamplerate's sinc interpolation.
@@ -101,6 +110,7 @@ using cmd_queue::CommandQueue;
 /// And ZOH has the useful property that it preserves the exact amplitudes
 /// coming from the S-DSP.
 constexpr AudioOptions FAST_RESAMPLER = {
+    .resampler = audio::ResamplerKind::Libsamplerate,
     .resampler_quality = SRC_ZERO_ORDER_HOLD,
 };
 
@@ -117,7 +127,7 @@ static std::vector<Amplitude> run_new_synth(
     doc::Document const & document,
     uint32_t smp_per_s,
     NsampT nsamp,
-    AudioCommand * stub_command)
+    CommandReceiver commands)
 {
     using audio::synth::STEREO_NCHAN;
 
@@ -125,7 +135,7 @@ static std::vector<Amplitude> run_new_synth(
     CAPTURE(nsamp);
 
     audio::synth::OverallSynth synth{
-        STEREO_NCHAN, smp_per_s, document.clone(), stub_command, FAST_RESAMPLER
+        STEREO_NCHAN, smp_per_s, document.clone(), commands, FAST_RESAMPLER
     };
 
     std::vector<Amplitude> buffer;
@@ -175,7 +185,7 @@ TEST_CASE("Test that not beginning playback produces silence") {
     CommandQueue no_command;
 
     std::vector<Amplitude> buffer = run_new_synth(
-        document, 48000, 4 * 1024, no_command.begin()
+        document, 48000, 4 * 1024, no_command.receiver()
     );
     for (size_t idx = 0; idx < buffer.size(); idx++) {
         Amplitude y = buffer[idx];
@@ -196,7 +206,7 @@ TEST_CASE("Test that playing empty documents produces silence") {
     CommandQueue play_commands = play_from_begin();
 
     std::vector<Amplitude> buffer = run_new_synth(
-        document, 48000, 4 * 1024, play_commands.begin()
+        document, 48000, 4 * 1024, play_commands.receiver()
     );
     for (size_t idx = 0; idx < buffer.size(); idx++) {
         Amplitude y = buffer[idx];
@@ -223,19 +233,78 @@ TEST_CASE("Test that notes produce sound") {
         auto driver = Spc700Driver(document.frequency_table);
 
         std::vector<Amplitude> buffer = run_new_synth(
-            document, 48000, 4 * 1024, play_commands.begin()
+            document, 48000, 4 * 1024, play_commands.receiver()
         );
         constexpr Amplitude THRESHOLD = 0.04f;
         check_signed_amplitude(buffer, THRESHOLD);
     }
 }
 
+/// Runs a new synth for nframe frames, split into calls of at most block_size frames.
+static std::vector<Amplitude> run_synth_blocked(
+    doc::Document const & document,
+    uint32_t smp_per_s,
+    AudioOptions const& options,
+    size_t nframe,
+    size_t block_size)
+{
+    using audio::synth::STEREO_NCHAN;
+
+    CommandQueue play_commands = play_from_begin();
+    audio::synth::OverallSynth synth{
+        STEREO_NCHAN, smp_per_s, document.clone(), play_commands.receiver(), options
+    };
+
+    std::vector<Amplitude> out(nframe * STEREO_NCHAN);
+    for (size_t begin = 0; begin < nframe; begin += block_size) {
+        size_t const block = std::min(block_size, nframe - begin);
+        synth.synthesize_overall(
+            gsl::span(out).subspan(begin * STEREO_NCHAN, block * STEREO_NCHAN), block
+        );
+    }
+    return out;
+}
+
+TEST_CASE("Test that output is independent of sampling rate and block size") {
+    // Every output setting the GUI allows (audio::latency) must work,
+    // and chopping the output into blocks must not change the audio.
+    doc::Document document{one_note_document(Spc700ChannelID::Channel1, 60)};
+
+    AudioOptions const all_options[] = {
+        {.resampler = audio::ResamplerKind::Polyphase},
+        FAST_RESAMPLER,
+    };
+    uint32_t const rates[] = {8000, 32000, 44100, 48000, 96000, 192000};
+    size_t const block_sizes[] = {32, 333, 512, 4096};
+
+    for (auto const& options : all_options) {
+        for (uint32_t smp_per_s : rates) {
+            CAPTURE((int) options.resampler);
+            CAPTURE(smp_per_s);
+
+            // 1/8 of a second. Longer than the largest block at low rates.
+            size_t const nframe = smp_per_s / 8;
+            auto const expected =
+                run_synth_blocked(document, smp_per_s, options, nframe, nframe);
+
+            Amplitude peak = *std::max_element(expected.begin(), expected.end());
+            CHECK(peak > 0.04f);
+
+            for (size_t block_size : block_sizes) {
+                CAPTURE(block_size);
+                auto const actual = run_synth_blocked(
+                    document, smp_per_s, options, nframe, block_size
+                );
+                CHECK(actual == expected);
+            }
+        }
+    }
+}
+
 TEST_CASE("Send random values into AudioInstance and look for assertion errors") {
 
     doc::Note note{60};
     doc::Document document{one_note_document(Spc700ChannelID::Channel1, note)};
-    CommandQueue play_commands = play_from_begin();
-
     auto driver = Spc700Driver(document.frequency_table);
 
 #define INCREASE(x)  x = (x) * 3 / 2 + 3
@@ -244,26 +313,27 @@ TEST_CASE("Send random values into AudioInstance and look for assertion errors")
     // libsamplerate, but let's keep 1000 Hz as a minimum sample rate to test.
     for (uint32_t smp_per_s = 1000; smp_per_s <= 250'000; INCREASE(smp_per_s)) {
         // smp_per_s * 0.25 second
-        run_new_synth(document, smp_per_s, smp_per_s / 4, play_commands.begin());
+        run_new_synth(
+            document, smp_per_s, smp_per_s / 4, play_from_begin().receiver()
+        );
     }
 
     // 44100Hz, zero samples
-    run_new_synth(document, 44100, 0, play_commands.begin());
+    run_new_synth(document, 44100, 0, play_from_begin().receiver());
 
     // 48000Hz, various durations
     for (uint32_t nsamp = 1; nsamp <= 100'000; INCREASE(nsamp)) {
-        run_new_synth(document, 48000, nsamp, play_commands.begin());
+        run_new_synth(document, 48000, nsamp, play_from_begin().receiver());
     }
 }
 
 TEST_CASE("Send all note pitches into AudioInstance and look for assertion errors") {
     // 32000Hz, 4000 samples, various note pitches.
-    CommandQueue play_commands = play_from_begin();
     for (doc::Chromatic pitch = 0; pitch < doc::CHROMATIC_COUNT; pitch++) {
         doc::Document document{
             one_note_document(Spc700ChannelID::Channel1, {pitch})
         };
-        run_new_synth(document, 32000, 1000, play_commands.begin());
+        run_new_synth(document, 32000, 1000, play_from_begin().receiver());
     }
 }
 
@@ -282,7 +352,7 @@ TEST_CASE("Ensure that restarting playback produces the same output range") {
         STEREO_NCHAN,
         SAMPLES_PER_S_IDEAL,
         one_note_document(Spc700ChannelID::Channel1, {60}),
-        play_commands.begin(),
+        play_commands.receiver(),
         FAST_RESAMPLER);
 
     constexpr size_t NSAMP = 1000;
@@ -319,7 +389,7 @@ TEST_CASE("Ensure that stopping playback works") {
         STEREO_NCHAN,
         SAMPLES_PER_S_IDEAL,
         one_note_document(Spc700ChannelID::Channel1, {60}),
-        play_commands.begin(),
+        play_commands.receiver(),
         FAST_RESAMPLER);
 
     constexpr size_t NSAMP = 1000;
@@ -371,7 +441,7 @@ TEST_CASE("Ensure that editing samples mutes playing notes") {
         STEREO_NCHAN,
         SAMPLES_PER_S_IDEAL,
         doc.clone(),
-        play_commands.begin(),
+        play_commands.receiver(),
         FAST_RESAMPLER);
 
     constexpr size_t NSAMP = 1000;
@@ -437,4 +507,507 @@ TEST_CASE("Ensure that editing samples mutes playing notes") {
     }
 }
 
+TEST_CASE("Ensure that rewriting a playing sample silences its voice immediately") {
+    using audio::synth::STEREO_NCHAN;
+
+    Spc700ChannelID which_channel;
+    PICK(all_channels(which_channel));
+
+    // Create a document where instrument 0 uses sample 1.
+    auto doc = sample_idx_document(which_channel, 1);
+    doc.samples[0] = long_silence();
+    doc.samples[1] = pulse_50();
+
+    // Play the same document in two synths, but only replace sample 1 in `edited`.
+    CommandQueue /*mut*/ orig_commands;
+    CommandQueue /*mut*/ edited_commands;
+    auto orig = audio::synth::OverallSynth(
+        STEREO_NCHAN,
+        SAMPLES_PER_S_IDEAL,
+        doc.clone(),
+        orig_commands.receiver(),
+        FAST_RESAMPLER);
+    auto edited = audio::synth::OverallSynth(
+        STEREO_NCHAN,
+        SAMPLES_PER_S_IDEAL,
+        doc.clone(),
+        edited_commands.receiver(),
+        FAST_RESAMPLER);
+
+    constexpr size_t NSAMP = 1000;
+    auto orig_buffer = std::vector<Amplitude>(NSAMP * STEREO_NCHAN);
+    auto edited_buffer = std::vector<Amplitude>(NSAMP * STEREO_NCHAN);
+
+    orig_commands.push(cmd_queue::PlayFrom{0});
+    edited_commands.push(cmd_queue::PlayFrom{0});
+    orig.synthesize_overall(orig_buffer, NSAMP);
+    edited.synthesize_overall(edited_buffer, NSAMP);
+    REQUIRE(orig_buffer == edited_buffer);
+
+    {
+        auto command = replace_sample(doc, 1, pulse_50_quiet());
+        edited_commands.push(command->clone_for_audio(doc));
+        command->apply_swap(doc);
+    }
+
+    // The sample is rewritten on a later tick. Afterwards, the voice must not
+    // play its release envelope over whatever was written to the sample's address.
+    auto edited_end = edited_buffer.end();
+    for (int i = 0; i < 10 && edited_end == edited_buffer.end(); i++) {
+        orig.synthesize_overall(orig_buffer, NSAMP);
+        edited.synthesize_overall(edited_buffer, NSAMP);
+        edited_end = std::mismatch(
+            orig_buffer.begin(), orig_buffer.end(), edited_buffer.begin()
+        ).second;
+    }
+    REQUIRE(edited_end != edited_buffer.end());
+
+    // Allow a few samples for the S-DSP's pipeline to apply the volume write.
+    constexpr ptrdiff_t LATENCY = 4 * STEREO_NCHAN;
+    REQUIRE(edited_buffer.end() - edited_end > LATENCY);
+    for (auto it = edited_end + LATENCY; it != edited_buffer.end(); ++it) {
+        CAPTURE(it - edited_buffer.begin());
+        REQUIRE(*it == 0);
+    }
+}
+
+TEST_CASE("Ensure that editing other samples doesn't mute playing notes") {
+    using audio::synth::STEREO_NCHAN;
+
+    Spc700ChannelID which_channel;
+    PICK(all_channels(which_channel));
+
+    CommandQueue /*mut*/ play_commands;
+
+    // Create a document where instrument 0 uses sample 1.
+    auto doc = sample_idx_document(which_channel, 1);
+    doc.samples[0] = long_silence();
+    doc.samples[1] = pulse_50();
+
+    auto synth = audio::synth::OverallSynth(
+        STEREO_NCHAN,
+        SAMPLES_PER_S_IDEAL,
+        doc.clone(),
+        play_commands.receiver(),
+        FAST_RESAMPLER);
+
+    constexpr size_t NSAMP = 1000;
+
+    Amplitude orig_min, orig_max;
+    auto buffer = std::vector<Amplitude>(NSAMP * STEREO_NCHAN);
+    {
+        // Play audio from start.
+        play_commands.push(cmd_queue::PlayFrom{0});
+        synth.synthesize_overall(buffer, NSAMP);
+
+        orig_min = *std::min_element(buffer.begin(), buffer.end());
+        orig_max = *std::max_element(buffer.begin(), buffer.end());
+        CHECK(orig_min < 0);
+        CHECK(orig_max > 0);
+    }
+
+    // Replace sample 0 (not playing) with a sample of a different size.
+    {
+        auto command = replace_sample(doc, 0, pulse_50_quiet());
+        play_commands.push(command->clone_for_audio(doc));
+        command->apply_swap(doc);
+    }
+
+    {
+        // Sample 1 is still loaded at the same address, so the note keeps playing.
+        synth.synthesize_overall(buffer, NSAMP);
+        synth.synthesize_overall(buffer, NSAMP);
+
+        Amplitude min = *std::min_element(buffer.begin(), buffer.end());
+        Amplitude max = *std::max_element(buffer.begin(), buffer.end());
+        CHECK(min == orig_min);
+        CHECK(max == orig_max);
+    }
+}
+
 // TODO add RapidCheck for randomized testing?
+
+
+// # Test that SoaDsp produces the same output as SPC_DSP.
+
+using audio::synth::soa_dsp::SoaDsp;
+
+TEST_CASE("Synthesizing chips on worker threads produces identical output") {
+    using audio::synth::STEREO_NCHAN;
+
+    constexpr NsampT NSAMP = 2 * SAMPLES_PER_S_IDEAL;
+
+    // Play the same song on 3 chips.
+    doc::Document document = sample_docs::DOCUMENTS.at("dream-fragments").clone();
+    document.chips = {ChipKind::Spc700, ChipKind::Spc700, ChipKind::Spc700};
+    document.sequence = {document.sequence[0], document.sequence[0], document.sequence[0]};
+    document.update_extent();
+
+    auto render = [&document](uint32_t chip_threads) {
+        AudioOptions options = FAST_RESAMPLER;
+        options.chip_threads = chip_threads;
+
+        auto commands = play_from_begin();
+        audio::synth::OverallSynth synth{
+            STEREO_NCHAN,
+            SAMPLES_PER_S_IDEAL,
+            document.clone(),
+            commands.receiver(),
+            options,
+        };
+
+        std::vector<Amplitude> buffer(NSAMP * STEREO_NCHAN);
+        synth.synthesize_overall(/*mut*/ buffer, NSAMP);
+        return buffer;
+    };
+
+    auto const serial = render(1);
+    auto const parallel = render(3);
+
+    CHECK(*std::max_element(serial.begin(), serial.end()) > 0);
+    CHECK(serial == parallel);
+}
+
+TEST_CASE("Seeking recalls channel state as if the song played from the beginning") {
+    using audio::synth::STEREO_NCHAN;
+    using audio::synth::OverallSynth;
+
+    constexpr NsampT NSAMP_SONG = 8 * SAMPLES_PER_S_IDEAL;
+    constexpr NsampT NSAMP_SEEK = SAMPLES_PER_S_IDEAL / 2;
+
+    doc::Document const& document = sample_docs::DOCUMENTS.at("dream-fragments");
+    auto const& options = document.sequencer_options;
+    // Seek past the first checkpoint, but not onto a measure boundary,
+    // while a note is playing.
+    doc::TickT const seek_time =
+        options.ticks_per_beat * options.beats_per_measure + options.ticks_per_beat / 2;
+    REQUIRE(seek_time < document.extent.song_length);
+
+    for (auto dsp_core : {audio::DspCore::ClockAccurate, audio::DspCore::SoaSimd}) {
+        CAPTURE((int) dsp_core);
+        AudioOptions audio_options = FAST_RESAMPLER;
+        audio_options.dsp_core = dsp_core;
+        audio_options.realtime_seek = false;
+
+        auto new_synth = [&](CommandQueue & commands) {
+            return std::make_unique<OverallSynth>(
+                STEREO_NCHAN,
+                SAMPLES_PER_S_IDEAL,
+                document.clone(),
+                commands.receiver(),
+                audio_options);
+        };
+        // The resampler's first output frame after a seek depends on
+        // the previous input, so skip it.
+        auto run = [](OverallSynth & synth, NsampT nsamp) {
+            std::vector<Amplitude> buffer(nsamp * STEREO_NCHAN);
+            synth.synthesize_overall(/*mut*/ buffer, nsamp);
+            buffer.erase(buffer.begin(), buffer.begin() + STEREO_NCHAN);
+            return buffer;
+        };
+
+        // Play the song from the beginning, saving checkpoints along the way.
+        auto commands = play_from_begin();
+        auto synth = new_synth(commands);
+        auto const song = run(*synth, NSAMP_SONG);
+
+        // Seek without checkpoints, fast-forwarding from the beginning.
+        CommandQueue cold_commands;
+        cold_commands.push(cmd_queue::PlayFrom{seek_time});
+        auto cold_synth = new_synth(cold_commands);
+        auto const cold = run(*cold_synth, NSAMP_SEEK);
+        CHECK(cold.front() != 0);
+
+        // The output should continue the notes playing at the seek point,
+        // matching the song.
+        auto found = std::search(song.begin(), song.end(), cold.begin(), cold.end());
+        CHECK(found != song.end());
+
+        // Seek again in the synth which played the song,
+        // fast-forwarding from a checkpoint.
+        commands.push(cmd_queue::PlayFrom{seek_time});
+        auto const warm = run(*synth, NSAMP_SEEK);
+        CHECK(warm == cold);
+    }
+}
+
+TEST_CASE("Silent fast-forward writes the same registers as running the S-DSP") {
+    using namespace audio::synth;
+    using audio::tempo_calc::CLOCKS_PER_SAMPLE;
+
+    // 2 ms per tick.
+    constexpr ClockT NCLK = CLOCKS_PER_SAMPLE * 64;
+    constexpr int NTICK = 2000;
+
+    doc::Document const& document = sample_docs::DOCUMENTS.at("dream-fragments");
+    auto emulated = spc700::make_Spc700Instance(0, document.frequency_table);
+    auto silent = spc700::make_Spc700Instance(0, document.frequency_table);
+    for (auto * chip : {emulated.get(), silent.get()}) {
+        chip->reset_state(document);
+        chip->seek(document, 0);
+    }
+
+    std::vector<SpcAmplitude> buffer(NCLK / CLOCKS_PER_SAMPLE * STEREO_NCHAN);
+    for (int tick = 0; tick < NTICK; tick++) {
+        CAPTURE(tick);
+        (void) emulated->tick_sequencer(document);
+        (void) emulated->run_chip_for(NCLK, buffer);
+        auto const emulated_stats = emulated->flush_register_writes();
+
+        (void) silent->tick_sequencer(document);
+        silent->run_chip_silent();
+        auto const silent_stats = silent->flush_register_writes();
+
+        REQUIRE(silent_stats.writes == emulated_stats.writes);
+        REQUIRE(silent->shadow_regs() == emulated->shadow_regs());
+        REQUIRE(silent->next_tick_time() == emulated->next_tick_time());
+    }
+}
+
+TEST_CASE("Saving a sequencer checkpoint after an event tick doesn't allocate") {
+    using audio::synth::sequencer::ChannelSequencer;
+    using Events = std::vector<doc::RowEvent>;
+
+    doc::Document const& document = sample_docs::DOCUMENTS.at("dream-fragments");
+    ChannelSequencer seq;
+    seq.set_chip_chan(0, 0);
+    seq.seek(document, 0);
+
+    // Like ChipInstance::new_snapshot(), before any events have played.
+    ChannelSequencer checkpoint = seq;
+    auto const* checkpoint_events = checkpoint._events_this_tick.data();
+    auto const checkpoint_capacity = checkpoint._events_this_tick.capacity();
+
+    // Like ChipInstance::save_snapshot(), right after a tick with events.
+    bool played_event = false;
+    for (int i = 0; i < 1000 && !played_event; i++) {
+        auto [t, ev] = seq.next_tick(document);
+        played_event = !ev.empty();
+    }
+    REQUIRE(played_event);
+    seq.save_to(checkpoint);
+    CHECK(checkpoint._events_this_tick.empty());
+    CHECK(checkpoint._events_this_tick.data() == checkpoint_events);
+    CHECK(checkpoint._events_this_tick.capacity() == checkpoint_capacity);
+
+    std::vector<Events> played;
+    for (int i = 0; i < 200; i++) {
+        auto [t, ev] = seq.next_tick(document);
+        played.emplace_back(ev.begin(), ev.end());
+    }
+
+    // Loading the checkpoint resumes playback after the event tick.
+    seq.load_from(checkpoint);
+    CHECK(seq._events_this_tick.empty());
+    for (Events const& expected : played) {
+        auto [t, ev] = seq.next_tick(document);
+        CHECK(Events(ev.begin(), ev.end()) == expected);
+    }
+}
+
+TEST_CASE("SoaDsp is bit-exact with SPC_DSP on random registers and ARAM") {
+    // Random BRR data and register values exercise noise, pitch modulation,
+    // all envelope modes, and the echo buffer overwriting sample data.
+    constexpr size_t RAM_SIZE = 0x1'0000;
+    constexpr int NSAMP = 20000;
+
+    std::mt19937 rng{1};
+    auto rand_byte = [&]() {
+        return (uint8_t) (rng() & 0xFF);
+    };
+
+    std::vector<uint8_t> accurate_ram(RAM_SIZE);
+    for (auto & byte : accurate_ram) {
+        byte = rand_byte();
+    }
+    std::vector<uint8_t> soa_ram = accurate_ram;
+
+    auto accurate = std::make_unique<SPC_DSP>();
+    accurate->init(accurate_ram.data());
+    auto soa = std::make_unique<SoaDsp>();
+    soa->init(soa_ram.data());
+
+    auto write = [&](int addr, int value) {
+        accurate->write(addr, value);
+        soa->write(addr, value);
+    };
+    // Turn off FLG's soft reset (which silences all voices),
+    // and key on all voices.
+    write(SPC_DSP::r_flg, 0x00);
+    write(SPC_DSP::r_kon, 0xFF);
+
+    std::vector<int16_t> accurate_out(8);
+    std::vector<int16_t> soa_out(8);
+
+    int nsamp = 0;
+    while (nsamp < NSAMP) {
+        CAPTURE(nsamp);
+
+        // Registers may only be written at sample boundaries.
+        for (uint32_t i = rng() % 4; i--; ) {
+            int const addr = (int) (rng() % SPC_DSP::register_count);
+            uint8_t value = rand_byte();
+            if (addr == SPC_DSP::r_flg && rng() % 8) {
+                value &= 0x7F;
+            }
+            write(addr, value);
+        }
+
+        int const step = 1 + (int) (rng() % 4);
+        accurate->set_output(accurate_out.data(), accurate_out.size());
+        soa->set_output(soa_out.data(), soa_out.size());
+        accurate->run(step * 32);
+        soa->run(step * 32);
+        nsamp += step;
+
+        REQUIRE(accurate->out_pos() - accurate_out.data() == step * 2);
+        REQUIRE(soa->out_pos() - soa_out.data() == step * 2);
+        REQUIRE(accurate_out == soa_out);
+        for (int addr = 0; addr < SPC_DSP::register_count; addr++) {
+            CAPTURE(addr);
+            REQUIRE(accurate->read(addr) == soa->read(addr));
+        }
+    }
+
+    CHECK(accurate_ram == soa_ram);
+}
+
+TEST_CASE("SoaDsp is bit-exact with SPC_DSP when voices go silent") {
+    // Repeatedly key voices on and off, so SoaDsp switches between running voices
+    // and its idle path (which skips BRR decoding, but must still update ENDX),
+    // and the echo buffer fills and drains.
+    constexpr size_t RAM_SIZE = 0x1'0000;
+    constexpr int NROUND = 16;
+
+    std::mt19937 rng{2};
+    auto rand_byte = [&]() {
+        return (uint8_t) (rng() & 0xFF);
+    };
+
+    std::vector<uint8_t> accurate_ram(RAM_SIZE);
+    for (auto & byte : accurate_ram) {
+        byte = rand_byte();
+    }
+    std::vector<uint8_t> soa_ram = accurate_ram;
+
+    auto accurate = std::make_unique<SPC_DSP>();
+    accurate->init(accurate_ram.data());
+    auto soa = std::make_unique<SoaDsp>();
+    soa->init(soa_ram.data());
+
+    auto write = [&](int addr, int value) {
+        accurate->write(addr, value);
+        soa->write(addr, value);
+    };
+
+    std::vector<int16_t> accurate_out(2);
+    std::vector<int16_t> soa_out(2);
+    int nidle = 0;
+
+    auto run = [&](int nsamp) {
+        for (int i = 0; i < nsamp; i++) {
+            CAPTURE(i);
+            nidle += soa->voices_idle();
+
+            accurate->set_output(accurate_out.data(), accurate_out.size());
+            soa->set_output(soa_out.data(), soa_out.size());
+            accurate->run(32);
+            soa->run(32);
+
+            REQUIRE(accurate_out == soa_out);
+            for (int addr = 0; addr < SPC_DSP::register_count; addr++) {
+                CAPTURE(addr);
+                REQUIRE(accurate->read(addr) == soa->read(addr));
+            }
+        }
+    };
+
+    for (int round = 0; round < NROUND; round++) {
+        CAPTURE(round);
+
+        // Randomize voices and echo, but keep the echo buffer short
+        // so it drains quickly.
+        for (int v = 0; v < 8; v++) {
+            for (int reg = 0; reg < 8; reg++) {
+                write(v * 0x10 + reg, rand_byte());
+            }
+            // Use ADSR, so KOFF releases the voice.
+            write(v * 0x10 + SPC_DSP::v_adsr0, rand_byte() | 0x80);
+            write(SPC_DSP::r_fir + v * 0x10, rand_byte());
+        }
+        write(SPC_DSP::r_efb, rand_byte());
+        write(SPC_DSP::r_evoll, rand_byte());
+        write(SPC_DSP::r_evolr, rand_byte());
+        write(SPC_DSP::r_eon, rand_byte());
+        write(SPC_DSP::r_pmon, rand_byte());
+        write(SPC_DSP::r_esa, rand_byte());
+        write(SPC_DSP::r_edl, (int) (rng() % 3));
+        // Enable echo writes most of the time, and randomize noise frequency.
+        write(SPC_DSP::r_flg, (rng() % 4 ? 0x00 : 0x20) | (rand_byte() & 0x1F));
+
+        write(SPC_DSP::r_koff, 0x00);
+        write(SPC_DSP::r_kon, rand_byte());
+        run(1000);
+
+        // Release all voices and stop echo feedback, so echo drains to silence.
+        write(SPC_DSP::r_kon, 0x00);
+        write(SPC_DSP::r_koff, 0xFF);
+        run(500);
+        write(SPC_DSP::r_efb, 0x00);
+        run(1000);
+
+        // Silent voices still set ENDX when they reach the end of a sample.
+        write(SPC_DSP::r_endx, 0);
+        run(1000);
+    }
+
+    CHECK(accurate_ram == soa_ram);
+    CHECK(nidle > 0);
+}
+
+TEST_CASE("SoaDsp is bit-exact with SPC_DSP when playing sample documents") {
+    using audio::synth::STEREO_NCHAN;
+    using audio::DspCore;
+
+    // Render 4 seconds of each document.
+    constexpr NsampT NSAMP = 4 * SAMPLES_PER_S_IDEAL;
+
+    // Some documents have no samples, and are silent.
+    int naudible = 0;
+
+    for (auto const& [name, document] : sample_docs::DOCUMENTS) {
+        CAPTURE(name);
+
+        auto render = [&document](DspCore dsp_core) {
+            AudioOptions options = FAST_RESAMPLER;
+            options.dsp_core = dsp_core;
+
+            auto commands = play_from_begin();
+            audio::synth::OverallSynth synth{
+                STEREO_NCHAN,
+                SAMPLES_PER_S_IDEAL,
+                document.clone(),
+                commands.receiver(),
+                options,
+            };
+
+            std::vector<Amplitude> buffer(NSAMP * STEREO_NCHAN);
+            synth.synthesize_overall(/*mut*/ buffer, NSAMP);
+            return buffer;
+        };
+
+        auto const accurate = render(DspCore::ClockAccurate);
+        auto const soa = render(DspCore::SoaSimd);
+
+        if (*std::max_element(accurate.begin(), accurate.end()) > 0) {
+            naudible++;
+        }
+
+        // On failure, print the first differing sample.
+        auto const [accurate_diff, soa_diff] =
+            std::mismatch(accurate.begin(), accurate.end(), soa.begin());
+        CHECK(accurate_diff - accurate.begin() == (ptrdiff_t) accurate.size());
+    }
+
+    CHECK(naudible > 0);
+}
@@ -0,0 +1,242 @@
+#include "bench_util.h"
+#include "audio/synth/echo_fir.h"
+#include "audio/synth/soa_dsp.h"
+#include "sample_docs.h"
+#include "util/release_assert.h"
+
+#include <snes9x-dsp/SPC_DSP.h>
+
+#include <algorithm>  // std::copy
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <doctest.h>
+
+using namespace audio::synth::echo_fir;
+using audio::synth::soa_dsp::SoaDsp;
+
+TEST_CASE("Benchmark echo FIR") {
+    constexpr size_t NSAMP = 4096;
+
+    std::minstd_rand rng{1};
+    std::uniform_int_distribution<int> sample_dist{-0x4000, 0x3fff};
+    std::uniform_int_distribution<int> coef_dist{-0x80, 0x7f};
+
+    std::vector<int16_t> input(NSAMP * 2);
+    for (auto & smp : input) {
+        smp = (int16_t) sample_dist(rng);
+    }
+    int8_t coefs[NTAP];
+    for (auto & coef : coefs) {
+        coef = (int8_t) coef_dist(rng);
+    }
+
+    std::vector<StereoInt> scalar(NSAMP);
+    std::vector<StereoInt> simd(NSAMP);
+
+    auto run = [&](auto fir, std::vector<StereoInt> & out) {
+        EchoHistory left, right;
+        for (size_t i = 0; i < NSAMP; i++) {
+            out[i] = fir(left, right, {input[i * 2], input[i * 2 + 1]}, coefs);
+        }
+        bench::do_not_optimize(out.data());
+    };
+    auto run_scalar = [&] { run(echo_fir_scalar, scalar); };
+    auto run_simd = [&] { run(echo_fir, simd); };
+
+    fmt::print("Echo FIR (both channels), {} samples:\n", NSAMP);
+    bench::print_result("scalar", bench::time_per_call(run_scalar), NSAMP, "sample");
+    bench::print_result(
+        fmt::format("{}", echo_fir_isa()).c_str(),
+        bench::time_per_call(run_simd),
+        NSAMP,
+        "sample");
+
+    CHECK(simd == scalar);
+}
+
+namespace {
+
+/// Samples from a sample document, loaded into ARAM and played on all 8 voices,
+/// optionally with echo (feedback, FIR, and the longest echo buffer).
+struct EchoScene {
+    static constexpr uint8_t DIR_PAGE = 0x02;
+    static constexpr uint8_t ESA_PAGE = 0x80;
+
+    std::vector<uint8_t> ram = std::vector<uint8_t>(0x1'0000);
+    size_t nsample = 0;
+
+    EchoScene() {
+        auto const& document = sample_docs::DOCUMENTS.at("dream-fragments");
+
+        uint32_t addr = 0x400;
+        for (auto const& maybe_sample : document.samples) {
+            if (!maybe_sample || maybe_sample->brr.empty()) {
+                continue;
+            }
+            auto const& brr = maybe_sample->brr;
+            if (addr + brr.size() > ESA_PAGE * 0x100u || nsample >= 0x40) {
+                break;
+            }
+            uint32_t const loop = addr + maybe_sample->loop_byte;
+            uint8_t * entry = &ram[DIR_PAGE * 0x100u + nsample * 4];
+            entry[0] = uint8_t(addr);
+            entry[1] = uint8_t(addr >> 8);
+            entry[2] = uint8_t(loop);
+            entry[3] = uint8_t(loop >> 8);
+
+            std::copy(brr.begin(), brr.end(), ram.begin() + addr);
+            addr += (uint32_t) brr.size();
+            nsample++;
+        }
+        release_assert(nsample > 0);
+    }
+
+    template<typename Dsp>
+    void start(Dsp & dsp, bool echo) const {
+        for (int v = 0; v < 8; v++) {
+            int const base = v * 0x10;
+            dsp.write(base + SPC_DSP::v_voll, 0x30);
+            dsp.write(base + SPC_DSP::v_volr, 0x30);
+            // Spread pitches over about 2 octaves.
+            int const pitch = 0x0800 + v * 0x180;
+            dsp.write(base + SPC_DSP::v_pitchl, pitch & 0xff);
+            dsp.write(base + SPC_DSP::v_pitchh, pitch >> 8);
+            dsp.write(base + SPC_DSP::v_srcn, int(size_t(v) % nsample));
+            dsp.write(base + SPC_DSP::v_adsr0, 0x8F);
+            dsp.write(base + SPC_DSP::v_adsr1, 0xF0);
+        }
+        dsp.write(SPC_DSP::r_mvoll, 0x60);
+        dsp.write(SPC_DSP::r_mvolr, 0x60);
+        dsp.write(SPC_DSP::r_dir, DIR_PAGE);
+
+        int8_t const fir[8] = {0x0c, 0x21, 0x2b, 0x2b, 0x13, -2, -13, -4};
+        for (int i = 0; i < 8; i++) {
+            dsp.write(SPC_DSP::r_fir + i * 0x10, echo ? (uint8_t) fir[i] : 0);
+        }
+        dsp.write(SPC_DSP::r_evoll, echo ? 0x40 : 0);
+        dsp.write(SPC_DSP::r_evolr, echo ? 0x40 : 0);
+        dsp.write(SPC_DSP::r_efb, echo ? 0x50 : 0);
+        dsp.write(SPC_DSP::r_eon, echo ? 0xFF : 0);
+        dsp.write(SPC_DSP::r_esa, ESA_PAGE);
+        dsp.write(SPC_DSP::r_edl, echo ? 0x0F : 0);
+        // Enable echo writes (bit 5) if echo is on, and unmute.
+        dsp.write(SPC_DSP::r_flg, echo ? 0x00 : 0x20);
+
+        dsp.write(SPC_DSP::r_koff, 0x00);
+        dsp.write(SPC_DSP::r_kon, 0xFF);
+    }
+};
+
+}
+
+TEST_CASE("Benchmark S-DSP cores with echo") {
+    // 1 second of audio per call.
+    constexpr int NSAMP = 32000;
+    constexpr double SAMPLE_PERIOD = 1. / 32000.;
+
+    EchoScene const scene;
+
+    for (bool echo : {false, true}) {
+        std::vector<uint8_t> accurate_ram = scene.ram;
+        std::vector<uint8_t> soa_ram = scene.ram;
+
+        auto accurate = std::make_unique<SPC_DSP>();
+        accurate->init(accurate_ram.data());
+        scene.start(*accurate, echo);
+
+        auto soa = std::make_unique<SoaDsp>();
+        soa->init(soa_ram.data());
+        scene.start(*soa, echo);
+
+        std::vector<int16_t> accurate_out(NSAMP * 2);
+        std::vector<int16_t> soa_out(NSAMP * 2);
+
+        // Compare the first second of each core's output,
+        // before the timing loops desynchronize the two cores.
+        accurate->set_output(accurate_out.data(), accurate_out.size());
+        accurate->run(NSAMP * 32);
+        soa->set_output(soa_out.data(), soa_out.size());
+        soa->run(NSAMP * 32);
+        CHECK(soa_out == accurate_out);
+        CHECK(accurate_ram == soa_ram);
+
+        auto run_accurate = [&] {
+            accurate->set_output(accurate_out.data(), accurate_out.size());
+            accurate->write(SPC_DSP::r_kon, 0xFF);
+            accurate->run(NSAMP * 32);
+            bench::do_not_optimize(accurate_out.data());
+        };
+        auto run_soa = [&] {
+            soa->set_output(soa_out.data(), soa_out.size());
+            soa->write(SPC_DSP::r_kon, 0xFF);
+            soa->run(NSAMP * 32);
+            bench::do_not_optimize(soa_out.data());
+        };
+
+        fmt::print("S-DSP, 8 voices, echo {}, {} samples:\n", echo ? "on" : "off", NSAMP);
+        auto report = [&](char const* name, auto & fn) {
+            double const seconds = bench::time_per_call(fn);
+            bench::print_result(name, seconds, NSAMP, "sample");
+            fmt::print("  {:<36} {:10.2f} %\n", "  of realtime",
+                seconds / NSAMP / SAMPLE_PERIOD * 100.);
+        };
+        report("SPC_DSP (clock-accurate)", run_accurate);
+        report(
+            fmt::format("SoaDsp (echo FIR {})", echo_fir_isa()).c_str(),
+            run_soa);
+    }
+}
+
+TEST_CASE("Benchmark idle S-DSP cores") {
+    // 1 second of audio per call.
+    constexpr int NSAMP = 32000;
+
+    EchoScene const scene;
+    std::vector<uint8_t> accurate_ram = scene.ram;
+    std::vector<uint8_t> soa_ram = scene.ram;
+
+    auto accurate = std::make_unique<SPC_DSP>();
+    accurate->init(accurate_ram.data());
+    auto soa = std::make_unique<SoaDsp>();
+    soa->init(soa_ram.data());
+
+    std::vector<int16_t> accurate_out(NSAMP * 2);
+    std::vector<int16_t> soa_out(NSAMP * 2);
+
+    auto run_accurate = [&] {
+        accurate->set_output(accurate_out.data(), accurate_out.size());
+        accurate->run(NSAMP * 32);
+        bench::do_not_optimize(accurate_out.data());
+    };
+    auto run_soa = [&] {
+        soa->set_output(soa_out.data(), soa_out.size());
+        soa->run(NSAMP * 32);
+        bench::do_not_optimize(soa_out.data());
+    };
+
+    // Play notes with echo, then release them and let the echo decay.
+    // Released voices keep decoding their looped samples.
+    scene.start(*accurate, true);
+    scene.start(*soa, true);
+    run_accurate();
+    run_soa();
+    for (int reg : {SPC_DSP::r_efb, SPC_DSP::r_kon}) {
+        accurate->write(reg, 0);
+        soa->write(reg, 0);
+    }
+    accurate->write(SPC_DSP::r_koff, 0xFF);
+    soa->write(SPC_DSP::r_koff, 0xFF);
+    run_accurate();
+    run_soa();
+    CHECK(soa->voices_idle());
+    CHECK(soa_out == accurate_out);
+    CHECK(soa_ram == accurate_ram);
+
+    fmt::print("S-DSP, all voices released, echo drained, {} samples:\n", NSAMP);
+    bench::print_result("SPC_DSP (clock-accurate)", bench::time_per_call(run_accurate),
+        NSAMP, "sample");
+    bench::print_result("SoaDsp (idle voices)", bench::time_per_call(run_soa),
+        NSAMP, "sample");
+}
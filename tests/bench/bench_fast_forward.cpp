@@ -0,0 +1,57 @@
+#include "bench_util.h"
+#include "audio/synth/spc700.h"
+#include "audio/tempo_calc.h"
+#include "sample_docs.h"
+
+#include <memory>
+#include <vector>
+
+#include <doctest.h>
+
+using namespace audio::synth;
+using chip_instance::ChipInstance;
+using audio::tempo_calc::CLOCKS_PER_S_IDEAL;
+using audio::tempo_calc::CLOCKS_PER_SAMPLE;
+
+TEST_CASE("Benchmark silent driver fast-forward") {
+    // Run through the whole song once per call.
+    auto const& document = sample_docs::DOCUMENTS.at("dream-fragments");
+    auto const& options = document.sequencer_options;
+    doc::TickT const ntick = document.extent.song_length;
+
+    // Clocks per tick at the song's tempo.
+    auto const nclk = ClockT(
+        double(CLOCKS_PER_S_IDEAL) * 60. / (options.target_tempo * options.ticks_per_beat)
+    );
+    std::vector<SpcAmplitude> buffer(size_t(nclk / CLOCKS_PER_SAMPLE + 1) * STEREO_NCHAN);
+
+    auto run_song = [&](ChipInstance & chip, bool run_synth) {
+        chip.reset_state(document);
+        chip.seek(document, 0);
+        for (doc::TickT tick = 0; tick < ntick; tick++) {
+            (void) chip.tick_sequencer(document);
+            if (run_synth) {
+                (void) chip.run_chip_for(nclk, buffer);
+            } else {
+                chip.run_chip_silent();
+            }
+            (void) chip.flush_register_writes();
+        }
+        bench::do_not_optimize(chip.shadow_regs());
+    };
+
+    auto accurate = spc700::make_Spc700Instance(
+        0, document.frequency_table, audio::DspCore::ClockAccurate
+    );
+    auto soa = spc700::make_Spc700Instance(
+        0, document.frequency_table, audio::DspCore::SoaSimd
+    );
+
+    fmt::print("Fast-forward through dream-fragments, {} ticks:\n", ntick);
+    bench::print_result("run_chip_for (SPC_DSP)",
+        bench::time_per_call([&] { run_song(*accurate, true); }), double(ntick), "tick");
+    bench::print_result("run_chip_for (SoaDsp)",
+        bench::time_per_call([&] { run_song(*soa, true); }), double(ntick), "tick");
+    bench::print_result("run_chip_silent (driver only)",
+        bench::time_per_call([&] { run_song(*accurate, false); }), double(ntick), "tick");
+}
@@ -0,0 +1,120 @@
+#include "bench_util.h"
+#include "test_utils/golden_audio.h"
+#include "audio/synth.h"
+#include "cmd_queue.h"
+#include "sample_docs.h"
+
+#include <fmt/core.h>
+
+#include <algorithm>  // std::min
+#include <cstdlib>  // getenv, atof
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <doctest.h>
+
+using namespace test_utils::golden_audio;
+using audio::synth::OverallSynth;
+using audio::synth::STEREO_NCHAN;
+
+/// If a document renders this much slower than its baseline, the benchmark fails.
+/// Can be overridden by EXOTRACKER_BENCH_THRESHOLD, on machines with noisy timings.
+constexpr double DEFAULT_REGRESSION_THRESHOLD = 0.2;
+
+/// Reads "name seconds" lines written by write_baseline().
+static std::map<std::string, double> read_baseline(std::ifstream & file) {
+    std::map<std::string, double> out;
+    std::string name;
+    double seconds;
+    while (file >> name >> seconds) {
+        out[name] = seconds;
+    }
+    return out;
+}
+
+static void write_baseline(char const* path, std::map<std::string, double> const& times) {
+    std::ofstream file(path);
+    for (auto const& [name, seconds] : times) {
+        file << name << ' ' << fmt::format("{:.9f}", seconds) << '\n';
+    }
+}
+
+/// Renders every sample document through OverallSynth (with the default resampler)
+/// and reports throughput.
+///
+/// To catch speed regressions, set EXOTRACKER_BENCH_BASELINE to a file path.
+/// If the file doesn't exist, the timings are saved there.
+/// If it does, the benchmark fails when any document renders more than
+/// DEFAULT_REGRESSION_THRESHOLD (or EXOTRACKER_BENCH_THRESHOLD) slower
+/// than the saved timing.
+TEST_CASE("Benchmark rendering sample documents") {
+    constexpr uint32_t SMP_PER_S = 48000;
+    constexpr double SECONDS = double(RENDER_NSAMP) / 32000.;
+    constexpr auto NFRAME = size_t(SECONDS * SMP_PER_S);
+
+    std::vector<audio::Amplitude> buffer(NFRAME * STEREO_NCHAN);
+    std::map<std::string, double> times;
+
+    fmt::print("Render {} seconds at {} Hz:\n", SECONDS, SMP_PER_S);
+    for (auto const& [name, document] : sample_docs::DOCUMENTS) {
+        for (auto dsp_core : {audio::DspCore::ClockAccurate, audio::DspCore::SoaSimd}) {
+            auto render = [&] {
+                cmd_queue::CommandQueue commands;
+                commands.push(cmd_queue::PlayFrom{0});
+                OverallSynth synth{
+                    STEREO_NCHAN,
+                    SMP_PER_S,
+                    document.clone(),
+                    commands.receiver(),
+                    audio::AudioOptions{.dsp_core = dsp_core},
+                };
+                synth.synthesize_overall(buffer, NFRAME);
+                bench::do_not_optimize(buffer.data());
+            };
+
+            auto const key = fmt::format(
+                "{}/{}",
+                name,
+                dsp_core == audio::DspCore::ClockAccurate ? "SPC_DSP" : "SoaDsp");
+            // Take the fastest of several runs, to filter out noise from other processes.
+            double seconds = bench::time_per_call(render, 0.25);
+            for (int i = 0; i < 2; i++) {
+                seconds = std::min(seconds, bench::time_per_call(render, 0.25));
+            }
+            times[key] = seconds;
+
+            fmt::print("  {:<36} {:10.3f} ms {:10.1f}x realtime\n",
+                key, seconds * 1e3, SECONDS / seconds);
+        }
+    }
+
+    char const* baseline_path = std::getenv("EXOTRACKER_BENCH_BASELINE");
+    if (!baseline_path) {
+        return;
+    }
+    std::ifstream baseline_file(baseline_path);
+    if (!baseline_file) {
+        write_baseline(baseline_path, times);
+        fmt::print("Saved baseline to {}\n", baseline_path);
+        return;
+    }
+
+    double threshold = DEFAULT_REGRESSION_THRESHOLD;
+    if (char const* env = std::getenv("EXOTRACKER_BENCH_THRESHOLD")) {
+        threshold = std::atof(env);
+    }
+
+    auto const baseline = read_baseline(baseline_file);
+    for (auto const& [key, seconds] : times) {
+        CAPTURE(key);
+        auto it = baseline.find(key);
+        if (it == baseline.end()) {
+            continue;
+        }
+        CAPTURE(seconds);
+        CAPTURE(it->second);
+        CHECK(seconds <= it->second * (1. + threshold));
+    }
+}
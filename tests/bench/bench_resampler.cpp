@@ -0,0 +1,122 @@
+#include "bench_util.h"
+#include "audio/synth/polyphase.h"
+#include "audio/synth/upsample.h"
+#include "audio/tempo_calc.h"
+#include "util/release_assert.h"
+#include "util/simd.h"
+
+#include <samplerate.h>
+
+#include <random>
+#include <vector>
+
+#include <doctest.h>
+
+using namespace audio::synth;
+using audio::PolyphaseQuality;
+using audio::tempo_calc::SAMPLES_PER_S_IDEAL;
+using upsample::Mix;
+using upsample::OVERSAMPLING_FACTOR;
+
+/// Approximately one SPC timer period.
+constexpr size_t BLOCK = 160;
+/// One audio callback.
+constexpr size_t OUT_FRAMES = 1024;
+constexpr uint32_t OUT_RATE = 48000;
+
+static std::vector<SpcAmplitude> random_block() {
+    std::minstd_rand rng{1};
+    std::uniform_int_distribution<int> dist{-0x4000, 0x3fff};
+
+    std::vector<SpcAmplitude> out(BLOCK * STEREO_NCHAN);
+    for (auto & smp : out) {
+        smp = (SpcAmplitude) dist(rng);
+    }
+    return out;
+}
+
+/// The path used before PolyphaseResampler was added:
+/// 4x ZOH upsampling, followed by libsamplerate.
+struct LibsamplerateResampler {
+    SRC_STATE * state;
+    SRC_DATA args = {};
+    std::vector<float> upsampled;
+
+    LibsamplerateResampler(int quality) {
+        int error;
+        state = src_new(quality, STEREO_NCHAN, &error);
+        release_assert(state);
+        args.src_ratio = double(OUT_RATE) / (SAMPLES_PER_S_IDEAL * OVERSAMPLING_FACTOR);
+    }
+    ~LibsamplerateResampler() {
+        src_delete(state);
+    }
+
+    void resample(gsl::span<SpcAmplitude const> in, gsl::span<float> out) {
+        args.data_out = out.data();
+        args.output_frames = long(out.size() / STEREO_NCHAN);
+        while (args.output_frames > 0) {
+            if (args.input_frames == 0) {
+                upsample::upsample_zoh(in, upsampled, Mix::Overwrite);
+                args.data_in = upsampled.data();
+                args.input_frames = long(upsampled.size() / STEREO_NCHAN);
+            }
+            src_process(state, &args);
+            args.data_in += args.input_frames_used * STEREO_NCHAN;
+            args.input_frames -= args.input_frames_used;
+            args.data_out += args.output_frames_gen * STEREO_NCHAN;
+            args.output_frames -= args.output_frames_gen;
+        }
+    }
+};
+
+TEST_CASE("Benchmark resamplers") {
+    auto const block = random_block();
+    std::vector<float> out(OUT_FRAMES * STEREO_NCHAN);
+
+    fmt::print(
+        "Resampling {} Hz to {} Hz, {} output frames per call:\n",
+        SAMPLES_PER_S_IDEAL, OUT_RATE, OUT_FRAMES);
+
+    auto report = [&](std::string const& name, auto & fn) {
+        double seconds = bench::time_per_call(fn);
+        bench::print_result(name.c_str(), seconds, double(OUT_FRAMES), "frame");
+    };
+
+    {
+        LibsamplerateResampler src{SRC_SINC_FASTEST};
+        src.upsampled.resize(BLOCK * STEREO_NCHAN * OVERSAMPLING_FACTOR);
+        auto run = [&] {
+            src.resample(block, out);
+            bench::do_not_optimize(out.data());
+        };
+        report("ZOH + SRC_SINC_FASTEST (old)", run);
+    }
+
+    struct Tier {
+        char const* name;
+        PolyphaseQuality quality;
+    };
+    Tier const tiers[] = {
+        {"low", PolyphaseQuality::Low},
+        {"medium", PolyphaseQuality::Medium},
+        {"high", PolyphaseQuality::High},
+    };
+    for (auto const& tier : tiers) {
+        polyphase::PolyphaseResampler resampler{OUT_RATE, tier.quality, BLOCK};
+        auto generate_input = [&] {
+            resampler.write_input(block, Mix::Overwrite);
+        };
+        auto run = [&] {
+            resampler.resample(generate_input, out);
+            bench::do_not_optimize(out.data());
+        };
+        report(
+            fmt::format(
+                "polyphase {} ({} taps, {})",
+                tier.name,
+                polyphase::taps_per_phase(tier.quality),
+                util::simd::ISA_NAME),
+            run);
+    }
+}
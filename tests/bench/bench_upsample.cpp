@@ -0,0 +1,89 @@
+#include "bench_util.h"
+#include "audio/synth/upsample.h"
+
+#include <algorithm>  // std::fill
+#include <random>
+#include <string>
+#include <vector>
+
+#include <doctest.h>
+
+using namespace audio::synth;
+using namespace audio::synth::upsample;
+
+/// The loop in OverallSynth::synthesize_tick_oversampled()
+/// before upsample_zoh() was added: zero the buffer, then accumulate every chip.
+static void upsample_unfused(
+    gsl::span<SpcAmplitude const> in, std::vector<float> & out, bool first_chip
+) {
+    size_t const nframe = in.size() / STEREO_NCHAN;
+    if (first_chip) {
+        out.resize(nframe * STEREO_NCHAN * OVERSAMPLING_FACTOR);
+        std::fill(out.begin(), out.end(), 0.f);
+    }
+    for (size_t i = 0; i < nframe; i++) {
+        float in_left = in[i * STEREO_NCHAN + 0] / (1.0f * 0x8000);
+        float in_right = in[i * STEREO_NCHAN + 1] / (1.0f * 0x8000);
+
+        for (size_t j = 0; j < OVERSAMPLING_FACTOR; j++) {
+            out[(i * OVERSAMPLING_FACTOR + j) * STEREO_NCHAN + 0] += in_left;
+            out[(i * OVERSAMPLING_FACTOR + j) * STEREO_NCHAN + 1] += in_right;
+        }
+    }
+}
+
+TEST_CASE("Benchmark ZOH upsampling and chip mixing") {
+    // A typical timer period (at ~200 Hz) produces ~160 SPC samples.
+    // Use a larger block to get stable timings.
+    constexpr size_t NFRAME = 1024;
+
+    std::minstd_rand rng{1};
+    std::uniform_int_distribution<int> dist{-0x8000, 0x7fff};
+
+    size_t const nchips[] = {1, 2, 4};
+    for (size_t nchip : nchips) {
+        std::vector<std::vector<SpcAmplitude>> chips(nchip);
+        for (auto & chip : chips) {
+            chip.resize(NFRAME * STEREO_NCHAN);
+            for (auto & smp : chip) {
+                smp = (SpcAmplitude) dist(rng);
+            }
+        }
+
+        std::vector<float> unfused;
+        std::vector<float> scalar(NFRAME * STEREO_NCHAN * OVERSAMPLING_FACTOR);
+        std::vector<float> simd(scalar.size());
+
+        auto run_unfused = [&] {
+            for (size_t c = 0; c < nchip; c++) {
+                upsample_unfused(chips[c], unfused, c == 0);
+            }
+            bench::do_not_optimize(unfused.data());
+        };
+        auto run_scalar = [&] {
+            for (size_t c = 0; c < nchip; c++) {
+                auto mix = c ? Mix::Accumulate : Mix::Overwrite;
+                upsample_zoh_scalar(chips[c], scalar, mix);
+            }
+            bench::do_not_optimize(scalar.data());
+        };
+        auto run_simd = [&] {
+            for (size_t c = 0; c < nchip; c++) {
+                upsample_zoh(chips[c], simd, c ? Mix::Accumulate : Mix::Overwrite);
+            }
+            bench::do_not_optimize(simd.data());
+        };
+
+        fmt::print("ZOH upsampling, {} chip(s), {} frames:\n", nchip, NFRAME);
+        auto report = [&](std::string const& name, auto & fn) {
+            double seconds = bench::time_per_call(fn);
+            bench::print_result(name.c_str(), seconds, double(NFRAME * nchip), "frame");
+        };
+        report("fill + accumulate (old)", run_unfused);
+        report("fused scalar", run_scalar);
+        report(fmt::format("fused {}", upsample_zoh_isa()), run_simd);
+
+        CHECK(scalar == unfused);
+        CHECK(simd == unfused);
+    }
+}
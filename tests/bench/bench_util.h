@@ -0,0 +1,50 @@
+#pragma once
+
+// Helpers for exotracker-bench. Benchmarks are doctest test cases
+// which print timings, and check that optimized code matches reference code.
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace bench {
+
+/// Prevents the compiler from optimizing away a computed value.
+template<typename T>
+inline void do_not_optimize(T const& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    // Leak the value's address, so the compiler can't prove it's unused.
+    static void const* volatile sink;
+    sink = &value;
+#endif
+}
+
+/// Runs `fn` repeatedly for at least `min_seconds`,
+/// and returns the average wall-clock seconds per call.
+template<typename Fn>
+double time_per_call(Fn && fn, double min_seconds = 0.5) {
+    using Clock = std::chrono::steady_clock;
+
+    // Warm up caches and branch predictors.
+    fn();
+
+    uint64_t ncall = 0;
+    auto const begin = Clock::now();
+    double elapsed;
+    do {
+        fn();
+        ncall++;
+        elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    } while (elapsed < min_seconds);
+
+    return elapsed / double(ncall);
+}
+
+inline void print_result(char const* name, double seconds, double items, char const* unit) {
+    fmt::print("  {:<36} {:10.3f} ns/{}\n", name, seconds / items * 1e9, unit);
+}
+
+}
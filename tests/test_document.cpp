@@ -1,6 +1,7 @@
 #include "doc.h"
 #include "doc_util/event_search.h"
 #include "doc_util/event_builder.h"
+#include "sample_docs.h"
 
 #include <fmt/core.h>
 
@@ -73,3 +74,35 @@ TEST_CASE ("Test that EventList and KV search is implemented properly.") {
         CHECK(&added == &events[0]);
     }
 }
+
+TEST_CASE("Cloning a document shares sample data and patterns") {
+    auto const& orig = sample_docs::DOCUMENTS.at("dream-fragments");
+    doc::Document copy = orig.clone();
+    CHECK(copy == orig);
+
+    size_t nsample = 0;
+    for (size_t i = 0; i < doc::MAX_SAMPLES; i++) {
+        if (orig.samples[i] && !orig.samples[i]->brr.empty()) {
+            CHECK(copy.samples[i]->brr.shares_with(orig.samples[i]->brr));
+            nsample++;
+        }
+    }
+    REQUIRE(nsample > 0);
+
+    auto const& orig_block = orig.sequence[0][0].blocks[0];
+    auto & copy_block = copy.sequence[0][0].blocks[0];
+    CHECK(copy_block.pattern.shares_with(orig_block.pattern));
+
+    SUBCASE("Editing a clone's sample data does not affect the original") {
+        size_t i = 0;
+        while (!orig.samples[i] || orig.samples[i]->brr.empty()) {
+            i++;
+        }
+        auto const orig_brr = orig.samples[i]->brr;
+        copy.samples[i]->brr.mut()[0] ^= 0xff;
+
+        CHECK(!copy.samples[i]->brr.shares_with(orig.samples[i]->brr));
+        CHECK(orig.samples[i]->brr.shares_with(orig_brr));
+        CHECK(copy.samples[i]->brr[0] != orig.samples[i]->brr[0]);
+    }
+}
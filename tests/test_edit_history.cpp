@@ -1,6 +1,8 @@
 #include "gui/history.h"
 #include "gui/cursor.h"
 #include "edit/edit_pattern.h"
+#include "edit/edit_instr_list.h"
+#include "edit/modified.h"
 #include "doc.h"
 #include "chip_common.h"
 #include "timing_common.h"
@@ -194,4 +196,212 @@ TEST_CASE("Check that undo and redo work") {
     CHECK_FALSE(h.can_redo());
 }
 
+
+/// Returns a copy of the document which shares no pattern bodies with `document`.
+doc::Document deep_copy_patterns(doc::Document const& document) {
+    auto out = document.clone();
+    for (auto & chip : out.sequence) {
+        for (auto & track : chip) {
+            for (auto & block : track.blocks) {
+                block.pattern = doc::Pattern(*block.pattern);
+            }
+        }
+    }
+    return out;
+}
+
+TEST_CASE("Single-cell edits swap events in place on GUI and audio documents") {
+    auto h = History(sample_docs::DOCUMENTS.at("dream-fragments").clone());
+    // Shares pattern bodies with the GUI document, like after restarting audio.
+    auto audio_doc = h.get_document().clone();
+    auto const before = deep_copy_patterns(h.get_document());
+
+    auto const& block = get_track(h.get_document()).blocks[0];
+    auto const& audio_block = get_track(audio_doc).blocks[0];
+    REQUIRE(block.pattern->length_ticks > 1);
+
+    // Send the edit to the audio thread before applying it, like MainWindow.
+    auto push = [&](EditBox edit) {
+        edit->clone_for_audio(h.get_document())->apply_swap(audio_doc);
+        h.push(UndoFrame{std::move(edit), Cursor{}, Cursor{}});
+        CHECK(audio_doc == h.get_document());
+    };
+
+    // Editing a shared pattern copies it, on both the GUI and audio threads.
+    push(ep::insert_note(h.get_document(), 0, 0, 1, ExtendBlock::Never, 60, {}));
+    CHECK(!block.pattern.shares_with(audio_block.pattern));
+    CHECK(h.get_document() != before);
+    auto const orig = deep_copy_patterns(sample_docs::DOCUMENTS.at("dream-fragments"));
+    CHECK(orig == before);
+
+    // Afterwards, edits modify both copies in place.
+    auto const* gui_body = block.pattern.get();
+    auto const* audio_body = audio_block.pattern.get();
+    push(ep::add_effect_char(
+        h.get_document(), 0, 0, 1, ExtendBlock::Never,
+        sc::Effect{0}, ep::EffectAction_::Replace("0G")));
+    push(ep::insert_note(h.get_document(), 0, 0, 2, ExtendBlock::Never, 62, {}));
+    push(ep::delete_cell(h.get_document(), 0, 0, sc::Note{}, 2));
+    CHECK(block.pattern.get() == gui_body);
+    CHECK(audio_block.pattern.get() == audio_body);
+
+    // Undo all edits, then redo them.
+    for (int i = 0; i < 4; i++) {
+        auto undo = h.try_undo();
+        REQUIRE(undo.has_value());
+        undo->edit->apply_swap(audio_doc);
+        CHECK(audio_doc == h.get_document());
+    }
+    CHECK(h.get_document() == before);
+    for (int i = 0; i < 4; i++) {
+        auto redo = h.try_redo();
+        REQUIRE(redo.has_value());
+        redo->edit->apply_swap(audio_doc);
+        CHECK(audio_doc == h.get_document());
+    }
+    CHECK(block.pattern.get() == gui_body);
+    CHECK(audio_block.pattern.get() == audio_body);
+}
+
+TEST_CASE("Editing a shared pattern only changes the edited block") {
+    doc::Document document = sample_docs::new_document();
+    auto & blocks = document.sequence[0][0].blocks;
+    blocks.clear();
+
+    doc::SharedPattern const shared = doc::Pattern{
+        .length_ticks = 48,
+        .events = {{0, doc::RowEvent{60, 0}}},
+    };
+    blocks.push_back(doc::TrackBlock{.begin_tick = 0, .pattern = shared});
+    blocks.push_back(doc::TrackBlock{.begin_tick = 48, .pattern = shared});
+    blocks.push_back(doc::TrackBlock{.begin_tick = 96, .pattern = shared});
+    document.update_extent();
+
+    auto h = History(std::move(document));
+    auto const& track = get_track(h.get_document());
+
+    // Swapping instruments copies the shared pattern once,
+    // and the blocks still share the copy.
+    h.push(UndoFrame{edit::edit_instr_list::swap_instruments(0, 1), {}, {}});
+    CHECK(track.blocks[0].pattern->events[0].v.instr == 1);
+    CHECK(track.blocks[0].pattern.shares_with(track.blocks[2].pattern));
+    CHECK(shared->events[0].v.instr == 0);
+
+    // Editing a block copies its pattern, leaving other blocks unchanged.
+    h.push(UndoFrame{
+        ep::insert_note(h.get_document(), 0, 0, 48, ExtendBlock::Never, 62, {}),
+        Cursor{},
+        Cursor{},
+    });
+    CHECK(track.blocks[1].pattern->events[0].v.note == 62);
+    CHECK(track.blocks[0].pattern->events[0].v.note == 60);
+    CHECK(track.blocks[2].pattern->events[0].v.note == 60);
+    CHECK(track.blocks[0].pattern.shares_with(track.blocks[2].pattern));
+
+    CHECK(h.try_undo().has_value());
+    CHECK(h.try_undo().has_value());
+    CHECK(track.blocks[1].pattern->events[0].v == doc::RowEvent{60, 0});
+}
+
+TEST_CASE("History discards the oldest undo steps beyond its memory limit") {
+    auto const& orig = sample_docs::DOCUMENTS.at("dream-fragments");
+    auto push_notes = [](History & h) {
+        for (int i = 0; i < 10; i++) {
+            h.push(UndoFrame{
+                ep::insert_note(
+                    h.get_document(),
+                    0, 0, 1, ExtendBlock::Never, doc::NoteInt(60 + i), {}
+                ),
+                Cursor{},
+                Cursor{},
+            });
+        }
+    };
+    auto count_undo = [](History & h) {
+        int n = 0;
+        while (h.try_undo()) {
+            n++;
+        }
+        return n;
+    };
+
+    // By default, history is unbounded.
+    auto h = History(orig.clone());
+    CHECK(h.memory_usage() == 0);
+    push_notes(h);
+    size_t const total = h.memory_usage();
+    CHECK(total > 0);
+
+    // Undoing moves steps (and their memory) to the redo stack.
+    CHECK(h.try_undo().has_value());
+    CHECK(h.try_undo().has_value());
+    CHECK(h.memory_usage() > 0);
+
+    // Lowering the limit discards the oldest undo and redo steps,
+    // but keeps the newest of each.
+    h.set_memory_limit(0);
+    CHECK(h.memory_usage() > 0);
+    CHECK(h.memory_usage() < total);
+    CHECK(h.try_redo().has_value());
+    CHECK(!h.can_redo());
+    CHECK(count_undo(h) == 1);
+    CHECK(h.get_document() != orig);
+
+    // Pushing edits past the limit discards older steps.
+    auto bounded = History(orig.clone(), total / 2);
+    push_notes(bounded);
+    CHECK(bounded.memory_usage() <= total / 2);
+    int const nundo = count_undo(bounded);
+    CHECK(nundo > 1);
+    CHECK(nundo < 10);
+    CHECK(bounded.memory_usage() <= total / 2);
+    CHECK(bounded.get_document() != orig);
+}
+
+
+TEST_CASE("Check that pattern edits update the cached song length") {
+    auto h = History(sample_docs::new_document());
+    TickT const begin_len = h.get_document().extent.song_length;
+    REQUIRE(begin_len > 0);
+
+    // Creating a block past the end of the song extends the song.
+    h.push(UndoFrame{
+        ep::insert_note(
+            h.get_document(), 0, 1, 2 * begin_len, ExtendBlock::Always, 60, {}
+        ),
+        Cursor{},
+        Cursor{},
+    });
+    {
+        auto const& extent = h.get_document().extent;
+        // Cloning a document recomputes its extent from scratch.
+        auto const fresh = h.get_document().clone();
+        CHECK(extent.song_length > 2 * begin_len);
+        CHECK(extent.song_length == fresh.extent.song_length);
+    }
+
+    // Undoing the edit shrinks it again.
+    CHECK(h.try_undo().has_value());
+    CHECK(h.get_document().extent.song_length == begin_len);
+}
+
+
+TEST_CASE("Pattern edits report which channel they modified") {
+    auto document = sample_docs::new_document();
+    TickT const time = document.extent.song_length + 48;
+
+    auto edit = ep::insert_note(document, 0, 1, time, ExtendBlock::Always, 60, {});
+    CHECK(edit->modified() == edit::ModifiedFlags::Patterns);
+
+    for (int undo = 0; undo < 2; undo++) {
+        CAPTURE(undo);
+        edit->apply_swap(document);
+        auto const scope = edit->modified_scope();
+        REQUIRE(scope.channel);
+        CHECK(scope.channel->chip == 0);
+        CHECK(scope.channel->channel == 1);
+        CHECK(scope.channel->begin_tick <= time - doc::MAX_TICK_OFFSET);
+    }
+}
+
 }
@@ -0,0 +1,70 @@
+#include "golden_audio.h"
+#include "audio/synth.h"
+#include "cmd_queue.h"
+
+namespace test_utils::golden_audio {
+
+using audio::synth::OverallSynth;
+using audio::synth::STEREO_NCHAN;
+
+std::vector<SpcAmplitude> render_raw(
+    doc::Document const& document, audio::DspCore dsp_core, NsampT nsamp
+) {
+    cmd_queue::CommandQueue commands;
+    commands.push(cmd_queue::PlayFrom{0});
+
+    OverallSynth synth{
+        STEREO_NCHAN,
+        // Unused, since synthesize_tick_raw() doesn't resample.
+        48000,
+        document.clone(),
+        commands.receiver(),
+        audio::AudioOptions{.dsp_core = dsp_core},
+    };
+
+    std::vector<SpcAmplitude> out;
+    out.reserve((nsamp + 1024) * STEREO_NCHAN);
+    while (out.size() < nsamp * STEREO_NCHAN) {
+        synth.synthesize_tick_raw(out);
+    }
+    out.resize(nsamp * STEREO_NCHAN);
+    return out;
+}
+
+std::vector<audio::Amplitude> render_resampled(
+    doc::Document const& document,
+    audio::AudioOptions const& options,
+    uint32_t smp_per_s,
+    size_t nframe
+) {
+    cmd_queue::CommandQueue commands;
+    commands.push(cmd_queue::PlayFrom{0});
+
+    OverallSynth synth{
+        STEREO_NCHAN,
+        smp_per_s,
+        document.clone(),
+        commands.receiver(),
+        options,
+    };
+
+    std::vector<audio::Amplitude> out(nframe * STEREO_NCHAN);
+    synth.synthesize_overall(out, nframe);
+    return out;
+}
+
+uint64_t hash_audio(gsl::span<SpcAmplitude const> audio) {
+    uint64_t hash = 0xcbf29ce484222325;
+    auto hash_byte = [&hash](uint8_t byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3;
+    };
+    for (SpcAmplitude const smp : audio) {
+        auto const bits = (uint16_t) smp;
+        hash_byte(uint8_t(bits));
+        hash_byte(uint8_t(bits >> 8));
+    }
+    return hash;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/// Renders sample_docs for golden-audio regression tests (tests/audio/test_golden.cpp)
+/// and throughput benchmarks (tests/bench/bench_golden.cpp).
+
+#include "audio/audio_common.h"
+#include "audio/synth_common.h"
+#include "doc.h"
+
+#include <gsl/span>
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <vector>
+
+namespace test_utils::golden_audio {
+
+using audio::synth::NsampT;
+using audio::synth::SpcAmplitude;
+
+/// 20 seconds at the S-DSP's 32 kHz sampling rate.
+constexpr NsampT RENDER_NSAMP = 20 * 32000;
+
+/// Plays `document` from the beginning through OverallSynth,
+/// and returns the first `nsamp` stereo frames of raw (not resampled) S-DSP output.
+std::vector<SpcAmplitude> render_raw(
+    doc::Document const& document, audio::DspCore dsp_core, NsampT nsamp
+);
+
+/// Plays `document` from the beginning through OverallSynth::synthesize_overall()
+/// (including upsampling, mixing, and resampling), and returns the first `nframe`
+/// stereo frames at `smp_per_s`.
+std::vector<audio::Amplitude> render_resampled(
+    doc::Document const& document,
+    audio::AudioOptions const& options,
+    uint32_t smp_per_s,
+    size_t nframe
+);
+
+/// 64-bit FNV-1a hash of the samples' little-endian bytes,
+/// so hashes are identical on every platform.
+uint64_t hash_audio(gsl::span<SpcAmplitude const> audio);
+
+}